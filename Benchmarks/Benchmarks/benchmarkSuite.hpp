@@ -0,0 +1,393 @@
+#ifndef _BENCHMARKSUITE_HPP_
+#define _BENCHMARKSUITE_HPP_
+
+
+
+////////////////////////
+// STL
+////////////////////////
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <ctime>
+
+////////////////////////
+// UTILITIES
+////////////////////////
+#include "stopWatch.hpp"
+
+
+/**
+* \file benchmarkSuite.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup UTILITIES */
+/*@{*/
+
+
+/*!
+*  \brief Result of one benchmark \n
+*		times are per iteration, in seconds
+*/
+struct BenchmarkResult
+{
+	std::string name;
+	std::string unit; /**< throughput unit: "MB/s", "verts/s", "draws/s", ... */
+	double itemsPerIteration = 0.0; /**< work done by one iteration, in unit (MB for MB/s) */
+	size_t iterations = 0; /**< total number of timed iterations */
+	double minTime = 0.0;
+	double medianTime = 0.0;
+	double meanTime = 0.0;
+	bool skipped = false;
+	std::string note; /**< why it was skipped */
+
+	//! throughput of the median iteration
+	double throughput() const { return medianTime > 0.0 ? itemsPerIteration / medianTime : 0.0; }
+};
+
+/*!
+*  \brief Result of one check: a property of the code under benchmark (bounds, conservativeness, ...)
+*/
+struct CheckResult
+{
+	std::string name;
+	bool passed = false;
+	std::string detail; /**< measured values */
+};
+
+
+/*!
+*  \brief Benchmark Suite: \n
+*		Runs benchmarks one after the other, prints a table and writes the results as JSON \n
+*		Each benchmark is a functor doing one iteration of the measured work. Iterations are timed in batches, \n
+*		large enough for the clock resolution, until both MIN_SAMPLES batches and minTime seconds are reached: \n
+*		min, median and mean are taken over the batches
+*
+*	\code{.cpp}
+*		BenchmarkSuite suite("obj");
+*		suite.run("parser/loadOBJ", "MB/s", fileSize / 1e6, [&]() { parser::loadOBJ(model, &obj); });
+*		suite.setFence([]() { glFinish(); }); // GL benchmarks: wait for the driver at the end of each batch
+*		suite.run("material/bindMaterial", "draws/s", 1.0, [&]() { material.bindMaterial(); });
+*		suite.check("occlusion/check/partly_hidden", occlusion.isVisible(boundsMin, boundsMax));
+*		suite.writeJSON("benchmarks.json");
+*		return suite.getFailedCount() == 0 ? 0 : 1;
+*	\endcode
+*
+*	\note the JSON layout follows Google Benchmark's (context + benchmarks array, real_time in ns, \n
+*		bytes_per_second/items_per_second), with the throughput unit and a checks array added
+*/
+class BenchmarkSuite
+{
+public:
+	//! minimal number of timed batches per benchmark
+	static const size_t MIN_SAMPLES = 10;
+	//! maximal number of timed batches per benchmark
+	static const size_t MAX_SAMPLES = 1000;
+
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Constructor
+	* \param const std::string filter : only benchmarks whose name contains filter are run (empty => all)
+	* \param double minTime : minimal time spent timing each benchmark (seconds)
+	*/
+	explicit BenchmarkSuite(const std::string filter = "", double minTime = 0.5) : filter(filter), minTime(minTime)
+	{}
+
+	///////////////////////////////////////////
+	//	SETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Sets the call closing every timed batch (e.g. glFinish, so that GL work is not left queued in the driver)
+	*/
+	void setFence(std::function<void()> fence)
+	{
+		this->fence = fence;
+	}
+
+	/*!
+	*  \brief Adds a key/value pair to the JSON context (model, GL renderer, ...)
+	*/
+	void setContext(const std::string key, const std::string value)
+	{
+		context.push_back(std::make_pair(key, value));
+	}
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Checks the filter
+	*/
+	bool isEnabled(const std::string name) const
+	{
+		return filter.empty() || name.find(filter) != std::string::npos;
+	}
+
+	/*!
+	*  \brief Times a benchmark
+	*
+	* \param const std::string name : benchmark name ("group/case")
+	* \param const std::string unit : throughput unit
+	* \param double itemsPerIteration : work done by one call to f, in unit
+	* \param F f : one iteration
+	* \return appends and prints the result (nothing if filtered out)
+	*/
+	template<typename F>
+	void run(const std::string name, const std::string unit, double itemsPerIteration, F f)
+	{
+		if (!isEnabled(name))
+			return;
+
+		BenchmarkResult result;
+		result.name = name;
+		result.unit = unit;
+		result.itemsPerIteration = itemsPerIteration;
+
+		// warm up (caches, lazy allocations, driver), then grow the batch until it is well above the clock resolution
+		f();
+		sync();
+		size_t batchSize = 1;
+		double batchTime = timeBatch(f, batchSize);
+		while (batchTime < 1e-3 && batchSize < (1 << 20))
+		{
+			batchSize *= batchTime > 0.0 ? std::max<size_t>(2, std::min<size_t>(10, static_cast<size_t>(2e-3 / batchTime))) : 10;
+			batchTime = timeBatch(f, batchSize);
+		}
+
+		std::vector<double> samples;
+		double total = 0.0;
+		while (samples.size() < MAX_SAMPLES && (samples.size() < MIN_SAMPLES || total < minTime))
+		{
+			const double seconds = timeBatch(f, batchSize);
+			samples.push_back(seconds / batchSize);
+			total += seconds;
+		}
+
+		std::sort(samples.begin(), samples.end());
+		result.iterations = samples.size() * batchSize;
+		result.minTime = samples.front();
+		result.medianTime = samples[samples.size() / 2];
+		for (size_t i = 0; i < samples.size(); ++i)
+			result.meanTime += samples[i];
+		result.meanTime /= samples.size();
+
+		results.push_back(result);
+		print(result);
+	}
+
+	/*!
+	*  \brief Records a benchmark that could not run (e.g. no OpenGL context, missing resource)
+	*/
+	void skip(const std::string name, const std::string note)
+	{
+		if (!isEnabled(name))
+			return;
+
+		BenchmarkResult result;
+		result.name = name;
+		result.skipped = true;
+		result.note = note;
+		results.push_back(result);
+		std::cout << std::left << std::setw(48) << name << "skipped: " << note << std::endl;
+	}
+
+	/*!
+	*  \brief Records a check: printed along the benchmarks, written to the JSON, counted by getFailedCount
+	*
+	* \param const std::string name : check name ("group/check/case")
+	* \param bool passed : result
+	* \param const std::string detail : measured values, printed either way
+	* \return passed (true if filtered out)
+	*/
+	bool check(const std::string name, bool passed, const std::string detail = "")
+	{
+		if (!isEnabled(name))
+			return true;
+
+		CheckResult result;
+		result.name = name;
+		result.passed = passed;
+		result.detail = detail;
+		checks.push_back(result);
+		std::cout << std::left << std::setw(48) << name << (passed ? "ok" : "FAILED") << (detail.empty() ? "" : ": ") << detail << std::endl;
+		return passed;
+	}
+
+	/*!
+	*  \brief Returns the results in run order
+	*/
+	const std::vector<BenchmarkResult> & getResults() const
+	{
+		return results;
+	}
+	/*!
+	*  \brief Returns the number of failed checks
+	*/
+	size_t getFailedCount() const
+	{
+		size_t failed = 0;
+		for (size_t i = 0; i < checks.size(); ++i)
+			failed += checks[i].passed ? 0 : 1;
+		return failed;
+	}
+
+	/*!
+	*  \brief Writes the context and the results as JSON
+	* \param std::ostream & os : output stream
+	*/
+	void writeJSON(std::ostream & os) const
+	{
+		char date[64] = { 0 };
+		const std::time_t now = std::time(NULL);
+		std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+		os << "{" << std::endl;
+		os << "  \"context\": {" << std::endl;
+		os << "    \"date\": \"" << date << "\"," << std::endl;
+		os << "    \"num_cpus\": " << std::thread::hardware_concurrency() << "," << std::endl;
+#ifdef NDEBUG
+		os << "    \"library_build_type\": \"release\"";
+#else
+		os << "    \"library_build_type\": \"debug\"";
+#endif
+		for (size_t i = 0; i < context.size(); ++i)
+			os << "," << std::endl << "    \"" << escape(context[i].first) << "\": \"" << escape(context[i].second) << "\"";
+		os << std::endl << "  }," << std::endl;
+
+		os << "  \"benchmarks\": [";
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const BenchmarkResult & r = results[i];
+			os << (i == 0 ? "" : ",") << std::endl << "    {" << std::endl;
+			os << "      \"name\": \"" << escape(r.name) << "\"," << std::endl;
+			if (r.skipped)
+			{
+				os << "      \"skipped\": true," << std::endl;
+				os << "      \"note\": \"" << escape(r.note) << "\"" << std::endl;
+			}
+			else
+			{
+				const double throughput = r.throughput();
+				os << std::setprecision(9);
+				os << "      \"run_type\": \"iteration\"," << std::endl;
+				os << "      \"iterations\": " << r.iterations << "," << std::endl;
+				os << "      \"real_time\": " << r.medianTime * 1e9 << "," << std::endl;
+				os << "      \"min_time\": " << r.minTime * 1e9 << "," << std::endl;
+				os << "      \"mean_time\": " << r.meanTime * 1e9 << "," << std::endl;
+				os << "      \"time_unit\": \"ns\"," << std::endl;
+				if (r.unit == "MB/s")
+					os << "      \"bytes_per_second\": " << throughput * 1e6 << "," << std::endl;
+				else
+					os << "      \"items_per_second\": " << throughput << "," << std::endl;
+				os << "      \"throughput\": " << throughput << "," << std::endl;
+				os << "      \"unit\": \"" << escape(r.unit) << "\"" << std::endl;
+			}
+			os << "    }";
+		}
+		os << std::endl << "  ]," << std::endl;
+
+		os << "  \"checks\": [";
+		for (size_t i = 0; i < checks.size(); ++i)
+		{
+			const CheckResult & c = checks[i];
+			os << (i == 0 ? "" : ",") << std::endl << "    { \"name\": \"" << escape(c.name) << "\", \"passed\": " << (c.passed ? "true" : "false")
+				<< ", \"detail\": \"" << escape(c.detail) << "\" }";
+		}
+		os << std::endl << "  ]" << std::endl << "}" << std::endl;
+	}
+
+	/*!
+	*  \brief Writes the results as JSON to a file
+	* \return false if the file could not be written
+	*/
+	bool writeJSON(const std::string path) const
+	{
+		std::ofstream file(path.c_str());
+		if (!file)
+		{
+			std::cout << "ERROR::BENCHMARK::FILE_NOT_WRITTEN: " << path << std::endl;
+			return false;
+		}
+		writeJSON(file);
+		return true;
+	}
+
+
+private:
+	std::string filter;
+	double minTime;
+	std::function<void()> fence;
+	std::vector<std::pair<std::string, std::string> > context;
+	std::vector<BenchmarkResult> results;
+	std::vector<CheckResult> checks;
+
+	void sync()
+	{
+		if (fence)
+			fence();
+	}
+
+	/*!
+	*  \brief Wall time of batchSize iterations, fence included
+	*/
+	template<typename F>
+	double timeBatch(F & f, size_t batchSize)
+	{
+		stopWatch timer;
+		timer.start();
+		for (size_t i = 0; i < batchSize; ++i)
+			f();
+		sync();
+		return timer.end();
+	}
+
+	static void print(const BenchmarkResult & r)
+	{
+		std::ostringstream time;
+		if (r.medianTime >= 1e-3)
+			time << std::fixed << std::setprecision(3) << r.medianTime * 1e3 << " ms";
+		else
+			time << std::fixed << std::setprecision(3) << r.medianTime * 1e6 << " us";
+
+		const double throughput = r.throughput();
+		std::ostringstream rate;
+		if (r.unit != "MB/s" && throughput >= 1e6)
+			rate << std::fixed << std::setprecision(2) << throughput / 1e6 << " M" << r.unit;
+		else
+			rate << std::fixed << std::setprecision(2) << throughput << " " << r.unit;
+
+		std::cout << std::left << std::setw(48) << r.name
+			<< std::right << std::setw(14) << time.str()
+			<< std::setw(20) << rate.str()
+			<< std::setw(12) << r.iterations << " it" << std::endl;
+	}
+
+	static std::string escape(const std::string s)
+	{
+		std::string escaped;
+		for (size_t i = 0; i < s.size(); ++i)
+		{
+			if (s[i] == '"' || s[i] == '\\')
+				escaped += '\\';
+			escaped += s[i];
+		}
+		return escaped;
+	}
+};
+
+/*@}*/
+
+
+
+
+#endif // _BENCHMARKSUITE_HPP_
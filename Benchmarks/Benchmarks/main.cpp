@@ -0,0 +1,886 @@
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL\glew.h>
+
+////////////////////////
+// GLFW
+////////////////////////
+#include <GLFW\glfw3.h>
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+#include <glm\gtc\constants.hpp>
+
+////////////////////////
+// OpenGL Engine
+////////////////////////
+#include <OpenGLEngine\parser.hpp> // memory-mapped .obj parser
+#include <OpenGLEngine\modelGeometry.hpp> // Vertex, Geometry
+#include <OpenGLEngine\tangentSpace.hpp> // tangent frame generation
+#include <OpenGLEngine\windowInterface.hpp> // hidden window, for the OpenGL context
+#include <OpenGLEngine\cameraInterface.hpp>
+#include <OpenGLEngine\shaderInterface.hpp>
+#include <OpenGLEngine\shaderPermutations.hpp>
+#include <OpenGLEngine\sampleTables.hpp>
+#include <OpenGLEngine\frameBuffer.hpp>
+#include <OpenGLEngine\gpuProfiler.hpp>
+#include <OpenGLEngine\uniformInterface.hpp>
+#include <OpenGLEngine\textureInterface.hpp> // IBL spherical harmonics
+#include <OpenGLEngine\modelMaterial.hpp>
+#include <OpenGLEngine\compiledMaterial.hpp>
+#include <OpenGLEngine\glState.hpp>
+#include <OpenGLEngine\jobSystem.hpp>
+#include <OpenGLEngine\occlusionCulling.hpp>
+#include <OpenGLEngine\sceneRenderer.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+////////////////////////
+// UTILITIES
+////////////////////////
+#include "stopWatch.hpp"
+#include "benchmarkSuite.hpp"
+
+
+
+////////////////////////
+// Engine microbenchmarks
+//	usage: Benchmarks.exe [model.obj] [--json=file] [--filter=name] [--no-gl]
+//		--json : results file (default: benchmarks.json)
+//		--filter : only runs the benchmarks whose name contains it
+//		--no-gl : CPU benchmarks only (no window, no OpenGL context)
+//	Resources (shaders, models, cubemap) are read from the PBR_IBL demo
+////////////////////////
+const std::string DEMO_PATH = "../../PBR_IBL/PBR_IBL/";
+const std::string DEFAULT_MODEL = DEMO_PATH + "Resources/Models/clumsy-dragon.obj";
+const std::string CUBEMAP_PATH = DEMO_PATH + "Resources/Textures/Langholmen2/";
+const std::string DEFAULT_JSON = "benchmarks.json";
+
+
+////////////////////////
+// Input meshes
+////////////////////////
+/*!
+*  \brief Expands a parsed .obj into a triangle soup (three consecutive vertices per face)
+*/
+void buildSoup(const OpenGLEngine::parser::OBJData & obj, std::vector<OpenGLEngine::Vertex> * soup)
+{
+	soup->resize(obj.corners.size());
+	for (size_t i = 0; i < obj.corners.size(); ++i)
+	{
+		const OpenGLEngine::parser::OBJCorner & corner = obj.corners[i];
+		OpenGLEngine::Vertex & vertex = (*soup)[i];
+		vertex.Position = corner.position >= 0 ? obj.positions[corner.position] : glm::vec3(0.0f);
+		vertex.Normal = corner.normal >= 0 ? obj.normals[corner.normal] : glm::vec3(0.0f, 1.0f, 0.0f);
+		vertex.TexCoords = corner.uv >= 0 ? obj.uvs[corner.uv] : glm::vec2(0.0f);
+		vertex.Tangeant = vertex.BiTangeant = glm::vec3(0.0f);
+	}
+}
+
+/*!
+*  \brief Spherical projection around the bounding box center, for models without texture coordinates \n
+*		(otherwise every face is degenerate and only the generator's fallback path is measured)
+*/
+void projectTexCoords(std::vector<OpenGLEngine::Vertex> * vertices)
+{
+	glm::vec3 boundsMin(1e30f), boundsMax(-1e30f);
+	for (size_t i = 0; i < vertices->size(); ++i)
+	{
+		boundsMin = glm::min(boundsMin, (*vertices)[i].Position);
+		boundsMax = glm::max(boundsMax, (*vertices)[i].Position);
+	}
+	const glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+	for (size_t i = 0; i < vertices->size(); ++i)
+	{
+		const glm::vec3 d = (*vertices)[i].Position - center;
+		const float length = glm::length(d);
+		(*vertices)[i].TexCoords = glm::vec2(0.5f + std::atan2(d.z, d.x) / (2.0f * glm::pi<float>()),
+			0.5f + (length > 0.0f ? std::asin(glm::clamp(d.y / length, -1.0f, 1.0f)) : 0.0f) / glm::pi<float>());
+	}
+}
+
+/*!
+*  \brief Welds the soup on its (position, uv, normal) .obj indices
+*/
+void buildIndexed(const OpenGLEngine::parser::OBJData & obj, const std::vector<OpenGLEngine::Vertex> & soup,
+	std::vector<OpenGLEngine::Vertex> * vertices, std::vector<unsigned int> * indices)
+{
+	std::unordered_map<unsigned long long, unsigned int> unique;
+	vertices->clear();
+	indices->resize(soup.size());
+	for (size_t i = 0; i < soup.size(); ++i)
+	{
+		const OpenGLEngine::parser::OBJCorner & corner = obj.corners[i];
+		const unsigned long long key = (static_cast<unsigned long long>(corner.position + 1) << 42) ^
+			(static_cast<unsigned long long>(corner.uv + 1) << 21) ^ static_cast<unsigned long long>(corner.normal + 1);
+		std::pair<std::unordered_map<unsigned long long, unsigned int>::iterator, bool> inserted =
+			unique.insert(std::make_pair(key, static_cast<unsigned int>(vertices->size())));
+		if (inserted.second)
+			vertices->push_back(soup[i]);
+		(*indices)[i] = inserted.first->second;
+	}
+}
+
+
+////////////////////////
+// Reference: scalar Lengyel's method on the triangle soup, one vertex at a time
+//	(the tangent generation used before tangentSpace)
+////////////////////////
+void referenceTangents(std::vector<OpenGLEngine::Vertex> * vertices)
+{
+	for (size_t f = 0; f + 2 < vertices->size(); f += 3)
+	{
+		OpenGLEngine::Vertex * v = &(*vertices)[f];
+		const glm::vec3 e1 = v[1].Position - v[0].Position;
+		const glm::vec3 e2 = v[2].Position - v[0].Position;
+		const glm::vec2 d1 = v[1].TexCoords - v[0].TexCoords;
+		const glm::vec2 d2 = v[2].TexCoords - v[0].TexCoords;
+		const float det = d1.x * d2.y - d2.x * d1.y;
+		const float r = det != 0.0f ? 1.0f / det : 0.0f;
+		const glm::vec3 sdir = (d2.y * e1 - d1.y * e2) * r;
+		const glm::vec3 tdir = (d1.x * e2 - d2.x * e1) * r;
+
+		for (int k = 0; k < 3; ++k)
+		{
+			const glm::vec3 n = v[k].Normal;
+			glm::vec3 t = sdir - n * glm::dot(n, sdir);
+			const float length = glm::length(t);
+			t = length > 0.0f ? t / length : glm::vec3(1.0f, 0.0f, 0.0f);
+			const float w = glm::dot(glm::cross(n, t), tdir) < 0.0f ? -1.0f : 1.0f;
+			v[k].Tangeant = t;
+			v[k].BiTangeant = w * glm::cross(n, t);
+		}
+	}
+}
+
+
+////////////////////////
+// Files
+////////////////////////
+/*!
+*  \brief Size of a file in bytes, -1 if it cannot be read
+*/
+long long fileSize(const std::string path)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		return -1;
+	return static_cast<long long>(file.tellg());
+}
+
+
+////////////////////////
+// CPU: parsing, tangent frames, IBL spherical harmonics
+////////////////////////
+void meshBenchmarks(BenchmarkSuite & suite, const std::string model)
+{
+	OpenGLEngine::parser::OBJData obj;
+	if (!OpenGLEngine::parser::loadOBJ(model, &obj))
+	{
+		suite.skip("parser/", "cannot read " + model);
+		return;
+	}
+	const double megabytes = fileSize(model) / 1e6;
+	suite.setContext("model", model);
+	suite.setContext("model_triangles", std::to_string(static_cast<long long>(obj.corners.size() / 3)));
+
+	////////////////////////
+	// OBJ parsing (source bytes)
+	////////////////////////
+	suite.run("parser/loadOBJ/1_thread", "MB/s", megabytes, [&]() { OpenGLEngine::parser::OBJData o; OpenGLEngine::parser::loadOBJ(model, &o, 1); });
+	suite.run("parser/loadOBJ/all_threads", "MB/s", megabytes, [&]() { OpenGLEngine::parser::OBJData o; OpenGLEngine::parser::loadOBJ(model, &o, 0); });
+
+	////////////////////////
+	// Tangent space generation (Geometry::computeTangeant_BiTangeant), against the scalar reference
+	////////////////////////
+	std::vector<OpenGLEngine::Vertex> soup;
+	buildSoup(obj, &soup);
+	if (obj.uvs.empty())
+	{
+		projectTexCoords(&soup);
+		suite.setContext("tangents_uv", "spherical projection");
+	}
+	std::vector<OpenGLEngine::Vertex> welded;
+	std::vector<unsigned int> indices;
+	buildIndexed(obj, soup, &welded, &indices);
+
+	std::vector<OpenGLEngine::Vertex> work;
+	suite.run("tangents/reference/soup", "verts/s", static_cast<double>(soup.size()), [&]() { work = soup; referenceTangents(&work); });
+	suite.run("tangents/tangentSpace/soup/1_thread", "verts/s", static_cast<double>(soup.size()), [&]() { work = soup; OpenGLEngine::tangentSpace::compute(&work, NULL, 1); });
+	suite.run("tangents/tangentSpace/soup/all_threads", "verts/s", static_cast<double>(soup.size()), [&]() { work = soup; OpenGLEngine::tangentSpace::compute(&work, NULL, 0); });
+	suite.run("tangents/tangentSpace/welded/1_thread", "verts/s", static_cast<double>(welded.size()), [&]() { work = welded; OpenGLEngine::tangentSpace::compute(&work, &indices, 1); });
+	suite.run("tangents/tangentSpace/welded/all_threads", "verts/s", static_cast<double>(welded.size()), [&]() { work = welded; OpenGLEngine::tangentSpace::compute(&work, &indices, 0); });
+
+	// on the soup both compute the same frames
+	std::vector<OpenGLEngine::Vertex> expected = soup;
+	referenceTangents(&expected);
+	work = soup;
+	OpenGLEngine::tangentSpace::compute(&work, NULL, 0);
+	size_t nbMismatches = 0;
+	for (size_t i = 0; i < soup.size(); ++i)
+		if (glm::dot(work[i].Tangeant, expected[i].Tangeant) < 0.999f || glm::dot(work[i].BiTangeant, expected[i].BiTangeant) < 0.999f)
+			++nbMismatches;
+	suite.setContext("tangents_mismatches", std::to_string(static_cast<long long>(nbMismatches)) + " / " + std::to_string(static_cast<long long>(soup.size())));
+}
+
+////////////////////////
+// Tangent frames: the SSE orthogonalization against the scalar one, on vertices without a usable tangent
+////////////////////////
+void tangentChecks(BenchmarkSuite & suite)
+{
+	// summed tangents that vanish once projected (null, tiny, parallel to the normal), some of them negative: t * 0 is then -0.0
+	const glm::vec3 normals[8] = { glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.6f, -0.8f, 0.0f), glm::vec3(-0.6f, 0.0f, -0.8f), glm::vec3(0.0f) };
+	const glm::vec3 tangents[4] = { glm::vec3(0.0f), glm::vec3(-1e-9f, -1e-9f, -1e-9f), glm::vec3(1e-9f, -1e-9f, 1e-9f), glm::vec3(-3.0f) };
+	OpenGLEngine::tangentSpace::Streams streams;
+	std::vector<float> tx, ty, tz, bx, by, bz;
+	for (int n = 0; n < 8; ++n)
+		for (int t = 0; t < 5; ++t)
+		{
+			// the last case is a usable tangent, so that vectors mix valid and degenerate lanes
+			const glm::vec3 tangent = t < 3 ? tangents[t] : t == 3 ? tangents[3] * normals[n] : glm::vec3(normals[n].y - 1.0f, normals[n].z, -normals[n].x);
+			streams.nx.push_back(normals[n].x); streams.ny.push_back(normals[n].y); streams.nz.push_back(normals[n].z);
+			tx.push_back(tangent.x); ty.push_back(tangent.y); tz.push_back(tangent.z);
+			bx.push_back(-1.0f); by.push_back(0.5f); bz.push_back(-0.25f);
+		}
+	const size_t count = tx.size();
+	streams.px = streams.py = streams.pz = streams.u = streams.v = std::vector<float>(count, 0.0f);
+
+	// [0, count): 4 vertices at a time; [i, i + 1): the scalar loop
+	std::vector<float> simdX = tx, simdY = ty, simdZ = tz, simdW(count);
+	OpenGLEngine::tangentSpace::orthogonalize(streams, &simdX[0], &simdY[0], &simdZ[0], &bx[0], &by[0], &bz[0], &simdW[0], 0, count);
+	std::vector<float> scalarX = tx, scalarY = ty, scalarZ = tz, scalarW(count);
+	for (size_t i = 0; i < count; ++i)
+		OpenGLEngine::tangentSpace::orthogonalize(streams, &scalarX[0], &scalarY[0], &scalarZ[0], &bx[0], &by[0], &bz[0], &scalarW[0], i, i + 1);
+
+	size_t nbMismatches = 0;
+	for (size_t i = 0; i < count; ++i)
+		if (glm::distance(glm::vec3(simdX[i], simdY[i], simdZ[i]), glm::vec3(scalarX[i], scalarY[i], scalarZ[i])) > 1e-5f || simdW[i] != scalarW[i])
+			++nbMismatches;
+	suite.check("tangents/check/sse_vs_scalar/degenerate", nbMismatches == 0,
+		std::to_string(static_cast<long long>(nbMismatches)) + " / " + std::to_string(static_cast<long long>(count)) + " frames differ");
+}
+
+////////////////////////
+// Vertex cache optimization: ACMR of every demo model, before and after meshOptimizer
+////////////////////////
+void optimizerChecks(BenchmarkSuite & suite)
+{
+	const char * models[5] = { "cube", "sphere", "teapot", "suzanne", "clumsy-dragon" };
+	for (int m = 0; m < 5; ++m)
+	{
+		const std::string path = DEMO_PATH + "Resources/Models/" + models[m] + ".obj";
+		const std::string name = std::string("meshOptimizer/check/acmr/") + models[m];
+		OpenGLEngine::parser::OBJData obj;
+		if (!OpenGLEngine::parser::loadOBJ(path, &obj))
+		{
+			suite.skip(name, "cannot read " + path);
+			continue;
+		}
+		std::vector<OpenGLEngine::Vertex> soup, vertices;
+		std::vector<unsigned int> indices;
+		buildSoup(obj, &soup);
+		buildIndexed(obj, soup, &vertices, &indices);
+
+		const OpenGLEngine::meshOptimizer::Report report = OpenGLEngine::meshOptimizer::optimize(&vertices, &indices);
+		std::ostringstream detail;
+		detail << std::fixed << std::setprecision(3) << "ACMR " << report.before.acmr << " => " << report.after.acmr;
+		suite.check(name, report.after.acmr <= report.before.acmr, detail.str());
+	}
+}
+
+////////////////////////
+// LOD chains: every level reaches its ratio, stays within its error, and keeps its faces oriented
+////////////////////////
+void simplifierChecks(BenchmarkSuite & suite)
+{
+	const char * models[5] = { "cube", "sphere", "teapot", "suzanne", "clumsy-dragon" };
+	for (int m = 0; m < 5; ++m)
+	{
+		const std::string path = DEMO_PATH + "Resources/Models/" + models[m] + ".obj";
+		const std::string name = "meshSimplifier/check/";
+		OpenGLEngine::parser::OBJData obj;
+		if (!OpenGLEngine::parser::loadOBJ(path, &obj))
+		{
+			suite.skip(name + "*/" + models[m], "cannot read " + path);
+			continue;
+		}
+		std::vector<OpenGLEngine::Vertex> soup, vertices;
+		std::vector<unsigned int> indices;
+		buildSoup(obj, &soup);
+		buildIndexed(obj, soup, &vertices, &indices);
+		OpenGLEngine::meshOptimizer::optimize(&vertices, &indices);
+
+		std::vector<OpenGLEngine::LevelOfDetail> lods;
+		OpenGLEngine::meshSimplifier::buildChain(vertices, &indices, OpenGLEngine::meshSimplifier::DEFAULT_LOD_RATIOS, OpenGLEngine::meshSimplifier::DEFAULT_LOD_COUNT, &lods);
+		if (lods.size() < 2)
+		{
+			suite.skip(name + "*/" + models[m], "no simplified level");
+			continue;
+		}
+		const size_t fullCount = lods[0].indexCount;
+		std::vector<glm::vec3> fullNormals;
+		OpenGLEngine::meshSimplifier::faceNormalSums(vertices, &indices[0], fullCount, &fullNormals);
+
+		// faces of the full resolution mesh, in every rotation: a level keeps some of them untouched
+		std::unordered_map<unsigned long long, unsigned int> fullFaces;
+		for (size_t i = 0; i < fullCount; i += 3)
+			for (int k = 0; k < 3; ++k)
+				fullFaces[(static_cast<unsigned long long>(indices[i + k]) << 32) | indices[i + (k + 1) % 3]] = indices[i + (k + 2) % 3];
+
+		bool ratiosReached = true, errorsBounded = true, oriented = true;
+		std::ostringstream ratioDetail, errorDetail, flipDetail;
+		ratioDetail << std::fixed << std::setprecision(3);
+		errorDetail << std::setprecision(4);
+		for (size_t l = 1; l < lods.size(); ++l)
+		{
+			const OpenGLEngine::LevelOfDetail & lod = lods[l];
+			const unsigned int * level = &indices[lod.firstIndex];
+			const size_t nbTriangles = lod.indexCount / 3;
+
+			// ratio: reached, or out of reach (simplifying the level again removes nothing: locked seams, flips)
+			const size_t target = 3 * static_cast<size_t>(lod.ratio * (fullCount / 3));
+			bool reached = lod.indexCount <= target;
+			if (!reached)
+			{
+				std::vector<unsigned int> again;
+				OpenGLEngine::meshSimplifier::simplify(vertices, level, lod.indexCount, target, &again, NULL, &fullNormals);
+				reached = again.size() == lod.indexCount;
+			}
+			ratiosReached = ratiosReached && reached;
+			ratioDetail << (l > 1 ? ", " : "") << static_cast<double>(lod.indexCount) / fullCount << (lod.indexCount <= target ? "" : " (locked)");
+
+			// error: brute force distance from every full resolution vertex to the level (small meshes only)
+			if (static_cast<double>(vertices.size()) * nbTriangles <= 2e8)
+			{
+				float maxDistance = 0.0f;
+				for (size_t v = 0; v < vertices.size(); ++v)
+				{
+					float distance = std::numeric_limits<float>::max();
+					for (size_t t = 0; t < lod.indexCount; t += 3)
+						distance = std::min(distance, OpenGLEngine::meshSimplifier::distanceToTriangle(vertices[v].Position,
+							vertices[level[t]].Position, vertices[level[t + 1]].Position, vertices[level[t + 2]].Position));
+					maxDistance = std::max(maxDistance, distance);
+				}
+				errorsBounded = errorsBounded && maxDistance <= lod.error * 1.0001f + 1e-6f;
+				errorDetail << (l > 1 ? ", " : "") << maxDistance << " <= " << lod.error;
+			}
+			else
+				errorDetail << (l > 1 ? ", " : "") << "skipped";
+
+			// flips: a new face turned away from the full resolution normals of all its corners
+			size_t nbFlips = 0;
+			for (size_t t = 0; t < lod.indexCount; t += 3)
+			{
+				const std::unordered_map<unsigned long long, unsigned int>::const_iterator kept = fullFaces.find((static_cast<unsigned long long>(level[t]) << 32) | level[t + 1]);
+				if (kept != fullFaces.end() && kept->second == level[t + 2])
+					continue;
+				const glm::vec3 p0 = vertices[level[t]].Position;
+				const glm::vec3 normal = glm::cross(vertices[level[t + 1]].Position - p0, vertices[level[t + 2]].Position - p0);
+				if (glm::dot(normal, fullNormals[level[t]]) <= 0.0f && glm::dot(normal, fullNormals[level[t + 1]]) <= 0.0f && glm::dot(normal, fullNormals[level[t + 2]]) <= 0.0f)
+					++nbFlips;
+			}
+			oriented = oriented && nbFlips == 0;
+			flipDetail << (l > 1 ? ", " : "") << nbFlips;
+		}
+		suite.check(name + "ratio/" + models[m], ratiosReached, "triangle ratios " + ratioDetail.str());
+		suite.check(name + "error/" + models[m], errorsBounded, "max distance " + errorDetail.str());
+		suite.check(name + "flips/" + models[m], oriented, "flipped faces " + flipDetail.str());
+	}
+}
+
+void lightingBenchmarks(BenchmarkSuite & suite)
+{
+	////////////////////////
+	// IBL diffuse: SH9 projection of the cubemap (image decoding included, source bytes)
+	////////////////////////
+	std::vector<std::string> faces;
+	const char * names[6] = { "px.jpg", "nx.jpg", "py.jpg", "ny.jpg", "pz.jpg", "nz.jpg" };
+	long long bytes = 0;
+	for (int i = 0; i < 6; ++i)
+	{
+		faces.push_back(CUBEMAP_PATH + names[i]);
+		const long long size = fileSize(faces.back());
+		if (size < 0)
+		{
+			suite.skip("textureClient/IBLDiffuse_Lambert_SHCoeffs", "cannot read " + faces.back());
+			return;
+		}
+		bytes += size;
+	}
+	float SH_COEFFS[9][3] = { 0 };
+	suite.run("textureClient/IBLDiffuse_Lambert_SHCoeffs", "MB/s", bytes / 1e6, [&]() { OpenGLEngine::textureClient::IBLDiffuse_Lambert_SHCoeffs(&SH_COEFFS, &faces); });
+}
+
+
+////////////////////////
+// Occlusion culling: a wall hiding a grid of boxes, rasterized and tested on the CPU
+////////////////////////
+void occlusionBenchmarks(BenchmarkSuite & suite)
+{
+	const glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+		* glm::lookAt(glm::vec3(0.0f, 1.0f, 10.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// occluder: a 16 x 4 wall at z = 0, as a 32 x 8 grid of quads (512 triangles)
+	const int nbColumns = 32, nbRows = 8;
+	std::vector<glm::vec3> wall;
+	std::vector<unsigned int> wallIndices;
+	for (int y = 0; y <= nbRows; ++y)
+		for (int x = 0; x <= nbColumns; ++x)
+			wall.push_back(glm::vec3(-8.0f + 16.0f * x / nbColumns, -1.0f + 4.0f * y / nbRows, 0.0f));
+	for (int y = 0; y < nbRows; ++y)
+		for (int x = 0; x < nbColumns; ++x)
+		{
+			const unsigned int i = y * (nbColumns + 1) + x;
+			const unsigned int quad[6] = { i, i + 1, i + nbColumns + 2, i, i + nbColumns + 2, i + nbColumns + 1 };
+			wallIndices.insert(wallIndices.end(), quad, quad + 6);
+		}
+
+	// occludees: 10k unit boxes behind the wall, on a 100 x 100 grid from z = -2 to z = -52
+	std::vector<glm::vec3> boxes;
+	for (int z = 0; z < 100; ++z)
+		for (int x = 0; x < 100; ++x)
+			boxes.push_back(glm::vec3(-25.0f + 0.5f * x, 0.0f, -2.0f - 0.5f * z));
+
+	OpenGLEngine::OcclusionBuffer occlusion;
+	const glm::mat4 identity(1.0f);
+	suite.run("occlusion/OcclusionBuffer::rasterize", "tris/s", wallIndices.size() / 3.0, [&]() {
+		occlusion.clear(viewProjection);
+		occlusion.addOccluder(&wall[0], sizeof(glm::vec3), &wallIndices[0], wallIndices.size(), identity);
+		occlusion.rasterize();
+	});
+
+	size_t nbOccluded = 0;
+	suite.run("occlusion/OcclusionBuffer::isVisible", "boxes/s", static_cast<double>(boxes.size()), [&]() {
+		nbOccluded = 0;
+		for (size_t i = 0; i < boxes.size(); ++i)
+			if (!occlusion.isVisible(boxes[i] - glm::vec3(0.2f), boxes[i] + glm::vec3(0.2f)))
+				++nbOccluded;
+	});
+	suite.setContext("occlusion_occluded", std::to_string(static_cast<long long>(nbOccluded)) + " / " + std::to_string(static_cast<long long>(boxes.size())));
+
+	// rasterizer: the wall faces the camera, its depth is the same everywhere. Pixels whose center is more than a pixel
+	// inside its screen rectangle hold that depth, pixels more than a pixel outside are cleared
+	occlusion.clear(viewProjection);
+	occlusion.addOccluder(&wall[0], sizeof(glm::vec3), &wallIndices[0], wallIndices.size(), identity);
+	occlusion.rasterize();
+	const glm::vec4 corners[3] = { viewProjection * glm::vec4(-8.0f, -1.0f, 0.0f, 1.0f), viewProjection * glm::vec4(8.0f, 3.0f, 0.0f, 1.0f),
+		viewProjection * glm::vec4(0.0f, 1.0f, 0.0f, 1.0f) };
+	const glm::vec2 wallMin = (glm::vec2(corners[0]) / corners[0].w * 0.5f + 0.5f) * glm::vec2(occlusion.getWidth(), occlusion.getHeight());
+	const glm::vec2 wallMax = (glm::vec2(corners[1]) / corners[1].w * 0.5f + 0.5f) * glm::vec2(occlusion.getWidth(), occlusion.getHeight());
+	const float wallDepth = corners[2].z / corners[2].w * 0.5f + 0.5f;
+	size_t nbWrong = 0, nbCovered = 0;
+	for (int y = 0; y < occlusion.getHeight(); ++y)
+		for (int x = 0; x < occlusion.getWidth(); ++x)
+		{
+			const glm::vec2 center(x + 0.5f, y + 0.5f);
+			const bool inside = glm::all(glm::greaterThan(center, wallMin + 1.0f)) && glm::all(glm::lessThan(center, wallMax - 1.0f));
+			const bool outside = glm::any(glm::lessThan(center, wallMin - 1.0f)) || glm::any(glm::greaterThan(center, wallMax + 1.0f));
+			const float depth = occlusion.getDepth(x, y);
+			nbCovered += inside ? 1 : 0;
+			if ((inside && std::fabs(depth - wallDepth) > 1e-4f) || (outside && depth != 1.0f))
+				++nbWrong;
+		}
+	suite.check("occlusion/check/rasterizer_depth", nbWrong == 0 && nbCovered > 0,
+		std::to_string(static_cast<long long>(nbWrong)) + " wrong pixels, " + std::to_string(static_cast<long long>(nbCovered)) + " covered");
+
+	// depth test: only a box entirely behind the wall is hidden. Half behind it (past its right edge, over its top edge)
+	// or crossing its plane, the box is visible
+	struct Case { const char * name; glm::vec3 center; float halfSize; bool hidden; };
+	const Case cases[5] = {
+		{ "behind", glm::vec3(0.0f, 1.0f, -2.0f), 0.2f, true },
+		{ "in_front", glm::vec3(0.0f, 1.0f, 2.0f), 0.2f, false },
+		{ "partly_behind_edge", glm::vec3(10.0f, 1.0f, -2.0f), 0.5f, false },
+		{ "partly_behind_top", glm::vec3(0.0f, 3.0f, -1.0f), 0.5f, false },
+		{ "crossing_plane", glm::vec3(0.0f, 1.0f, 0.0f), 0.5f, false }
+	};
+	for (int c = 0; c < 5; ++c)
+	{
+		const bool visible = occlusion.isVisible(cases[c].center - cases[c].halfSize, cases[c].center + cases[c].halfSize);
+		suite.check(std::string("occlusion/check/") + cases[c].name, visible != cases[c].hidden, visible ? "visible" : "hidden");
+	}
+}
+
+
+////////////////////////
+// OpenGL: Geometry construction and per draw CPU overhead of the material and uniform bindings
+////////////////////////
+void glBenchmarks(BenchmarkSuite & suite, const std::string model)
+{
+	// hidden window: its only purpose is the OpenGL context
+	OpenGLEngine::window::Window window(64, 64, "Benchmarks");
+	if (window.getWindow() == NULL)
+	{
+		suite.skip("gl/", "no OpenGL context");
+		return;
+	}
+	glfwHideWindow(window.getWindow());
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK)
+	{
+		suite.skip("gl/", "glewInit failed");
+		return;
+	}
+	suite.setContext("gl_renderer", reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+	suite.setContext("gl_version", reinterpret_cast<const char *>(glGetString(GL_VERSION)));
+	// every timed batch waits for the driver
+	suite.setFence([]() { glFinish(); });
+
+	////////////////////////
+	// Geometry construction (Geometry::loadOBJ): from the .obj (parse, weld, tangents, upload) and from the baked cache
+	////////////////////////
+	size_t nbVertices = 0;
+	OpenGLEngine::GeometryOptions fromSource, fromCache;
+	fromSource.useCache = false;
+	{
+		OpenGLEngine::Geometry geometry;
+		if (geometry.loadOBJ(model, glm::vec3(0.0f), 1.0, fromCache)) // writes the cache if it is missing or stale
+			nbVertices = geometry.getVertexCount();
+		geometry.release();
+	}
+	const long long cacheSize = fileSize(OpenGLEngine::meshCache::cachePath(model));
+	if (nbVertices == 0)
+		suite.skip("gl/Geometry::loadOBJ/", "cannot read " + model);
+	else
+	{
+		suite.run("gl/Geometry::loadOBJ/source", "verts/s", static_cast<double>(nbVertices), [&]() {
+			OpenGLEngine::Geometry geometry;
+			geometry.loadOBJ(model, glm::vec3(0.0f), 1.0, fromSource);
+			geometry.release();
+		});
+		if (cacheSize > 0)
+			suite.run("gl/Geometry::loadOBJ/cache", "MB/s", cacheSize / 1e6, [&]() {
+				OpenGLEngine::Geometry geometry;
+				geometry.loadOBJ(model, glm::vec3(0.0f), 1.0, fromCache);
+				geometry.release();
+			});
+		else
+			suite.skip("gl/Geometry::loadOBJ/cache", "cache not written");
+	}
+
+	////////////////////////
+	// Shader construction: GLSL compilation and link (cold start) against the program binary cache (warm start)
+	////////////////////////
+	const std::string pbrVert = DEMO_PATH + "pbr.vert", pbrFrag = DEMO_PATH + "pbr.frag";
+	if (OpenGLEngine::programCache::isSupported())
+	{
+		OpenGLEngine::programCache::enabled() = false;
+		suite.run("gl/Shader/compile", "programs/s", 1.0, [&]() {
+			OpenGLEngine::Shader shader(pbrVert.c_str(), pbrFrag.c_str());
+			glDeleteProgram(shader.Program);
+		});
+		// the PBR_IBL demo's programs, built one after the other against one batch (cf ShaderBatch)
+		const char * programs[4][2] = { { "pbr.vert", "pbr.frag" }, { "skybox.vert", "skybox.frag" }, { "envMapConvol.vert", "envMapConvol.frag" }, { "brdfLUT.vert", "brdfLUT.frag" } };
+		suite.setContext("parallel_shader_compile", OpenGLEngine::Shader::hasParallelCompile() ? "yes" : "no");
+		suite.run("gl/Shader/4_programs/sequential", "programs/s", 4.0, [&]() {
+			for (int p = 0; p < 4; ++p)
+			{
+				OpenGLEngine::Shader shader((DEMO_PATH + programs[p][0]).c_str(), (DEMO_PATH + programs[p][1]).c_str());
+				glDeleteProgram(shader.Program);
+			}
+		});
+		suite.run("gl/Shader/4_programs/ShaderBatch", "programs/s", 4.0, [&]() {
+			OpenGLEngine::ShaderBatch batch;
+			std::vector<std::unique_ptr<OpenGLEngine::Shader> > shaders;
+			for (int p = 0; p < 4; ++p)
+				shaders.push_back(std::unique_ptr<OpenGLEngine::Shader>(new OpenGLEngine::Shader((DEMO_PATH + programs[p][0]).c_str(), (DEMO_PATH + programs[p][1]).c_str(), &batch)));
+			batch.wait();
+			for (int p = 0; p < 4; ++p)
+				glDeleteProgram(shaders[p]->Program);
+		});
+		OpenGLEngine::programCache::enabled() = true;
+		suite.run("gl/Shader/programCache", "programs/s", 1.0, [&]() {
+			OpenGLEngine::Shader shader(pbrVert.c_str(), pbrFrag.c_str());
+			glDeleteProgram(shader.Program);
+		});
+		const OpenGLEngine::programCache::Stats & cacheStats = OpenGLEngine::programCache::getStats();
+		suite.setContext("programCache_hits_misses_rejected", std::to_string(static_cast<long long>(cacheStats.hits)) + " / "
+			+ std::to_string(static_cast<long long>(cacheStats.misses)) + " / " + std::to_string(static_cast<long long>(cacheStats.rejected)));
+	}
+	else
+		suite.skip("gl/Shader/", "no program binary format");
+
+	////////////////////////
+	// ShaderPermutations: switching between two prebuilt IBL_MODE variants of pbr.frag (lookup by key + glUseProgram)
+	////////////////////////
+	{
+		OpenGLEngine::ShaderPermutations pbrShaders(pbrVert.c_str(), pbrFrag.c_str(), { { "IBL_MODE", "SPLIT_SUM" } });
+		const OpenGLEngine::ShaderDefines modes[2] = { { { "IBL_MODE", "SPLIT_SUM" } }, { { "IBL_MODE", "REFERENCE" } } };
+		for (int m = 0; m < 2; ++m)
+			pbrShaders.get(modes[m])->wait();
+		int m = 0;
+		suite.run("gl/ShaderPermutations::select", "switches/s", 1.0, [&]() {
+			m = 1 - m;
+			pbrShaders.select(modes[m])->Use();
+		});
+	}
+
+	////////////////////////
+	// brdfLUT.frag (PBR_IBL's split-sum LUT): 1024 GGX samples per texel, read from the precomputed Hammersley table (cf SampleTables)
+	////////////////////////
+	{
+		OpenGLEngine::Shader brdfLUTShader((DEMO_PATH + "brdfLUT.vert").c_str(), (DEMO_PATH + "brdfLUT.frag").c_str());
+		OpenGLEngine::Geometry screenQuad("ScreenGeometry", 1.0, glm::vec3(0.0f));
+		const size_t lutSize = 64;
+		OpenGLEngine::FBO lutFBO;
+		lutFBO.addColorRenderTarget(GL_RG32F, lutSize, lutSize, GL_RG, GL_FLOAT);
+		lutFBO.setColorAttachments();
+		OpenGLEngine::f2vUniform uInverseResolution;
+		uInverseResolution.name = "uInverseResolution";
+		uInverseResolution.value = glm::vec2(1.0f / lutSize);
+
+		lutFBO.bindFBO();
+		glViewport(0, 0, lutSize, lutSize);
+		OpenGLEngine::GLState::get().invalidate(); // framebuffer and viewport set behind the state cache
+		glDisable(GL_DEPTH_TEST);
+		brdfLUTShader.Use();
+		OpenGLEngine::SampleTables::get().bindProgram(&brdfLUTShader);
+		uInverseResolution.linkUniform(&brdfLUTShader);
+		suite.run("gl/brdfLUT/hammersley_table", "texels/s", static_cast<double>(lutSize * lutSize), [&]() { screenQuad.drawGeometry(); });
+		glEnable(GL_DEPTH_TEST);
+		lutFBO.unbindFBO();
+		OpenGLEngine::GLState::get().invalidate();
+		OpenGLEngine::GLState::get().vertexArrayDeleted(screenQuad.getVAO());
+		screenQuad.dealocate();
+		OpenGLEngine::ProgramReflection::forget(brdfLUTShader.Program);
+		OpenGLEngine::GLState::get().programDeleted(brdfLUTShader.Program);
+		glDeleteProgram(brdfLUTShader.Program);
+	}
+
+	////////////////////////
+	// GPUProfiler: cost of a scoped marker (two timestamp queries) and of a frame (read back of the frame issued 4 frames ago)
+	////////////////////////
+	if (OpenGLEngine::GPUProfiler::isSupported())
+	{
+		OpenGLEngine::GPUProfiler profiler;
+		suite.run("gl/GPUProfiler::Scope", "markers/s", 8.0, [&]() {
+			profiler.beginFrame();
+			for (int m = 0; m < 8; ++m)
+				OpenGLEngine::GPUProfiler::Scope pass(profiler, "pass");
+			profiler.endFrame();
+		});
+		suite.setContext("gpu_profiler_dropped_frames", std::to_string(static_cast<long long>(profiler.getDroppedFrames())));
+	}
+	else
+		suite.skip("gl/GPUProfiler::", "no timer queries");
+
+	OpenGLEngine::camera::Camera camera(window.aspectRatio(), glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), 70.0f);
+	OpenGLEngine::Shader pbrShader((DEMO_PATH + "pbr.vert").c_str(), (DEMO_PATH + "pbr.frag").c_str());
+	pbrShader.Use();
+
+	////////////////////////
+	// pbr.frag's material, as the PBR_IBL demo sets it up
+	////////////////////////
+	OpenGLEngine::af3vUniform sphericalHarmonics_Coeff;
+	sphericalHarmonics_Coeff.name = "sphericalHarmonics_Coeff";
+	sphericalHarmonics_Coeff.value = std::vector<glm::vec3>(9, glm::vec3(0.5f));
+	OpenGLEngine::f3vUniform lightPos;
+	lightPos.name = "lightPos";
+	lightPos.value = glm::vec3(1.0f);
+	OpenGLEngine::f3vUniform F0;
+	F0.name = "uF_0";
+	F0.value = glm::vec3(1.00f, 0.71f, 0.29f);
+	OpenGLEngine::fUniform roughness;
+	roughness.name = "uRoughness";
+	roughness.value = 0.3f;
+	OpenGLEngine::fUniform metalness;
+	metalness.name = "uMaterialMetalness";
+	metalness.value = 1.0f;
+	OpenGLEngine::m4fUniform normalMatrix;
+	normalMatrix.name = "normalMatrix";
+	normalMatrix.value = glm::mat4(1.0f);
+
+	std::vector<std::string> faces;
+	const char * names[6] = { "px.jpg", "nx.jpg", "py.jpg", "ny.jpg", "pz.jpg", "nz.jpg" };
+	for (int i = 0; i < 6; ++i)
+		faces.push_back(CUBEMAP_PATH + names[i]);
+	OpenGLEngine::TextureCube envMap;
+	envMap.ID = OpenGLEngine::textureClient::loadCubeMap(&faces);
+	envMap.name = "skybox";
+	envMap.type = "samplerCube";
+
+	std::vector<OpenGLEngine::Uniform *> uniformVec = { &sphericalHarmonics_Coeff, &lightPos, &F0, &roughness, &metalness };
+	std::vector<OpenGLEngine::Texture *> textureVec = { &envMap };
+	OpenGLEngine::Material material(&textureVec, &uniformVec, &pbrShader);
+
+	////////////////////////
+	// Uniform::linkCached, one call per uniform type: changed (slot location + upload) and unchanged (value comparison only),
+	// against the library's Uniform::linkUniform (location lookup + upload on every call)
+	////////////////////////
+	float phase = 0.0f; // written into the values, so that every link sees a new one
+	OpenGLEngine::ProgramReflection & pbrProgram = OpenGLEngine::ProgramReflection::of(pbrShader.Program);
+	suite.run("gl/Uniform::linkUniform/f", "uniforms/s", 1.0, [&]() { roughness.value = (phase += 1.0f); roughness.linkUniform(&pbrShader); });
+	suite.run("gl/Uniform::linkCached/f/changed", "uniforms/s", 1.0, [&]() { roughness.value = (phase += 1.0f); roughness.linkCached(&pbrShader, pbrProgram); });
+	suite.run("gl/Uniform::linkCached/f3v/changed", "uniforms/s", 1.0, [&]() { F0.value.x = (phase += 1.0f); F0.linkCached(&pbrShader, pbrProgram); });
+	suite.run("gl/Uniform::linkCached/m4f/changed", "uniforms/s", 1.0, [&]() { normalMatrix.value[3][3] = (phase += 1.0f); normalMatrix.linkCached(&pbrShader, pbrProgram); });
+	suite.run("gl/Uniform::linkCached/af3v[9]/changed", "uniforms/s", 1.0, [&]() { sphericalHarmonics_Coeff.value[8].z = (phase += 1.0f); sphericalHarmonics_Coeff.linkCached(&pbrShader, pbrProgram); });
+	suite.run("gl/Uniform::linkCached/f/unchanged", "uniforms/s", 1.0, [&]() { roughness.linkCached(&pbrShader, pbrProgram); });
+	suite.run("gl/Uniform::linkCached/af3v[9]/unchanged", "uniforms/s", 1.0, [&]() { sphericalHarmonics_Coeff.linkCached(&pbrShader, pbrProgram); });
+
+	////////////////////////
+	// Material::bindMaterial: every uniform and texture of one draw (unchanged values, as between two meshes sharing the material)
+	////////////////////////
+	suite.run("gl/Material::bindMaterial", "draws/s", 1.0, [&]() { material.bindMaterial(); });
+	suite.run("gl/Material::bindMaterial+unbindMaterial", "draws/s", 1.0, [&]() { material.bindMaterial(); material.unbindMaterial(); });
+	suite.run("gl/Material::linkUniforms/changed", "draws/s", 1.0, [&]() {
+		phase += 1.0f;
+		sphericalHarmonics_Coeff.value[0].x = phase;
+		lightPos.value.x = phase;
+		F0.value.x = phase;
+		roughness.value = phase;
+		metalness.value = phase;
+		material.linkUniforms(&pbrShader);
+	});
+	suite.run("gl/Material::linkUniforms/unchanged", "draws/s", 1.0, [&]() { material.linkUniforms(&pbrShader); });
+
+	////////////////////////
+	// CompiledMaterial: the same material, flattened (slot locations, texture IDs and targets, version tests)
+	////////////////////////
+	OpenGLEngine::CompiledMaterial compiledMaterial(&material);
+	const int roughnessHandle = compiledMaterial.getHandle("uRoughness");
+	suite.run("gl/CompiledMaterial::bindParameters+bindTextures", "draws/s", 1.0, [&]() { compiledMaterial.bindParameters(); compiledMaterial.bindTextures(); });
+	suite.run("gl/CompiledMaterial::set+bindParameters", "draws/s", 1.0, [&]() { compiledMaterial.set(roughnessHandle, phase += 1.0f); compiledMaterial.bindParameters(); });
+	suite.run("gl/CompiledMaterial::sync", "materials/s", 1.0, [&]() { compiledMaterial.sync(); });
+
+	////////////////////////
+	// GLState: a texture bind and the skybox toggles, raw against filtered by the state cache
+	////////////////////////
+	OpenGLEngine::GLState & glState = OpenGLEngine::GLState::get();
+	glState.invalidate();
+	suite.run("gl/glBindTexture/raw", "binds/s", 1.0, [&]() { glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_CUBE_MAP, envMap.ID); });
+	suite.run("gl/GLState::bindTexture/redundant", "binds/s", 1.0, [&]() { glState.bindTexture(0, GL_TEXTURE_CUBE_MAP, envMap.ID); });
+	suite.run("gl/GLState::depthMask+frontFace/redundant", "calls/s", 2.0, [&]() { glState.depthMask(GL_TRUE); glState.frontFace(GL_CCW); });
+	glState.invalidate();
+
+	////////////////////////
+	// Scene::linkDefaultUniforms: per mesh matrix products and uploads, against the per frame uniform blocks
+	////////////////////////
+	OpenGLEngine::SceneRenderer scene;
+	suite.run("gl/Scene::linkDefaultUniforms", "draws/s", 1.0, [&]() { scene.linkDefaultUniforms(&pbrShader, &camera, &window); });
+	suite.run("gl/Scene::updateFrameUniforms/still_camera", "frames/s", 1.0, [&]() { scene.updateFrameUniforms(&camera, &window); });
+	// a moving camera: the default uniforms are read back every frame (cf UniformBlocks::captureDefaults)
+	float cameraShift = 0.0f;
+	suite.run("gl/Scene::updateFrameUniforms/moving_camera", "frames/s", 1.0, [&]() {
+		cameraShift = cameraShift > 1.0f ? 0.0f : cameraShift + 0.01f;
+		camera.moveTo(glm::vec3(cameraShift, 0.0f, 3.0f));
+		scene.updateFrameUniforms(&camera, &window);
+	});
+	camera.moveTo(glm::vec3(0.0f, 0.0f, 3.0f));
+
+	////////////////////////
+	// Scene::drawMeshes: a grid of cubes, one draw per mesh (RenderQueue) against multi-draw indirect (IndirectRenderer)
+	////////////////////////
+	const int gridSize = 32;
+	OpenGLEngine::Geometry cubeGeometry("CubeGeometry", 0.1, glm::vec3(0.0f));
+	std::vector<std::unique_ptr<OpenGLEngine::Mesh> > cubes;
+	OpenGLEngine::SceneRenderer cubeScene;
+	cubeScene.setFrustumCulling(false);
+	for (int i = 0; i < gridSize * gridSize; ++i)
+	{
+		cubes.push_back(std::unique_ptr<OpenGLEngine::Mesh>(new OpenGLEngine::Mesh(&cubeGeometry, &material)));
+		cubes.back()->setWorldSpacePosition(glm::vec3(-1.6f + 0.1f * (i % gridSize), -1.6f + 0.1f * (i / gridSize), 0.0f));
+		cubeScene.addMesh(cubes.back().get());
+	}
+	const double nbCubes = static_cast<double>(cubes.size());
+
+	suite.run("gl/Scene::drawMeshes/direct", "meshes/s", nbCubes, [&]() { cubeScene.drawMeshes(&camera, &window); });
+	suite.setContext("drawMeshes_direct_draws", std::to_string(static_cast<long long>(cubeScene.getRenderStats().draws)));
+
+	if (OpenGLEngine::IndirectRenderer::isSupported())
+	{
+		OpenGLEngine::Shader pbrIndirectShader((DEMO_PATH + "pbrIndirect.vert").c_str(), (DEMO_PATH + "pbr.frag").c_str());
+		cubeScene.setIndirectDraw(&pbrIndirectShader);
+		suite.run("gl/Scene::drawMeshes/indirect", "meshes/s", nbCubes, [&]() { cubeScene.drawMeshes(&camera, &window); });
+		suite.setContext("drawMeshes_indirect_draws", std::to_string(static_cast<long long>(cubeScene.getRenderStats().draws)));
+		cubeScene.setIndirectDraw(NULL);
+	}
+	else
+		suite.skip("gl/Scene::drawMeshes/indirect", "needs OpenGL 4.3 or ARB_multi_draw_indirect");
+
+	////////////////////////
+	// Scene::drawMeshes: 10k culled meshes, frame preparation (LODs, culling, sort keys, object records) on one thread against every core (cf JobSystem)
+	////////////////////////
+	const int largeGridSize = 100;
+	std::vector<std::unique_ptr<OpenGLEngine::Mesh> > largeCubes;
+	OpenGLEngine::SceneRenderer largeScene;
+	for (int i = 0; i < largeGridSize * largeGridSize; ++i)
+	{
+		largeCubes.push_back(std::unique_ptr<OpenGLEngine::Mesh>(new OpenGLEngine::Mesh(&cubeGeometry, &material)));
+		largeCubes.back()->setWorldSpacePosition(glm::vec3(-5.0f + 0.1f * (i % largeGridSize), -5.0f + 0.1f * (i / largeGridSize), 0.0f));
+		largeScene.addMesh(largeCubes.back().get());
+	}
+	const double nbLargeCubes = static_cast<double>(largeCubes.size());
+
+	OpenGLEngine::JobSystem & jobs = OpenGLEngine::JobSystem::get();
+	const unsigned int nbJobThreads = jobs.getThreadCount();
+	jobs.resize(1);
+	suite.run("gl/Scene::drawMeshes/10k/1_thread", "meshes/s", nbLargeCubes, [&]() { largeScene.drawMeshes(&camera, &window); });
+	jobs.resize(nbJobThreads);
+	suite.run("gl/Scene::drawMeshes/10k/all_threads", "meshes/s", nbLargeCubes, [&]() { largeScene.drawMeshes(&camera, &window); });
+	suite.setContext("drawMeshes_10k_threads", std::to_string(static_cast<long long>(nbJobThreads)));
+	suite.setContext("drawMeshes_10k_visible", std::to_string(static_cast<long long>(largeScene.getCullingStats().visible)));
+
+	suite.setFence(std::function<void()>());
+	glDeleteTextures(1, &envMap.ID);
+	window.close();
+}
+
+
+int main(int argc, char ** argv)
+{
+	std::string model = DEFAULT_MODEL;
+	std::string jsonPath = DEFAULT_JSON;
+	std::string filter;
+	bool useGL = true;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg.compare(0, 7, "--json=") == 0)
+			jsonPath = arg.substr(7);
+		else if (arg.compare(0, 9, "--filter=") == 0)
+			filter = arg.substr(9);
+		else if (arg == "--no-gl")
+			useGL = false;
+		else
+			model = arg;
+	}
+
+	BenchmarkSuite suite(filter);
+	std::cout << std::thread::hardware_concurrency() << " hardware threads, median of at least " << BenchmarkSuite::MIN_SAMPLES << " batches" << std::endl << std::endl;
+
+	meshBenchmarks(suite, model);
+	tangentChecks(suite);
+	optimizerChecks(suite);
+	simplifierChecks(suite);
+	lightingBenchmarks(suite);
+	occlusionBenchmarks(suite);
+	if (useGL)
+		glBenchmarks(suite, model);
+
+	if (!suite.writeJSON(jsonPath))
+		return 1;
+	std::cout << std::endl << "results: " << jsonPath << std::endl;
+	if (suite.getFailedCount() != 0)
+	{
+		std::cout << suite.getFailedCount() << " checks FAILED" << std::endl;
+		return 1;
+	}
+	return 0;
+}
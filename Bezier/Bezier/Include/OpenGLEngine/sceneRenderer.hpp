@@ -0,0 +1,755 @@
+#ifndef SCENERENDERER_HPP
+#define SCENERENDERER_HPP
+
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+#include <glm\gtc\type_ptr.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "scene.hpp"
+#include "instancedMesh.hpp"
+#include "renderQueue.hpp"
+#include "indirectRenderer.hpp"
+#include "uniformBlocks.hpp"
+#include "programReflection.hpp"
+#include "glState.hpp"
+#include "jobSystem.hpp"
+#include "frustumCulling.hpp"
+#include "occlusionCulling.hpp"
+
+
+namespace OpenGLEngine
+{
+
+
+/**
+* \file sceneRenderer.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SCENE */
+/*@{*/
+
+
+/*!
+*  \brief  Scene Renderer: Scene drawing every mesh through the engine's render paths. \n
+*
+*/
+
+/*!
+*	Same interface as Scene, for the geometries the engine library cannot draw (indexed, quantized, LOD chains, \n
+*	background loads, cf GeometryRecord) and for the per frame work added since: levels of detail, frustum and \n
+*	occlusion culling, sorted render queue, multi-draw indirect, uniform blocks, instanced meshes. \n
+*	The Scene part keeps the layout of the engine library: every mesh is added to it as well (cf Scene::addMesh), \n
+*	the draw calls of SceneRenderer hide the library ones.
+*
+*	\code{.cpp}
+*		Mesh mesh(&geometry,&material);
+*		SceneRenderer scene;
+*		scene.addMesh(&mesh);
+*		scene.addOccluder(&mesh);
+*		...
+*		...
+*		// drawing meshes
+*		scene.drawMeshes(&camera, &window);
+*	\endcode
+*/
+class SceneRenderer : public Scene {
+public:
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Default Constructor: \n
+	*		initialise an empty scene
+	*
+	* \return empty scene (no meshes created)
+	*
+	*/
+	SceneRenderer()
+	{}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	/*!
+	*	\brief returns the submission counters of the last drawMeshes (draws, meshes drawn, binds made and binds skipped)
+	*/
+	const RenderStats & getRenderStats() const
+	{
+		return renderStats;
+	}
+	/*!
+	*	\brief returns the culling counters of the last drawMeshes (meshes tested, meshes visible, meshes occluded)
+	*/
+	const CullingStats & getCullingStats() const
+	{
+		return cullingStats;
+	}
+
+
+	///////////////////////////////////////////
+	//	SETTERS
+	///////////////////////////////////////////
+	/*!
+	*	\brief adds a Mesh to the scene
+	*
+	* \param Mesh * mesh : new Mesh to add to the scene
+	* \return appends input Mesh to the render list (and to the Scene one)
+	*/
+	void addMesh(Mesh * mesh)
+	{
+		Scene::addMesh(mesh);
+		meshes.push_back(mesh);
+	}
+	/*!
+	*	\brief adds an InstancedMesh to the scene
+	*
+	* \param InstancedMesh * instancedMesh : new InstancedMesh to add to the scene (drawn in a single call by drawMeshes)
+	* \return appends input InstancedMesh to the render list
+	*/
+	void addInstancedMesh(InstancedMesh * instancedMesh)
+	{
+		instancedMeshes.push_back(instancedMesh);
+	}
+	/*!
+	*	\brief sets the screen space error tolerated when picking levels of detail (cf selectLOD)
+	*
+	* \param float pixels : maximum projected geometric error, in pixels (1 by default)
+	* \return
+	*/
+	void setLODPixelError(float pixels)
+	{
+		lodPixelError = pixels;
+	}
+	/*!
+	*	\brief enables or disables frustum culling in drawMeshes (enabled by default)
+	*
+	* \param bool enabled : false => every mesh is submitted
+	* \return
+	*/
+	void setFrustumCulling(bool enabled)
+	{
+		frustumCullingEnabled = enabled;
+	}
+	/*!
+	*	\brief adds an occluder: a mesh hiding the others (e.g. a floor, a wall, a large building)
+	*
+	* \param Mesh * mesh : mesh already added to the scene, whose vertices are kept on the CPU (not loaded from a baked cache)
+	* \return its full resolution mesh is rasterized every frame by drawMeshes in a small CPU depth buffer, \n
+	*		the meshes behind it are not submitted (cf OcclusionBuffer, getCullingStats)
+	*/
+	void addOccluder(Mesh * mesh)
+	{
+		occluders.push_back(mesh);
+	}
+	/*!
+	*	\brief enables or disables occlusion culling in drawMeshes (enabled by default, only effective once occluders are added)
+	*
+	* \param bool enabled : false => the occluders are not rasterized
+	* \return
+	*/
+	void setOcclusionCulling(bool enabled)
+	{
+		occlusionCullingEnabled = enabled;
+	}
+	/*!
+	*	\brief returns the occlusion buffer of the last drawMeshes (e.g. to display it)
+	*/
+	const OcclusionBuffer & getOcclusionBuffer() const
+	{
+		return occlusionBuffer;
+	}
+	/*!
+	*	\brief enables or disables multi-draw indirect submission in drawMeshes (disabled by default, cf IndirectRenderer)
+	*
+	* \param Shader * shader : indirect variant of the meshes' shader, reading the draw and material SSBOs (e.g. pbrIndirect.vert), NULL => disabled
+	* \return if the context supports it, the static geometries are copied into shared arenas and the whole scene is drawn \n
+	*		with one glMultiDrawElementsIndirect per vertex format and texture set, whatever the number of meshes
+	*/
+	void setIndirectDraw(Shader * shader)
+	{
+		indirectShader = shader;
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*	\brief render a single input mesh
+	*
+	* \param Mesh * mesh : input mesh to be rendered
+	* \param camera::Camera * camera : camera filming the scene (will be used in projecting the mesh correctly)
+	* \param window::Window * window : viewport window (will be used in projecting the mesh correctly)
+	* \return draws the mesh on current viewport and using input camera specifications
+	*
+	* \note Make use of the stencil buffer (renders the mesh on the stencil buffer) \n
+	*		Full resolution, skipped while its geometry is loading (cf drawDirect)
+	*/
+	void drawMesh(Mesh * mesh, camera::Camera * camera, window::Window * window)
+	{
+		const unsigned int lod = 0;
+		const std::shared_ptr<GeometryRecord> record = mesh->getGeometry()->getRecord();
+		GLState & state = GLState::get();
+		state.invalidate();
+		updateFrameUniforms(camera, window);
+		state.stencilFunc(GL_ALWAYS, 1, 0xFF);
+		state.stencilMask(0xFF);
+		drawDirect(&mesh, &record, &lod, 1, NULL, 1.0f, camera, window);
+	}
+	/*!
+	*	\brief render all stored scene meshes
+	*
+	* \param camera::Camera * camera : camera filming the scene (will be used in projecting the mesh correctly)
+	* \param window::Window * window : viewport window (will be used in projecting the mesh correctly)
+	* \return draws all scene on current viewport and using input camera specifications
+	*
+	* \note Make use of the stencil buffer (renders all mesh on the stencil buffer) \n
+	*		Meshes whose geometry is still loading in the background (cf MeshLoader) are skipped \n
+	*		The per mesh work is prepared on every core (cf prepareMeshes): levels of detail (cf selectLOD), \n
+	*		frustum culling, occlusion culling against the occluders (cf addOccluder), \n
+	*		sort keys recorded in per thread command buffers; the GL thread merges and draws them \n
+	*		Draws go through a RenderQueue sorted by program, textures, material and depth: \n
+	*		meshes sharing a shader or textures do not bind them again (cf getRenderStats), \n
+	*		or through the IndirectRenderer with the indirect shader when multi-draw indirect is enabled (cf setIndirectDraw) \n
+	*		Instanced meshes follow, one instanced draw call each (neither culled nor sorted) \n
+	*		The uniform blocks are updated first (cf updateFrameUniforms): shaders declaring them get no per program glUniform* call
+	*/
+	void drawMeshes(camera::Camera * camera, window::Window * window)
+	{
+		// the engine library and the demos may have changed the context since the last call
+		GLState & state = GLState::get();
+		state.invalidate();
+		updateFrameUniforms(camera, window);
+
+		const bool indirect = indirectShader != NULL && IndirectRenderer::isSupported();
+		renderQueue.clear();
+		indirectRenderer.clear();
+		prepareMeshes(camera, window, indirect);
+		// meshes the arenas cannot take go through the render queue
+		for (size_t t = 0; t < prepareBuffers.size() && indirect; ++t)
+		{
+			const std::vector<std::pair<size_t, float> > & candidates = prepareBuffers[t]->indirect;
+			for (size_t k = 0; k < candidates.size(); ++k)
+			{
+				const size_t i = candidates[k].first;
+				if (!indirectRenderer.push(meshes[i], meshRecords[i], meshLODs[i]))
+					renderQueue.push(meshes[i], meshRecords[i].get(), candidates[k].second, 0, meshLODs[i]);
+			}
+		}
+		renderQueue.endRecording();
+
+		// every mesh writes 1 in the stencil buffer (cf outlineMeshes), set once for the whole queue
+		state.stencilFunc(GL_ALWAYS, 1, 0xFF);
+		state.stencilMask(0xFF);
+		renderQueue.submit([&](Shader * shader) { linkDefaultUniforms(shader, camera, window); }, &uniformBlocks);
+		renderStats = renderQueue.getStats();
+		if (indirect)
+		{
+			indirectRenderer.submit(indirectShader, [&](Shader * shader) { linkUniformBlocks(shader, camera, window); });
+			renderStats += indirectRenderer.getStats();
+		}
+
+		for (size_t i = 0; i < instancedMeshes.size(); ++i)
+		{
+			linkUniformBlocks(instancedMeshes[i]->getMaterial()->getShader(), camera, window);
+			instancedMeshes[i]->render();
+		}
+	}
+	/*!
+	*	\brief render all stored scene meshes using input shader for every mesh
+	*
+	* \param camera::Camera * camera : camera filming the scene (will be used in projecting the mesh correctly)
+	* \param window::Window * window : viewport window (will be used in projecting the mesh correctly)
+	* \param Shader * shader : custom shader to use for all meshes
+	* \param unsigned int lodBias : levels added to the selection, to force coarser meshes (e.g. in a shadow pass)
+	* \return draws all scene on current viewport and using input camera specifications
+	*
+	* \note uses input Shader to draw the meshes and not their current Material \n
+	*		Each mesh is drawn at the level of detail picked for input camera (cf selectLOD, as drawMeshes), neither culled nor sorted
+	*/
+	void drawMeshes(camera::Camera * camera, window::Window * window, Shader * shader, unsigned int lodBias = 0)
+	{
+		GLState & state = GLState::get();
+		state.invalidate();
+		updateFrameUniforms(camera, window);
+		resolveRecords();
+		const FrameView view = viewOf(camera, window, lodBias);
+		JobSystem::get().parallelFor(meshes.size(), PREPARE_GRAIN, [&](size_t first, size_t last, unsigned int) {
+			for (size_t i = first; i < last; ++i)
+				selectLOD(view, i);
+		});
+		state.stencilFunc(GL_ALWAYS, 1, 0xFF);
+		state.stencilMask(0xFF);
+		if (!meshes.empty())
+			drawDirect(&meshes[0], &meshRecords[0], &meshLODs[0], meshes.size(), shader, 1.0f, camera, window);
+	}
+
+	/*!
+	*	\brief Render the mesh outline (using the stencil buffer) \n
+	*			The scene is re-rendered using the stencil buffer as a mask. \n
+	*			Previous rendering (that updated the stencil buffer) is unafected
+	*
+	* \param Shader * stencilShader : shader to use when rendering the scene => outline aspect
+	* \param camera::Camera * camera : camera filming the scene (will be used in projecting the mesh correctly)
+	* \param window::Window * window : viewport window (will be used in projecting the mesh correctly)
+	* \return draws the scene meshes slightly larger that current dimension but using stencil buffer as a mask (ie discarding previously rendered pixels)
+	*/
+	void outlineMeshes(Shader * stencilShader, camera::Camera * camera, window::Window * window)
+	{
+		// size of the outline, relative to the meshes
+		static const float outlineScale = 1.1f;
+		GLState & state = GLState::get();
+		state.invalidate();
+		updateFrameUniforms(camera, window);
+		resolveRecords();
+		state.stencilFunc(GL_NOTEQUAL, 1, 0xFF);
+		state.stencilMask(0x00);
+		state.disable(GL_DEPTH_TEST);
+		if (!meshes.empty())
+			drawDirect(&meshes[0], &meshRecords[0], &meshLODs[0], meshes.size(), stencilShader, outlineScale, camera, window);
+		state.stencilMask(0xFF);
+		state.enable(GL_DEPTH_TEST);
+	}
+	/*!
+	*	\brief Updates the uniform blocks for a new frame (or a new camera, e.g. a shadow pass): \n
+	*			the default uniforms are read back (cf UniformBlocks::captureDefaults) only when the camera, the controler or the window \n
+	*			changed since the last capture, then sent as FrameUniforms and ObjectUniforms record 0, both bound to their binding points
+	*
+	* \param camera::Camera * camera : camera filming the scene
+	* \param window::Window * window : viewport window
+	* \return called by drawMeshes; call it before drawing without it (drawMesh, outlineMeshes, linkUniformBlocks...)
+	*/
+	void updateFrameUniforms(camera::Camera * camera, window::Window * window)
+	{
+		const FrameKey key = FrameKey::of(camera, window);
+		if (!defaultsCaptured || !(key == capturedKey))
+		{
+			capturedDefaults = uniformBlocks.captureDefaults([&](Shader * shader) { linkDefaultUniforms(shader, camera, window); });
+			capturedKey = key;
+			defaultsCaptured = true;
+		}
+
+		std::pair<FrameUniforms, ObjectUniforms> defaults = capturedDefaults;
+		const std::pair<float, float> nearFar = camera->getNearFarPlane();
+		defaults.first.cameraPosition = glm::vec4(camera->getCameraPosition(), 1.0f);
+		defaults.first.viewport = glm::vec4(static_cast<float>(window->getWidth()), static_cast<float>(window->getHeight()), nearFar.first, nearFar.second);
+		uniformBlocks.setFrame(defaults.first, defaults.second);
+	}
+	/*!
+	*	\brief Uses a program and links its default uniforms for a draw outside the render queue: \n
+	*			its uniform blocks are bound to the current frame (ObjectUniforms record 0, cf updateFrameUniforms); \n
+	*			a program without ObjectUniforms gets the plain uniforms (cf linkDefaultUniforms)
+	*
+	* \param Shader * shader : shader about to draw
+	* \param camera::Camera * camera : camera filming the scene
+	* \param window::Window * window : viewport window
+	*/
+	void linkUniformBlocks(Shader * shader, camera::Camera * camera, window::Window * window)
+	{
+		GLState::get().useProgram(shader->Program);
+		if (uniformBlocks.bindProgram(shader))
+			uniformBlocks.bindObject(0);
+		else
+			linkDefaultUniforms(shader, camera, window);
+	}
+	/*!
+	*	\brief returns the level of detail of a mesh picked by the last drawMeshes
+	*
+	* \param size_t index : mesh index, in the order of addMesh
+	*/
+	unsigned int getMeshLOD(size_t index) const
+	{
+		return index < meshLODs.size() ? meshLODs[index] : 0;
+	}
+	/*!
+	*	\brief Frame preparation, on every thread of the JobSystem (no OpenGL call): \n
+	*			meshes are cut in chunks of PREPARE_GRAIN; for each chunk, a thread picks the levels of detail (cf selectLOD), \n
+	*			tests the bounds 4 at a time (cf frustumCulling::cull) then against the occlusion buffer (cf addOccluder), \n
+	*			and records the visible meshes with their sort keys in its own \n
+	*			command buffer of the render queue (cf RenderQueue::record), or keeps them for the IndirectRenderer
+	*
+	* \param camera::Camera * camera : camera filming the scene
+	* \param window::Window * window : viewport window
+	* \param bool indirect : the visible meshes are kept in prepareBuffers for IndirectRenderer::push instead of recorded
+	* \return the render queue is recording (cf RenderQueue::endRecording), getCullingStats is updated
+	*/
+	void prepareMeshes(camera::Camera * camera, window::Window * window, bool indirect)
+	{
+		JobSystem & jobs = JobSystem::get();
+		const unsigned int nbThreads = jobs.getThreadCount();
+		while (prepareBuffers.size() < nbThreads)
+			prepareBuffers.push_back(std::unique_ptr<PrepareBuffer>(new PrepareBuffer()));
+		for (size_t t = 0; t < prepareBuffers.size(); ++t)
+		{
+			prepareBuffers[t]->indirect.clear();
+			prepareBuffers[t]->stats = CullingStats();
+		}
+		renderQueue.beginRecording(nbThreads);
+		meshVisible.assign(meshes.size(), 1);
+		resolveRecords();
+
+		FrameView view = viewOf(camera, window, 0);
+		view.culling = frustumCullingEnabled;
+		view.occlusion = rasterizeOccluders(camera->getProjectionMatrix() * camera->getViewMatrix());
+		view.indirect = indirect;
+
+		jobs.parallelFor(meshes.size(), PREPARE_GRAIN, [&](size_t first, size_t last, unsigned int thread) {
+			prepareRange(view, first, last, thread);
+		});
+
+		cullingStats = CullingStats();
+		for (size_t t = 0; t < prepareBuffers.size(); ++t)
+		{
+			cullingStats.tested += prepareBuffers[t]->stats.tested;
+			cullingStats.visible += prepareBuffers[t]->stats.visible;
+			cullingStats.occluded += prepareBuffers[t]->stats.occluded;
+		}
+	}
+
+	/*!
+	*	\brief Occluders rasterization, on the GL thread before prepareMeshes' jobs (the tiles are filled on every thread)
+	*
+	* \param const glm::mat4 & viewProjection : projection * view matrix of the camera
+	* \return false if occlusion culling is disabled or there is nothing to rasterize (every mesh is then kept)
+	*/
+	bool rasterizeOccluders(const glm::mat4 & viewProjection)
+	{
+		if (!occlusionCullingEnabled || occluders.empty())
+			return false;
+
+		occlusionBuffer.clear(viewProjection);
+		for (size_t o = 0; o < occluders.size(); ++o)
+		{
+			Geometry * geometry = occluders[o]->getGeometry();
+			if (!geometry->isReady() || geometry->getVertices()->empty())
+				continue;
+			const std::vector<Vertex> & vertices = *geometry->getVertices();
+			const glm::mat4 model = glm::translate(glm::mat4(1.0f), occluders[o]->getWorldSpacePosition());
+			const std::vector<unsigned int> & indices = *geometry->getIndices();
+			if (indices.empty())
+				occlusionBuffer.addOccluder(&vertices[0].Position, sizeof(Vertex), NULL, vertices.size(), model);
+			else
+			{
+				// full resolution: a simplified level may bulge out of the mesh and hide what it does not
+				const LevelOfDetail lod = geometry->getLOD(0);
+				occlusionBuffer.addOccluder(&vertices[0].Position, sizeof(Vertex), &indices[lod.firstIndex], lod.indexCount, model);
+			}
+		}
+		if (occlusionBuffer.getTriangleCount() == 0)
+			return false;
+		occlusionBuffer.rasterize();
+		return true;
+	}
+
+
+private:
+	////////////////////
+	//  Scene Data
+	////////////////////
+	//! Mesh data
+	/*! Meshes drawn by SceneRenderer, in the order of addMesh (the Scene keeps its own list for the engine library)
+	*/
+	std::vector<Mesh *> meshes;
+	//! Instanced mesh data
+	/*! A list of previously allocated instanced meshes
+	*/
+	std::vector<InstancedMesh *> instancedMeshes;
+	//! LOD selection threshold
+	/*! maximum projected error of a level of detail, in pixels (cf selectLOD)
+	*/
+	float lodPixelError = 1.0f;
+	//! Mesh render state
+	/*! GeometryRecord of every mesh, looked up on the GL thread for the frame (cf resolveRecords), and its level of detail
+	*/
+	std::vector<std::shared_ptr<GeometryRecord> > meshRecords;
+	std::vector<unsigned int> meshLODs;
+	//! Render queue
+	/*! draws of the current frame, sorted to skip redundant binds (cf drawMeshes)
+	*/
+	RenderQueue renderQueue;
+	//! Multi-draw indirect
+	/*! indirect shader (NULL => disabled, cf setIndirectDraw), geometry arenas and per frame draws, counters of both paths
+	*/
+	Shader * indirectShader = NULL;
+	IndirectRenderer indirectRenderer;
+	RenderStats renderStats;
+	//! Uniform blocks
+	/*! FrameUniforms and ObjectUniforms buffers, and the default uniforms captured for the last camera (cf updateFrameUniforms)
+	*/
+	struct FrameKey
+	{
+		glm::mat4 viewMatrix, projectionMatrix;
+		glm::vec3 cameraPosition;
+		glm::vec3 controler; /**< X and Y rotation, zoom */
+		size_t width, height;
+
+		static FrameKey of(camera::Camera * camera, window::Window * window)
+		{
+			controler::Controler * input = window->getControler();
+			FrameKey key;
+			key.viewMatrix = camera->getViewMatrix();
+			key.projectionMatrix = camera->getProjectionMatrix();
+			key.cameraPosition = camera->getCameraPosition();
+			key.controler = glm::vec3(input->getXRotation(), input->getYRotation(), input->getZoom());
+			key.width = window->getWidth();
+			key.height = window->getHeight();
+			return key;
+		}
+		bool operator==(const FrameKey & other) const
+		{
+			return viewMatrix == other.viewMatrix && projectionMatrix == other.projectionMatrix && cameraPosition == other.cameraPosition
+				&& controler == other.controler && width == other.width && height == other.height;
+		}
+	};
+	UniformBlocks uniformBlocks;
+	bool defaultsCaptured = false;
+	FrameKey capturedKey;
+	std::pair<FrameUniforms, ObjectUniforms> capturedDefaults;
+	//! Frustum culling
+	/*! switch, and the visibility of every mesh (the bounds are tested per chunk, cf PrepareBuffer)
+	*/
+	bool frustumCullingEnabled = true;
+	std::vector<unsigned char> meshVisible;
+	CullingStats cullingStats;
+	//! Occlusion culling
+	/*! switch, meshes rasterized as occluders, and their depth buffer (cf addOccluder)
+	*/
+	bool occlusionCullingEnabled = true;
+	std::vector<Mesh *> occluders;
+	OcclusionBuffer occlusionBuffer;
+	//! Frame preparation
+	/*! camera values of the frame, and one buffer per JobSystem thread (cf prepareMeshes)
+	*/
+	static const size_t PREPARE_GRAIN = 256;
+	struct FrameView
+	{
+		glm::vec3 cameraPosition;
+		float nearPlane, farPlane, pixelsPerUnit;
+		unsigned int lodBias;
+		frustumCulling::Frustum frustum;
+		bool culling, occlusion, indirect;
+	};
+	struct PrepareBuffer
+	{
+		frustumCulling::Bounds bounds;
+		std::vector<size_t> ready; /**< meshes of the chunk whose geometry is loaded */
+		std::vector<size_t> tested; /**< meshes of the chunk with known bounds */
+		std::vector<unsigned char> visible;
+		std::vector<std::pair<size_t, float> > indirect; /**< visible meshes (indices) and depths, for the IndirectRenderer */
+		CullingStats stats;
+	};
+	std::vector<std::unique_ptr<PrepareBuffer> > prepareBuffers;
+
+	/*!
+	*	\brief Looks up the GeometryRecord of every mesh, on the GL thread: the JobSystem threads then only read them
+	*/
+	void resolveRecords()
+	{
+		meshRecords.resize(meshes.size());
+		meshLODs.resize(meshes.size(), 0);
+		for (size_t i = 0; i < meshes.size(); ++i)
+			meshRecords[i] = meshes[i]->getGeometry()->getRecord();
+	}
+
+	/*!
+	*	\brief Camera values of a frame (culling, occlusion and indirect disabled)
+	*/
+	static FrameView viewOf(camera::Camera * camera, window::Window * window, unsigned int lodBias)
+	{
+		FrameView view;
+		view.cameraPosition = camera->getCameraPosition();
+		view.nearPlane = camera->getNearFarPlane().first;
+		view.farPlane = camera->getNearFarPlane().second;
+		view.pixelsPerUnit = 0.5f * static_cast<float>(window->getHeight()) * camera->getProjectionMatrix()[1][1];
+		view.lodBias = lodBias;
+		view.frustum = frustumCulling::extract(camera->getProjectionMatrix() * camera->getViewMatrix());
+		view.culling = view.occlusion = view.indirect = false;
+		return view;
+	}
+
+	/*!
+	*	\brief Picks the level of detail of a mesh from its resolved record: the coarsest level whose object space error, \n
+	*			seen from the camera at the distance of the mesh bounding sphere, stays under the pixel threshold (cf setLODPixelError), \n
+	*			plus the bias of the view
+	*/
+	void selectLOD(const FrameView & view, size_t i)
+	{
+		const GeometryRecord & record = *meshRecords[i];
+		meshLODs[i] = 0;
+		if (!record.ready || record.getLODCount() == 1)
+			return;
+
+		const glm::vec3 center = meshes[i]->getWorldSpacePosition() + 0.5f * (record.boundsMin + record.boundsMax);
+		const float radius = 0.5f * glm::length(record.boundsMax - record.boundsMin);
+		const float distance = std::max(glm::length(center - view.cameraPosition) - radius, view.nearPlane);
+
+		meshLODs[i] = std::min(record.selectLOD(distance, view.pixelsPerUnit, lodPixelError) + view.lodBias, record.getLODCount() - 1);
+	}
+
+	/*!
+	*	\brief Prepares meshes [first, last) on a JobSystem thread (cf prepareMeshes)
+	*/
+	void prepareRange(const FrameView & view, size_t first, size_t last, unsigned int thread)
+	{
+		PrepareBuffer & buffer = *prepareBuffers[thread];
+		buffer.ready.clear();
+		buffer.tested.clear();
+		buffer.bounds.clear();
+		for (size_t i = first; i < last; ++i)
+		{
+			const GeometryRecord & record = *meshRecords[i];
+			if (!record.ready)
+				continue;
+			selectLOD(view, i);
+			buffer.ready.push_back(i);
+
+			glm::vec3 center;
+			float radius;
+			if (!(view.culling || view.occlusion) || !record.getBoundingSphere(&center, &radius))
+				continue;
+			buffer.bounds.push(meshes[i]->getWorldSpacePosition() + center, 0.5f * (record.boundsMax - record.boundsMin), radius);
+			buffer.tested.push_back(i);
+		}
+
+		if (!buffer.tested.empty())
+		{
+			buffer.visible.resize(buffer.tested.size());
+			if (view.culling)
+			{
+				buffer.stats.tested += static_cast<unsigned int>(buffer.tested.size());
+				buffer.stats.visible += static_cast<unsigned int>(frustumCulling::cull(view.frustum, buffer.bounds, &buffer.visible[0]));
+			}
+			else
+				std::fill(buffer.visible.begin(), buffer.visible.end(), static_cast<unsigned char>(1));
+			for (size_t k = 0; k < buffer.tested.size(); ++k)
+			{
+				const size_t i = buffer.tested[k];
+				if (view.occlusion && buffer.visible[k])
+				{
+					const GeometryRecord & record = *meshRecords[i];
+					const glm::vec3 position = meshes[i]->getWorldSpacePosition();
+					if (!occlusionBuffer.isVisible(position + record.boundsMin, position + record.boundsMax))
+					{
+						buffer.visible[k] = 0;
+						++buffer.stats.occluded;
+					}
+				}
+				meshVisible[i] = buffer.visible[k];
+			}
+		}
+
+		for (size_t k = 0; k < buffer.ready.size(); ++k)
+		{
+			const size_t i = buffer.ready[k];
+			if (!meshVisible[i])
+				continue;
+			const GeometryRecord & record = *meshRecords[i];
+			const glm::vec3 center = meshes[i]->getWorldSpacePosition() + 0.5f * (record.boundsMin + record.boundsMax);
+			const float depth = glm::length(center - view.cameraPosition) / view.farPlane;
+			if (view.indirect)
+				buffer.indirect.push_back(std::make_pair(i, depth));
+			else
+				renderQueue.record(thread, meshes[i], meshRecords[i].get(), depth, 0, meshLODs[i]);
+		}
+	}
+
+	/*!
+	*	\brief Draws meshes one after the other, outside the render queue (drawMesh, drawMeshes with a shader, outlineMeshes): \n
+	*			the model matrices (times the geometry's dequantization, cf RenderQueue::submit) are sent in one upload of object records \n
+	*			(or per mesh, as plain uniforms), the default uniforms are linked once per program, the materials are bound to the program in use
+	*
+	* \param Mesh * const * list : meshes to draw, whose geometry may still be loading (skipped, cf GeometryRecord::draw)
+	* \param const std::shared_ptr<GeometryRecord> * records : record of every mesh geometry (cf resolveRecords)
+	* \param const unsigned int * lods : level of detail of every mesh
+	* \param size_t count : number of meshes
+	* \param Shader * shader : shader used for every mesh instead of its material's (the material is then not bound), NULL => material shaders
+	* \param float scale : scaling of the meshes around their origin
+	* \param camera::Camera * camera : camera filming the scene
+	* \param window::Window * window : viewport window
+	* \return the frame uniforms have to be updated first (cf updateFrameUniforms)
+	*/
+	void drawDirect(Mesh * const * list, const std::shared_ptr<GeometryRecord> * records, const unsigned int * lods, size_t count, Shader * shader, float scale, camera::Camera * camera, window::Window * window)
+	{
+		static const unsigned int modelSlot = ProgramReflection::slotOf("modelMatrix");
+		GLState & state = GLState::get();
+		const ObjectUniforms defaults = uniformBlocks.getDefaultObject();
+		const glm::mat4 scaling = glm::scale(glm::mat4(1.0f), glm::vec3(scale));
+
+		const size_t firstObject = uniformBlocks.reserveObjects(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			ObjectUniforms object = defaults;
+			object.modelMatrix = glm::translate(glm::mat4(1.0f), list[i]->getWorldSpacePosition()) * scaling * defaults.modelMatrix * records[i]->getDequantizationMatrix();
+			uniformBlocks.writeObject(firstObject + i, object);
+		}
+		uniformBlocks.uploadObjects();
+
+		GLuint program = 0;
+		bool objectBlock = false;
+		GLint modelLocation = -1;
+		bool texturesBound = false;
+		for (size_t i = 0; i < count; ++i)
+		{
+			Material * material = list[i]->getMaterial();
+			Shader * current = shader != NULL ? shader : material->getShader();
+			if (current->Program != program)
+			{
+				program = current->Program;
+				state.useProgram(program);
+				objectBlock = uniformBlocks.bindProgram(current);
+				modelLocation = -1;
+				if (!objectBlock)
+				{
+					linkDefaultUniforms(current, camera, window);
+					modelLocation = ProgramReflection::of(program).location(modelSlot);
+				}
+			}
+			if (shader == NULL)
+			{
+				material->linkUniforms(current);
+				material->bindTextures(current);
+				texturesBound = true;
+			}
+
+			if (objectBlock)
+				uniformBlocks.bindObject(firstObject + i);
+			else if (modelLocation >= 0)
+			{
+				const glm::mat4 model = glm::translate(glm::mat4(1.0f), list[i]->getWorldSpacePosition()) * scaling * defaults.modelMatrix * records[i]->getDequantizationMatrix();
+				glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+			}
+			records[i]->draw(lods[i]);
+		}
+
+		if (texturesBound)
+		{
+			list[count - 1]->getMaterial()->unbindMaterial();
+			state.invalidateTextures();
+		}
+	}
+
+
+};
+
+/*@}*/
+
+}
+
+#endif
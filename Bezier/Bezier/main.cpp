@@ -28,9 +28,10 @@
 #include <OpenGLEngine\textureInterface.hpp> // texture wrapper
 #include <OpenGLEngine\uniformInterface.hpp> // uniform wrapper
 #include <OpenGLEngine\mesh.hpp> // mesh wrapper
-#include <OpenGLEngine\scene.hpp> // scene manager
+#include <OpenGLEngine\sceneRenderer.hpp> // scene manager
 #include <OpenGLEngine\frameBuffer.hpp> // FBO wrapper
 #include <OpenGLEngine\renderBuffer.hpp> // RBO wrapper
+#include <OpenGLEngine\gpuProfiler.hpp> // GPU time per render pass (timer queries)
 
 
 ////////////////////////
@@ -125,13 +126,9 @@ int main(int argc, char ** argv)
 	// SHADERS
 	// NB: No support for tesselation nor geometry shaders in current build
 	/////////////////////////////
-	OpenGLEngine::Shader bezierCurveShader("quad.vert", "quad.frag");
-	bezierCurveShader.addGeometryShader("quad.geom");
-	bezierCurveShader.addTesselationShader("quad.tesc", "quad.tese");
+	OpenGLEngine::Shader bezierCurveShader("quad.vert", "quad.tesc", "quad.tese", "quad.geom", "quad.frag");
 
-	OpenGLEngine::Shader bezierSurfaceShader("surface.vert", "surface.frag");
-	bezierSurfaceShader.addGeometryShader("surface.geom");
-	bezierSurfaceShader.addTesselationShader("surface.tesc", "surface.tese");
+	OpenGLEngine::Shader bezierSurfaceShader("surface.vert", "surface.tesc", "surface.tese", "surface.geom", "surface.frag");
 
 	OpenGLEngine::Shader pointShader("point.vert", "point.frag");
 
@@ -226,9 +223,9 @@ int main(int argc, char ** argv)
 	//
 	// Memory managment is left to the user. No copies are done
 	//
-	// => <OpenGLEngine\scene.hpp>
+	// => <OpenGLEngine\sceneRenderer.hpp>
 	////////////////////////
-	OpenGLEngine::Scene scene;
+	OpenGLEngine::SceneRenderer scene;
 
 
 	// Create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
@@ -247,11 +244,13 @@ int main(int argc, char ** argv)
 	////////////////////////
 
 	stopWatch timer; // FPS counter
+	OpenGLEngine::GPUProfiler profiler; // GPU time per pass, read back a few frames later (no glFinish)
 
 	// Render loop
 	while (window.isOpen())
 	{
 		timer.start();
+		profiler.beginFrame();
 
 		////////////////////////
 		//	- Update Events
@@ -276,14 +275,15 @@ int main(int argc, char ** argv)
 		// 1st render pass: draw object as normal and fill stencil buffer
 		//scene.drawMeshes(&camera, &window);
 		//bezierCurveShader.Use();
-		scene.linkDefaultUniforms(&bezierSurfaceShader, &camera, &window);
+		scene.updateFrameUniforms(&camera, &window);
+		scene.linkUniformBlocks(&bezierSurfaceShader, &camera, &window);
 
 		glBindVertexArray(VAO);
 		glDrawArrays(GL_PATCHES, 0, 16);
 		glBindVertexArray(0);
 		
 		//pointShader.Use();
-		scene.linkDefaultUniforms(&pointShader, &camera, &window);
+		scene.linkUniformBlocks(&pointShader, &camera, &window);
 
 		glBindVertexArray(VAO);
 		glDrawArrays(GL_POINTS, 0, 16);
@@ -297,22 +297,31 @@ int main(int argc, char ** argv)
 
 
 
+		profiler.endFrame();
+
 		// Swap the screen buffers
 		window.draw();
 
-		// Syncronyse
-		glFinish();
-
 
 		timer.end();
 		double render_time = timer.time();
-		std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+		// every 120 frames: CPU frame time and GPU time of each pass
+		if (profiler.getFrameCount() % 120 == 0)
+		{
+			std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+			profiler.print(std::cout);
+		}
 	}
 
 	// Melete meshes
 	// Properly de-allocate all resources once they've outlived their purpose
 	// => done in mesh desctuctor
 
+	// GPU time statistics of the last frames
+	profiler.flush();
+	profiler.writeCSV("gpuProfile.csv");
+	profiler.writeJSON("gpuProfile.json");
+
 	window.isClosed();
 
 
@@ -1,9 +1,18 @@
 #version 330 core
 layout (location = 0) in vec3 position;
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+// default uniforms (cf OpenGLEngine::UniformBlocks)
+layout (std140) uniform FrameUniforms {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	mat4 cameraMovment;
+	vec4 cameraPosition;
+	vec4 viewport;
+};
+layout (std140) uniform ObjectUniforms {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
 
 void main()
 {
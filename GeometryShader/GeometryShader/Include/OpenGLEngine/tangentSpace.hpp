@@ -0,0 +1,370 @@
+#ifndef TANGENTSPACE_HPP
+#define TANGENTSPACE_HPP
+
+
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <cmath>
+#include <cstddef>
+
+////////////////////////
+// SIMD
+////////////////////////
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OPENGLENGINE_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "parser.hpp" // parser::parallelRanges
+
+namespace OpenGLEngine
+{
+
+/**
+* \file tangentSpace.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup MESH */
+/*@{*/
+
+
+/*!
+*  \brief Tangent space generation: \n
+*		"Computing Tangent Space Basis Vectors for an Arbitrary Mesh (Lengyel's Method)" by Eric Lengyel \n
+*		C.f: http://www.terathon.com/code/tangent.html \n
+*
+*		-# the vertices are split into SoA streams (one array per component)
+*		-# face tangents/bitangents are computed 4 triangles at a time (SSE, scalar fallback), in parallel
+*		-# every vertex sums the faces it belongs to (welded vertices share them), in parallel
+*		-# Gram-Schmidt orthogonalization against the normal, handedness from the bitangent (SSE, scalar fallback)
+*
+*	Works on triangle lists, indexed or not (three consecutive vertices per face). No OpenGL call is made.
+*
+*	\code{.cpp}
+*		tangentSpace::compute(&vertices, &indices); // Tangeant & BiTangeant of every vertex
+*	\endcode
+*/
+namespace tangentSpace
+{
+	/*!
+	*  \brief Streams: \n
+	*		SoA copy of the vertex attributes needed by the generator
+	*/
+	struct Streams
+	{
+		std::vector<float> px, py, pz; /**< positions */
+		std::vector<float> nx, ny, nz; /**< normals */
+		std::vector<float> u, v; /**< texture coordinates */
+
+		size_t size() const { return px.size(); }
+	};
+
+	/*!
+	*  \brief Frames: \n
+	*		SoA tangent frames: unit tangent orthogonal to the normal, and handedness (bitangent = w * cross(normal, tangent))
+	*/
+	struct Frames
+	{
+		std::vector<float> tx, ty, tz; /**< tangents */
+		std::vector<float> w; /**< handedness: +1 or -1 */
+	};
+
+	/*!
+	*  \brief Splits vertices into SoA streams
+	* \param const std::vector<V> & vertices : source vertices (struct with Position, Normal, TexCoords members)
+	* \param Streams * streams : SoA output
+	*/
+	template<typename V>
+	void gather(const std::vector<V> & vertices, Streams * streams)
+	{
+		const size_t count = vertices.size();
+		streams->px.resize(count); streams->py.resize(count); streams->pz.resize(count);
+		streams->nx.resize(count); streams->ny.resize(count); streams->nz.resize(count);
+		streams->u.resize(count); streams->v.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const V & vertex = vertices[i];
+			streams->px[i] = vertex.Position.x; streams->py[i] = vertex.Position.y; streams->pz[i] = vertex.Position.z;
+			streams->nx[i] = vertex.Normal.x; streams->ny[i] = vertex.Normal.y; streams->nz[i] = vertex.Normal.z;
+			streams->u[i] = vertex.TexCoords.x; streams->v[i] = vertex.TexCoords.y;
+		}
+	}
+
+	/*!
+	*  \brief Face tangents and bitangents (unnormalized, i.e area weighted) of triangles [first, last)
+	* \param const Streams & s : vertex streams
+	* \param const unsigned int * indices : triangle list (NULL => not indexed)
+	* \param size_t first, size_t last : triangle range
+	* \param float * face[6] : SoA output (sx, sy, sz, tx, ty, tz), one entry per triangle
+	* \note triangles with degenerate texture coordinates get a null tangent
+	*/
+	inline void faceTangents(const Streams & s, const unsigned int * indices, size_t first, size_t last, float * const face[6])
+	{
+		size_t t = first;
+#ifdef OPENGLENGINE_USE_SSE
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		unsigned int identity[12];
+		for (; t + 4 <= last; t += 4)
+		{
+			const unsigned int * tri = indices != NULL ? indices + 3 * t : identity;
+			if (indices == NULL)
+				for (unsigned int k = 0; k < 12; ++k)
+					identity[k] = static_cast<unsigned int>(3 * t) + k;
+#define OPENGLENGINE_GATHER(stream, k) _mm_set_ps(s.stream[tri[9 + k]], s.stream[tri[6 + k]], s.stream[tri[3 + k]], s.stream[tri[k]])
+			const __m128 x0 = OPENGLENGINE_GATHER(px, 0), y0 = OPENGLENGINE_GATHER(py, 0), z0 = OPENGLENGINE_GATHER(pz, 0);
+			const __m128 x1 = OPENGLENGINE_GATHER(px, 1), y1 = OPENGLENGINE_GATHER(py, 1), z1 = OPENGLENGINE_GATHER(pz, 1);
+			const __m128 x2 = OPENGLENGINE_GATHER(px, 2), y2 = OPENGLENGINE_GATHER(py, 2), z2 = OPENGLENGINE_GATHER(pz, 2);
+			const __m128 u0 = OPENGLENGINE_GATHER(u, 0), v0 = OPENGLENGINE_GATHER(v, 0);
+			const __m128 u1 = OPENGLENGINE_GATHER(u, 1), v1 = OPENGLENGINE_GATHER(v, 1);
+			const __m128 u2 = OPENGLENGINE_GATHER(u, 2), v2 = OPENGLENGINE_GATHER(v, 2);
+#undef OPENGLENGINE_GATHER
+
+			const __m128 e1x = _mm_sub_ps(x1, x0), e1y = _mm_sub_ps(y1, y0), e1z = _mm_sub_ps(z1, z0);
+			const __m128 e2x = _mm_sub_ps(x2, x0), e2y = _mm_sub_ps(y2, y0), e2z = _mm_sub_ps(z2, z0);
+			const __m128 s1 = _mm_sub_ps(u1, u0), s2 = _mm_sub_ps(u2, u0);
+			const __m128 t1 = _mm_sub_ps(v1, v0), t2 = _mm_sub_ps(v2, v0);
+
+			const __m128 det = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+			const __m128 r = _mm_and_ps(_mm_cmpneq_ps(det, zero), _mm_div_ps(one, det));
+
+			_mm_storeu_ps(face[0] + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, e1x), _mm_mul_ps(t1, e2x)), r));
+			_mm_storeu_ps(face[1] + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, e1y), _mm_mul_ps(t1, e2y)), r));
+			_mm_storeu_ps(face[2] + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, e1z), _mm_mul_ps(t1, e2z)), r));
+			_mm_storeu_ps(face[3] + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, e2x), _mm_mul_ps(s2, e1x)), r));
+			_mm_storeu_ps(face[4] + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, e2y), _mm_mul_ps(s2, e1y)), r));
+			_mm_storeu_ps(face[5] + t, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, e2z), _mm_mul_ps(s2, e1z)), r));
+		}
+#endif
+		for (; t < last; ++t)
+		{
+			const unsigned int first3 = static_cast<unsigned int>(3 * t);
+			const unsigned int i0 = indices != NULL ? indices[first3] : first3;
+			const unsigned int i1 = indices != NULL ? indices[first3 + 1] : first3 + 1;
+			const unsigned int i2 = indices != NULL ? indices[first3 + 2] : first3 + 2;
+			const float e1x = s.px[i1] - s.px[i0], e1y = s.py[i1] - s.py[i0], e1z = s.pz[i1] - s.pz[i0];
+			const float e2x = s.px[i2] - s.px[i0], e2y = s.py[i2] - s.py[i0], e2z = s.pz[i2] - s.pz[i0];
+			const float s1 = s.u[i1] - s.u[i0], s2 = s.u[i2] - s.u[i0];
+			const float t1 = s.v[i1] - s.v[i0], t2 = s.v[i2] - s.v[i0];
+
+			const float det = s1 * t2 - s2 * t1;
+			const float r = det != 0.0f ? 1.0f / det : 0.0f;
+
+			face[0][t] = (t2 * e1x - t1 * e2x) * r;
+			face[1][t] = (t2 * e1y - t1 * e2y) * r;
+			face[2][t] = (t2 * e1z - t1 * e2z) * r;
+			face[3][t] = (s1 * e2x - s2 * e1x) * r;
+			face[4][t] = (s1 * e2y - s2 * e1y) * r;
+			face[5][t] = (s1 * e2z - s2 * e1z) * r;
+		}
+	}
+
+	/*!
+	*  \brief Gram-Schmidt orthogonalization and handedness of vertices [first, last) \n
+	*		in: summed tangent (tx,ty,tz) and bitangent (bx,by,bz). out: unit tangent orthogonal to the normal (tx,ty,tz), handedness (w)
+	* \note vertices without a usable tangent (no uv variation, tangent parallel to the normal) get an arbitrary one orthogonal to the normal
+	*/
+	inline void orthogonalize(const Streams & s, float * tx, float * ty, float * tz, const float * bx, const float * by, const float * bz, float * w, size_t first, size_t last)
+	{
+		const float EPSILON = 1e-12f;
+		size_t i = first;
+#ifdef OPENGLENGINE_USE_SSE
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 minusOne = _mm_set1_ps(-1.0f);
+		const __m128 epsilon = _mm_set1_ps(EPSILON);
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		const __m128 limit = _mm_set1_ps(0.9f);
+		for (; i + 4 <= last; i += 4)
+		{
+			const __m128 nx = _mm_loadu_ps(&s.nx[i]), ny = _mm_loadu_ps(&s.ny[i]), nz = _mm_loadu_ps(&s.nz[i]);
+			__m128 x = _mm_loadu_ps(tx + i), y = _mm_loadu_ps(ty + i), z = _mm_loadu_ps(tz + i);
+
+			// t = normalize(t - n * dot(n, t))
+			const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, x), _mm_mul_ps(ny, y)), _mm_mul_ps(nz, z));
+			x = _mm_sub_ps(x, _mm_mul_ps(nx, d));
+			y = _mm_sub_ps(y, _mm_mul_ps(ny, d));
+			z = _mm_sub_ps(z, _mm_mul_ps(nz, d));
+			const __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+			const __m128 degenerate = _mm_cmpngt_ps(length2, epsilon); // NaN lanes included, as in the scalar loop
+			const __m128 invLength = _mm_andnot_ps(degenerate, _mm_div_ps(one, _mm_sqrt_ps(length2)));
+			x = _mm_mul_ps(x, invLength);
+			y = _mm_mul_ps(y, invLength);
+			z = _mm_mul_ps(z, invLength);
+
+			// degenerate lanes: t = normalize(cross(|n.x| < 0.9 ? X : Y, n)), i.e (0, -nz, ny) or (nz, 0, -nx)
+			// selected with and/andnot: t * 0 may be -0.0, whose sign bit an or would keep
+			if (_mm_movemask_ps(degenerate) != 0)
+			{
+				const __m128 useX = _mm_cmplt_ps(_mm_andnot_ps(signMask, nx), limit);
+				const __m128 fx = _mm_andnot_ps(useX, nz);
+				const __m128 fy = _mm_and_ps(useX, _mm_xor_ps(nz, signMask));
+				const __m128 fz = _mm_or_ps(_mm_and_ps(useX, ny), _mm_andnot_ps(useX, _mm_xor_ps(nx, signMask)));
+				const __m128 fLength2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_mul_ps(fz, fz));
+				const __m128 fValid = _mm_cmpgt_ps(fLength2, zero);
+				const __m128 fInvLength = _mm_and_ps(fValid, _mm_div_ps(one, _mm_sqrt_ps(fLength2)));
+				// null normal: the axis itself
+				const __m128 fallbackX = _mm_or_ps(_mm_and_ps(fValid, _mm_mul_ps(fx, fInvLength)), _mm_andnot_ps(fValid, _mm_and_ps(useX, one)));
+				const __m128 fallbackY = _mm_or_ps(_mm_and_ps(fValid, _mm_mul_ps(fy, fInvLength)), _mm_andnot_ps(fValid, _mm_andnot_ps(useX, one)));
+				const __m128 fallbackZ = _mm_and_ps(fValid, _mm_mul_ps(fz, fInvLength));
+				x = _mm_or_ps(_mm_and_ps(degenerate, fallbackX), _mm_andnot_ps(degenerate, x));
+				y = _mm_or_ps(_mm_and_ps(degenerate, fallbackY), _mm_andnot_ps(degenerate, y));
+				z = _mm_or_ps(_mm_and_ps(degenerate, fallbackZ), _mm_andnot_ps(degenerate, z));
+			}
+
+			// w = dot(cross(n, t), b) < 0 ? -1 : 1
+			const __m128 cx = _mm_sub_ps(_mm_mul_ps(ny, z), _mm_mul_ps(nz, y));
+			const __m128 cy = _mm_sub_ps(_mm_mul_ps(nz, x), _mm_mul_ps(nx, z));
+			const __m128 cz = _mm_sub_ps(_mm_mul_ps(nx, y), _mm_mul_ps(ny, x));
+			const __m128 h = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_loadu_ps(bx + i)), _mm_mul_ps(cy, _mm_loadu_ps(by + i))), _mm_mul_ps(cz, _mm_loadu_ps(bz + i)));
+			const __m128 negative = _mm_cmplt_ps(h, zero);
+
+			_mm_storeu_ps(tx + i, x);
+			_mm_storeu_ps(ty + i, y);
+			_mm_storeu_ps(tz + i, z);
+			_mm_storeu_ps(w + i, _mm_or_ps(_mm_and_ps(negative, minusOne), _mm_andnot_ps(negative, one)));
+		}
+#endif
+		for (; i < last; ++i)
+		{
+			const glm::vec3 n(s.nx[i], s.ny[i], s.nz[i]);
+			glm::vec3 t(tx[i], ty[i], tz[i]);
+			t = t - n * glm::dot(n, t);
+			const float length2 = glm::dot(t, t);
+			if (length2 > EPSILON)
+				t = t / std::sqrt(length2);
+			else
+			{
+				const glm::vec3 axis = std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				t = glm::cross(axis, n);
+				const float length = glm::length(t);
+				t = length > 0.0f ? t / length : axis;
+			}
+			tx[i] = t.x; ty[i] = t.y; tz[i] = t.z;
+			w[i] = glm::dot(glm::cross(n, t), glm::vec3(bx[i], by[i], bz[i])) < 0.0f ? -1.0f : 1.0f;
+		}
+	}
+
+	/*!
+	*  \brief Computes the tangent frame of every vertex
+	* \param const Streams & s : vertex streams
+	* \param const unsigned int * indices : triangle list (NULL => not indexed, three consecutive vertices per face)
+	* \param size_t nbTriangles : number of triangles
+	* \param unsigned int nbThreads : number of threads (0 => one per core)
+	* \param Frames * frames : output, one frame per vertex
+	*/
+	inline void compute(const Streams & s, const unsigned int * indices, size_t nbTriangles, unsigned int nbThreads, Frames * frames)
+	{
+		const size_t nbVertices = s.size();
+
+		const bool indexed = indices != NULL;
+
+		// 1. face tangents
+		std::vector<float> faceData(6 * nbTriangles);
+		float * const faceBase = faceData.empty() ? NULL : &faceData[0];
+		float * const face[6] = { faceBase, faceBase + nbTriangles, faceBase + 2 * nbTriangles,
+			faceBase + 3 * nbTriangles, faceBase + 4 * nbTriangles, faceBase + 5 * nbTriangles };
+		if (nbTriangles != 0)
+			parser::parallelRanges(nbTriangles, nbThreads, [&](size_t first, size_t last)
+			{
+				faceTangents(s, indices, first, last, face);
+			});
+
+		// 2. vertex -> triangles adjacency (CSR), not needed without index buffer (vertex v belongs to face v / 3 only)
+		std::vector<unsigned int> offsets;
+		std::vector<unsigned int> adjacency;
+		if (indexed)
+		{
+			offsets.assign(nbVertices + 1, 0);
+			for (size_t i = 0; i < 3 * nbTriangles; ++i)
+				++offsets[indices[i] + 1];
+			for (size_t v = 0; v < nbVertices; ++v)
+				offsets[v + 1] += offsets[v];
+			adjacency.resize(3 * nbTriangles);
+			std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < 3 * nbTriangles; ++i)
+				adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+		}
+
+		// 3. per vertex sum, then orthogonalization
+		frames->tx.assign(nbVertices, 0.0f);
+		frames->ty.assign(nbVertices, 0.0f);
+		frames->tz.assign(nbVertices, 0.0f);
+		frames->w.assign(nbVertices, 1.0f);
+		std::vector<float> bitangents(3 * nbVertices, 0.0f);
+		float * bx = bitangents.empty() ? NULL : &bitangents[0];
+		float * by = bx + nbVertices;
+		float * bz = by + nbVertices;
+		float * tx = frames->tx.empty() ? NULL : &frames->tx[0];
+		float * ty = frames->ty.empty() ? NULL : &frames->ty[0];
+		float * tz = frames->tz.empty() ? NULL : &frames->tz[0];
+		float * w = frames->w.empty() ? NULL : &frames->w[0];
+
+		if (nbVertices != 0)
+			parser::parallelRanges(nbVertices, nbThreads, [&](size_t first, size_t last)
+			{
+				for (size_t v = first; v < last && !indexed; ++v)
+				{
+					const size_t f = v / 3;
+					if (f >= nbTriangles)
+						break; // trailing vertices of an incomplete face keep a null sum
+					tx[v] = face[0][f]; ty[v] = face[1][f]; tz[v] = face[2][f];
+					bx[v] = face[3][f]; by[v] = face[4][f]; bz[v] = face[5][f];
+				}
+				for (size_t v = first; v < last && indexed; ++v)
+				{
+					float sum[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+					for (unsigned int a = offsets[v]; a < offsets[v + 1]; ++a)
+						for (int k = 0; k < 6; ++k)
+							sum[k] += face[k][adjacency[a]];
+					tx[v] = sum[0]; ty[v] = sum[1]; tz[v] = sum[2];
+					bx[v] = sum[3]; by[v] = sum[4]; bz[v] = sum[5];
+				}
+				orthogonalize(s, tx, ty, tz, bx, by, bz, w, first, last);
+			});
+	}
+
+	/*!
+	*  \brief Computes Tangeant and BiTangeant of every vertex (BiTangeant = handedness * cross(Normal, Tangeant))
+	* \param std::vector<V> * vertices : vertices (struct with Position, Normal, TexCoords, Tangeant, BiTangeant members), updated in place
+	* \param const std::vector<unsigned int> * indices : triangle list (NULL or empty => not indexed)
+	* \param unsigned int nbThreads : number of threads (0 => one per core)
+	*/
+	template<typename V>
+	void compute(std::vector<V> * vertices, const std::vector<unsigned int> * indices = NULL, unsigned int nbThreads = 0)
+	{
+		const bool indexed = indices != NULL && !indices->empty();
+		const size_t nbTriangles = indexed ? indices->size() / 3 : vertices->size() / 3;
+
+		Streams streams;
+		gather(*vertices, &streams);
+		Frames frames;
+		compute(streams, indexed ? &(*indices)[0] : NULL, nbTriangles, nbThreads, &frames);
+
+		for (size_t i = 0; i < vertices->size(); ++i)
+		{
+			V & vertex = (*vertices)[i];
+			vertex.Tangeant = glm::vec3(frames.tx[i], frames.ty[i], frames.tz[i]);
+			vertex.BiTangeant = frames.w[i] * glm::cross(vertex.Normal, vertex.Tangeant);
+		}
+	}
+}
+
+/*@}*/
+
+}
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef VERTEXFORMAT_HPP
+#define VERTEXFORMAT_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <cstring>
+#include <cmath>
+
+namespace OpenGLEngine
+{
+
+/**
+* \file vertexFormat.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup MESH */
+/*@{*/
+
+
+/*!
+*  \brief VertexAttribute: \n
+*		Describes one vertex attribute inside an interleaved vertex buffer \n
+*		Maps one to one onto a glVertexAttribPointer call:
+*			\code{.cpp}
+*				glVertexAttribPointer(location, components, type, normalized, stride, (GLvoid*)offset);
+*			\endcode
+*/
+struct VertexAttribute
+{
+	unsigned int location; /**< shader attribute location (layout (location = ...)) */
+	unsigned int components; /**< number of components (1 to 4) */
+	unsigned int type; /**< component type (GL_FLOAT, GL_HALF_FLOAT, GL_INT_2_10_10_10_REV...) */
+	unsigned int normalized; /**< GL_TRUE if integer components are normalized when fetched */
+	unsigned int offset; /**< byte offset of the attribute inside a vertex */
+};
+
+
+/*!
+*  \brief VertexFormat: \n
+*		GPU side layout of a Geometry's vertices. The CPU side array (std::vector<Vertex>) is not affected. \n
+*		Every format keeps the attribute locations of struct Vertex, so shaders need no change: \n
+*		packed attributes are fetched as normalized integers or half floats and reach the shader as vec2/vec3 \n
+*
+*		Format							| Position				| Normal		| TexCoords	| Tangeant, BiTangeant	| Size
+*		--------------------------------|-----------------------|---------------|-----------|-----------------------|---------
+*		VERTEX_FORMAT_FULL				| 3 float				| 3 float		| 2 float	| 3 float each			| 56 bytes
+*		VERTEX_FORMAT_PACKED			| 3 float				| 10_10_10_2	| 2 half	| 10_10_10_2 each		| 28 bytes
+*		VERTEX_FORMAT_PACKED_NO_TANGENT	| 3 float				| 10_10_10_2	| 2 half	| -						| 20 bytes
+*		VERTEX_FORMAT_QUANTIZED			| 4 unsigned short (*)	| 10_10_10_2	| 2 half	| -						| 16 bytes
+*
+*		(*) positions are normalized over the mesh bounding box: position = offset + scale * quantizedPosition. \n
+*			The transform (cf Geometry::getDequantizationMatrix) has to be applied by the vertex shader or folded into the model matrix \n
+*			(SceneRenderer and RenderQueue fold it, IndirectRenderer passes it to the shader). Normals stay in object space. \n
+*		Formats without tangents leave locations 3 and 4 disabled: only use them with shaders that do not read them.
+*/
+enum VertexFormat
+{
+	VERTEX_FORMAT_FULL = 0,
+	VERTEX_FORMAT_PACKED = 1,
+	VERTEX_FORMAT_PACKED_NO_TANGENT = 2,
+	VERTEX_FORMAT_QUANTIZED = 3
+};
+
+
+/*!
+*  \brief Vertex attribute packing: \n
+*		Conversions from float data to the compact GPU formats used by VertexFormat
+*/
+namespace vertexPacking
+{
+	/*!
+	*  \brief Converts a float to an IEEE 754 half float (round to nearest even, overflow to infinity)
+	* \param float value : input value
+	* \return 16 bits half float
+	*/
+	inline unsigned short floatToHalf(float value)
+	{
+		unsigned int bits;
+		std::memcpy(&bits, &value, sizeof(float));
+
+		const unsigned int sign = (bits >> 16) & 0x8000u;
+		const unsigned int absBits = bits & 0x7FFFFFFFu;
+
+		// NaN / infinity
+		if (absBits >= 0x7F800000u)
+			return static_cast<unsigned short>(sign | 0x7C00u | (absBits > 0x7F800000u ? 0x200u : 0u));
+		// overflow
+		if (absBits >= 0x477FF000u)
+			return static_cast<unsigned short>(sign | 0x7C00u);
+		// denormal half (or zero)
+		if (absBits < 0x38800000u)
+		{
+			if (absBits < 0x33000000u)
+				return static_cast<unsigned short>(sign);
+			const unsigned int mantissa = (absBits & 0x007FFFFFu) | 0x00800000u;
+			const unsigned int shift = 126u - (absBits >> 23);
+			unsigned int half = mantissa >> shift;
+			const unsigned int remainder = mantissa & ((1u << shift) - 1u);
+			const unsigned int halfway = 1u << (shift - 1u);
+			if (remainder > halfway || (remainder == halfway && (half & 1u)))
+				++half;
+			return static_cast<unsigned short>(sign | half);
+		}
+		// normal half
+		unsigned int half = ((absBits - 0x38000000u) >> 13);
+		const unsigned int remainder = absBits & 0x1FFFu;
+		if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+			++half;
+		return static_cast<unsigned short>(sign | half);
+	}
+
+	/*!
+	*  \brief Packs a vector into GL_INT_2_10_10_10_REV (signed normalized: x,y,z on 10 bits, w on 2 bits)
+	* \param const glm::vec3 v : components in [-1,1] (clamped)
+	* \param float w : fourth component in [-1,1] (clamped)
+	* \return packed 32 bits value
+	*/
+	inline unsigned int packSnorm10(const glm::vec3 v, float w = 0.0f)
+	{
+		unsigned int packed = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			const int q = static_cast<int>(std::floor(glm::clamp(v[k], -1.0f, 1.0f) * 511.0f + 0.5f));
+			packed |= (static_cast<unsigned int>(q) & 0x3FFu) << (10 * k);
+		}
+		const int qw = static_cast<int>(std::floor(glm::clamp(w, -1.0f, 1.0f) + 0.5f));
+		packed |= (static_cast<unsigned int>(qw) & 0x3u) << 30;
+		return packed;
+	}
+
+	/*!
+	*  \brief Quantizes a float to an unsigned normalized 16 bits integer
+	* \param float value : input in [0,1] (clamped)
+	* \return value * 65535, rounded
+	*/
+	inline unsigned short packUnorm16(float value)
+	{
+		return static_cast<unsigned short>(std::floor(glm::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f));
+	}
+
+	/*!
+	*  \brief Returns the size in bytes of a vertex in a given format
+	*/
+	inline unsigned int vertexSize(VertexFormat format)
+	{
+		switch (format)
+		{
+		case VERTEX_FORMAT_PACKED: return 28;
+		case VERTEX_FORMAT_PACKED_NO_TANGENT: return 20;
+		case VERTEX_FORMAT_QUANTIZED: return 16;
+		default: return 56;
+		}
+	}
+
+	/*!
+	*  \brief Returns the size in bytes of a vertex attribute (0 if its type or number of components is not supported)
+	*/
+	inline unsigned int attributeSize(const VertexAttribute & attribute)
+	{
+		if (attribute.components < 1 || attribute.components > 4)
+			return 0;
+		switch (attribute.type)
+		{
+		case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: return 4 * attribute.components;
+		case GL_HALF_FLOAT: case GL_SHORT: case GL_UNSIGNED_SHORT: return 2 * attribute.components;
+		case GL_BYTE: case GL_UNSIGNED_BYTE: return attribute.components;
+		case GL_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_2_10_10_10_REV: return attribute.components == 4 ? 4 : 0;
+		default: return 0;
+		}
+	}
+
+	/*!
+	*  \brief Returns the vertex layout of a packed format (VERTEX_FORMAT_FULL is described by Geometry::vertexLayout)
+	* \param VertexFormat format : packed format
+	* \return one VertexAttribute per enabled location
+	*/
+	inline std::vector<VertexAttribute> packedLayout(VertexFormat format)
+	{
+		std::vector<VertexAttribute> layout;
+		const VertexAttribute position = { 0, 3, GL_FLOAT, GL_FALSE, 0 };
+		const VertexAttribute quantizedPosition = { 0, 4, GL_UNSIGNED_SHORT, GL_TRUE, 0 };
+		const unsigned int normalOffset = format == VERTEX_FORMAT_QUANTIZED ? 8 : 12;
+		const VertexAttribute normal = { 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, normalOffset };
+		const VertexAttribute texCoords = { 2, 2, GL_HALF_FLOAT, GL_FALSE, normalOffset + 4 };
+		const VertexAttribute tangeant = { 3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, normalOffset + 8 };
+		const VertexAttribute biTangeant = { 4, 4, GL_INT_2_10_10_10_REV, GL_TRUE, normalOffset + 12 };
+
+		layout.push_back(format == VERTEX_FORMAT_QUANTIZED ? quantizedPosition : position);
+		layout.push_back(normal);
+		layout.push_back(texCoords);
+		if (format == VERTEX_FORMAT_PACKED)
+		{
+			layout.push_back(tangeant);
+			layout.push_back(biTangeant);
+		}
+		return layout;
+	}
+
+	/*!
+	*  \brief Packs vertices into a compact format
+	*
+	* \param const V * vertices : source vertices (struct with Position, Normal, TexCoords, Tangeant, BiTangeant members)
+	* \param size_t count : number of vertices
+	* \param VertexFormat format : packed format (not VERTEX_FORMAT_FULL)
+	* \param const glm::vec3 offset : dequantization offset (VERTEX_FORMAT_QUANTIZED only, usually the bounding box min corner)
+	* \param const glm::vec3 scale : dequantization scale (VERTEX_FORMAT_QUANTIZED only, usually the bounding box extent)
+	* \param std::vector<unsigned char> * out : packed vertex data, count * vertexSize(format) bytes
+	* \return fills out
+	*/
+	template<typename V>
+	void pack(const V * vertices, size_t count, VertexFormat format, const glm::vec3 offset, const glm::vec3 scale, std::vector<unsigned char> * out)
+	{
+		const unsigned int stride = vertexSize(format);
+		out->assign(count * stride, 0);
+		const glm::vec3 invScale(scale.x != 0.0f ? 1.0f / scale.x : 0.0f, scale.y != 0.0f ? 1.0f / scale.y : 0.0f, scale.z != 0.0f ? 1.0f / scale.z : 0.0f);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const V & vertex = vertices[i];
+			unsigned char * dst = &(*out)[i * stride];
+			unsigned int offsetBytes = 0;
+
+			if (format == VERTEX_FORMAT_QUANTIZED)
+			{
+				const glm::vec3 normalized = (vertex.Position - offset) * invScale;
+				const unsigned short q[4] = { packUnorm16(normalized.x), packUnorm16(normalized.y), packUnorm16(normalized.z), 65535 };
+				std::memcpy(dst, q, sizeof(q));
+				offsetBytes = 8;
+			}
+			else
+			{
+				std::memcpy(dst, &vertex.Position[0], 3 * sizeof(float));
+				offsetBytes = 12;
+			}
+
+			const unsigned int normal = packSnorm10(vertex.Normal);
+			std::memcpy(dst + offsetBytes, &normal, 4);
+			const unsigned short uv[2] = { floatToHalf(vertex.TexCoords.x), floatToHalf(vertex.TexCoords.y) };
+			std::memcpy(dst + offsetBytes + 4, uv, 4);
+
+			if (format == VERTEX_FORMAT_PACKED)
+			{
+				const unsigned int tangeant = packSnorm10(vertex.Tangeant);
+				const unsigned int biTangeant = packSnorm10(vertex.BiTangeant);
+				std::memcpy(dst + offsetBytes + 8, &tangeant, 4);
+				std::memcpy(dst + offsetBytes + 12, &biTangeant, 4);
+			}
+		}
+	}
+}
+
+/*@}*/
+
+}
+
+#endif
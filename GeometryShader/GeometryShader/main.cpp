@@ -28,9 +28,10 @@
 #include <OpenGLEngine\textureInterface.hpp> // texture wrapper
 #include <OpenGLEngine\uniformInterface.hpp> // uniform wrapper
 #include <OpenGLEngine\mesh.hpp> // mesh wrapper
-#include <OpenGLEngine\scene.hpp> // scene manager
+#include <OpenGLEngine\sceneRenderer.hpp> // scene manager
 #include <OpenGLEngine\frameBuffer.hpp> // FBO wrapper
 #include <OpenGLEngine\renderBuffer.hpp> // RBO wrapper
+#include <OpenGLEngine\gpuProfiler.hpp> // GPU time per render pass (timer queries)
 
 
 ////////////////////////
@@ -125,11 +126,9 @@ int main(int argc, char ** argv)
 	// SHADERS
 	// NB: No support for tesselation nor geometry shaders in current build
 	/////////////////////////////
-	OpenGLEngine::Shader pbrShader("wireframe.vert", "wireframe.frag");
-	pbrShader.addGeometryShader("wireframe.geom");
+	OpenGLEngine::Shader pbrShader("wireframe.vert", "wireframe.geom", "wireframe.frag");
 	
-	OpenGLEngine::Shader normalShader("normal.vert", "normal.frag");
-	normalShader.addGeometryShader("normal.geom");
+	OpenGLEngine::Shader normalShader("normal.vert", "normal.geom", "normal.frag");
 
 	/////////////////////////////
 	// UNIFORMS
@@ -165,7 +164,10 @@ int main(int argc, char ** argv)
 	// GEOMETRY
 	/////////////////////////////
 	glm::vec3 meshPos = glm::vec3(0.0, -2.0, 0.0);
-	OpenGLEngine::Geometry mesh_geometry("Resources/Models/clumsy-dragon.obj", meshPos, 5.0);
+	OpenGLEngine::GeometryOptions meshOptions;
+	meshOptions.vertexFormat = OpenGLEngine::VERTEX_FORMAT_PACKED_NO_TANGENT; // the wireframe/normal shaders never read tangents
+	OpenGLEngine::Geometry mesh_geometry;
+	mesh_geometry.loadOBJ("Resources/Models/clumsy-dragon.obj", meshPos, 5.0, meshOptions);
 
 
 
@@ -191,9 +193,9 @@ int main(int argc, char ** argv)
 	//
 	// Memory managment is left to the user. No copies are done
 	//
-	// => <OpenGLEngine\scene.hpp>
+	// => <OpenGLEngine\sceneRenderer.hpp>
 	////////////////////////
-	OpenGLEngine::Scene scene;
+	OpenGLEngine::SceneRenderer scene;
 
 
 	// Create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
@@ -212,11 +214,13 @@ int main(int argc, char ** argv)
 	////////////////////////
 
 	stopWatch timer; // FPS counter
+	OpenGLEngine::GPUProfiler profiler; // GPU time per pass, read back a few frames later (no glFinish)
 
 	// Render loop
 	while (window.isOpen())
 	{
 		timer.start();
+		profiler.beginFrame();
 
 		////////////////////////
 		//	- Update Events
@@ -242,6 +246,9 @@ int main(int argc, char ** argv)
 		// 1st render pass: draw object as normal and fill stencil buffer
 		//scene.drawMeshes(&camera, &window);
 
+		// drawMesh does not update the uniform blocks: the frame's camera is sent once here
+		scene.updateFrameUniforms(&camera, &window);
+
 		clumbsy_dragon.setMaterial(&pbrWireframeMaterial);
 		scene.drawMesh(&clumbsy_dragon, &camera, &window);
 
@@ -259,22 +266,31 @@ int main(int argc, char ** argv)
 
 
 
+		profiler.endFrame();
+
 		// Swap the screen buffers
 		window.draw();
 
-		// Syncronyse
-		glFinish();
-
 
 		timer.end();
 		double render_time = timer.time();
-		std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+		// every 120 frames: CPU frame time and GPU time of each pass
+		if (profiler.getFrameCount() % 120 == 0)
+		{
+			std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+			profiler.print(std::cout);
+		}
 	}
 
 	// Melete meshes
 	// Properly de-allocate all resources once they've outlived their purpose
 	// => done in mesh desctuctor
 
+	// GPU time statistics of the last frames
+	profiler.flush();
+	profiler.writeCSV("gpuProfile.csv");
+	profiler.writeJSON("gpuProfile.json");
+
 	window.isClosed();
 
 
@@ -8,10 +8,18 @@ out vec3 vPosition;
 out vec2 TexCoord;
 
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
-uniform mat4 normalMatrix;
+// default uniforms (cf OpenGLEngine::UniformBlocks)
+layout (std140) uniform FrameUniforms {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	mat4 cameraMovment;
+	vec4 cameraPosition;
+	vec4 viewport;
+};
+layout (std140) uniform ObjectUniforms {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
 
 void main()
 {
@@ -28,9 +28,10 @@
 #include <OpenGLEngine\textureInterface.hpp> // texture wrapper
 #include <OpenGLEngine\uniformInterface.hpp> // uniform wrapper
 #include <OpenGLEngine\mesh.hpp> // mesh wrapper
-#include <OpenGLEngine\scene.hpp> // scene manager
+#include <OpenGLEngine\sceneRenderer.hpp> // scene manager
 #include <OpenGLEngine\frameBuffer.hpp> // FBO wrapper
 #include <OpenGLEngine\renderBuffer.hpp> // RBO wrapper
+#include <OpenGLEngine\gpuProfiler.hpp> // GPU time per render pass (timer queries)
 
 
 ////////////////////////
@@ -205,9 +206,9 @@ int main(int argc, char ** argv)
 	//
 	// Memory managment is left to the user. No copies are done
 	//
-	// => <OpenGLEngine\scene.hpp>
+	// => <OpenGLEngine\sceneRenderer.hpp>
 	////////////////////////
-	OpenGLEngine::Scene scene;
+	OpenGLEngine::SceneRenderer scene;
 	scene.addMesh(&model);
 	scene.addMesh(&lightModel);
 
@@ -228,11 +229,13 @@ int main(int argc, char ** argv)
 	////////////////////////
 
 	stopWatch timer; // FPS counter
+	OpenGLEngine::GPUProfiler profiler; // GPU time per pass, read back a few frames later (no glFinish)
 
 	// Render loop
 	while (window.isOpen())
 	{
 		timer.start();
+		profiler.beginFrame();
 
 		////////////////////////
 		//	- Update Events
@@ -265,22 +268,31 @@ int main(int argc, char ** argv)
 
 
 
+		profiler.endFrame();
+
 		// Swap the screen buffers
 		window.draw();
 
-		// Syncronyse
-		glFinish();
-
 
 		timer.end();
 		double render_time = timer.time();
-		std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+		// every 120 frames: CPU frame time and GPU time of each pass
+		if (profiler.getFrameCount() % 120 == 0)
+		{
+			std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+			profiler.print(std::cout);
+		}
 	}
 
 	// Melete meshes
 	// Properly de-allocate all resources once they've outlived their purpose
 	// => done in mesh desctuctor
 
+	// GPU time statistics of the last frames
+	profiler.flush();
+	profiler.writeCSV("gpuProfile.csv");
+	profiler.writeJSON("gpuProfile.json");
+
 	window.isClosed();
 
 
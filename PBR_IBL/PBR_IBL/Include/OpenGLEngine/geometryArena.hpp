@@ -0,0 +1,424 @@
+#ifndef GEOMETRYARENA_HPP
+#define GEOMETRYARENA_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "modelGeometry.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file geometryArena.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup MESH */
+/*@{*/
+
+
+/*!
+*  \brief Place of a geometry in a GeometryArena: \n
+*		its indices are relative to baseVertex, the LOD ranges (cf Geometry::getLOD) are relative to firstIndex
+*/
+struct ArenaAllocation
+{
+	unsigned int baseVertex = 0; /**< first vertex of the geometry in the arena VBO */
+	unsigned int vertexCount = 0; /**< vertices of the geometry */
+	unsigned int firstIndex = 0; /**< first index of the geometry in the arena EBO */
+	unsigned int indexCount = 0; /**< indices of every level of detail */
+};
+
+
+/*!
+*  \brief Geometry Arena: \n
+*		One large VBO and EBO, recorded in a single VAO, holding the buffers of many static geometries sharing a VertexFormat. \n
+*		Geometries are copied into it on the GPU (glCopyBufferSubData, from their own VBO/EBO: CPU side arrays are not needed), \n
+*		in the first free range large enough, or at the end of the arena. Non indexed geometries get a 0..n-1 index range, so that every geometry \n
+*		can be drawn with glDrawElements*BaseVertex or a DrawElementsIndirectCommand (cf IndirectRenderer). \n
+*		The buffers grow by doubling (the previous content is copied to the new ones). \n
+*		remove() gives the ranges of a geometry back (adjacent free ranges are merged, the end of the arena moves back over them), \n
+*		purge() removes the geometries released since they were added (cf Geometry::release, GeometryRecord::released)
+*
+*	\code{.cpp}
+*		GeometryArena arena(VERTEX_FORMAT_FULL);
+*		const ArenaAllocation * allocation = arena.add(&geometry);
+*		glBindVertexArray(arena.getVAO());
+*		glDrawElementsBaseVertex(GL_TRIANGLES, allocation->indexCount, GL_UNSIGNED_INT, (GLvoid*)(allocation->firstIndex * sizeof(unsigned int)), allocation->baseVertex);
+*	\endcode
+*
+*	\note geometries are found by GeometryRecord id (never reused, unlike VAO names): copies of a Geometry (e.g. the one in each Mesh) \n
+*		share their allocation, a new geometry taking the VAO name of a released one gets its own. \n
+*		The arena keeps a copy: a geometry modified afterwards has to be removed and added again
+*/
+class GeometryArena
+{
+public:
+	//! initial capacity of the vertex buffer, in bytes
+	static const size_t DEFAULT_VERTEX_BYTES = 4 << 20;
+	//! initial capacity of the index buffer, in indices
+	static const size_t DEFAULT_INDEX_COUNT = 1 << 20;
+
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Constructor: \n
+	*		the buffers are allocated by the first add()
+	* \param VertexFormat format : vertex format of every geometry of the arena
+	*/
+	explicit GeometryArena(VertexFormat format) : format(format)
+	{
+		Geometry::getVertexLayout(format, &layout, &stride);
+	}
+
+	/*!
+	*  \brief Destructor: \n
+	*		deletes VAO, VBO and EBO (the source geometries are untouched)
+	*/
+	~GeometryArena()
+	{
+		if (VAO != 0)
+		{
+			GLState::get().vertexArrayDeleted(VAO);
+			glDeleteVertexArrays(1, &VAO);
+		}
+		if (VBO != 0)
+			glDeleteBuffers(1, &VBO);
+		if (EBO != 0)
+			glDeleteBuffers(1, &EBO);
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	VertexFormat getVertexFormat() const
+	{
+		return format;
+	}
+	/*!
+	*  \brief Returns the VAO recording the arena VBO, EBO and vertex layout (0 until the first add)
+	*/
+	GLuint getVAO() const
+	{
+		return VAO;
+	}
+	/*!
+	*  \brief Returns the number of geometries held
+	*/
+	size_t size() const
+	{
+		return allocations.size();
+	}
+	/*!
+	*  \brief Returns the bytes held by the geometries (vertices + indices)
+	*/
+	size_t getUsedBytes() const
+	{
+		return usedVertices * stride + usedIndices * sizeof(unsigned int);
+	}
+	/*!
+	*  \brief Returns the bytes of the free ranges before the end of the arena, reused by the next add() calls
+	*/
+	size_t getFreeBytes() const
+	{
+		return (vertexEnd - usedVertices) * stride + (indexEnd - usedIndices) * sizeof(unsigned int);
+	}
+	/*!
+	*  \brief Returns where a geometry is in the arena
+	* \return NULL if it was not added
+	*/
+	const ArenaAllocation * find(Geometry * geometry)
+	{
+		return find(*geometry->getRecord());
+	}
+	/*!
+	*  \brief Returns where a geometry is in the arena, from its resolved record
+	* \return NULL if it was not added
+	*/
+	const ArenaAllocation * find(const GeometryRecord & record) const
+	{
+		std::unordered_map<unsigned long long, Entry>::const_iterator it = allocations.find(record.id);
+		return it != allocations.end() ? &it->second.allocation : NULL;
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Copies a geometry into the arena (once: a geometry already added is only looked up)
+	* \param Geometry * geometry : ready geometry (cf Geometry::isReady) of the arena vertex format
+	* \return its allocation, NULL if it cannot be added (not ready, other vertex format, empty)
+	*/
+	const ArenaAllocation * add(Geometry * geometry)
+	{
+		return add(geometry->getRecord());
+	}
+	/*!
+	*  \brief Copies a geometry into the arena, from its resolved record (cf Geometry::getRecord): no registry lookup
+	*/
+	const ArenaAllocation * add(const std::shared_ptr<GeometryRecord> & record)
+	{
+		if (!record->ready || record->vertexFormat != format || record->VBO == 0)
+			return NULL;
+		const ArenaAllocation * existing = find(*record);
+		if (existing != NULL)
+			return existing;
+
+		const size_t nbVertices = record->vertexCount;
+		const size_t nbIndices = record->EBO != 0 ? record->indexCount : nbVertices;
+		if (nbVertices == 0 || nbIndices == 0)
+			return NULL;
+
+		// place it in the free ranges first, the buffers only grow if it goes past their end
+		size_t newVertexEnd = vertexEnd, newIndexEnd = indexEnd;
+		ArenaAllocation allocation;
+		allocation.baseVertex = static_cast<unsigned int>(freeVertices.allocate(nbVertices, &newVertexEnd));
+		allocation.vertexCount = static_cast<unsigned int>(nbVertices);
+		allocation.firstIndex = static_cast<unsigned int>(freeIndices.allocate(nbIndices, &newIndexEnd));
+		allocation.indexCount = static_cast<unsigned int>(nbIndices);
+		reserve(newVertexEnd * stride, newIndexEnd);
+		vertexEnd = newVertexEnd;
+		indexEnd = newIndexEnd;
+
+		glBindBuffer(GL_COPY_READ_BUFFER, record->VBO);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, static_cast<GLintptr>(allocation.baseVertex) * stride, static_cast<GLsizeiptr>(nbVertices * stride));
+
+		const GLintptr indexOffset = static_cast<GLintptr>(allocation.firstIndex * sizeof(unsigned int));
+		glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+		if (record->EBO != 0)
+		{
+			glBindBuffer(GL_COPY_READ_BUFFER, record->EBO);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, indexOffset, static_cast<GLsizeiptr>(nbIndices * sizeof(unsigned int)));
+		}
+		else
+		{
+			std::vector<unsigned int> sequence(nbIndices);
+			for (size_t i = 0; i < nbIndices; ++i)
+				sequence[i] = static_cast<unsigned int>(i);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset, static_cast<GLsizeiptr>(nbIndices * sizeof(unsigned int)), &sequence[0]);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		usedVertices += nbVertices;
+		usedIndices += nbIndices;
+		Entry & entry = allocations[record->id];
+		entry.allocation = allocation;
+		entry.record = record;
+		return &entry.allocation;
+	}
+
+	/*!
+	*  \brief Removes a geometry from the arena: its ranges are free for the next add() calls
+	* \param Geometry * geometry : geometry added before
+	* \return false if it was not in the arena
+	* \note the draws already recorded with its allocation must not be submitted anymore
+	*/
+	bool remove(Geometry * geometry)
+	{
+		return removeRecord(geometry->getRecord()->id);
+	}
+
+	/*!
+	*  \brief Removes the geometries deallocated since they were added (cf Geometry::release), \n
+	*		or whose VAO name was taken by another geometry: their records are released or gone
+	* \return number of geometries removed
+	*/
+	size_t purge()
+	{
+		std::vector<unsigned long long> released;
+		for (std::unordered_map<unsigned long long, Entry>::const_iterator it = allocations.begin(); it != allocations.end(); ++it)
+		{
+			const std::shared_ptr<GeometryRecord> record = it->second.record.lock();
+			if (!record || record->released)
+				released.push_back(it->first);
+		}
+		for (size_t i = 0; i < released.size(); ++i)
+			removeRecord(released[i]);
+		return released.size();
+	}
+
+
+private:
+	VertexFormat format;
+	std::vector<VertexAttribute> layout;
+	unsigned int stride = 0;
+
+	/*!
+	*  \brief Free ranges of a buffer, by offset: first fit, adjacent ranges merged, a range reaching the end moves the end back
+	*/
+	struct FreeList
+	{
+		std::map<size_t, size_t> ranges; /**< offset => size */
+
+		/*!
+		*  \brief Takes size units from the first free range large enough, or at *end (then moved)
+		* \return offset of the range
+		*/
+		size_t allocate(size_t size, size_t * end)
+		{
+			for (std::map<size_t, size_t>::iterator it = ranges.begin(); it != ranges.end(); ++it)
+			{
+				if (it->second < size)
+					continue;
+				const size_t offset = it->first;
+				const size_t remaining = it->second - size;
+				ranges.erase(it);
+				if (remaining != 0)
+					ranges[offset + size] = remaining;
+				return offset;
+			}
+			const size_t offset = *end;
+			*end += size;
+			return offset;
+		}
+
+		/*!
+		*  \brief Gives a range back, merged with its free neighbours; *end moves back if the range reaches it
+		*/
+		void release(size_t offset, size_t size, size_t * end)
+		{
+			std::map<size_t, size_t>::iterator next = ranges.lower_bound(offset);
+			if (next != ranges.end() && offset + size == next->first)
+			{
+				size += next->second;
+				next = ranges.erase(next);
+			}
+			if (next != ranges.begin())
+			{
+				std::map<size_t, size_t>::iterator previous = next;
+				--previous;
+				if (previous->first + previous->second == offset)
+				{
+					offset = previous->first;
+					size += previous->second;
+					ranges.erase(previous);
+				}
+			}
+			if (offset + size == *end)
+				*end = offset;
+			else
+				ranges[offset] = size;
+		}
+	};
+
+	/*!
+	*  \brief Allocation of a geometry, and its record (not kept alive: cf purge)
+	*/
+	struct Entry
+	{
+		ArenaAllocation allocation;
+		std::weak_ptr<GeometryRecord> record;
+	};
+
+	GLuint VAO = 0, VBO = 0, EBO = 0;
+	//! end of the used part (vertices, indices), allocated sizes (vertex buffer in bytes, index buffer in indices)
+	size_t vertexEnd = 0, vertexCapacity = 0;
+	size_t indexEnd = 0, indexCapacity = 0;
+	//! free ranges before the ends, and units held by the geometries
+	FreeList freeVertices, freeIndices;
+	size_t usedVertices = 0, usedIndices = 0;
+
+	//! allocations, by source GeometryRecord id
+	std::unordered_map<unsigned long long, Entry> allocations;
+
+	/*!
+	*  \brief Removes an allocation, by GeometryRecord id
+	*/
+	bool removeRecord(unsigned long long id)
+	{
+		std::unordered_map<unsigned long long, Entry>::iterator it = allocations.find(id);
+		if (it == allocations.end())
+			return false;
+		const ArenaAllocation & allocation = it->second.allocation;
+		freeVertices.release(allocation.baseVertex, allocation.vertexCount, &vertexEnd);
+		freeIndices.release(allocation.firstIndex, allocation.indexCount, &indexEnd);
+		usedVertices -= allocation.vertexCount;
+		usedIndices -= allocation.indexCount;
+		allocations.erase(it);
+		return true;
+	}
+
+	/*!
+	*  \brief Grows the buffers to hold at least the requested sizes, and records them in the VAO
+	*/
+	void reserve(size_t vertexBytesNeeded, size_t indicesNeeded)
+	{
+		bool grown = false;
+		if (vertexBytesNeeded > vertexCapacity)
+		{
+			const size_t capacity = std::max(vertexBytesNeeded, vertexCapacity != 0 ? 2 * vertexCapacity : DEFAULT_VERTEX_BYTES);
+			VBO = grow(VBO, vertexEnd * stride, capacity);
+			vertexCapacity = capacity;
+			grown = true;
+		}
+		if (indicesNeeded > indexCapacity)
+		{
+			const size_t capacity = std::max(indicesNeeded, indexCapacity != 0 ? 2 * indexCapacity : DEFAULT_INDEX_COUNT);
+			EBO = grow(EBO, indexEnd * sizeof(unsigned int), capacity * sizeof(unsigned int));
+			indexCapacity = capacity;
+			grown = true;
+		}
+		if (!grown)
+			return;
+
+		if (VAO == 0)
+			glGenVertexArrays(1, &VAO);
+		setupVertexArray(VAO, VBO, EBO, stride, &layout[0], static_cast<unsigned int>(layout.size()));
+	}
+
+	/*!
+	*  \brief Replaces a buffer by a larger one, keeping its first usedBytes
+	* \return new buffer
+	*/
+	static GLuint grow(GLuint buffer, size_t usedBytes, size_t newBytes)
+	{
+		GLuint grown;
+		glGenBuffers(1, &grown);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+		glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(newBytes), NULL, GL_STATIC_DRAW);
+		if (buffer != 0)
+		{
+			if (usedBytes != 0)
+			{
+				glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(usedBytes));
+				glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			}
+			glDeleteBuffers(1, &buffer);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return grown;
+	}
+
+	GeometryArena(const GeometryArena &);
+	GeometryArena & operator=(const GeometryArena &);
+};
+
+/*@}*/
+
+}
+
+#endif
@@ -14,6 +14,11 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
 
 ////////////////////////
 // CUSTOM
@@ -21,6 +26,13 @@
 #include "shaderInterface.hpp"
 #include "textureInterface.hpp"
 #include "uniformInterface.hpp"
+#include "parser.hpp"
+#include "meshCache.hpp"
+#include "vertexFormat.hpp"
+#include "tangentSpace.hpp"
+#include "meshOptimizer.hpp"
+#include "meshSimplifier.hpp"
+#include "glState.hpp"
 
 
 namespace OpenGLEngine
@@ -55,15 +67,287 @@ struct Vertex {
 
 
 
+/*!
+*  \brief GeometryOptions: \n
+*		How Geometry::loadOBJ (or MeshLoader::loadOBJ) builds a geometry
+*
+*	\code{.cpp}
+*		GeometryOptions options;
+*		options.vertexFormat = VERTEX_FORMAT_PACKED_NO_TANGENT; // optional
+*		options.setLODChain(); // optional: 50%, 25%, 10% and 3% of the triangles
+*		dragon.loadOBJ("Resources/Models/clumsy-dragon.obj", meshPos, 5.0, options);
+*	\endcode
+*/
+struct GeometryOptions
+{
+	VertexFormat vertexFormat = VERTEX_FORMAT_FULL; /**< GPU side vertex format (cf VertexFormat) */
+	std::vector<float> lodRatios; /**< fraction of the full resolution triangle count of each simplified level (empty => no LOD chain) */
+	unsigned int nbThreads = 0; /**< number of loading threads (0 => one per core, 1 => sequential) */
+	bool useCache = true; /**< read/write the baked mesh cache */
+
+	/*!
+	*  \brief Requests a LOD chain (cf meshSimplifier)
+	* \param const float * ratios : fraction of the full resolution triangle count of each simplified level (decreasing)
+	* \param unsigned int nbLevels : number of ratios (at most meshSimplifier::MAX_LOD_LEVELS, 0 => no LOD chain)
+	*/
+	void setLODChain(const float * ratios = meshSimplifier::DEFAULT_LOD_RATIOS, unsigned int nbLevels = meshSimplifier::DEFAULT_LOD_COUNT)
+	{
+		lodRatios.assign(ratios, ratios + std::min(nbLevels, meshSimplifier::MAX_LOD_LEVELS));
+	}
+};
+
+
+/*!
+*  \brief GeometryData: \n
+*		CPU side result of a Geometry load, ready to be uploaded (cf Geometry::prepareOBJ) \n
+*		The vertex/index pointers point either inside the mapped baked cache, inside packed, or inside vertices/indices
+*/
+struct GeometryData
+{
+	meshCache::CachedMesh cache; /**< mapping of the baked cache, when the data comes from it */
+	std::vector<Vertex> vertices; /**< welded vertices (empty when the data comes from the cache) */
+	std::vector<unsigned int> indices; /**< three consecutive indices per face, every LOD level (empty when the data comes from the cache) */
+	std::vector<LevelOfDetail> lods; /**< LOD chain (empty if none) */
+	std::vector<unsigned char> packed; /**< vertices converted to a compact VertexFormat */
+	std::vector<VertexAttribute> layout; /**< vertex layout of vertexData */
+
+	const void * vertexData = NULL; /**< interleaved vertex data */
+	unsigned int vertexCount = 0; /**< number of vertices */
+	unsigned int vertexStride = 0; /**< size of a vertex in bytes */
+	const unsigned int * indexData = NULL; /**< index data (NULL if not indexed) */
+	unsigned int indexCount = 0; /**< number of indices */
+
+	glm::vec3 dequantizationOffset = glm::vec3(0.0f); /**< cf Geometry::getDequantizationMatrix */
+	glm::vec3 dequantizationScale = glm::vec3(1.0f);
+	glm::vec3 boundsMin = glm::vec3(0.0f); /**< object space bounding box min corner */
+	glm::vec3 boundsMax = glm::vec3(0.0f); /**< object space bounding box max corner */
+	float boundsRadius = -1.0f; /**< bounding sphere radius, around the bounding box center (-1 if unknown) */
+	meshOptimizer::Report optimization; /**< vertex cache efficiency before and after processMesh (zero when the data comes from the cache or is not indexed) */
+};
+
+
+/*!
+*  \brief GeometryRecord: \n
+*		Render state of a Geometry that the engine library's Geometry class has no room for: \n
+*		element buffer, vertex format, dequantization, LOD chain, bounds, background upload. \n
+*		Kept in the GeometryRegistry, by VAO: every copy of a Geometry (e.g. the one stored in a Mesh) shares its record. \n
+*		The const queries are safe on any thread; records are created, filled and released on the GL thread only
+*/
+struct GeometryRecord
+{
+	unsigned long long id = 0; /**< never reused, unlike VAO names (cf GeometryArena) */
+	bool owned = false; /**< buffers created by loadOBJ / MeshLoader, false for the geometries built by the engine library (adopted) */
+	bool ready = true; /**< false while a MeshLoader uploads the buffers */
+	bool failed = false; /**< the file could not be loaded: the geometry will never be ready */
+	bool released = false; /**< buffers deleted (cf Geometry::release), or VAO name taken by another geometry */
+	size_t signature = 0; /**< adopted geometries: VBO, vertex count and end vertices, to tell a reused VAO name */
+
+	GLuint VAO = 0, VBO = 0, EBO = 0; /**< OpenGL objects (EBO = 0 if not indexed) */
+	size_t vertexCount = 0, indexCount = 0; /**< buffer sizes */
+	VertexFormat vertexFormat = VERTEX_FORMAT_FULL; /**< layout of the vertices in the VBO */
+	glm::vec3 dequantizationOffset = glm::vec3(0.0f); /**< VERTEX_FORMAT_QUANTIZED only: position = offset + scale * quantized position */
+	glm::vec3 dequantizationScale = glm::vec3(1.0f);
+	std::vector<Vertex> vertices; /**< CPU side copy of loadOBJ (empty if uploaded from a baked cache, by a MeshLoader, or adopted) */
+	std::vector<unsigned int> indices; /**< CPU side copy of the index buffer (same) */
+	std::vector<LevelOfDetail> lods; /**< index ranges of the LOD chain (empty if none) */
+	glm::vec3 boundsMin = glm::vec3(0.0f); /**< object space axis aligned bounding box */
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	float boundsRadius = -1.0f; /**< object space bounding sphere radius, around the bounding box center (-1 while unknown) */
+	meshOptimizer::Report optimization; /**< vertex cache efficiency before and after the optimizer (zero if it did not run, e.g. baked cache) */
+
+	/*!
+	*  \brief Returns the number of levels of detail
+	* \return 1 + number of simplified levels (1 if no LOD chain was built)
+	*/
+	unsigned int getLODCount() const
+	{
+		return lods.empty() ? 1 : static_cast<unsigned int>(lods.size());
+	}
+	/*!
+	*  \brief Returns a level of detail
+	* \param unsigned int level : 0 (full resolution) to getLODCount() - 1 (coarsest), clamped
+	* \return index range and object space error of the level
+	*/
+	LevelOfDetail getLOD(unsigned int level) const
+	{
+		if (lods.empty())
+		{
+			const LevelOfDetail full = { 1.0f, 0.0f, 0, static_cast<unsigned int>(EBO != 0 ? indexCount : 0) };
+			return full;
+		}
+		return lods[std::min<size_t>(level, lods.size() - 1)];
+	}
+	/*!
+	*  \brief Picks the coarsest level whose error stays under a screen space threshold
+	* \param float distance : distance from the camera to the mesh (world units)
+	* \param float pixelsPerUnit : size in pixels of one world unit seen at distance 1 (viewport height * 0.5 * projection[1][1])
+	* \param float maxPixelError : tolerated error, in pixels
+	* \return level to draw
+	*/
+	unsigned int selectLOD(float distance, float pixelsPerUnit, float maxPixelError) const
+	{
+		const unsigned int nbLevels = getLODCount();
+		unsigned int level = 0;
+		while (level + 1 < nbLevels && lods[level + 1].error * pixelsPerUnit <= maxPixelError * distance)
+			++level;
+		return level;
+	}
+	/*!
+	*  \brief Returns the object space bounding sphere, centered on the bounding box
+	* \return false if the bounds are unknown: such a mesh must not be culled
+	*/
+	bool getBoundingSphere(glm::vec3 * center, float * radius) const
+	{
+		*center = 0.5f * (boundsMin + boundsMax);
+		*radius = boundsRadius;
+		return boundsRadius >= 0.0f;
+	}
+	/*!
+	*  \brief Returns translate(dequantizationOffset) * scale(dequantizationScale) (identity unless VERTEX_FORMAT_QUANTIZED)
+	*/
+	glm::mat4 getDequantizationMatrix() const
+	{
+		glm::mat4 dequantization(1.0f);
+		dequantization[0][0] = dequantizationScale.x;
+		dequantization[1][1] = dequantizationScale.y;
+		dequantization[2][2] = dequantizationScale.z;
+		dequantization[3] = glm::vec4(dequantizationOffset, 1.0f);
+		return dequantization;
+	}
+	/*!
+	*  \brief Renders a level of detail (cf Geometry::drawGeometry), GL thread only \n
+	*		Callers drawing many meshes keep the record they resolved (cf RenderQueue, SceneRenderer): no registry lookup per draw
+	* \param unsigned int level : 0 (full resolution) to getLODCount() - 1 (coarsest), clamped
+	*/
+	void draw(unsigned int level) const
+	{
+		if (!ready)
+			return;
+
+		GLState::get().bindVertexArray(VAO);
+		if (EBO != 0)
+		{
+			const LevelOfDetail lod = getLOD(level);
+			glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(lod.indexCount), GL_UNSIGNED_INT, (GLvoid*)(static_cast<size_t>(lod.firstIndex) * sizeof(unsigned int)));
+		}
+		else
+			glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertexCount));
+	}
+};
+
+
+/*!
+*  \brief GeometryRegistry: \n
+*		GeometryRecord of every geometry, by VAO name (cf Geometry::getRecord)
+*
+*	\note one registry per process, used on the GL thread only
+*/
+class GeometryRegistry
+{
+public:
+	/*!
+	*  \brief Returns the registry
+	*/
+	static GeometryRegistry & get()
+	{
+		static GeometryRegistry registry;
+		return registry;
+	}
+
+	/*!
+	*  \brief Returns the record of a VAO
+	* \return NULL if there is none
+	*/
+	std::shared_ptr<GeometryRecord> find(GLuint VAO) const
+	{
+		std::unordered_map<GLuint, std::shared_ptr<GeometryRecord> >::const_iterator it = records.find(VAO);
+		return it != records.end() ? it->second : std::shared_ptr<GeometryRecord>();
+	}
+	/*!
+	*  \brief Adds a record (the previous record of the VAO, if any, is marked released: its name was reused)
+	* \return record, with its VAO and a new id
+	*/
+	GeometryRecord * insert(GLuint VAO, const std::shared_ptr<GeometryRecord> & record)
+	{
+		std::shared_ptr<GeometryRecord> & slot = records[VAO];
+		if (slot)
+			slot->released = true;
+		slot = record;
+		record->VAO = VAO;
+		record->id = nextId++;
+		return record.get();
+	}
+	/*!
+	*  \brief Removes the record of a VAO (marked released)
+	*/
+	void erase(GLuint VAO)
+	{
+		std::unordered_map<GLuint, std::shared_ptr<GeometryRecord> >::iterator it = records.find(VAO);
+		if (it == records.end())
+			return;
+		it->second->released = true;
+		records.erase(it);
+	}
+	/*!
+	*  \brief Returns the number of records
+	*/
+	size_t size() const
+	{
+		return records.size();
+	}
+
+private:
+	std::unordered_map<GLuint, std::shared_ptr<GeometryRecord> > records;
+	unsigned long long nextId = 1;
+
+	GeometryRegistry() {}
+	GeometryRegistry(const GeometryRegistry &);
+	GeometryRegistry & operator=(const GeometryRegistry &);
+};
+
+
+/*!
+*  \brief Records the vertex layout and the element buffer into a VAO
+* \param GLuint VAO : vertex array to configure
+* \param GLuint VBO : filled vertex buffer
+* \param GLuint EBO : filled element buffer (0 => not indexed)
+* \param unsigned int stride : size of a vertex in bytes
+* \param const VertexAttribute * attributes : vertex layout (one glVertexAttribPointer per entry)
+* \param unsigned int nbAttributes : number of attributes
+* \return VAO is configured (and unbound)
+*/
+inline void setupVertexArray(GLuint VAO, GLuint VBO, GLuint EBO, unsigned int stride, const VertexAttribute * attributes, unsigned int nbAttributes)
+{
+	GLState & state = GLState::get();
+	state.bindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	if (EBO != 0)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+	for (unsigned int i = 0; i < nbAttributes; ++i)
+	{
+		glEnableVertexAttribArray(attributes[i].location);
+		glVertexAttribPointer(attributes[i].location, attributes[i].components, attributes[i].type, static_cast<GLboolean>(attributes[i].normalized), stride, (GLvoid*)(static_cast<size_t>(attributes[i].offset)));
+	}
+
+	state.bindVertexArray(0);
+}
+
+
+class MeshLoader;
+
+
 /*!
 *  \brief Mesh Geometry Wrapper: \n
 *		The geometrical data of a mesh is represented by a set of 3D points, normals and texture coordinates \n
 *		These data are grouped in an array of Vertex (pos,normal,uv) \n
-*		
+*
 *	This wrapper takes care of the OpenGL direction to allocate and fill the corresponding mesh VBO and VAO \n
 *	Loads a mesh either from a set of vertices or a file \n
 *	Calls the needed OpenGL directives to draw and dump the mesh \n
 *
+*	\note the constructors and the non inline methods are compiled in the OpenGLEngine library, so the data members keep its layout. \n
+*		Everything the library does not know about (EBO, vertex format, LOD chain, bounds, ...) lives in the geometry's GeometryRecord
 */
 
 
@@ -100,7 +384,7 @@ public:
 	*			- Cube
 	*			- Plane
 	*			- Screen_Plane (aka Plane without normal)
-	*		
+	*
 	*
 	* \param const std::string geometryType : one of the supported type (CubeGeometry, PlaneGeometry,...)
 	* \param const float scale : geometry scaling factor. All vertices x,z,y position will be multiplied by scale
@@ -113,7 +397,7 @@ public:
 	*		Empty Mesh \n
 	*		VAO and VBO are not build
 	*
-	* \param 
+	* \param
 	* \return sets mesh world frame position to (0,0,0)
 	*/
 	Geometry();
@@ -172,6 +456,99 @@ public:
 	void loadScreenPlaneGeometry(const float size, const glm::vec3 worldSpacePosition = glm::vec3(0, 0, 0));
 
 
+	///////////////////////////////////////////
+	//	LOAD FROM FILE
+	///////////////////////////////////////////
+	/*!
+	*  \brief Loads an .obj file through the memory-mapped parser: \n
+	*		Same result as the file constructor, without its per-token std::string allocations \n
+	*		The file is mapped read-only and parsed in place (cf parser::loadOBJ), the vertex array is allocated once \n
+	*		Large files are parsed and expanded on all cores (cf parser::parseOBJParallel) \n
+	*		Identical (position, normal, uv) corners are then welded into a single vertex (cf weldVertices) \n
+	*		and triangles/vertices are reordered for the post-transform cache (cf meshOptimizer) \n
+	*		Formats that store a tangent frame get it from tangentSpace::compute \n
+	*		If a LOD chain is requested (cf GeometryOptions::setLODChain), the simplified levels follow level 0 in the EBO \n
+	*		Builds VAO, VBO and EBO: the mesh is drawn with glDrawElements (cf drawGeometry) \n
+	*		\n
+	*		The first load bakes the result next to the source (cf meshCache, "<filename>.mbin"). \n
+	*		Later loads map that cache and upload it as is: no parsing and no CPU side vertex/index arrays (getVertices() and getIndices() are then empty)
+	*
+	*	\code{.cpp}
+	*		GeometryOptions options;
+	*		options.vertexFormat = VERTEX_FORMAT_PACKED_NO_TANGENT; // optional
+	*		options.setLODChain(); // optional: 50%, 25%, 10% and 3% of the triangles
+	*		Geometry dragon;
+	*		dragon.loadOBJ("Resources/Models/clumsy-dragon.obj", meshPos, 5.0, options);
+	*	\endcode
+	*
+	* \param const std::string filename : .obj file see <https://en.wikipedia.org/wiki/Wavefront_.obj_file>
+	* \param const glm::vec3 worldSpacePosition : mesh's referntial world space position (default value 0,0,0)
+	* \param const float scale : geometry scaling factor. All vertices x,z,y position will be multiplied by scale
+	* \param const GeometryOptions & options : vertex format, LOD chain, loading threads and baked cache
+	* \return true if the file could be read. Builds the geomety from file and binds corresponding VAO and VBO
+	* \note faces without normals get their flat face normal, missing texture coordinates are set to (0,0) \n
+	*		the library's vertex array stays empty (cf getGeometricData): such a geometry is drawn by drawGeometry(), not draw()
+	*/
+	bool loadOBJ(const std::string filename, const glm::vec3 worldSpacePosition = glm::vec3(0, 0, 0), const float scale = 1.0, const GeometryOptions & options = GeometryOptions())
+	{
+		this->worldSpacePosition = worldSpacePosition;
+
+		GeometryData data;
+		if (!prepareOBJ(filename, scale, options, &data))
+			return false;
+		GeometryRecord * record = createRecord(options.vertexFormat);
+		uploadData(record, &data);
+		record->vertices.swap(data.vertices);
+		record->indices.swap(data.indices);
+		return true;
+	}
+
+	/*!
+	*  \brief Builds an indexed mesh from arrays made by hand, the way loadOBJ does from a file: \n
+	*		triangles/vertices are reordered for the post-transform cache, then come the tangent frames and the LOD chain, if requested
+	*
+	* \param const std::vector<Vertex> & vertices : vertices (Position, Normal and TexCoords are read)
+	* \param const std::vector<unsigned int> & indices : three consecutive indices per face
+	* \param const glm::vec3 worldSpacePosition : mesh's referntial world space position (default value 0,0,0)
+	* \param const GeometryOptions & options : vertex format and LOD chain (the baked cache is not used)
+	* \return builds VAO, VBO and EBO
+	*/
+	void loadVertices(const std::vector<Vertex> & vertices, const std::vector<unsigned int> & indices, const glm::vec3 worldSpacePosition = glm::vec3(0, 0, 0), const GeometryOptions & options = GeometryOptions())
+	{
+		this->worldSpacePosition = worldSpacePosition;
+
+		GeometryData data;
+		data.vertices = vertices;
+		data.indices = indices;
+		processMesh(options, &data);
+		GeometryRecord * record = createRecord(options.vertexFormat);
+		uploadData(record, &data);
+		record->vertices.swap(data.vertices);
+		record->indices.swap(data.indices);
+	}
+
+	/*!
+	*  \brief Returns the vertex layout of struct Vertex (interleaved, 56 bytes): \n
+	*			- location 0 : Position
+	*			- location 1 : Normal
+	*			- location 2 : TexCoords
+	*			- location 3 : Tangeant
+	*			- location 4 : BiTangeant
+	* \return one VertexAttribute per Vertex member
+	*/
+	static std::vector<VertexAttribute> vertexLayout()
+	{
+		const VertexAttribute layout[] = {
+			{ 0, 3, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(Vertex, Position)) },
+			{ 1, 3, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(Vertex, Normal)) },
+			{ 2, 2, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(Vertex, TexCoords)) },
+			{ 3, 3, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(Vertex, Tangeant)) },
+			{ 4, 3, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(Vertex, BiTangeant)) }
+		};
+		return std::vector<VertexAttribute>(layout, layout + 5);
+	}
+
+
 	///////////////////////////////////////////
 	//	GETTERS
 	///////////////////////////////////////////
@@ -195,6 +572,162 @@ public:
 	* \return GLuint mesh VBO index (generated by OpenGL allocation call)
 	*/
 	GLuint getVBO();
+	/*!
+	*  \brief Returns the render state shared by this geometry and its copies (cf GeometryRecord) \n
+	*		A geometry built by the engine library gets one the first time it is asked: not indexed, full vertex format, bounds from its vertices
+	* \return record of the geometry's VAO (GL thread only: the record may be created, or replaced if the VAO name was reused)
+	*/
+	std::shared_ptr<GeometryRecord> getRecord()
+	{
+		std::shared_ptr<GeometryRecord> record = GeometryRegistry::get().find(VAO);
+		if (record && (record->owned ? vertices.empty() && record->VBO == VBO : record->signature == librarySignature()))
+			return record;
+		return adoptRecord();
+	}
+	/*!
+	*  \brief Returns whether the mesh can be drawn \n
+	*		Always true, unless the geometry is being loaded in the background (cf MeshLoader)
+	* \return true if VAO, VBO and EBO are complete
+	*/
+	bool isReady()
+	{
+		return getRecord()->ready;
+	}
+	/*!
+	*  \brief Returns the number of vertices in the VBO
+	* \return size of the vertex buffer
+	*/
+	size_t getVertexCount()
+	{
+		return getRecord()->vertexCount;
+	}
+	/*!
+	*  \brief Returns the mesh's CPU side vertices
+	* \return vertices kept by loadOBJ / loadVertices (empty if the mesh was uploaded from a baked cache or by a MeshLoader), \n
+	*		getGeometricData() for a geometry built by the engine library
+	*/
+	const std::vector<Vertex> * getVertices()
+	{
+		const std::shared_ptr<GeometryRecord> record = getRecord();
+		return record->owned ? &record->vertices : &vertices;
+	}
+	/*!
+	*  \brief Returns the mesh's index data (three consecutive indices per face, every LOD level)
+	* \return pointer to the mesh's indices (empty if the mesh is not indexed, or has no CPU side copy, cf getVertices)
+	*/
+	const std::vector<unsigned int> * getIndices()
+	{
+		return &getRecord()->indices;
+	}
+	/*!
+	*  \brief Returns the mesh's corresponding EBO
+	* \return GLuint mesh EBO index (0 if the mesh is not indexed)
+	*/
+	GLuint getEBO()
+	{
+		return getRecord()->EBO;
+	}
+	/*!
+	*  \brief Returns the size of the index buffer
+	* \return number of indices of every LOD level (0 if the mesh is not indexed)
+	*/
+	size_t getIndexCount()
+	{
+		const std::shared_ptr<GeometryRecord> record = getRecord();
+		return record->EBO != 0 ? record->indexCount : 0;
+	}
+	/*!
+	*  \brief Returns the GPU side vertex format
+	* \return VertexFormat of the VBO (VERTEX_FORMAT_FULL unless loaded with another one, cf GeometryOptions)
+	*/
+	VertexFormat getVertexFormat()
+	{
+		return getRecord()->vertexFormat;
+	}
+	/*!
+	*  \brief Returns the VBO layout of a vertex format
+	* \param VertexFormat format : vertex format (cf getVertexFormat)
+	* \param std::vector<VertexAttribute> * layout : one VertexAttribute per enabled location
+	* \param unsigned int * stride : size of a vertex in bytes
+	* \return vertexLayout() for VERTEX_FORMAT_FULL, vertexPacking::packedLayout otherwise
+	*/
+	static void getVertexLayout(VertexFormat format, std::vector<VertexAttribute> * layout, unsigned int * stride)
+	{
+		if (format == VERTEX_FORMAT_FULL)
+		{
+			*layout = vertexLayout();
+			*stride = sizeof(Vertex);
+		}
+		else
+		{
+			*layout = vertexPacking::packedLayout(format);
+			*stride = vertexPacking::vertexSize(format);
+		}
+	}
+	/*!
+	*  \brief Returns the transform turning VERTEX_FORMAT_QUANTIZED positions back into object space positions
+	* \return translate(offset) * scale(scale) (identity for the other formats) \n
+	*		to be applied in the vertex shader, or folded into the model matrix: modelMatrix * getDequantizationMatrix()
+	*/
+	glm::mat4 getDequantizationMatrix()
+	{
+		return getRecord()->getDequantizationMatrix();
+	}
+	/*!
+	*  \brief Returns the object space axis aligned bounding box (scale applied, worldSpacePosition not)
+	* \param glm::vec3 * boundsMin : min corner
+	* \param glm::vec3 * boundsMax : max corner
+	* \return (0,0,0) for both corners until the mesh is loaded
+	*/
+	void getBoundingBox(glm::vec3 * boundsMin, glm::vec3 * boundsMax)
+	{
+		const std::shared_ptr<GeometryRecord> record = getRecord();
+		*boundsMin = record->boundsMin;
+		*boundsMax = record->boundsMax;
+	}
+	/*!
+	*  \brief Returns the object space bounding sphere, centered on the bounding box (scale applied, worldSpacePosition not)
+	* \param glm::vec3 * center : sphere center
+	* \param float * radius : sphere radius, as tight as the vertices allow for this center
+	* \return false if the bounds are unknown (mesh not loaded yet): such a mesh must not be culled
+	*/
+	bool getBoundingSphere(glm::vec3 * center, float * radius)
+	{
+		return getRecord()->getBoundingSphere(center, radius);
+	}
+	/*!
+	*  \brief Returns the number of levels of detail
+	* \return 1 + number of simplified levels (1 if no LOD chain was built)
+	*/
+	unsigned int getLODCount()
+	{
+		return getRecord()->getLODCount();
+	}
+	/*!
+	*  \brief Returns a level of detail
+	* \param unsigned int level : 0 (full resolution) to getLODCount() - 1 (coarsest), clamped
+	* \return index range and object space error of the level
+	*/
+	LevelOfDetail getLOD(unsigned int level)
+	{
+		return getRecord()->getLOD(level);
+	}
+	/*!
+	*  \brief Picks the coarsest level whose error stays under a screen space threshold (cf GeometryRecord::selectLOD)
+	* \return level to pass to drawGeometry
+	*/
+	unsigned int selectLOD(float distance, float pixelsPerUnit, float maxPixelError)
+	{
+		return getRecord()->selectLOD(distance, pixelsPerUnit, maxPixelError);
+	}
+	/*!
+	*  \brief Returns the vertex cache efficiency (ACMR, ATVR) of the index buffer before and after meshOptimizer
+	* \return zero stats if the optimizer did not run: not indexed, loaded from the baked cache, or built by the engine library
+	*/
+	meshOptimizer::Report getOptimizationReport()
+	{
+		return getRecord()->optimization;
+	}
 
 
 	///////////////////////////////////////////
@@ -218,6 +751,61 @@ public:
 	*/
 	void draw();
 
+	/*!
+	*  \brief Renders the mesh at a level of detail
+	* \param unsigned int level : 0 (full resolution) to getLODCount() - 1 (coarsest), clamped
+	* \return indexed meshes (EBO != 0) are drawn with glDrawElements, the others with glDrawArrays \n
+	*		meshes still loading in the background (cf isReady) are not drawn
+	* \note the VAO is bound through GLState and left bound: consecutive draws of the same geometry bind it once \n
+	*		one registry lookup per call (cf getRecord): per mesh loops draw from the resolved record (cf GeometryRecord::draw)
+	*/
+	void drawGeometry(unsigned int level = 0)
+	{
+		getRecord()->draw(level);
+	}
+
+	/*!
+	*  \brief Renders several instances of the mesh in one draw call
+	* \param GLsizei instanceCount : number of instances
+	* \param GLuint instanceBuffer : vertex buffer holding one record per instance
+	* \param unsigned int stride : size of an instance record in bytes
+	* \param const VertexAttribute * attributes : per instance attributes (locations not used by the vertex layout, advanced once per instance)
+	* \param unsigned int nbAttributes : number of attributes
+	* \param unsigned int level : level of detail (cf drawGeometry)
+	* \return glDrawElementsInstanced or glDrawArraysInstanced, like drawGeometry(). \n
+	*		The instance attributes are only enabled for the draw: the VAO is shared by every copy of the geometry
+	*/
+	void drawInstanced(GLsizei instanceCount, GLuint instanceBuffer, unsigned int stride, const VertexAttribute * attributes, unsigned int nbAttributes, unsigned int level = 0)
+	{
+		const std::shared_ptr<GeometryRecord> record = getRecord();
+		if (!record->ready || instanceCount == 0)
+			return;
+
+		GLState::get().bindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		for (unsigned int i = 0; i < nbAttributes; ++i)
+		{
+			glEnableVertexAttribArray(attributes[i].location);
+			glVertexAttribPointer(attributes[i].location, attributes[i].components, attributes[i].type, static_cast<GLboolean>(attributes[i].normalized), stride, (GLvoid*)(static_cast<size_t>(attributes[i].offset)));
+			glVertexAttribDivisor(attributes[i].location, 1);
+		}
+
+		if (record->EBO != 0)
+		{
+			const LevelOfDetail lod = record->getLOD(level);
+			glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(lod.indexCount), GL_UNSIGNED_INT, (GLvoid*)(static_cast<size_t>(lod.firstIndex) * sizeof(unsigned int)), instanceCount);
+		}
+		else
+			glDrawArraysInstanced(GL_TRIANGLES, 0, static_cast<GLsizei>(record->vertexCount), instanceCount);
+
+		for (unsigned int i = 0; i < nbAttributes; ++i)
+		{
+			glVertexAttribDivisor(attributes[i].location, 0);
+			glDisableVertexAttribArray(attributes[i].location);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
 	/*!
 	*  \brief Dumps the mesh
 	* \param
@@ -225,6 +813,25 @@ public:
 	*/
 	void dealocate();
 
+	/*!
+	*  \brief Dumps the mesh, element buffer included, and forgets its GeometryRecord
+	* \return dumps VAO, VBO and EBO (the copies of the geometry must not be drawn anymore)
+	*/
+	void release()
+	{
+		const std::shared_ptr<GeometryRecord> record = getRecord();
+		if (record->EBO != 0)
+			glDeleteBuffers(1, &record->EBO);
+		record->EBO = 0;
+		GeometryRegistry::get().erase(VAO);
+
+		GLState::get().vertexArrayDeleted(VAO);
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		VAO = VBO = 0;
+		vertices.clear();
+	}
+
 	/*!
 	*  \brief Computes Tangeant and Bit-Tangeant vectors for every vertex
 	* \param
@@ -237,6 +844,8 @@ public:
 
 
 private:
+	friend class MeshLoader;
+
 	////////////////////
 	//  Mesh Data
 	////////////////////
@@ -267,6 +876,342 @@ private:
 	* \return VBO and VAO of the corresponding mesh
 	*/
 	void setupMesh();
+
+	/*!
+	*  \brief Fingerprint of a geometry built by the engine library: VBO, vertex count, first and last positions \n
+	*		tells a record from the geometry that held the same VAO name before
+	*/
+	size_t librarySignature() const
+	{
+		size_t hash = 2166136261u;
+		const size_t words[2] = { VBO, vertices.size() };
+		for (int k = 0; k < 2; ++k)
+			hash = (hash ^ words[k]) * 16777619u;
+		if (!vertices.empty())
+		{
+			unsigned int bits[6];
+			std::memcpy(bits, &vertices.front().Position, sizeof(glm::vec3));
+			std::memcpy(bits + 3, &vertices.back().Position, sizeof(glm::vec3));
+			for (int k = 0; k < 6; ++k)
+				hash = (hash ^ bits[k]) * 16777619u;
+		}
+		return hash;
+	}
+
+	/*!
+	*  \brief Records a geometry built by the engine library: not indexed, full vertex format, bounds from its vertices
+	*/
+	std::shared_ptr<GeometryRecord> adoptRecord()
+	{
+		std::shared_ptr<GeometryRecord> record = std::make_shared<GeometryRecord>();
+		record->VBO = VBO;
+		record->vertexCount = vertices.size();
+		record->signature = librarySignature();
+		computeBounds(vertices, &record->boundsMin, &record->boundsMax, &record->boundsRadius);
+		GeometryRegistry::get().insert(VAO, record);
+		return record;
+	}
+
+	/*!
+	*  \brief Generates the VAO and VBO names of a geometry built by loadOBJ / MeshLoader, and its record (buffers not filled yet)
+	* \param VertexFormat format : layout of the vertices in the VBO
+	* \return owned record
+	*/
+	GeometryRecord * createRecord(VertexFormat format)
+	{
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		vertices.clear();
+
+		std::shared_ptr<GeometryRecord> record = std::make_shared<GeometryRecord>();
+		record->owned = true;
+		record->VBO = VBO;
+		record->vertexFormat = format;
+		return GeometryRegistry::get().insert(VAO, record);
+	}
+
+	/*!
+	*  \brief Fills VBO and EBO from prepared data and records them in the VAO (cf completeRecord)
+	* \param GeometryRecord * record : record of createRecord
+	* \param const GeometryData * data : data to upload (cf prepareOBJ)
+	*/
+	static void uploadData(GeometryRecord * record, const GeometryData * data)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, record->VBO);
+		glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(data->vertexCount) * data->vertexStride, data->vertexData, GL_STATIC_DRAW);
+		if (data->indexData != NULL && data->indexCount != 0)
+		{
+			glGenBuffers(1, &record->EBO);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, record->EBO);
+			glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(data->indexCount) * sizeof(unsigned int), data->indexData, GL_STATIC_DRAW);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		completeRecord(record, data);
+	}
+
+	/*!
+	*  \brief Records the vertex layout of filled buffers in the VAO, and the counts, LOD chain, bounds and dequantization of the data in the record
+	*/
+	static void completeRecord(GeometryRecord * record, const GeometryData * data)
+	{
+		setupVertexArray(record->VAO, record->VBO, record->EBO, data->vertexStride, data->layout.empty() ? NULL : &data->layout[0], static_cast<unsigned int>(data->layout.size()));
+		record->vertexCount = data->vertexCount;
+		record->indexCount = record->EBO != 0 ? data->indexCount : 0;
+		record->dequantizationOffset = data->dequantizationOffset;
+		record->dequantizationScale = data->dequantizationScale;
+		record->lods = data->lods;
+		record->boundsMin = data->boundsMin;
+		record->boundsMax = data->boundsMax;
+		record->boundsRadius = data->boundsRadius;
+		record->optimization = data->optimization;
+	}
+
+	/*!
+	*  \brief CPU side of loadOBJ: reads the baked cache, or parses, welds, optimizes and packs the source file (and bakes the cache) \n
+	*		No OpenGL call is made: MeshLoader runs it on its worker thread
+	* \param const std::string filename : .obj file
+	* \param const float scale : geometry scaling factor
+	* \param const GeometryOptions & options : vertex format, LOD chain, parsing threads (0 => one per core) and baked cache
+	* \param GeometryData * data : data to upload
+	* \return false if the file could not be read. Fills vertices, indices, the LOD chain, the bounding box and the dequantization transform
+	*/
+	static bool prepareOBJ(const std::string filename, const float scale, const GeometryOptions & options, GeometryData * data)
+	{
+		const std::string cacheFile = meshCache::cachePath(filename);
+
+		// 1. baked cache: map it, its bytes are uploaded as is
+		if (options.useCache && data->cache.open(cacheFile, filename, scale, options.vertexFormat, options.lodRatios))
+		{
+			const meshCache::Header * header = data->cache.getHeader();
+			data->boundsMin = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+			data->boundsMax = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+			data->boundsRadius = header->boundsRadius;
+			setDequantization(options.vertexFormat, data);
+			data->layout.assign(data->cache.attributes(), data->cache.attributes() + header->attributeCount);
+			data->vertexData = data->cache.vertexData();
+			data->vertexCount = header->vertexCount;
+			data->vertexStride = header->vertexStride;
+			data->indexData = data->cache.indexData();
+			data->indexCount = header->indexCount;
+			data->lods.assign(data->cache.lods(), data->cache.lods() + header->lodCount);
+			return true;
+		}
+
+		// 2. source file
+		parser::OBJData obj;
+		if (!parser::loadOBJ(filename, &obj, options.nbThreads))
+			return false;
+
+		// small meshes are expanded on the calling thread
+		buildVertices(&obj, scale, obj.corners.size() < 3 * 16384 ? 1 : options.nbThreads, &data->vertices);
+		weldVertices(&data->vertices, &data->indices);
+		processMesh(options, data);
+
+		if (options.useCache && !data->vertices.empty())
+		{
+			if (!meshCache::write(cacheFile, filename, scale, options.vertexFormat, data->layout, data->vertexData, data->vertexCount, data->vertexStride,
+				data->indexData, data->indexCount, data->boundsMin, data->boundsMax, data->boundsRadius, options.lodRatios, data->lods))
+				std::cout << "WARNING::GEOMETRY::MESH_CACHE_NOT_WRITTEN: " << cacheFile << std::endl;
+		}
+		return true;
+	}
+
+	/*!
+	*  \brief Turns welded vertices and indices into GPU data: \n
+	*		triangles/vertices reordered for the post-transform cache (cf meshOptimizer, report kept in optimization), tangent frames for the formats that store them, \n
+	*		LOD chain (cf meshSimplifier), bounds, vertices converted to the vertex format
+	*/
+	static void processMesh(const GeometryOptions & options, GeometryData * data)
+	{
+		if (!data->indices.empty())
+			data->optimization = meshOptimizer::optimize(&data->vertices, &data->indices);
+		if (options.vertexFormat == VERTEX_FORMAT_FULL || options.vertexFormat == VERTEX_FORMAT_PACKED)
+			tangentSpace::compute(&data->vertices, &data->indices, options.nbThreads);
+		data->lods.clear();
+		if (!data->indices.empty() && !options.lodRatios.empty())
+			meshSimplifier::buildChain(data->vertices, &data->indices, &options.lodRatios[0], static_cast<unsigned int>(options.lodRatios.size()), &data->lods);
+
+		computeBounds(data->vertices, &data->boundsMin, &data->boundsMax, &data->boundsRadius);
+		data->vertexData = gpuVertices(options.vertexFormat, data);
+		data->vertexCount = static_cast<unsigned int>(data->vertices.size());
+		data->indexData = data->indices.empty() ? NULL : &data->indices[0];
+		data->indexCount = static_cast<unsigned int>(data->indices.size());
+	}
+
+	/*!
+	*  \brief Converts vertices to a vertex format
+	* \param VertexFormat format : vertex format
+	* \param GeometryData * data : vertices and bounding box (in), layout, stride, packed vertices and dequantization transform (out)
+	* \return pointer to the data to upload (vertices or packed), NULL if there are no vertices
+	*/
+	static const void * gpuVertices(VertexFormat format, GeometryData * data)
+	{
+		getVertexLayout(format, &data->layout, &data->vertexStride);
+		setDequantization(format, data);
+		if (format == VERTEX_FORMAT_FULL)
+			return data->vertices.empty() ? NULL : &data->vertices[0];
+
+		vertexPacking::pack(data->vertices.empty() ? NULL : &data->vertices[0], data->vertices.size(), format, data->dequantizationOffset, data->dequantizationScale, &data->packed);
+		return data->packed.empty() ? NULL : &data->packed[0];
+	}
+
+	/*!
+	*  \brief Sets the dequantization transform from the bounding box of the data (identity unless the format is VERTEX_FORMAT_QUANTIZED)
+	*/
+	static void setDequantization(VertexFormat format, GeometryData * data)
+	{
+		const bool quantized = format == VERTEX_FORMAT_QUANTIZED;
+		data->dequantizationOffset = quantized ? data->boundsMin : glm::vec3(0.0f);
+		data->dequantizationScale = quantized ? data->boundsMax - data->boundsMin : glm::vec3(1.0f);
+	}
+
+	/*!
+	*  \brief Computes the object space axis aligned bounding box of vertices, and the bounding sphere around its center
+	* \param float * radius : sphere radius
+	* \return (0,0,0) for both corners, and a -1 radius, if there are no vertices
+	*/
+	static void computeBounds(const std::vector<Vertex> & vertices, glm::vec3 * boundsMin, glm::vec3 * boundsMax, float * radius)
+	{
+		*boundsMin = *boundsMax = vertices.empty() ? glm::vec3(0.0f) : vertices[0].Position;
+		for (size_t i = 1; i < vertices.size(); ++i)
+		{
+			*boundsMin = glm::min(*boundsMin, vertices[i].Position);
+			*boundsMax = glm::max(*boundsMax, vertices[i].Position);
+		}
+
+		const glm::vec3 center = 0.5f * (*boundsMin + *boundsMax);
+		float radius2 = vertices.empty() ? -1.0f : 0.0f;
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const glm::vec3 d = vertices[i].Position - center;
+			radius2 = std::max(radius2, glm::dot(d, d));
+		}
+		*radius = radius2 < 0.0f ? -1.0f : std::sqrt(radius2);
+	}
+
+	/*!
+	*  \brief WeldKey: \n
+	*		Hash map key of a vertex: the bit patterns of its position, normal and uv (-0.0 is folded onto 0.0)
+	*/
+	struct WeldKey
+	{
+		unsigned int bits[8];
+
+		explicit WeldKey(const Vertex & vertex)
+		{
+			const float values[8] = { vertex.Position.x, vertex.Position.y, vertex.Position.z,
+				vertex.Normal.x, vertex.Normal.y, vertex.Normal.z,
+				vertex.TexCoords.x, vertex.TexCoords.y };
+			for (int k = 0; k < 8; ++k)
+			{
+				const float value = values[k] + 0.0f;
+				std::memcpy(&bits[k], &value, sizeof(float));
+			}
+		}
+
+		bool operator==(const WeldKey & other) const
+		{
+			return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+		}
+	};
+
+	/*!
+	*  \brief Hashes a WeldKey (FNV-1a over its 32 bits words)
+	*/
+	struct WeldKeyHash
+	{
+		size_t operator()(const WeldKey & key) const
+		{
+			size_t hash = 2166136261u;
+			for (int k = 0; k < 8; ++k)
+				hash = (hash ^ key.bits[k]) * 16777619u;
+			return hash;
+		}
+	};
+
+	/*!
+	*  \brief Turns a triangle soup into an indexed mesh: \n
+	*		corners with exactly the same position, normal and uv are merged into one vertex \n
+	*		Vertices keep their order of first appearance
+	* \return fills indices (one per former vertex) and shrinks vertices to the unique ones
+	*/
+	static void weldVertices(std::vector<Vertex> * soup, std::vector<unsigned int> * indices)
+	{
+		std::vector<Vertex> & vertices = *soup;
+		indices->clear();
+		indices->reserve(vertices.size());
+
+		std::unordered_map<WeldKey, unsigned int, WeldKeyHash> uniqueVertices;
+		uniqueVertices.reserve(vertices.size() / 2);
+
+		size_t nbUnique = 0;
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			std::pair<std::unordered_map<WeldKey, unsigned int, WeldKeyHash>::iterator, bool> inserted =
+				uniqueVertices.insert(std::make_pair(WeldKey(vertices[i]), static_cast<unsigned int>(nbUnique)));
+			if (inserted.second)
+				vertices[nbUnique++] = vertices[i];
+			indices->push_back(inserted.first->second);
+		}
+
+		vertices.resize(nbUnique);
+		std::vector<Vertex>(vertices).swap(vertices);
+	}
+
+	/*!
+	*  \brief Expands parsed .obj records into a vertex array (three consecutive vertices per face)
+	* \param const parser::OBJData * const obj : parsed .obj file
+	* \param const float scale : geometry scaling factor
+	* \param unsigned int nbThreads : faces are split evenly between nbThreads threads (0 => one per core)
+	* \param std::vector<Vertex> * out : expanded vertices, out of range indices are clamped to a zero attribute
+	*/
+	static void buildVertices(const parser::OBJData * const obj, const float scale, unsigned int nbThreads, std::vector<Vertex> * out)
+	{
+		out->clear();
+		out->resize(obj->corners.size());
+
+		parser::parallelRanges(obj->corners.size() / 3, nbThreads, [&](size_t first, size_t last)
+		{
+			buildFaces(obj, scale, first, last, out);
+		});
+	}
+
+	/*!
+	*  \brief Expands faces [first, last) of parsed .obj records into vertices (cf buildVertices)
+	*/
+	static void buildFaces(const parser::OBJData * const obj, const float scale, size_t first, size_t last, std::vector<Vertex> * out)
+	{
+		const size_t nbPositions = obj->positions.size();
+		const size_t nbNormals = obj->normals.size();
+		const size_t nbUVs = obj->uvs.size();
+		std::vector<Vertex> & vertices = *out;
+
+		for (size_t f = 3 * first; f < 3 * last; f += 3)
+		{
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const parser::OBJCorner & corner = obj->corners[f + k];
+				Vertex & vertex = vertices[f + k];
+
+				vertex.Position = (corner.position >= 0 && static_cast<size_t>(corner.position) < nbPositions) ? scale * obj->positions[corner.position] : glm::vec3(0.0f);
+				vertex.TexCoords = (corner.uv >= 0 && static_cast<size_t>(corner.uv) < nbUVs) ? obj->uvs[corner.uv] : glm::vec2(0.0f);
+				vertex.Normal = (corner.normal >= 0 && static_cast<size_t>(corner.normal) < nbNormals) ? obj->normals[corner.normal] : glm::vec3(0.0f);
+				vertex.Tangeant = glm::vec3(0.0f);
+				vertex.BiTangeant = glm::vec3(0.0f);
+			}
+
+			// flat normal for faces that come without one
+			if (obj->corners[f].normal < 0 || obj->corners[f + 1].normal < 0 || obj->corners[f + 2].normal < 0)
+			{
+				glm::vec3 faceNormal = glm::cross(vertices[f + 1].Position - vertices[f].Position, vertices[f + 2].Position - vertices[f].Position);
+				float length = glm::length(faceNormal);
+				faceNormal = length > 0.0f ? faceNormal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+				for (size_t k = 0; k < 3; ++k)
+					if (obj->corners[f + k].normal < 0)
+						vertices[f + k].Normal = faceNormal;
+			}
+		}
+	}
 };
 
 
@@ -274,4 +1219,4 @@ private:
 }
 
 
-#endif
\ No newline at end of file
+#endif
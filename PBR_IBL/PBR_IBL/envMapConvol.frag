@@ -15,44 +15,32 @@ const float PI = 3.141592653589793238462643383;
 
 
 
-// phi = a0/2 + a1/2**2 + ... + ar/2**r+1
-// where i = a0 + a1*2 + a2*2**2 +...+ ar*2**r
-float radicalInverse_VdC(uint i)
-{
-	i = (i << 16u) | (i >> 16u);
-    i = ((i & 0x55555555u) << 1u) | ((i & 0xAAAAAAAAu) >> 1u);
-    i = ((i & 0x33333333u) << 2u) | ((i & 0xCCCCCCCCu) >> 2u);
-    i = ((i & 0x0F0F0F0Fu) << 4u) | ((i & 0xF0F0F0F0u) >> 4u);
-    i = ((i & 0x00FF00FFu) << 8u) | ((i & 0xFF00FF00u) >> 8u);
-    return float(i) * 2.3283064365386963e-10; // / 0x100000000
-}
-
-vec2 Hammersley2D(uint i, uint nSamples)
-{
-	return vec2(float(i)/float(nSamples), radicalInverse_VdC(i));
-}
+// Hammersley point set, precomputed (cf OpenGLEngine::lowDiscrepancy::hammersley, bound by OpenGLEngine::SampleTables)
+// hammersley[i] = (i/N, radical inverse of i, cos(2*pi*i/N), sin(2*pi*i/N))
+const int HAMMERSLEY_SIZE = 1024;
+layout (std140) uniform HammersleyTable {
+	vec4 hammersley[HAMMERSLEY_SIZE];
+};
 
 // Xi is a point on the Hammarsley point set
-// Xi = (u,v)
+// Xi = (u, v, cos(2*pi*u), sin(2*pi*u))
 // we then map Xi to the hemmisphere
 // unifom mapping: theta = cos-1(1-u)
 //				   phi = 2*pi*v
 // cossinus mapping: theta = cos-1(sqrt(1-u))
 //				     phi = 2*pi*v
-vec3 importanceSampling_GGX(vec2 Xi, float roughness, vec3 N)
+vec3 importanceSampling_GGX(vec4 Xi, float roughness, vec3 N)
 {
 	float alpha_tr = roughness*roughness;
 
-	float u = Xi.x;
 	float v = Xi.y;
 
-	float phi = 2 * PI * u;
 	float cosTheta = sqrt( (1.0-v)/(1.0+(alpha_tr*alpha_tr -1.0)*v) );
 	float sinTheta = sqrt( 1.0 - cosTheta*cosTheta);
 
 	vec3 H;
-	H.x = sinTheta * cos(phi);
-	H.y = sinTheta * sin(phi);
+	H.x = sinTheta * Xi.z;
+	H.y = sinTheta * Xi.w;
 	H.z = cosTheta;
 
 	// Gramm-Schmitt
@@ -92,11 +80,11 @@ void main()
 	float totalWeight = 0.0;
 
 
-	const uint nSamples = uint(1024);
+	const uint nSamples = uint(HAMMERSLEY_SIZE);
 
 	for (uint i = uint(0); i < nSamples; i++)
 	{
-		vec2 Xi = Hammersley2D(i,nSamples);
+		vec4 Xi = hammersley[i];
 		vec3 H = importanceSampling_GGX(Xi,uRoughness,N);
 
 		vec3 L = 2.0 * dot(V,H) * H - V;
@@ -28,9 +28,13 @@
 #include <OpenGLEngine\textureInterface.hpp> // texture wrapper
 #include <OpenGLEngine\uniformInterface.hpp> // uniform wrapper
 #include <OpenGLEngine\mesh.hpp> // mesh wrapper
-#include <OpenGLEngine\scene.hpp> // scene manager
+#include <OpenGLEngine\sceneRenderer.hpp> // scene manager
 #include <OpenGLEngine\frameBuffer.hpp> // FBO wrapper
 #include <OpenGLEngine\renderBuffer.hpp> // RBO wrapper
+#include <OpenGLEngine\meshLoader.hpp> // background mesh loading
+#include <OpenGLEngine\shaderPermutations.hpp> // compile time shader variants
+#include <OpenGLEngine\sampleTables.hpp> // low-discrepancy sample tables shared by the shaders
+#include <OpenGLEngine\gpuProfiler.hpp> // GPU time per render pass (timer queries)
 
 
 ////////////////////////
@@ -128,9 +132,22 @@ int main(int argc, char ** argv)
 	/////////////////////////////
 	// SHADERS
 	// NB: No support for tesselation nor geometry shaders in current build
+	// every program is compiled in one batch: the sources are read while the cubemap loads, and the driver
+	// compiles them all at once (submitted below), each one is only waited for when first used
 	/////////////////////////////
-	OpenGLEngine::Shader pbrShader("pbr.vert", "pbr.frag");
-	OpenGLEngine::Shader skyboxShader("skybox.vert", "skybox.frag");
+	OpenGLEngine::ShaderBatch shaderBatch;
+	// the specular IBL of pbr.frag is chosen at compile time (IBL_MODE): one program per mode, switched with keys 1, 2 and 3
+	// => <OpenGLEngine\shaderPermutations.hpp>
+	OpenGLEngine::ShaderPermutations pbrShaders("pbr.vert", "pbr.frag", { { "IBL_MODE", "SPLIT_SUM" } });
+	OpenGLEngine::ShaderPermutations pbrIndirectShaders("pbrIndirect.vert", "pbr.frag", { { "IBL_MODE", "SPLIT_SUM" } });
+	OpenGLEngine::Shader & pbrShader = *pbrShaders.get(OpenGLEngine::ShaderDefines(), &shaderBatch);
+	OpenGLEngine::Shader & pbrIndirectShader = *pbrIndirectShaders.get(OpenGLEngine::ShaderDefines(), &shaderBatch);
+	pbrShaders.get({ { "IBL_MODE", "REFERENCE" } }, &shaderBatch);
+	pbrIndirectShaders.get({ { "IBL_MODE", "REFERENCE" } }, &shaderBatch);
+	OpenGLEngine::Shader pbrInstancedShader("pbrInstanced.vert", "pbr.frag", &shaderBatch);
+	OpenGLEngine::Shader skyboxShader("skybox.vert", "skybox.frag", &shaderBatch);
+	OpenGLEngine::Shader envMapConvolBRDFGenShader("envMapConvol.vert", "envMapConvol.frag", &shaderBatch);
+	OpenGLEngine::Shader brdfLUTGenShader("brdfLUT.vert", "brdfLUT.frag", &shaderBatch);
 
 
 	/////////////////////////////
@@ -141,11 +158,6 @@ int main(int argc, char ** argv)
 	vLight.value = glm::vec3(0.0);
 	vLight.type = "f3v";
 
-	OpenGLEngine::iUniform importanceSampling;
-	importanceSampling.name = "importanceSampling";
-	importanceSampling.value = 0;
-	importanceSampling.type = "i";
-
 
 	/////////////////////////////
 	// CUBEMAP
@@ -163,6 +175,7 @@ int main(int argc, char ** argv)
 	textures_faces.push_back(cube_mapPath + "pz.jpg");
 	textures_faces.push_back(cube_mapPath + "nz.jpg");
 	GLuint cubeMap = OpenGLEngine::textureClient::loadCubeMap(&textures_faces);
+	shaderBatch.submit();
 	
 	// custom utility texture class
 	OpenGLEngine::TextureCube envMap;
@@ -219,7 +232,6 @@ int main(int argc, char ** argv)
 	//							  ~ (1/N S_{k=1}^N L_i(lk) )  * (1/N S_{k=1}^N brdf(lk,v) cos(theta_lk) / p(lk,v) ) 
 	// pre-compute first sum 1/N S_{k=1}^N L_i(lk) for different rougness values and store result in mip-map
 	//	N.B: brdf being GGX distribution, the shading changes depending on the viewing angle. We thus assume that this angle is 0, n = v = r
-	OpenGLEngine::Shader envMapConvolBRDFGenShader("envMapConvol.vert", "envMapConvol.frag");
 
 
 	OpenGLEngine::fUniform uRoughness;
@@ -264,10 +276,12 @@ int main(int argc, char ** argv)
 		brdfEnvMapGenPassFBO.setColorAttachments();
 
 		brdfEnvMapGenPassFBO.bindFBO();
+		OpenGLEngine::GLState::get().invalidate(); // framebuffer and viewport set by the engine library, behind the state cache
 
 		// Clear all relevant buffers
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 		envMapConvolBRDFGenShader.Use();
+		OpenGLEngine::SampleTables::get().bindProgram(&envMapConvolBRDFGenShader); // precomputed Hammersley points
 
 		float roughnessValue = static_cast<float>(i) / static_cast<float>(max_mipmap_level);
 		uRoughness.updateValue(roughnessValue);
@@ -277,7 +291,7 @@ int main(int argc, char ** argv)
 
 
 		// draw quad
-		screenQuadGeometry.draw();
+		screenQuadGeometry.drawGeometry();
 
 		// Syncronyse
 		glFinish();
@@ -305,6 +319,7 @@ int main(int argc, char ** argv)
 
 		glFinish();
 		brdfEnvMapGenPassFBO.unbindFBO();
+		OpenGLEngine::GLState::get().invalidate();
 	}
 
 	glEnable(GL_DEPTH_TEST); // reset depth testing
@@ -327,7 +342,6 @@ int main(int argc, char ** argv)
 	// split-sum approximation: s = 1/N S_{k=1}^N L_i(lk) brdf(lk,v) cos(theta_lk) / p(lk,v)
 	//							  ~ (1/N S_{k=1}^N L_i(lk) )  * (1/N S_{k=1}^N brdf(lk,v) cos(theta_lk) / p(lk,v) ) 
 	// pre-compute second sum (1/N S_{k=1}^N brdf(lk,v) cos(theta_lk) / p(lk,v) ) for different rougness values & cos(theta_v) and store result in mip-map
-	OpenGLEngine::Shader brdfLUTGenShader("brdfLUT.vert", "brdfLUT.frag");
 
 
 	////////////////////////
@@ -360,13 +374,15 @@ int main(int argc, char ** argv)
 	brdfLUTGenPassFBO.setColorAttachments();
 
 	brdfLUTGenPassFBO.bindFBO();
+	OpenGLEngine::GLState::get().invalidate();
 
 	brdfLUTGenShader.Use();
+	OpenGLEngine::SampleTables::get().bindProgram(&brdfLUTGenShader); // precomputed Hammersley points
 
 	uInverseResolution.linkUniform(&brdfLUTGenShader);
 
 	// draw quad
-	screenQuadGeometry.draw();
+	screenQuadGeometry.drawGeometry();
 
 	glEnable(GL_DEPTH_TEST); // reset depth testing
 
@@ -396,6 +412,7 @@ int main(int argc, char ** argv)
 	glBindTexture(GL_TEXTURE_2D, 0);
 	glFinish();
 	brdfLUTGenPassFBO.unbindFBO();
+	OpenGLEngine::GLState::get().invalidate();
 
 
 
@@ -434,21 +451,32 @@ int main(int argc, char ** argv)
 	/////////////////////////////
 	float y_translate = -2.0;
 	glm::vec3 meshPos = glm::vec3(0.0, -3.0 + y_translate, 0.0);
-	OpenGLEngine::Geometry mesh_geometry("Resources/Models/clumsy-dragon.obj", meshPos, 5.0);
-
-	OpenGLEngine::Geometry mesh2_geometry("Resources/Models/stanford-dragon.obj", meshPos, 1.0);
+	// the dragons are loaded in the background: the render loop starts right away and draws them as they come in
+	// each one gets a LOD chain, Scene::drawMeshes picks a level per frame from its projected error
+	OpenGLEngine::MeshLoader meshLoader;
+	OpenGLEngine::GeometryOptions meshOptions;
+	meshOptions.setLODChain();
+	OpenGLEngine::Geometry mesh_geometry;
+	meshLoader.loadOBJ(&mesh_geometry, "Resources/Models/clumsy-dragon.obj", meshPos, 5.0, meshOptions);
+
+	OpenGLEngine::Geometry mesh2_geometry;
+	meshLoader.loadOBJ(&mesh2_geometry, "Resources/Models/stanford-dragon.obj", meshPos, 1.0, meshOptions);
 	mesh2_geometry.setWorldSpacePosition(glm::vec3(-5.5, -2.5 + y_translate, 3.0));
 
-	OpenGLEngine::Geometry mesh3_geometry("Resources/Models/dragon-xyz-rgb-scan.obj", meshPos, 1.0);
+	OpenGLEngine::Geometry mesh3_geometry;
+	meshLoader.loadOBJ(&mesh3_geometry, "Resources/Models/dragon-xyz-rgb-scan.obj", meshPos, 1.0, meshOptions);
 	mesh3_geometry.setWorldSpacePosition(glm::vec3(0.5, -2.0 + y_translate, -8));
 
 	OpenGLEngine::Geometry plane_geometry("PlaneGeometry", 20.0, glm::vec3(0.0, -2.0 + y_translate, 0.0));
 
+	// a field of cubes, drawn in a single instanced call
+	OpenGLEngine::Geometry cube_geometry("CubeGeometry", 1.0, glm::vec3(0.0, 0.0, 0.0));
+
 
 	/////////////////////////////
 	// MATERIAL
 	/////////////////////////////
-	std::vector<OpenGLEngine::Uniform *> uniformVec = { &sphericalHarmonics_Coeff, &importanceSampling };
+	std::vector<OpenGLEngine::Uniform *> uniformVec = { &sphericalHarmonics_Coeff };
 	std::vector<OpenGLEngine::Texture *> textureVec = { &envMap, &EnvBRDF2ndSum, &EnvBRDF1stSum };
 	OpenGLEngine::Material pbrPassMaterial(&textureVec, &uniformVec, &pbrShader);
 
@@ -461,6 +489,25 @@ int main(int argc, char ** argv)
 	OpenGLEngine::Mesh xyz_dragon(&mesh3_geometry, &pbrPassMaterial);
 	OpenGLEngine::Mesh plane(&plane_geometry, &pbrPassMaterial);
 
+	// Instanced PBR-Rendering: every cube has its own transform, Fresnel, roughness and metalness
+	// => <OpenGLEngine\instancedMesh.hpp>
+	std::vector<OpenGLEngine::Uniform *> instancedUniformVec = { &sphericalHarmonics_Coeff, &vLight };
+	OpenGLEngine::Material pbrInstancedMaterial(&textureVec, &instancedUniformVec, &pbrInstancedShader);
+	OpenGLEngine::InstancedMesh cube_field(&cube_geometry, &pbrInstancedMaterial, true);
+
+	const int fieldSize = 16;
+	const float cubeScale = 0.2f;
+	const glm::vec3 fieldF0[4] = { glm::vec3(1.0, 0.71, 0.29), glm::vec3(0.95, 0.64, 0.54), glm::vec3(0.95, 0.93, 0.88), glm::vec3(0.1, 0.1, 0.1) };
+	for (int i = 0; i < fieldSize; ++i)
+	{
+		for (int j = 0; j < fieldSize; ++j)
+		{
+			const glm::vec3 position(-9.0 + 18.0 * i / (fieldSize - 1), -2.0 + y_translate + cubeScale, -9.0 + 18.0 * j / (fieldSize - 1));
+			const glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(cubeScale));
+			cube_field.addInstance(model, fieldF0[(i + j) % 4], 0.1f + 0.8f * i / (fieldSize - 1), j % 2 == 0 ? 0.9f : 0.2f);
+		}
+	}
+
 
 	// Append uniforms afterwards
 	// Fresnel
@@ -542,13 +589,17 @@ int main(int argc, char ** argv)
 	//
 	// Memory managment is left to the user. No copies are done
 	//
-	// => <OpenGLEngine\scene.hpp>
+	// => <OpenGLEngine\sceneRenderer.hpp>
 	////////////////////////
-	OpenGLEngine::Scene scene;
+	OpenGLEngine::SceneRenderer scene;
 	scene.addMesh(&clumbsy_dragon);
 	scene.addMesh(&standford_dragon); 
 	scene.addMesh(&xyz_dragon);
 	scene.addMesh(&plane);
+	scene.addInstancedMesh(&cube_field);
+	// static meshes are merged into a shared arena and drawn with glMultiDrawElementsIndirect (when supported)
+	// => <OpenGLEngine\indirectRenderer.hpp>
+	scene.setIndirectDraw(&pbrIndirectShader);
 
 
 	// Create a renderbuffer object for depth and stencil attachment (we won't be sampling these)
@@ -567,11 +618,16 @@ int main(int argc, char ** argv)
 	////////////////////////
 
 	stopWatch timer; // FPS counter
+	OpenGLEngine::GPUProfiler profiler; // GPU time per pass, read back a few frames later (no glFinish)
+	OpenGLEngine::GLState & glState = OpenGLEngine::GLState::get(); // state cache: redundant state calls are dropped
+	glState.setDebug(true); // counts the issued and filtered state calls of each frame
 
 	// Render loop
 	while (window.isOpen())
 	{
 		timer.start();
+		profiler.beginFrame();
+		glState.beginFrame();
 
 		////////////////////////
 		//	- Update Events
@@ -581,22 +637,28 @@ int main(int argc, char ** argv)
 		//window::mouse.inertia();
 		window.getControler()->inertia();
 
+		// stream the background loaded meshes to the GPU (bounded amount per frame)
+		meshLoader.update();
+
 		////////////////////////
 		//	- Render
 		////////////////////////
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
 
-		// Draw skybox first
+		{
+			OpenGLEngine::GPUProfiler::Scope pass(profiler, "Skybox");
+			// Draw skybox first
 
-		glDepthMask(GL_FALSE);// Remember to turn depth writing off
+			glState.depthMask(GL_FALSE);// Remember to turn depth writing off
 
-		// draw the cube inside out
-		glFrontFace(GL_CW);
-		scene.drawMesh(&skybox, &camera, &window);
-		glFrontFace(GL_CCW);
+			// draw the cube inside out
+			glState.frontFace(GL_CW);
+			scene.drawMesh(&skybox, &camera, &window);
+			glState.frontFace(GL_CCW);
 
-		glDepthMask(GL_TRUE);
+			glState.depthMask(GL_TRUE);
+		}
 
 
 
@@ -605,9 +667,23 @@ int main(int argc, char ** argv)
 
 
 
+		// 1, 2, 3: split-sum, reference or sampled split-sum specular IBL (a variant each, no per fragment branch)
+		const char * iblModes[3] = { "SPLIT_SUM", "REFERENCE", "SPLIT_SUM_SAMPLED" };
+		for (int m = 0; m < 3; ++m)
+		{
+			const OpenGLEngine::ShaderDefines iblMode = { { "IBL_MODE", iblModes[m] } };
+			if (glfwGetKey(window.getWindow(), GLFW_KEY_1 + m) != GLFW_PRESS || pbrShaders.getCurrent() == pbrShaders.get(iblMode))
+				continue;
+			OpenGLEngine::Shader * variant = pbrShaders.select(iblMode);
+			OpenGLEngine::Mesh * pbrMeshes[4] = { &clumbsy_dragon, &standford_dragon, &xyz_dragon, &plane };
+			for (int k = 0; k < 4; ++k)
+				pbrMeshes[k]->getMaterial()->setShader(variant);
+			scene.setIndirectDraw(pbrIndirectShaders.select(iblMode));
+		}
+
 		float timeValue = glfwGetTime();
 		
-		pbrShader.Use();
+		pbrShaders.getCurrent()->Use();
 		float costheta = cos(0.3*timeValue);
 		float sintheta = sin(0.3*timeValue);
 		float r = 3.0;
@@ -615,10 +691,24 @@ int main(int argc, char ** argv)
 		glm::vec3 lightPos = glm::vec3(o.x + r*costheta, o.y + r*sintheta, o.z);
 
 		vLight.updateValue(lightPos);
-		vLight.linkUniform(&pbrShader);
-
-		// 1st render pass: draw object as normal and fill stencil buffer
-		scene.drawMeshes(&camera, &window);
+		vLight.linkUniform(pbrShaders.getCurrent());
+		pbrIndirectShaders.getCurrent()->Use();
+		vLight.linkUniform(pbrIndirectShaders.getCurrent());
+
+		// a few cubes jump: only their instance records are sent again
+		for (int k = 0; k < fieldSize; ++k)
+		{
+			const size_t instance = static_cast<size_t>(k * fieldSize + (k * 5) % fieldSize);
+			glm::mat4 model = cube_field.getInstance(instance).modelMatrix;
+			model[3].y = -2.0f + y_translate + cubeScale * (1.0f + 2.0f * std::fabs(std::sin(2.0f * timeValue + k)));
+			cube_field.setTransform(instance, model);
+		}
+
+		{
+			OpenGLEngine::GPUProfiler::Scope pass(profiler, "Meshes");
+			// 1st render pass: draw object as normal and fill stencil buffer
+			scene.drawMeshes(&camera, &window);
+		}
 
 		// 2nd render pass: now draw slightly scaled versions of the objects, this time disabling stencil writing.
 		// Because stencil buffer is now filled with several 1s. The parts of the buffer that are 1 are now not drawn, thus only drawing 
@@ -626,22 +716,36 @@ int main(int argc, char ** argv)
 		//		scene.outlineMeshes(&stencilShader, &camera, &window);
 
 
+		profiler.endFrame();
+
 		// Swap the screen buffers
 		window.draw();
 
-		// Syncronyse
-		glFinish();
-
 
 		timer.end();
 		double render_time = timer.time();
-		std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+		// every 120 frames: CPU frame time, scene statistics and GPU time of each pass
+		if (profiler.getFrameCount() % 120 == 0)
+		{
+			const OpenGLEngine::RenderStats & renderStats = scene.getRenderStats();
+			const OpenGLEngine::CullingStats & cullingStats = scene.getCullingStats();
+			std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time
+				<< ", visible: " << cullingStats.visible << "/" << cullingStats.tested << ", draws: " << renderStats.draws << " for " << renderStats.objects << " objects" << ", skipped binds: " << renderStats.programBindsSkipped << " programs " << renderStats.textureBindsSkipped << " textures" << ", ";
+			glState.getStats().print(std::cout);
+			std::cout << std::endl;
+			profiler.print(std::cout);
+		}
 	}
 
 	// Melete meshes
 	// Properly de-allocate all resources once they've outlived their purpose
 	// => done in mesh desctuctor
 
+	// GPU time statistics of the last frames
+	profiler.flush();
+	profiler.writeCSV("gpuProfile.csv");
+	profiler.writeJSON("gpuProfile.json");
+
 	window.isClosed();
 
 	return 0;
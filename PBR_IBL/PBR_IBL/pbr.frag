@@ -5,11 +5,20 @@ uniform sampler2D IntegrateBRDF;
 uniform sampler2D IBLequirectangularEnvMap;
 uniform vec3 lightPos;
 
-uniform int importanceSampling;
-
-uniform vec3 uF_0;
-uniform float uRoughness;
-uniform float uMaterialMetalness;
+// specular IBL, chosen at compile time (cf OpenGLEngine::ShaderPermutations):
+//	SPLIT_SUM: prefiltered environment map and BRDF LUT, REFERENCE: importance sampled ground truth,
+//	SPLIT_SUM_SAMPLED: both split-sum factors importance sampled per fragment
+#define SPLIT_SUM 0
+#define REFERENCE 1
+#define SPLIT_SUM_SAMPLED 2
+#ifndef IBL_MODE
+#define IBL_MODE SPLIT_SUM
+#endif
+
+// material parameters: uF_0, uRoughness and uMaterialMetalness, or per instance values (cf pbrInstanced.vert)
+flat in vec3 vF_0;
+flat in float vRoughness;
+flat in float vMaterialMetalness;
 
 
 in vec3 vNormal;
@@ -82,44 +91,32 @@ float G_l(vec3 n, vec3 v, float k) {
     return G;
 }
 
-// phi = a0/2 + a1/2**2 + ... + ar/2**r+1
-// where i = a0 + a1*2 + a2*2**2 +...+ ar*2**r
-float radicalInverse_VdC(uint i)
-{
-	i = (i << 16u) | (i >> 16u);
-    i = ((i & 0x55555555u) << 1u) | ((i & 0xAAAAAAAAu) >> 1u);
-    i = ((i & 0x33333333u) << 2u) | ((i & 0xCCCCCCCCu) >> 2u);
-    i = ((i & 0x0F0F0F0Fu) << 4u) | ((i & 0xF0F0F0F0u) >> 4u);
-    i = ((i & 0x00FF00FFu) << 8u) | ((i & 0xFF00FF00u) >> 8u);
-    return float(i) * 2.3283064365386963e-10; // / 0x100000000
-}
-
-vec2 Hammersley2D(uint i, uint nSamples)
-{
-	return vec2(float(i)/float(nSamples), radicalInverse_VdC(i));
-}
+// Hammersley point set, precomputed (cf OpenGLEngine::lowDiscrepancy::hammersley, bound by OpenGLEngine::SampleTables)
+// hammersley[i] = (i/N, radical inverse of i, cos(2*pi*i/N), sin(2*pi*i/N))
+const int HAMMERSLEY_SIZE = 1024;
+layout (std140) uniform HammersleyTable {
+	vec4 hammersley[HAMMERSLEY_SIZE];
+};
 
 // Xi is a point on the Hammarsley point set
-// Xi = (u,v)
+// Xi = (u, v, cos(2*pi*u), sin(2*pi*u))
 // we then map Xi to the hemmisphere
 // unifom mapping: theta = cos-1(1-u)
 //				   phi = 2*pi*v
 // cossinus mapping: theta = cos-1(sqrt(1-u))
 //				     phi = 2*pi*v
-vec3 importanceSampling_GGX(vec2 Xi, float roughness, vec3 N)
+vec3 importanceSampling_GGX(vec4 Xi, float roughness, vec3 N)
 {
 	float alpha_tr = roughness*roughness;
 
-	float u = Xi.x;
 	float v = Xi.y;
 
-	float phi = 2 * PI * u;
 	float cosTheta = sqrt( (1.0-v)/(1.0+(alpha_tr*alpha_tr -1.0)*v) );
 	float sinTheta = sqrt( 1.0 - cosTheta*cosTheta);
 
 	vec3 H;
-	H.x = sinTheta * cos(phi);
-	H.y = sinTheta * sin(phi);
+	H.x = sinTheta * Xi.z;
+	H.y = sinTheta * Xi.w;
 	H.z = cosTheta;
 
 	// Gramm-Schmitt
@@ -131,20 +128,18 @@ vec3 importanceSampling_GGX(vec2 Xi, float roughness, vec3 N)
 	return tangentX * H.x + tangentY * H.y + N * H.z;
 }
 
-vec3 importanceSampling_GGX(vec2 Xi, float roughness)
+vec3 importanceSampling_GGX(vec4 Xi, float roughness)
 {
 	float alpha_tr = roughness*roughness;
 
-	float u = Xi.x;
 	float v = Xi.y;
 
-	float phi = 2 * PI * u;
 	float cosTheta = sqrt( (1.0-v)/(1.0+(alpha_tr*alpha_tr -1.0)*v) );
 	float sinTheta = sqrt( 1.0 - cosTheta*cosTheta);
 
 	vec3 H;
-	H.x = sinTheta * cos(phi);
-	H.y = sinTheta * sin(phi);
+	H.x = sinTheta * Xi.z;
+	H.y = sinTheta * Xi.w;
 	H.z = cosTheta;
 
 	return H;
@@ -154,11 +149,11 @@ vec3 specularIBL(vec3 specularColor, float roughness, vec3 N, vec3 V)
 {
 	vec3 specularLighting;
 
-	const uint nSamples = uint(1024);
+	const uint nSamples = uint(HAMMERSLEY_SIZE);
 
 	for (uint i = uint(0); i < nSamples; i++)
 	{
-		vec2 Xi = Hammersley2D(i,nSamples);
+		vec4 Xi = hammersley[i];
 		vec3 H = importanceSampling_GGX(Xi,roughness,N);
 
 		vec3 L = 2.0 * dot(V,H) * H - V;
@@ -204,11 +199,11 @@ vec3 splitSum_1(float roughness, vec3 R)
 	float totalWeight = 0.0;
 
 	
-	const uint nSamples = uint(1024);
+	const uint nSamples = uint(HAMMERSLEY_SIZE);
 
 	for (uint i = uint(0); i < nSamples; i++)
 	{
-		vec2 Xi = Hammersley2D(i,nSamples);
+		vec4 Xi = hammersley[i];
 		vec3 H = importanceSampling_GGX(Xi,roughness,N);
 
 		vec3 L = 2.0 * dot(V,H) * H - V;
@@ -233,10 +228,10 @@ vec2 splitSum_2(float roughness, float NoV)
 
 	vec2 r = vec2(0.0);
 
-	const uint nSamples = uint(1024);
+	const uint nSamples = uint(HAMMERSLEY_SIZE);
 	for(uint i = uint(0); i < nSamples; i++){
 	
-		vec2 Xi = Hammersley2D(i,nSamples);
+		vec4 Xi = hammersley[i];
 		vec3 H = importanceSampling_GGX(Xi,roughness);
 		vec3 L = 2 * dot(V,H) * H - V;
 		
@@ -276,11 +271,11 @@ vec3 varianceIBL(float roughness, vec3 R)
 	float totalWeight = 0.0;
 
 	
-	const uint nSamples = uint(1024);
+	const uint nSamples = uint(HAMMERSLEY_SIZE);
 
 	for (uint i = uint(0); i < nSamples; i++)
 	{
-		vec2 Xi = Hammersley2D(i,nSamples);
+		vec4 Xi = hammersley[i];
 		vec3 H = importanceSampling_GGX(Xi,roughness,N);
 
 		vec3 L = 2.0 * dot(V,H) * H - V;
@@ -296,7 +291,7 @@ vec3 varianceIBL(float roughness, vec3 R)
 	totalWeight = 0.0;
 	for (uint i = uint(0); i < nSamples; i++)
 	{
-		vec2 Xi = Hammersley2D(i,nSamples);
+		vec4 Xi = hammersley[i];
 		vec3 H = importanceSampling_GGX(Xi,roughness,N);
 
 		vec3 L = 2.0 * dot(V,H) * H - V;
@@ -321,10 +316,10 @@ vec3 varianceBRDF(float roughness, float NoV, vec3 F_0)
 		vec3 sigma2 = vec3(0.0);
 
 
-		const uint nSamples = uint(1024);
+		const uint nSamples = uint(HAMMERSLEY_SIZE);
 		for(uint i = uint(0); i < nSamples; i++){
 	
-			vec2 Xi = Hammersley2D(i,nSamples);
+			vec4 Xi = hammersley[i];
 			vec3 H = importanceSampling_GGX(Xi,roughness);
 			vec3 L = 2 * dot(V,H) * H - V;
 		
@@ -355,7 +350,7 @@ vec3 varianceBRDF(float roughness, float NoV, vec3 F_0)
 
 		for(uint i = uint(0); i < nSamples; i++){
 	
-			vec2 Xi = Hammersley2D(i,nSamples);
+			vec4 Xi = hammersley[i];
 			vec3 H = importanceSampling_GGX(Xi,roughness);
 			vec3 L = 2 * dot(V,H) * H - V;
 		
@@ -478,7 +473,7 @@ void main()
 	
 //	float uRoughness = 0.2;
 
-	vec3 uDiffuseAlbedo = uF_0;
+	vec3 uDiffuseAlbedo = vF_0;
 	//uDiffuseAlbedo = vec3(121.0/255.0,76.0/255.0,19.0/255.0);
 	//uDiffuseAlbedo = vec3(0.95,0.93,0.88);
 //	uDiffuseAlbedo = vec3(224.0/255.0,17.0/255.0,95.0/255.0);
@@ -490,12 +485,12 @@ void main()
 
 
 	// Point Light - Specular
-	vec3 F = F_Schlick(uF_0,L,H);
+	vec3 F = F_Schlick(vF_0,L,H);
 	
-	float alpha_tr = uRoughness*uRoughness;
+	float alpha_tr = vRoughness*vRoughness;
 	float D = D_tr(N,H,alpha_tr);
 
-	float k = (uRoughness + 1.0)*(uRoughness + 1.0)/8.0;
+	float k = (vRoughness + 1.0)*(vRoughness + 1.0)/8.0;
 	float G = G_l(N,L,k)*G_l(N,V,k);
 	
 	vec3 specularBRDF_PtL = D*F*G/(4.0*max(dot(N,L),0.0)*max(dot(N,V),0.0)+0.001);
@@ -504,7 +499,7 @@ void main()
 	vec3 diffuseBRDF_PtL = uDiffuseAlbedo / PI;
 
 	// metalness blending
-	vec3 BRDF_PtL = mix(diffuseBRDF_PtL,specularBRDF_PtL, uMaterialMetalness);
+	vec3 BRDF_PtL = mix(diffuseBRDF_PtL,specularBRDF_PtL, vMaterialMetalness);
 
 	// => Specular Point Light
 	fColor.rgb = PI*specularBRDF_PtL*max(dot(N,L),0.0);
@@ -527,22 +522,22 @@ void main()
 	vec3 EnvBRDF, IBLEnvMapColor;
 
 
-	if (importanceSampling == 0) {
-		EnvBRDF = texture2D( IntegrateBRDF, vec2(uRoughness, NoV) ).rgb;
+#if IBL_MODE == SPLIT_SUM
+		EnvBRDF = texture2D( IntegrateBRDF, vec2(vRoughness, NoV) ).rgb;
 
 
 		int nMips =  textureQueryLevels(skybox);
-		int lodLevel = int(round(uRoughness * float(nMips)));
+		int lodLevel = int(round(vRoughness * float(nMips)));
 		IBLEnvMapColor = RadialLookup(IBLequirectangularEnvMap,R,lodLevel).rgb;
 
-		indirectSpecular = IBLEnvMapColor * (uF_0 * EnvBRDF.x + EnvBRDF.y);
-	} else if (importanceSampling == 1) {
-		indirectSpecular = specularIBL(uF_0,uRoughness,N,V);
-	} else {
-		IBLEnvMapColor = splitSum_1(uRoughness, R);
-		EnvBRDF.rg = splitSum_2(uRoughness, NoV);
-		indirectSpecular = IBLEnvMapColor * (uF_0 * EnvBRDF.x + EnvBRDF.y);
-	}
+		indirectSpecular = IBLEnvMapColor * (vF_0 * EnvBRDF.x + EnvBRDF.y);
+#elif IBL_MODE == REFERENCE
+		indirectSpecular = specularIBL(vF_0,vRoughness,N,V);
+#else
+		IBLEnvMapColor = splitSum_1(vRoughness, R);
+		EnvBRDF.rg = splitSum_2(vRoughness, NoV);
+		indirectSpecular = IBLEnvMapColor * (vF_0 * EnvBRDF.x + EnvBRDF.y);
+#endif
 	fColor.rgb = indirectSpecular;
 
 
@@ -560,7 +555,7 @@ void main()
 
 
 	// metalness blending
-	fColor.rgb = mix(indirectDiffuse,indirectSpecular, uMaterialMetalness);
+	fColor.rgb = mix(indirectDiffuse,indirectSpecular, vMaterialMetalness);
 
 
 	// adding sepcular point light
@@ -12,14 +12,31 @@ out vec4 Lvector;
 out vec4 Vvector;
 out vec3 vColor;
 
-
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
-uniform mat4 normalMatrix;
+// material parameters (per instance in pbrInstanced.vert)
+flat out vec3 vF_0;
+flat out float vRoughness;
+flat out float vMaterialMetalness;
+
+
+// default uniforms (cf OpenGLEngine::UniformBlocks)
+layout (std140) uniform FrameUniforms {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	mat4 cameraMovment;
+	vec4 cameraPosition;
+	vec4 viewport;
+};
+layout (std140) uniform ObjectUniforms {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
 
 uniform vec3 lighDir;
 
+uniform vec3 uF_0;
+uniform float uRoughness;
+uniform float uMaterialMetalness;
+
 const int N_SH_COEFFS = 9*3;
 uniform vec3 sphericalHarmonics_Coeff[N_SH_COEFFS];
 
@@ -104,6 +121,10 @@ void main()
         
 	vColor = IBL_diffuse(worldNormal);
 
+	vF_0 = uF_0;
+	vRoughness = uRoughness;
+	vMaterialMetalness = uMaterialMetalness;
+
 
 
 	/*
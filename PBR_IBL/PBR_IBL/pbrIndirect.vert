@@ -0,0 +1,119 @@
+#version 430 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 texCoord;
+
+// index of the draw in the multi-draw indirect call (cf IndirectRenderer)
+layout (location = 14) in uint drawID;
+
+struct DrawData {
+	mat4 modelMatrix; // placement, applied after the default modelMatrix
+	vec4 dequantizationOffset;
+	vec4 dequantizationScale;
+	uint materialIndex;
+};
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+	DrawData draws[];
+};
+
+struct MaterialData {
+	vec4 F_0Roughness;
+	vec4 metalness;
+};
+layout (std430, binding = 1) readonly buffer MaterialBuffer {
+	MaterialData materials[];
+};
+
+out vec3 vNormal;
+out vec3 vPosition;
+
+out vec2 TexCoord;
+
+out vec4 Lvector;
+out vec4 Vvector;
+out vec3 vColor;
+
+flat out vec3 vF_0;
+flat out float vRoughness;
+flat out float vMaterialMetalness;
+
+
+// default uniforms (cf OpenGLEngine::UniformBlocks)
+layout (std140) uniform FrameUniforms {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	mat4 cameraMovment;
+	vec4 cameraPosition;
+	vec4 viewport;
+};
+layout (std140) uniform ObjectUniforms {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
+
+uniform vec3 lighDir;
+
+
+const int N_SH_COEFFS = 9*3;
+uniform vec3 sphericalHarmonics_Coeff[N_SH_COEFFS];
+
+const float c1 = 0.429043 ;
+const float c2 = 0.511664 ;
+const float c3 = 0.743125 ;
+const float c4 = 0.886227 ;
+const float c5 = 0.247708 ;
+
+
+vec3 IBL_diffuse(vec3 v){
+    float x = v.x;
+    float y = v.y;
+    float z = v.z;
+	
+	vec3 L_0_0 = sphericalHarmonics_Coeff[0];
+	vec3 L_1_m1 = sphericalHarmonics_Coeff[1];
+	vec3 L_1_0 = sphericalHarmonics_Coeff[2];
+	vec3 L_1_1 = sphericalHarmonics_Coeff[3];
+	vec3 L_2_m2 = sphericalHarmonics_Coeff[4];
+	vec3 L_2_m1 = sphericalHarmonics_Coeff[5];
+	vec3 L_2_0 = sphericalHarmonics_Coeff[6];
+	vec3 L_2_1 = sphericalHarmonics_Coeff[7];
+	vec3 L_2_2 = sphericalHarmonics_Coeff[8];
+
+    vec3 E = c1*L_2_2*(x*x-y*y) + c3*L_2_0*z*z + c4*L_0_0 - c5*L_2_0
+            + 2.0*c1*(L_2_m2*x*y + L_2_1*x*z + L_2_m1*y*z)
+            + 2.0*c2*(L_1_1*x + L_1_m1*y + L_1_0*z);
+
+    return E;
+}
+
+
+void main()
+{
+	DrawData draw = draws[drawID];
+	MaterialData material = materials[draw.materialIndex];
+
+	vec3 objectPosition = draw.dequantizationOffset.xyz + draw.dequantizationScale.xyz * position;
+	vec4 viewPosition = viewMatrix * draw.modelMatrix * modelMatrix * vec4(objectPosition, 1.0f);
+
+    gl_Position = projectionMatrix * viewPosition;
+
+	// draws only differ by a translation: normalMatrix holds for all of them
+	vNormal = normalize(normalMatrix*vec4(normal,0.0f)).rgb;
+    TexCoord = texCoord;
+
+	vPosition = normalize(viewPosition.xyz);
+
+	vec4 eyePos = vec4(0.0,0.0,0.0,1.0);
+    Vvector = normalize(eyePos - viewPosition);
+
+    Lvector = normalize(vec4(lighDir,1.0) - viewPosition);
+
+	
+	vec3 worldNormal = normalize( ( vec4( vNormal, 0.0 ) * viewMatrix ).xyz );
+        
+	vColor = IBL_diffuse(worldNormal);
+
+	vF_0 = material.F_0Roughness.rgb;
+	vRoughness = material.F_0Roughness.a;
+	vMaterialMetalness = material.metalness.x;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 texCoord;
+
+// per instance attributes (cf InstancedMesh)
+layout (location = 8) in mat4 instanceModelMatrix;
+layout (location = 12) in vec3 instanceF_0;
+layout (location = 13) in vec2 instanceRoughnessMetalness;
+
+out vec3 vNormal;
+out vec3 vPosition;
+
+out vec2 TexCoord;
+
+out vec4 Lvector;
+out vec4 Vvector;
+out vec3 vColor;
+
+flat out vec3 vF_0;
+flat out float vRoughness;
+flat out float vMaterialMetalness;
+
+
+// default uniforms (cf OpenGLEngine::UniformBlocks)
+layout (std140) uniform FrameUniforms {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	mat4 cameraMovment;
+	vec4 cameraPosition;
+	vec4 viewport;
+};
+layout (std140) uniform ObjectUniforms {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
+
+uniform vec3 lighDir;
+
+// 1 => material parameters from the instance attributes, 0 => from the uniforms
+uniform int useInstanceMaterial;
+uniform vec3 uF_0;
+uniform float uRoughness;
+uniform float uMaterialMetalness;
+
+const int N_SH_COEFFS = 9*3;
+uniform vec3 sphericalHarmonics_Coeff[N_SH_COEFFS];
+
+const float c1 = 0.429043 ;
+const float c2 = 0.511664 ;
+const float c3 = 0.743125 ;
+const float c4 = 0.886227 ;
+const float c5 = 0.247708 ;
+
+
+vec3 IBL_diffuse(vec3 v){
+    float x = v.x;
+    float y = v.y;
+    float z = v.z;
+	
+	vec3 L_0_0 = sphericalHarmonics_Coeff[0];
+	vec3 L_1_m1 = sphericalHarmonics_Coeff[1];
+	vec3 L_1_0 = sphericalHarmonics_Coeff[2];
+	vec3 L_1_1 = sphericalHarmonics_Coeff[3];
+	vec3 L_2_m2 = sphericalHarmonics_Coeff[4];
+	vec3 L_2_m1 = sphericalHarmonics_Coeff[5];
+	vec3 L_2_0 = sphericalHarmonics_Coeff[6];
+	vec3 L_2_1 = sphericalHarmonics_Coeff[7];
+	vec3 L_2_2 = sphericalHarmonics_Coeff[8];
+
+    vec3 E = c1*L_2_2*(x*x-y*y) + c3*L_2_0*z*z + c4*L_0_0 - c5*L_2_0
+            + 2.0*c1*(L_2_m2*x*y + L_2_1*x*z + L_2_m1*y*z)
+            + 2.0*c2*(L_1_1*x + L_1_m1*y + L_1_0*z);
+
+    return E;
+}
+
+
+void main()
+{
+	mat4 model = modelMatrix * instanceModelMatrix;
+	vec4 viewPosition = viewMatrix * model * vec4(position, 1.0f);
+
+    gl_Position = projectionMatrix * viewPosition;
+
+	// instance transforms are rigid (+ uniform scale): their upper 3x3 transforms normals up to a scale
+	vNormal = normalize(mat3(normalMatrix) * mat3(instanceModelMatrix) * normal);
+    TexCoord = texCoord;
+
+	vPosition = normalize(viewPosition.xyz);
+
+	vec4 eyePos = vec4(0.0,0.0,0.0,1.0);
+    Vvector = normalize(eyePos - viewPosition);
+
+    Lvector = normalize(vec4(lighDir,1.0) - viewPosition);
+
+	
+	vec3 worldNormal = normalize( ( vec4( vNormal, 0.0 ) * viewMatrix ).xyz );
+        
+	vColor = IBL_diffuse(worldNormal);
+
+	if (useInstanceMaterial != 0) {
+		vF_0 = instanceF_0;
+		vRoughness = instanceRoughnessMetalness.x;
+		vMaterialMetalness = instanceRoughnessMetalness.y;
+	} else {
+		vF_0 = uF_0;
+		vRoughness = uRoughness;
+		vMaterialMetalness = uMaterialMetalness;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+#ifndef SHADERPERMUTATIONS_HPP
+#define SHADERPERMUTATIONS_HPP
+
+
+
+////////////////////////
+// STL
+////////////////////////
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "shaderInterface.hpp"
+#include "programReflection.hpp"
+#include "glState.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file shaderPermutations.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SHADER */
+/*@{*/
+
+
+/*!
+*  \brief Shader Permutations: \n
+*		The programs built from one pair of sources with different preprocessor definitions (cf ShaderDefines). \n
+*		Quality settings and modes become #defines: each variant is compiled with its loop counts and branches known, \n
+*		so the compiler unrolls the loops and drops the dead branches, instead of testing a uniform per fragment. \n
+*		Variants are created on first request (or ahead of time through a ShaderBatch), kept by key, and each one \n
+*		has its own program binary cache (cf programCache). Switching variants at runtime is a map lookup. \n
+*
+*	\code{.cpp}
+*		ShaderPermutations ssaoShaders("ssao.vert", "ssao.frag", { { "SSAO_SAMPLES", "16" } });
+*		const char * tiers[3] = { "8", "16", "32" };
+*		for (int t = 0; t < 3; ++t)
+*			ssaoShaders.get({ { "SSAO_SAMPLES", tiers[t] } }, &batch); // compiled along with the other programs
+*		...
+*		ssaoShaders.select({ { "SSAO_SAMPLES", "32" } });
+*		ssaoShaders.getCurrent()->Use();
+*	\endcode
+*
+*	\note the definitions given to get/select override the defaults given to the constructor, the others are kept. \n
+*		The Shader pointers stay valid as long as the ShaderPermutations exists (Materials may keep them). \n
+*		A ShaderBatch given to get has to be submitted before the ShaderPermutations is destroyed
+*/
+class ShaderPermutations
+{
+public:
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Constructor: \n
+	*		no program is built before get or select
+	*
+	* \param const char * vertexPath : string representing to input vertex shader (must end in .vert)
+	* \param const char * fragmentPath : string representing to input fragment shader (must end in .frag)
+	* \param const ShaderDefines & defaults : definitions of every variant, unless overridden
+	*/
+	ShaderPermutations(const char * vertexPath, const char * fragmentPath, const ShaderDefines & defaults = ShaderDefines())
+		: vertexPath(vertexPath), fragmentPath(fragmentPath), defaults(defaults), current(NULL)
+	{
+	}
+
+	/*!
+	*  \brief Destructor: \n
+	*		deletes the programs of every variant
+	*/
+	~ShaderPermutations()
+	{
+		for (std::map<std::string, std::unique_ptr<Shader> >::iterator it = variants.begin(); it != variants.end(); ++it)
+		{
+			it->second->wait();
+			ProgramReflection::forget(it->second->Program);
+			GLState::get().programDeleted(it->second->Program);
+			glDeleteProgram(it->second->Program);
+		}
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Returns the variant of a set of definitions, built on first request
+	*
+	* \param const ShaderDefines & defines : definitions overriding the defaults
+	* \param ShaderBatch * batch : batch compiling a new variant (NULL => built at once)
+	* \return Shader * : the variant's shader
+	*/
+	Shader * get(const ShaderDefines & defines = ShaderDefines(), ShaderBatch * batch = NULL)
+	{
+		ShaderDefines merged = defaults;
+		for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); ++it)
+			merged[it->first] = it->second;
+
+		std::unique_ptr<Shader> & variant = variants[key(merged)];
+		if (!variant)
+			variant.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), merged, batch));
+		return variant.get();
+	}
+	/*!
+	*  \brief Returns the selected variant (the defaults one until select is called)
+	*/
+	Shader * getCurrent()
+	{
+		if (current == NULL)
+			current = get();
+		return current;
+	}
+	/*!
+	*  \brief Returns the number of variants built so far
+	*/
+	size_t size() const
+	{
+		return variants.size();
+	}
+
+
+	///////////////////////////////////////////
+	//	SETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Selects the variant returned by getCurrent (built now if it was never requested)
+	*
+	* \param const ShaderDefines & defines : definitions overriding the defaults
+	* \return Shader * : the selected variant
+	*/
+	Shader * select(const ShaderDefines & defines)
+	{
+		current = get(defines);
+		return current;
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Returns the key of a set of definitions: "NAME=VALUE" entries, sorted by name and separated by spaces
+	*/
+	static std::string key(const ShaderDefines & defines)
+	{
+		std::string text;
+		for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); ++it)
+			text += (text.empty() ? "" : " ") + it->first + "=" + it->second;
+		return text;
+	}
+
+
+private:
+	//! sources shared by every variant
+	std::string vertexPath, fragmentPath;
+	//! definitions of every variant, unless overridden
+	ShaderDefines defaults;
+	//! variants built so far, by key
+	std::map<std::string, std::unique_ptr<Shader> > variants;
+	//! variant returned by getCurrent
+	Shader * current;
+
+	ShaderPermutations(const ShaderPermutations &);
+	ShaderPermutations & operator=(const ShaderPermutations &);
+};
+
+/*@}*/
+
+}
+
+#endif
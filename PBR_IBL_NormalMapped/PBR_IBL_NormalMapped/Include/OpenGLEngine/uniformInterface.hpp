@@ -16,12 +16,15 @@
 #include <typeinfo>  // operator typeid
 #include <type_traits> // is_same
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
 
 
 ////////////////////////
 // CUSTOM
 ////////////////////////
 #include "shaderInterface.hpp"
+#include "programReflection.hpp"
 
 namespace OpenGLEngine
 {
@@ -50,7 +53,11 @@ namespace OpenGLEngine
 *			type, uniform type (float, vector2,3f...): std::string \n
 *			\n
 *			virtual uniform linking to specified shader \n
-*			virtual update uniform value
+*			virtual update uniform value \n
+*			\n
+*			linkUniform is also compiled into the engine library: it looks the location up and sends the value on every call. \n
+*			linkCached goes through the ProgramReflection of the shader: the slot of the uniform is resolved once (cf UniformRegistry), \n
+*			and the value is only sent if it differs from the one the program holds (cf ProgramReflection::changed)
 */
 struct Uniform
 {
@@ -97,6 +104,23 @@ struct Uniform
 	virtual void updateValue()
 	{};
 
+	/*!
+	*  \brief Links uniform to input shader through its ProgramReflection: \n
+	*		same result as linkUniform, without the lookups and the values the program already holds
+	*
+	* \param Shader * shader: input shader to which uniforms needs to be linked (in use)
+	* \param ProgramReflection & program: reflection of its program (cf ProgramReflection::of)
+	*/
+	void linkCached(const Shader * const ourShader, ProgramReflection & program);
+
+	/*!
+	*  \brief Returns the ProgramReflection slot of the uniform name (a hash lookup: resolve it once, cf UniformRegistry)
+	*/
+	unsigned int getSlot() const
+	{
+		return ProgramReflection::slotOf(name);
+	}
+
 };
 
 
@@ -446,6 +470,124 @@ struct af3vUniform : Uniform
 	
 };
 
+/*!
+*  \brief Uniform Registry: \n
+*		The slot and the type of every Uniform linked through linkCached, resolved on its first link. \n
+*		The layout of Uniform is the engine library's, hence this side table keyed by the uniform address \n
+*		(as GeometryRegistry for the VAO of a Geometry); an entry is resolved again if the type or the name at this address changed
+*/
+class UniformRegistry
+{
+public:
+	enum Kind
+	{
+		KIND_FLOAT,
+		KIND_INT,
+		KIND_VEC2,
+		KIND_VEC3,
+		KIND_MAT4,
+		KIND_VEC3_ARRAY,
+		KIND_OTHER /**< linked through linkUniform */
+	};
+
+	struct Entry
+	{
+		const std::type_info * dynamicType = NULL;
+		std::string name;
+		unsigned int slot = 0;
+		Kind kind = KIND_OTHER;
+	};
+
+	static UniformRegistry & get()
+	{
+		static UniformRegistry registry;
+		return registry;
+	}
+
+	/*!
+	*  \brief Returns the entry of a uniform, resolved on its first call
+	*/
+	const Entry & find(const Uniform * uniform)
+	{
+		Entry & entry = entries[uniform];
+		if (entry.dynamicType == NULL || *entry.dynamicType != typeid(*uniform) || entry.name != uniform->name)
+		{
+			entry.dynamicType = &typeid(*uniform);
+			entry.name = uniform->name;
+			entry.slot = ProgramReflection::slotOf(uniform->name);
+			if (dynamic_cast<const fUniform *>(uniform) != NULL) entry.kind = KIND_FLOAT;
+			else if (dynamic_cast<const iUniform *>(uniform) != NULL) entry.kind = KIND_INT;
+			else if (dynamic_cast<const f2vUniform *>(uniform) != NULL) entry.kind = KIND_VEC2;
+			else if (dynamic_cast<const f3vUniform *>(uniform) != NULL) entry.kind = KIND_VEC3;
+			else if (dynamic_cast<const m4fUniform *>(uniform) != NULL) entry.kind = KIND_MAT4;
+			else if (dynamic_cast<const af3vUniform *>(uniform) != NULL) entry.kind = KIND_VEC3_ARRAY;
+			else entry.kind = KIND_OTHER;
+		}
+		return entry;
+	}
+
+private:
+	std::unordered_map<const Uniform *, Entry> entries;
+};
+
+
+inline void Uniform::linkCached(const Shader * const ourShader, ProgramReflection & program)
+{
+	const UniformRegistry::Entry & entry = UniformRegistry::get().find(this);
+	const unsigned int slot = entry.slot;
+	switch (entry.kind)
+	{
+	case UniformRegistry::KIND_FLOAT:
+	{
+		const float & value = static_cast<const fUniform *>(this)->value;
+		if (program.changed(slot, &value, sizeof(value)))
+			glUniform1f(program.location(slot), value);
+		break;
+	}
+	case UniformRegistry::KIND_INT:
+	{
+		const int & value = static_cast<const iUniform *>(this)->value;
+		if (program.changed(slot, &value, sizeof(value)))
+			glUniform1i(program.location(slot), value);
+		break;
+	}
+	case UniformRegistry::KIND_VEC2:
+	{
+		const glm::vec2 & value = static_cast<const f2vUniform *>(this)->value;
+		if (program.changed(slot, glm::value_ptr(value), sizeof(value)))
+			glUniform2fv(program.location(slot), 1, glm::value_ptr(value));
+		break;
+	}
+	case UniformRegistry::KIND_VEC3:
+	{
+		const glm::vec3 & value = static_cast<const f3vUniform *>(this)->value;
+		if (program.changed(slot, glm::value_ptr(value), sizeof(value)))
+			glUniform3fv(program.location(slot), 1, glm::value_ptr(value));
+		break;
+	}
+	case UniformRegistry::KIND_MAT4:
+	{
+		const glm::mat4 & value = static_cast<const m4fUniform *>(this)->value;
+		if (program.changed(slot, glm::value_ptr(value), sizeof(value)))
+			glUniformMatrix4fv(program.location(slot), 1, GL_FALSE, glm::value_ptr(value));
+		break;
+	}
+	case UniformRegistry::KIND_VEC3_ARRAY:
+	{
+		const std::vector<glm::vec3> & value = static_cast<const af3vUniform *>(this)->value;
+		if (value.empty() || !program.changed(slot, &value[0][0], value.size() * sizeof(glm::vec3)))
+			break;
+		// the whole array in one call, from element 0 (elements beyond the declared size are ignored)
+		const GLsizei count = std::min(static_cast<GLsizei>(value.size()), program.size(slot));
+		glUniform3fv(program.location(slot), count, &value[0][0]);
+		break;
+	}
+	default:
+		linkUniform(ourShader);
+		break;
+	}
+}
+
 /*@}*/
 
 }
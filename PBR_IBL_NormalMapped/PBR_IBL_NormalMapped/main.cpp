@@ -28,9 +28,10 @@
 #include <OpenGLEngine\textureInterface.hpp> // texture wrapper
 #include <OpenGLEngine\uniformInterface.hpp> // uniform wrapper
 #include <OpenGLEngine\mesh.hpp> // mesh wrapper
-#include <OpenGLEngine\scene.hpp> // scene manager
+#include <OpenGLEngine\sceneRenderer.hpp> // scene manager
 #include <OpenGLEngine\frameBuffer.hpp> // FBO wrapper
 #include <OpenGLEngine\renderBuffer.hpp> // RBO wrapper
+#include <OpenGLEngine\gpuProfiler.hpp> // GPU time per render pass (timer queries)
 
 
 ////////////////////////
@@ -277,6 +278,7 @@ int main(int argc, char ** argv)
 		brdfEnvMapGenPassFBO.setColorAttachments();
 
 		brdfEnvMapGenPassFBO.bindFBO();
+		OpenGLEngine::GLState::get().invalidate(); // framebuffer and viewport set by the engine library, behind the state cache
 
 		// Clear all relevant buffers
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
@@ -290,7 +292,7 @@ int main(int argc, char ** argv)
 
 
 		// draw quad
-		screenQuadGeometry.draw();
+		screenQuadGeometry.drawGeometry();
 
 		// Syncronyse
 		glFinish();
@@ -311,6 +313,7 @@ int main(int argc, char ** argv)
 
 		glFinish();
 		brdfEnvMapGenPassFBO.unbindFBO();
+		OpenGLEngine::GLState::get().invalidate();
 	}
 
 	glEnable(GL_DEPTH_TEST); // reset depth testing
@@ -366,13 +369,14 @@ int main(int argc, char ** argv)
 	brdfLUTGenPassFBO.setColorAttachments();
 
 	brdfLUTGenPassFBO.bindFBO();
+	OpenGLEngine::GLState::get().invalidate();
 
 	brdfLUTGenShader.Use();
 
 	uInverseResolution.linkUniform(&brdfLUTGenShader);
 
 	// draw quad
-	screenQuadGeometry.draw();
+	screenQuadGeometry.drawGeometry();
 
 	glEnable(GL_DEPTH_TEST); // reset depth testing
 
@@ -395,6 +399,7 @@ int main(int argc, char ** argv)
 	glBindTexture(GL_TEXTURE_2D, 0);
 	glFinish();
 	brdfLUTGenPassFBO.unbindFBO();
+	OpenGLEngine::GLState::get().invalidate();
 
 
 
@@ -523,9 +528,9 @@ int main(int argc, char ** argv)
 	//
 	// Memory managment is left to the user. No copies are done
 	//
-	// => <OpenGLEngine\scene.hpp>
+	// => <OpenGLEngine\sceneRenderer.hpp>
 	////////////////////////
-	OpenGLEngine::Scene scene;
+	OpenGLEngine::SceneRenderer scene;
 	scene.addMesh(&model_mesh);
 
 
@@ -545,11 +550,15 @@ int main(int argc, char ** argv)
 	////////////////////////
 
 	stopWatch timer; // FPS counter
+	OpenGLEngine::GPUProfiler profiler; // GPU time per pass, read back a few frames later (no glFinish)
+	OpenGLEngine::GLState & glState = OpenGLEngine::GLState::get(); // state cache: redundant state calls are dropped
 
 	// Render loop
 	while (window.isOpen())
 	{
 		timer.start();
+		profiler.beginFrame();
+		glState.beginFrame();
 
 		////////////////////////
 		//	- Update Events
@@ -567,14 +576,14 @@ int main(int argc, char ** argv)
 
 		// Draw skybox first
 
-		glDepthMask(GL_FALSE);// Remember to turn depth writing off
+		glState.depthMask(GL_FALSE);// Remember to turn depth writing off
 
 		// draw the cube inside out
-		glFrontFace(GL_CW);
+		glState.frontFace(GL_CW);
 		scene.drawMesh(&skybox, &camera, &window);
-		glFrontFace(GL_CCW);
+		glState.frontFace(GL_CCW);
 
-		glDepthMask(GL_TRUE);
+		glState.depthMask(GL_TRUE);
 
 
 
@@ -604,22 +613,31 @@ int main(int argc, char ** argv)
 		//		scene.outlineMeshes(&stencilShader, &camera, &window);
 
 
+		profiler.endFrame();
+
 		// Swap the screen buffers
 		window.draw();
 
-		// Syncronyse
-		glFinish();
-
 
 		timer.end();
 		double render_time = timer.time();
-		std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+		// every 120 frames: CPU frame time and GPU time of each pass
+		if (profiler.getFrameCount() % 120 == 0)
+		{
+			std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+			profiler.print(std::cout);
+		}
 	}
 
 	// Melete meshes
 	// Properly de-allocate all resources once they've outlived their purpose
 	// => done in mesh desctuctor
 
+	// GPU time statistics of the last frames
+	profiler.flush();
+	profiler.writeCSV("gpuProfile.csv");
+	profiler.writeJSON("gpuProfile.json");
+
 	window.isClosed();
 
 	return 0;
@@ -0,0 +1,233 @@
+#ifndef FRUSTUMCULLING_HPP
+#define FRUSTUMCULLING_HPP
+
+
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+////////////////////////
+// SIMD
+////////////////////////
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OPENGLENGINE_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace OpenGLEngine
+{
+
+/**
+* \file frustumCulling.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SCENE */
+/*@{*/
+
+
+/*!
+*  \brief Per frame counters of the frustum culling (cf SceneRenderer::getCullingStats)
+*/
+struct CullingStats
+{
+	unsigned int tested = 0; /**< meshes with known bounds, tested against the frustum */
+	unsigned int visible = 0; /**< tested meshes inside or intersecting the frustum */
+	unsigned int occluded = 0; /**< meshes in the frustum hidden behind the occluders (cf SceneRenderer::addOccluder) */
+};
+
+
+/*!
+*  \brief View frustum culling: \n
+*		The six planes are taken from a view-projection matrix ("Fast Extraction of Viewing Frustum Planes from the \n
+*		World-View-Projection Matrix" by Gil Gribb and Klaus Hartmann). Bounds are stored in SoA form (one array per component), \n
+*		and tested 4 objects at a time (SSE, scalar fallback). \n
+*
+*		Every object is a world space box (center, half extents) with a bounding sphere around the same center: \n
+*		for each plane, the object is outside if its center is further behind the plane than the smaller of the sphere radius \n
+*		and the box projected radius. Both are conservative, so an object is never culled while visible.
+*
+*	\code{.cpp}
+*		frustumCulling::Bounds bounds;
+*		bounds.push(center, halfExtents, radius); // per object
+*		std::vector<unsigned char> visible(bounds.size());
+*		size_t nbVisible = frustumCulling::cull(frustumCulling::extract(projection * view), bounds, &visible[0]);
+*	\endcode
+*/
+namespace frustumCulling
+{
+	/*!
+	*  \brief Frustum: \n
+	*		six normalized planes (nx, ny, nz, d), a point p is inside a plane if dot(n, p) + d >= 0 \n
+	*		order: left, right, bottom, top, near, far
+	*/
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+	};
+
+	/*!
+	*  \brief Extracts the frustum planes of a view-projection matrix (OpenGL clip space, -w <= z <= w)
+	* \param const glm::mat4 & viewProjection : projection * view (world space planes)
+	* \return world space frustum
+	*/
+	inline Frustum extract(const glm::mat4 & viewProjection)
+	{
+		// glm is column major: row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; ++i)
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+		Frustum frustum;
+		frustum.planes[0] = rows[3] + rows[0];
+		frustum.planes[1] = rows[3] - rows[0];
+		frustum.planes[2] = rows[3] + rows[1];
+		frustum.planes[3] = rows[3] - rows[1];
+		frustum.planes[4] = rows[3] + rows[2];
+		frustum.planes[5] = rows[3] - rows[2];
+		for (int p = 0; p < 6; ++p)
+		{
+			const float length = glm::length(glm::vec3(frustum.planes[p]));
+			if (length > 0.0f)
+				frustum.planes[p] /= length;
+		}
+		return frustum;
+	}
+
+	/*!
+	*  \brief Bounds: \n
+	*		world space boxes and spheres of the objects to test, in SoA form
+	*/
+	struct Bounds
+	{
+		std::vector<float> centerX, centerY, centerZ; /**< box center, also the sphere center */
+		std::vector<float> extentX, extentY, extentZ; /**< box half extents */
+		std::vector<float> radius; /**< sphere radius */
+
+		size_t size() const
+		{
+			return radius.size();
+		}
+
+		/*!
+		*  \brief Empties the arrays (allocations are kept)
+		*/
+		void clear()
+		{
+			centerX.clear(); centerY.clear(); centerZ.clear();
+			extentX.clear(); extentY.clear(); extentZ.clear();
+			radius.clear();
+		}
+
+		/*!
+		*  \brief Appends an object
+		* \param const glm::vec3 center : world space box center
+		* \param const glm::vec3 extent : box half extents
+		* \param float r : radius of the sphere around center
+		*/
+		void push(const glm::vec3 center, const glm::vec3 extent, float r)
+		{
+			centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+			extentX.push_back(extent.x); extentY.push_back(extent.y); extentZ.push_back(extent.z);
+			radius.push_back(r);
+		}
+	};
+
+	/*!
+	*  \brief Tests objects [first, last) one at a time
+	*/
+	inline size_t cullScalar(const Frustum & frustum, const Bounds & bounds, size_t first, size_t last, unsigned char * visible)
+	{
+		size_t nbVisible = 0;
+		for (size_t i = first; i < last; ++i)
+		{
+			bool outside = false;
+			for (int p = 0; p < 6 && !outside; ++p)
+			{
+				const glm::vec4 & plane = frustum.planes[p];
+				const float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+				const float boxRadius = std::fabs(plane.x) * bounds.extentX[i] + std::fabs(plane.y) * bounds.extentY[i] + std::fabs(plane.z) * bounds.extentZ[i];
+				outside = distance < -std::min(bounds.radius[i], boxRadius);
+			}
+			visible[i] = outside ? 0 : 1;
+			nbVisible += visible[i];
+		}
+		return nbVisible;
+	}
+
+	/*!
+	*  \brief Tests every object against the frustum
+	*
+	* \param const Frustum & frustum : world space frustum (cf extract)
+	* \param const Bounds & bounds : world space bounds
+	* \param unsigned char * visible : bounds.size() flags, set to 1 if the object may be visible, 0 if it is outside
+	* \return number of visible objects
+	*/
+	inline size_t cull(const Frustum & frustum, const Bounds & bounds, unsigned char * visible)
+	{
+		const size_t n = bounds.size();
+		size_t i = 0;
+		size_t nbVisible = 0;
+
+#ifdef OPENGLENGINE_USE_SSE
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		__m128 nx[6], ny[6], nz[6], nd[6], ax[6], ay[6], az[6];
+		for (int p = 0; p < 6; ++p)
+		{
+			nx[p] = _mm_set1_ps(frustum.planes[p].x);
+			ny[p] = _mm_set1_ps(frustum.planes[p].y);
+			nz[p] = _mm_set1_ps(frustum.planes[p].z);
+			nd[p] = _mm_set1_ps(frustum.planes[p].w);
+			ax[p] = _mm_and_ps(nx[p], signMask);
+			ay[p] = _mm_and_ps(ny[p], signMask);
+			az[p] = _mm_and_ps(nz[p], signMask);
+		}
+
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+			const __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+			const __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+			const __m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+			const __m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+			const __m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+			const __m128 r = _mm_loadu_ps(&bounds.radius[i]);
+
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < 6; ++p)
+			{
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), nd[p]));
+				const __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+				// distance < -min(r, boxRadius)  <=>  distance + min(r, boxRadius) < 0
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, _mm_min_ps(r, boxRadius)), _mm_setzero_ps()));
+			}
+
+			const int mask = _mm_movemask_ps(outside);
+			for (int k = 0; k < 4; ++k)
+			{
+				visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+				nbVisible += visible[i + k];
+			}
+		}
+#endif
+
+		return nbVisible + cullScalar(frustum, bounds, i, n, visible);
+	}
+}
+
+/*@}*/
+
+}
+
+#endif
@@ -0,0 +1,473 @@
+#ifndef GLSTATE_HPP
+#define GLSTATE_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// STL
+////////////////////////
+#include <ostream>
+#include <cstring>
+
+namespace OpenGLEngine
+{
+
+/**
+* \file glState.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SCENE */
+/*@{*/
+
+
+/*!
+*  \brief Kinds of state calls counted by GLState
+*/
+enum StateCall
+{
+	STATE_PROGRAM,
+	STATE_VERTEX_ARRAY,
+	STATE_FRAMEBUFFER,
+	STATE_TEXTURE,
+	STATE_SAMPLER,
+	STATE_CAPABILITY,
+	STATE_DEPTH,
+	STATE_STENCIL,
+	STATE_CULL,
+	STATE_BLEND,
+	STATE_VIEWPORT,
+	NB_STATE_CALLS
+};
+
+
+/*!
+*  \brief Per frame counters of a GLState in debug mode: calls sent to OpenGL, and calls filtered as redundant
+*/
+struct GLStateStats
+{
+	unsigned int issued[NB_STATE_CALLS];
+	unsigned int filtered[NB_STATE_CALLS];
+
+	GLStateStats()
+	{
+		std::memset(issued, 0, sizeof(issued));
+		std::memset(filtered, 0, sizeof(filtered));
+	}
+
+	unsigned int totalIssued() const
+	{
+		unsigned int total = 0;
+		for (int i = 0; i < NB_STATE_CALLS; ++i)
+			total += issued[i];
+		return total;
+	}
+	unsigned int totalFiltered() const
+	{
+		unsigned int total = 0;
+		for (int i = 0; i < NB_STATE_CALLS; ++i)
+			total += filtered[i];
+		return total;
+	}
+
+	//! prints "issued/filtered" per kind of call, on one line
+	void print(std::ostream & out) const
+	{
+		static const char * names[NB_STATE_CALLS] = { "program", "vao", "fbo", "texture", "sampler", "enable", "depth", "stencil", "cull", "blend", "viewport" };
+		out << "GL state calls: " << totalIssued() << " issued, " << totalFiltered() << " filtered (";
+		for (int i = 0; i < NB_STATE_CALLS; ++i)
+			out << (i != 0 ? ", " : "") << names[i] << " " << issued[i] << "/" << filtered[i];
+		out << ")";
+	}
+};
+
+
+/*!
+*  \brief GL State: \n
+*		Thin shadow of the OpenGL context state: program, VAO, framebuffers, texture units, sampler objects, \n
+*		depth / stencil / cull / blend state and viewport. A call setting the value already current is dropped. \n
+*
+*		Values start unknown (the first call is always sent). The engine headers bind through it (Shader::Use, Geometry::drawGeometry, \n
+*		SceneRenderer...). Code outside the cache (the engine library: Material::bindMaterial / unbindMaterial, Geometry::draw, \n
+*		FrameBuffer::bindFBO / unbindFBO / bindTextureTargets, or raw gl* calls in the demos) changes the context behind it: \n
+*		invalidate() (or invalidateTextures()) has to follow it. beginFrame and every SceneRenderer draw start with invalidate(). \n
+*
+*		In debug mode (setDebug), every call is counted as issued or filtered, per kind, until the next beginFrame.
+*
+*	\code{.cpp}
+*		GLState & state = GLState::get();
+*		state.beginFrame();
+*		state.depthMask(GL_FALSE);
+*		state.frontFace(GL_CW);
+*		scene.drawMesh(&skybox, &camera, &window);
+*		state.frontFace(GL_CCW);
+*		state.depthMask(GL_TRUE);
+*	\endcode
+*
+*	\note one instance, for the one OpenGL context of the demos
+*/
+class GLState
+{
+public:
+	//! texture units tracked (units beyond are always bound)
+	static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+	/*!
+	*  \brief Returns the state cache of the context
+	*/
+	static GLState & get()
+	{
+		static GLState state;
+		return state;
+	}
+
+
+	///////////////////////////////////////////
+	//	FRAME
+	///////////////////////////////////////////
+	/*!
+	*  \brief Starts a frame: forgets every value (cf invalidate) and resets the counters
+	*/
+	void beginFrame()
+	{
+		invalidate();
+		stats = GLStateStats();
+	}
+	/*!
+	*  \brief Forgets every value: the next call of each kind is sent
+	*/
+	void invalidate()
+	{
+		program = vertexArray = drawFramebuffer = readFramebuffer = UNKNOWN;
+		activeUnit = UNKNOWN;
+		for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+		{
+			for (int t = 0; t < NB_TEXTURE_TARGETS; ++t)
+				textures[unit][t] = UNKNOWN;
+			samplers[unit] = UNKNOWN;
+		}
+		for (int c = 0; c < NB_CAPABILITIES; ++c)
+			capabilities[c] = UNKNOWN_FLAG;
+		depthWrite = UNKNOWN_FLAG;
+		depthCompare = cullMode = frontFaceMode = UNKNOWN;
+		blendSource = blendDestination = UNKNOWN;
+		stencilCompare = stencilWriteMask = UNKNOWN;
+		stencilRef = 0;
+		stencilReadMask = UNKNOWN;
+		stencilFail = stencilDepthFail = stencilPass = UNKNOWN;
+		viewportKnown = false;
+	}
+
+	/*!
+	*  \brief Forgets the texture bindings and the active unit only \n
+	*		(after code binding textures behind the cache, e.g. Material::unbindMaterial)
+	*/
+	void invalidateTextures()
+	{
+		activeUnit = UNKNOWN;
+		for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+			for (int t = 0; t < NB_TEXTURE_TARGETS; ++t)
+				textures[unit][t] = UNKNOWN;
+	}
+
+	/*!
+	*  \brief Forgets a deleted vertex array / program if it is the bound one \n
+	*		(glDelete* unbinds it, and a later glGen* may hand the same name back)
+	*/
+	void vertexArrayDeleted(GLuint id)
+	{
+		if (vertexArray == id)
+			vertexArray = UNKNOWN;
+	}
+	void programDeleted(GLuint id)
+	{
+		if (program == id)
+			program = UNKNOWN;
+	}
+
+	/*!
+	*  \brief Counts the calls of the frame (issued and filtered, cf getStats)
+	*/
+	void setDebug(bool enabled)
+	{
+		debug = enabled;
+	}
+	bool isDebug() const
+	{
+		return debug;
+	}
+	/*!
+	*  \brief Returns the counters since beginFrame (debug mode only)
+	*/
+	const GLStateStats & getStats() const
+	{
+		return stats;
+	}
+
+
+	///////////////////////////////////////////
+	//	BINDINGS
+	///////////////////////////////////////////
+	void useProgram(GLuint id)
+	{
+		if (changed(STATE_PROGRAM, program, id))
+			glUseProgram(id);
+	}
+	void bindVertexArray(GLuint id)
+	{
+		if (changed(STATE_VERTEX_ARRAY, vertexArray, id))
+			glBindVertexArray(id);
+	}
+	/*!
+	*  \brief Binds a framebuffer (GL_FRAMEBUFFER binds both the draw and read framebuffers)
+	*/
+	void bindFramebuffer(GLenum target, GLuint id)
+	{
+		if (target == GL_FRAMEBUFFER)
+		{
+			if (drawFramebuffer == id && readFramebuffer == id)
+			{
+				count(STATE_FRAMEBUFFER, false);
+				return;
+			}
+			drawFramebuffer = readFramebuffer = id;
+			count(STATE_FRAMEBUFFER, true);
+			glBindFramebuffer(target, id);
+		}
+		else if (changed(STATE_FRAMEBUFFER, target == GL_READ_FRAMEBUFFER ? readFramebuffer : drawFramebuffer, id))
+			glBindFramebuffer(target, id);
+	}
+	/*!
+	*  \brief Binds a texture to a unit (glActiveTexture only if the unit changes)
+	* \param GLuint unit : texture unit, from 0
+	* \param GLenum target : GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP... (other targets than those tracked are always bound)
+	* \param GLuint id : texture, 0 to unbind
+	*/
+	void bindTexture(GLuint unit, GLenum target, GLuint id)
+	{
+		const int t = textureTarget(target);
+		if (unit < MAX_TEXTURE_UNITS && t >= 0)
+		{
+			if (!changed(STATE_TEXTURE, textures[unit][t], id))
+				return;
+		}
+		else
+			count(STATE_TEXTURE, true);
+		activeTexture(unit);
+		glBindTexture(target, id);
+	}
+	/*!
+	*  \brief Binds a sampler object to a unit (0 => the texture's own sampling parameters)
+	*/
+	void bindSampler(GLuint unit, GLuint sampler)
+	{
+		if (unit >= MAX_TEXTURE_UNITS || changed(STATE_SAMPLER, samplers[unit], sampler))
+			glBindSampler(unit, sampler);
+	}
+
+
+	///////////////////////////////////////////
+	//	FIXED FUNCTION STATE
+	///////////////////////////////////////////
+	/*!
+	*  \brief glEnable / glDisable (GL_DEPTH_TEST, GL_STENCIL_TEST, GL_CULL_FACE, GL_BLEND, GL_SCISSOR_TEST are tracked)
+	*/
+	void setCapability(GLenum capability, bool enabled)
+	{
+		const int c = capabilityIndex(capability);
+		if (c >= 0 && !changed(STATE_CAPABILITY, capabilities[c], enabled ? 1u : 0u))
+			return;
+		if (c < 0)
+			count(STATE_CAPABILITY, true);
+		if (enabled)
+			glEnable(capability);
+		else
+			glDisable(capability);
+	}
+	void enable(GLenum capability)
+	{
+		setCapability(capability, true);
+	}
+	void disable(GLenum capability)
+	{
+		setCapability(capability, false);
+	}
+
+	void depthMask(GLboolean write)
+	{
+		if (changed(STATE_DEPTH, depthWrite, write ? 1u : 0u))
+			glDepthMask(write);
+	}
+	void depthFunc(GLenum func)
+	{
+		if (changed(STATE_DEPTH, depthCompare, func))
+			glDepthFunc(func);
+	}
+	void cullFace(GLenum mode)
+	{
+		if (changed(STATE_CULL, cullMode, mode))
+			glCullFace(mode);
+	}
+	void frontFace(GLenum mode)
+	{
+		if (changed(STATE_CULL, frontFaceMode, mode))
+			glFrontFace(mode);
+	}
+	void blendFunc(GLenum source, GLenum destination)
+	{
+		if (blendSource == source && blendDestination == destination)
+		{
+			count(STATE_BLEND, false);
+			return;
+		}
+		blendSource = source;
+		blendDestination = destination;
+		count(STATE_BLEND, true);
+		glBlendFunc(source, destination);
+	}
+	void stencilFunc(GLenum func, GLint ref, GLuint mask)
+	{
+		if (stencilCompare == func && stencilRef == ref && stencilReadMask == mask)
+		{
+			count(STATE_STENCIL, false);
+			return;
+		}
+		stencilCompare = func;
+		stencilRef = ref;
+		stencilReadMask = mask;
+		count(STATE_STENCIL, true);
+		glStencilFunc(func, ref, mask);
+	}
+	void stencilOp(GLenum fail, GLenum depthFail, GLenum pass)
+	{
+		if (stencilFail == fail && stencilDepthFail == depthFail && stencilPass == pass)
+		{
+			count(STATE_STENCIL, false);
+			return;
+		}
+		stencilFail = fail;
+		stencilDepthFail = depthFail;
+		stencilPass = pass;
+		count(STATE_STENCIL, true);
+		glStencilOp(fail, depthFail, pass);
+	}
+	void stencilMask(GLuint mask)
+	{
+		if (changed(STATE_STENCIL, stencilWriteMask, mask))
+			glStencilMask(mask);
+	}
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (viewportKnown && viewportRect[0] == x && viewportRect[1] == y && viewportRect[2] == width && viewportRect[3] == height)
+		{
+			count(STATE_VIEWPORT, false);
+			return;
+		}
+		viewportRect[0] = x;
+		viewportRect[1] = y;
+		viewportRect[2] = width;
+		viewportRect[3] = height;
+		viewportKnown = true;
+		count(STATE_VIEWPORT, true);
+		glViewport(x, y, width, height);
+	}
+
+
+private:
+	//! a value no call sets (unknown state)
+	static const GLuint UNKNOWN = ~0u;
+	static const unsigned int UNKNOWN_FLAG = 2;
+	static const int NB_TEXTURE_TARGETS = 4;
+	static const int NB_CAPABILITIES = 5;
+
+	GLuint program, vertexArray, drawFramebuffer, readFramebuffer;
+	GLuint activeUnit;
+	GLuint textures[MAX_TEXTURE_UNITS][NB_TEXTURE_TARGETS];
+	GLuint samplers[MAX_TEXTURE_UNITS];
+	unsigned int capabilities[NB_CAPABILITIES];
+	unsigned int depthWrite;
+	GLuint depthCompare, cullMode, frontFaceMode;
+	GLuint blendSource, blendDestination;
+	GLuint stencilCompare, stencilReadMask, stencilWriteMask;
+	GLint stencilRef;
+	GLuint stencilFail, stencilDepthFail, stencilPass;
+	GLint viewportRect[4];
+	bool viewportKnown;
+
+	bool debug = false;
+	GLStateStats stats;
+
+	GLState()
+	{
+		invalidate();
+	}
+	GLState(const GLState &);
+	GLState & operator=(const GLState &);
+
+	void count(StateCall call, bool issued)
+	{
+		if (!debug)
+			return;
+		if (issued)
+			++stats.issued[call];
+		else
+			++stats.filtered[call];
+	}
+
+	/*!
+	*  \brief Records a new value
+	* \return true if it differs from the current one (the caller sends it)
+	*/
+	bool changed(StateCall call, GLuint & current, GLuint value)
+	{
+		const bool different = current != value;
+		current = value;
+		count(call, different);
+		return different;
+	}
+
+	void activeTexture(GLuint unit)
+	{
+		if (activeUnit != unit)
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			activeUnit = unit;
+		}
+	}
+
+	static int textureTarget(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_TEXTURE_2D: return 0;
+		case GL_TEXTURE_CUBE_MAP: return 1;
+		case GL_TEXTURE_2D_ARRAY: return 2;
+		case GL_TEXTURE_3D: return 3;
+		default: return -1;
+		}
+	}
+	static int capabilityIndex(GLenum capability)
+	{
+		switch (capability)
+		{
+		case GL_DEPTH_TEST: return 0;
+		case GL_STENCIL_TEST: return 1;
+		case GL_CULL_FACE: return 2;
+		case GL_BLEND: return 3;
+		case GL_SCISSOR_TEST: return 4;
+		default: return -1;
+		}
+	}
+};
+
+/*@}*/
+
+}
+
+#endif
@@ -0,0 +1,414 @@
+#ifndef INDIRECTRENDERER_HPP
+#define INDIRECTRENDERER_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "mesh.hpp"
+#include "geometryArena.hpp"
+#include "renderQueue.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file indirectRenderer.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SCENE */
+/*@{*/
+
+
+/*!
+*  \brief Layout of a GL_DRAW_INDIRECT_BUFFER entry for glMultiDrawElementsIndirect
+*/
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+/*!
+*  \brief Per draw record of the draw SSBO (std430, 112 bytes): \n
+*		layout (std430, binding = 0) buffer DrawBuffer { DrawData draws[]; } \n
+*		the vertex shader computes viewMatrix * draw.modelMatrix * modelMatrix * (offset + scale * position), \n
+*		modelMatrix being the default uniform (cf Scene::linkDefaultUniforms)
+*/
+struct IndirectDrawData
+{
+	glm::mat4 modelMatrix; /**< mesh placement: translation to its world space position */
+	glm::vec4 dequantizationOffset; /**< cf Geometry::getDequantizationMatrix (xyz) */
+	glm::vec4 dequantizationScale; /**< cf Geometry::getDequantizationMatrix (xyz) */
+	GLuint materialIndex; /**< entry of the material SSBO */
+	GLuint padding[3];
+};
+
+/*!
+*  \brief Per material record of the material SSBO (std430, 32 bytes): \n
+*		layout (std430, binding = 1) buffer MaterialBuffer { MaterialData materials[]; } \n
+*		filled from the material uniforms uF_0, uRoughness and uMaterialMetalness (pbr.frag's parameters)
+*/
+struct IndirectMaterialData
+{
+	glm::vec4 F_0Roughness; /**< uF_0, uRoughness */
+	glm::vec4 metalness; /**< uMaterialMetalness, unused, unused, unused */
+};
+
+
+/*!
+*  \brief Indirect Renderer: \n
+*		Draws meshes whose geometries live in GeometryArenas (one per VertexFormat, filled on first use) with glMultiDrawElementsIndirect. \n
+*		Draws are grouped by arena and texture set: each group is one call, whatever the number of meshes in it. \n
+*		Per draw data (model matrix, material index) is read by the vertex shader from an SSBO, \n
+*		indexed by a per instance drawID attribute (location DRAW_ID_LOCATION, fed 0..n-1: baseInstance = draw index)
+*
+*	\code{.cpp}
+*		Shader pbrIndirectShader("pbrIndirect.vert", "pbr.frag");
+*		renderer.clear();
+*		for (...)
+*			if (!renderer.push(&mesh))
+*				... // draw it another way
+*		renderer.submit(&pbrIndirectShader, [&](Shader * shader) { scene.linkDefaultUniforms(shader, &camera, &window); });
+*	\endcode
+*
+*	\note requires OpenGL 4.3 (or ARB_multi_draw_indirect, ARB_shader_storage_buffer_object and ARB_base_instance), cf isSupported \n
+*		the uniforms of the first material of a group are linked for the whole group: only uF_0, uRoughness and uMaterialMetalness \n
+*		may differ between meshes drawn together (they go through the material SSBO)
+*/
+class IndirectRenderer
+{
+public:
+	//! SSBO binding of the IndirectDrawData array
+	static const GLuint DRAW_DATA_BINDING = 0;
+	//! SSBO binding of the IndirectMaterialData array
+	static const GLuint MATERIAL_DATA_BINDING = 1;
+	//! vertex attribute location of the draw index (uint)
+	static const GLuint DRAW_ID_LOCATION = 14;
+
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	IndirectRenderer()
+	{}
+
+	/*!
+	*  \brief Destructor: \n
+	*		deletes the arenas and the per frame buffers
+	*/
+	~IndirectRenderer()
+	{
+		GLuint buffers[4] = { commandBuffer, drawDataBuffer, materialDataBuffer, drawIDBuffer };
+		for (int i = 0; i < 4; ++i)
+			if (buffers[i] != 0)
+				glDeleteBuffers(1, &buffers[i]);
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Returns whether the current context supports multi-draw indirect with SSBOs
+	*/
+	static bool isSupported()
+	{
+		return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_base_instance);
+	}
+	/*!
+	*  \brief Returns the counters of the last submit(): draws are glMultiDrawElementsIndirect calls, objects the meshes drawn
+	*/
+	const RenderStats & getStats() const
+	{
+		return stats;
+	}
+	/*!
+	*  \brief Returns the number of meshes pushed since clear()
+	*/
+	size_t size() const
+	{
+		return draws.size();
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Empties the draw list for a new frame: the arenas keep their geometries, \n
+	*		except the ones released since the last frame (cf GeometryArena::purge)
+	*/
+	void clear()
+	{
+		draws.clear();
+		for (std::map<VertexFormat, std::unique_ptr<GeometryArena> >::iterator it = arenas.begin(); it != arenas.end(); ++it)
+			it->second->purge();
+	}
+
+	/*!
+	*  \brief Queues a mesh, adding its geometry to the arena of its vertex format if needed
+	* \param Mesh * mesh : mesh to draw (has to stay alive until submit)
+	* \param unsigned int level : level of detail of its geometry (cf Geometry::getLOD)
+	* \return false if the geometry cannot be drawn from an arena (not ready, empty): the mesh is not queued
+	*/
+	bool push(Mesh * mesh, unsigned int level = 0)
+	{
+		return push(mesh, mesh->getGeometry()->getRecord(), level);
+	}
+	/*!
+	*  \brief Queues a mesh from the record of its geometry, resolved by the caller (cf SceneRenderer): no registry lookup
+	* \param const std::shared_ptr<GeometryRecord> & record : record of the mesh geometry (cf Geometry::getRecord)
+	*/
+	bool push(Mesh * mesh, const std::shared_ptr<GeometryRecord> & record, unsigned int level)
+	{
+		if (!record->ready)
+			return false;
+
+		const VertexFormat format = record->vertexFormat;
+		std::map<VertexFormat, std::unique_ptr<GeometryArena> >::iterator arena = arenas.find(format);
+		if (arena == arenas.end())
+			arena = arenas.insert(std::make_pair(format, std::unique_ptr<GeometryArena>(new GeometryArena(format)))).first;
+
+		const ArenaAllocation * allocation = arena->second->add(record);
+		if (allocation == NULL)
+			return false;
+
+		Draw draw;
+		draw.mesh = mesh;
+		draw.geometry = record.get();
+		draw.material = mesh->getMaterial();
+		draw.arena = arena->second.get();
+		draw.command.instanceCount = 1;
+		draw.command.baseVertex = static_cast<GLint>(allocation->baseVertex);
+		if (record->EBO != 0)
+		{
+			const LevelOfDetail lod = record->getLOD(level);
+			draw.command.firstIndex = allocation->firstIndex + lod.firstIndex;
+			draw.command.count = lod.indexCount;
+		}
+		else
+		{
+			draw.command.firstIndex = allocation->firstIndex;
+			draw.command.count = allocation->indexCount;
+		}
+		draw.command.baseInstance = 0;
+		draws.push_back(draw);
+		return true;
+	}
+
+	/*!
+	*  \brief Draws the queued meshes: \n
+	*			- groups them by arena and texture set \n
+	*			- fills the command buffer, the draw and material SSBOs (one upload each) \n
+	*			- one glMultiDrawElementsIndirect per group
+	*
+	* \param Shader * shader : indirect shader, reading the SSBOs (e.g. pbrIndirect.vert)
+	* \param std::function<void(Shader *)> linkDefaults : links the default uniforms of the shader (cf Scene::linkDefaultUniforms)
+	* \return draws every queued mesh, updates getStats()
+	*/
+	void submit(Shader * shader, std::function<void(Shader *)> linkDefaults)
+	{
+		stats = RenderStats();
+		if (draws.empty())
+			return;
+
+		GLState & state = GLState::get();
+		state.useProgram(shader->Program);
+		linkDefaults(shader);
+		++stats.programBinds;
+
+		// group ids: arena, then texture set (in order of first appearance)
+		std::map<std::vector<GLuint>, unsigned int> textureSets;
+		std::unordered_map<Material *, GLuint> materialIds;
+		materialData.clear();
+		for (size_t i = 0; i < draws.size(); ++i)
+		{
+			Draw & draw = draws[i];
+			std::vector<GLuint> textureIDs;
+			const std::vector<Texture *> & textures = draw.material->getTextures();
+			for (size_t t = 0; t < textures.size(); ++t)
+				textureIDs.push_back(textures[t]->ID);
+			draw.textureSet = textureSets.insert(std::make_pair(textureIDs, static_cast<unsigned int>(textureSets.size()))).first->second;
+
+			std::pair<std::unordered_map<Material *, GLuint>::iterator, bool> material =
+				materialIds.insert(std::make_pair(draw.material, static_cast<GLuint>(materialData.size())));
+			if (material.second)
+				materialData.push_back(materialParameters(draw.material));
+			draw.materialIndex = material.first->second;
+		}
+		std::stable_sort(draws.begin(), draws.end(), [](const Draw & a, const Draw & b) {
+			return a.arena != b.arena ? a.arena < b.arena : a.textureSet < b.textureSet;
+		});
+
+		commands.resize(draws.size());
+		drawData.resize(draws.size());
+		for (size_t i = 0; i < draws.size(); ++i)
+		{
+			const glm::mat4 dequantization = draws[i].geometry->getDequantizationMatrix();
+			commands[i] = draws[i].command;
+			commands[i].baseInstance = static_cast<GLuint>(i);
+			drawData[i].modelMatrix = glm::translate(glm::mat4(1.0f), draws[i].mesh->getWorldSpacePosition());
+			drawData[i].dequantizationOffset = dequantization[3];
+			drawData[i].dequantizationScale = glm::vec4(dequantization[0][0], dequantization[1][1], dequantization[2][2], 1.0f);
+			drawData[i].materialIndex = draws[i].materialIndex;
+		}
+
+		upload(GL_DRAW_INDIRECT_BUFFER, &commandBuffer, &commands[0], commands.size() * sizeof(DrawElementsIndirectCommand));
+		upload(GL_SHADER_STORAGE_BUFFER, &drawDataBuffer, &drawData[0], drawData.size() * sizeof(IndirectDrawData));
+		upload(GL_SHADER_STORAGE_BUFFER, &materialDataBuffer, &materialData[0], materialData.size() * sizeof(IndirectMaterialData));
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_DATA_BINDING, materialDataBuffer);
+		reserveDrawIDs(draws.size());
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		GeometryArena * arena = NULL;
+		for (size_t first = 0; first < draws.size();)
+		{
+			size_t last = first + 1;
+			while (last < draws.size() && draws[last].arena == draws[first].arena && draws[last].textureSet == draws[first].textureSet)
+				++last;
+
+			if (draws[first].arena != arena)
+			{
+				arena = draws[first].arena;
+				state.bindVertexArray(arena->getVAO());
+				glBindBuffer(GL_ARRAY_BUFFER, drawIDBuffer);
+				glEnableVertexAttribArray(DRAW_ID_LOCATION);
+				glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (GLvoid*)0);
+				glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+			}
+
+			Material * material = draws[first].material;
+			material->linkUniforms(shader);
+			material->bindTextures(shader);
+			++stats.materialBinds;
+			stats.materialBindsSkipped += static_cast<unsigned int>(last - first - 1);
+			stats.textureBinds += static_cast<unsigned int>(material->getTextures().size());
+
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (GLvoid*)(first * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(last - first), 0);
+			++stats.draws;
+			stats.objects += static_cast<unsigned int>(last - first);
+			first = last;
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		draws[0].material->unbindMaterial();
+		state.invalidateTextures();
+	}
+
+
+private:
+	/*!
+	*  \brief One queued mesh
+	*/
+	struct Draw
+	{
+		Mesh * mesh;
+		const GeometryRecord * geometry; /**< record of the mesh geometry, kept alive by its arena */
+		Material * material;
+		GeometryArena * arena;
+		DrawElementsIndirectCommand command;
+		unsigned int textureSet;
+		GLuint materialIndex;
+	};
+
+	//! one arena per vertex format
+	std::map<VertexFormat, std::unique_ptr<GeometryArena> > arenas;
+
+	std::vector<Draw> draws;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<IndirectDrawData> drawData;
+	std::vector<IndirectMaterialData> materialData;
+
+	GLuint commandBuffer = 0, drawDataBuffer = 0, materialDataBuffer = 0;
+	//! 0..drawIDCount-1, read once per instance (baseInstance selects the draw)
+	GLuint drawIDBuffer = 0;
+	size_t drawIDCount = 0;
+
+	RenderStats stats;
+
+	/*!
+	*  \brief Reads pbr.frag's parameters from the material uniforms (defaults if missing)
+	*/
+	static IndirectMaterialData materialParameters(Material * material)
+	{
+		IndirectMaterialData data;
+		data.F_0Roughness = glm::vec4(0.04f, 0.04f, 0.04f, 0.5f);
+		data.metalness = glm::vec4(0.0f);
+
+		f3vUniform * F_0 = dynamic_cast<f3vUniform *>(material->getUniform("uF_0"));
+		fUniform * roughness = dynamic_cast<fUniform *>(material->getUniform("uRoughness"));
+		fUniform * metalness = dynamic_cast<fUniform *>(material->getUniform("uMaterialMetalness"));
+		if (F_0 != NULL)
+			data.F_0Roughness = glm::vec4(F_0->value, data.F_0Roughness.w);
+		if (roughness != NULL)
+			data.F_0Roughness.w = roughness->value;
+		if (metalness != NULL)
+			data.metalness.x = metalness->value;
+		return data;
+	}
+
+	/*!
+	*  \brief Sends a per frame array (the previous content is orphaned)
+	*/
+	static void upload(GLenum target, GLuint * buffer, const void * data, size_t bytes)
+	{
+		if (*buffer == 0)
+			glGenBuffers(1, buffer);
+		glBindBuffer(target, *buffer);
+		glBufferData(target, static_cast<GLsizeiptr>(bytes), data, GL_STREAM_DRAW);
+	}
+
+	/*!
+	*  \brief Grows the draw index buffer to at least count entries
+	*/
+	void reserveDrawIDs(size_t count)
+	{
+		if (count <= drawIDCount)
+			return;
+		drawIDCount = std::max(count, 2 * drawIDCount);
+		std::vector<GLuint> ids(drawIDCount);
+		for (size_t i = 0; i < drawIDCount; ++i)
+			ids[i] = static_cast<GLuint>(i);
+		upload(GL_ARRAY_BUFFER, &drawIDBuffer, &ids[0], ids.size() * sizeof(GLuint));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	IndirectRenderer(const IndirectRenderer &);
+	IndirectRenderer & operator=(const IndirectRenderer &);
+};
+
+/*@}*/
+
+}
+
+#endif
@@ -8,7 +8,11 @@ in vec2 TexCoords;
 
 uniform sampler2D screenTexture;
 
-const int blurSize = 2;
+// filter window [-blurSize, blurSize]^2, chosen at compile time (cf OpenGLEngine::ShaderPermutations)
+#ifndef BLUR_SIZE
+#define BLUR_SIZE 2
+#endif
+const int blurSize = BLUR_SIZE;
 const float PI = 3.141592653589793238462643383;
 
 
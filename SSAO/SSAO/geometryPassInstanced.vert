@@ -0,0 +1,35 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 texCoords;
+
+// per instance attributes (cf InstancedMesh)
+layout (location = 8) in mat4 instanceModelMatrix;
+
+out vec3 vPosition;
+out vec2 TexCoords;
+out vec3 vNormal;
+
+// default uniforms (cf OpenGLEngine::UniformBlocks)
+layout (std140) uniform FrameUniforms {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	mat4 cameraMovment;
+	vec4 cameraPosition;
+	vec4 viewport;
+};
+layout (std140) uniform ObjectUniforms {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
+
+void main()
+{
+	vec4 viewPosition = viewMatrix * modelMatrix * instanceModelMatrix * vec4(position, 1.0f);
+    gl_Position = projectionMatrix * viewPosition;
+
+	// instance transforms are rigid (+ uniform scale): their upper 3x3 transforms normals up to a scale
+	vNormal = mat3(normalMatrix) * mat3(instanceModelMatrix) * normal;
+    TexCoords = texCoords;
+	vPosition = viewPosition.xyz;
+}
\ No newline at end of file
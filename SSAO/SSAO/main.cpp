@@ -28,9 +28,11 @@
 #include <OpenGLEngine\textureInterface.hpp> // texture wrapper
 #include <OpenGLEngine\uniformInterface.hpp> // uniform wrapper
 #include <OpenGLEngine\mesh.hpp> // mesh wrapper
-#include <OpenGLEngine\scene.hpp> // scene manager
+#include <OpenGLEngine\sceneRenderer.hpp> // scene manager
 #include <OpenGLEngine\frameBuffer.hpp> // FBO wrapper
 #include <OpenGLEngine\renderBuffer.hpp> // RBO wrapper
+#include <OpenGLEngine\shaderPermutations.hpp> // #define variants of a shader
+#include <OpenGLEngine\gpuProfiler.hpp> // GPU time per render pass (timer queries)
 
 
 ////////////////////////
@@ -43,7 +45,6 @@
 // STL
 ////////////////////////
 #include <vector>
-#include <time.h> 
 
 
 ////////////////////////
@@ -51,11 +52,6 @@
 ////////////////////////
 #include "stopWatch.hpp"
 
-float lerp(float a, float b, float w)
-{
-	return a + w*(b - a);
-}
-
 
 int main(int argc, char ** argv)
 {
@@ -128,10 +124,21 @@ int main(int argc, char ** argv)
 	/////////////////////////////
 	// SHADERS
 	// NB: No support for tesselation nor geometry shaders in current build
+	// the three passes are compiled in one batch (submitted once the kernels are generated), not one after the other
 	/////////////////////////////
-	OpenGLEngine::Shader geometryPassShader("geometryPass.vert", "geometryPass.frag");
-	OpenGLEngine::Shader ssaoShader("ssao.vert", "ssao.frag");
-	OpenGLEngine::Shader blurPassShader("blur.vert", "blur.frag");
+	OpenGLEngine::ShaderBatch shaderBatch;
+	OpenGLEngine::Shader geometryPassShader("geometryPass.vert", "geometryPass.frag", &shaderBatch);
+	// quality tiers (keys 1, 2, 3): the SSAO kernel size and the blur window are compile time constants,
+	// each tier is a program of its own with fully unrolled loops (=> <OpenGLEngine\shaderPermutations.hpp>)
+	const char * ssaoSamples[3] = { "8", "16", "32" };
+	const char * blurSizes[3] = { "1", "2", "3" };
+	OpenGLEngine::ShaderPermutations ssaoShaders("ssao.vert", "ssao.frag", { { "SSAO_SAMPLES", "16" } });
+	OpenGLEngine::ShaderPermutations blurPassShaders("blur.vert", "blur.frag", { { "BLUR_SIZE", "2" } });
+	for (int t = 0; t < 3; ++t)
+	{
+		ssaoShaders.get({ { "SSAO_SAMPLES", ssaoSamples[t] } }, &shaderBatch);
+		blurPassShaders.get({ { "BLUR_SIZE", blurSizes[t] } }, &shaderBatch);
+	}
 
 
 	/////////////////////////////
@@ -142,68 +149,11 @@ int main(int argc, char ** argv)
 	//	Instead of using a spherical sample kernel, we use a normal-oriented hemisphere
 	
 	// sampling direction in hemisphere oriented in the z direction, coalesed around z axis
-	std::vector<glm::vec3> ssaoKernel;
-	// seed srand 
-	srand(time(NULL));
-	size_t kernelSize = 16;
-	for (size_t i = 0; i < kernelSize; ++i)
-	{
-		// random points in unit sphere
-		float rndX = ((float)rand() / (RAND_MAX));
-		float rndY = ((float)rand() / (RAND_MAX));
-		float rndZ = ((float)rand() / (RAND_MAX));
+	// The kernels (of 8, 16 and 32 samples) and the rotations tilting them (=> reduces banding effects) are low-discrepancy
+	// sets computed by the compiler, and read by ssao.frag from one uniform buffer: every run samples the same points
+	//		=> <OpenGLEngine\sampleTables.hpp> (bound with the other uniform blocks, cf scene.linkUniformBlocks)
 
-		// unit hemisphere (z-direction)
-		glm::vec3 sample(2.0*rndX - 1.0, 2.0*rndY - 1.0,rndZ);
-		sample = glm::normalize(sample);
-
-		// uniform scale in hemisphere
-		sample *= ((float)rand() / (RAND_MAX));
-
-		// we group points near z-direction.
-		// we want points to be more distributed around z-axis and sparse as thurther away you get from axis
-		float scale = static_cast<float>(i) / static_cast<float>(kernelSize);
-		scale = lerp(0.1, 1.0, scale*scale);
-		sample *= scale;
-
-		ssaoKernel.push_back(sample);
-	}
-	// create uniform (to be passed to shader when rendering)
-	OpenGLEngine::af3vUniform samples;
-	samples.name = "samples";
-	samples.value = ssaoKernel;
-	samples.type = "af3v";
-
-
-	/////////////////////////////
-	// TEXTURES
-	/////////////////////////////
-	// noise texture
-	// will be used for tilting sample kernel
-	// => reduces banding effects
-	std::vector<glm::vec3> ssaoNoise;
-	for (size_t i = 0; i < 16; i++)
-	{	
-		// random orientation around z axis
-		float rndX = ((float)rand() / (RAND_MAX));
-		float rndY = ((float)rand() / (RAND_MAX));
-		glm::vec3 noise(2.0*rndX - 1.0, 2.0*rndY - 1.0, 0.0f);
-
-		ssaoNoise.push_back(noise);
-	}
-	// generate texture (to be used down the line)
-	GLuint noiseTexture = OpenGLEngine::textureClient::generateTexture(&ssaoNoise);
-	// texture uniform
-	OpenGLEngine::Texture2D tex_noise;
-	tex_noise.ID = noiseTexture;
-	tex_noise.name = "noiseTexture";
-	tex_noise.type = "sampler2D";
-
-	// noise scale (repectively to window width)
-	OpenGLEngine::f2vUniform uNoiseScale;
-	uNoiseScale.name = "uNoiseScale";
-	uNoiseScale.value = glm::vec2(window.getWidth() / sqrt(ssaoNoise.size()), window.getHeight() / sqrt(ssaoNoise.size()));
-	uNoiseScale.type = "f2v";
+	shaderBatch.submit();
 
 
 
@@ -236,9 +186,13 @@ int main(int argc, char ** argv)
 	OpenGLEngine::Geometry cube_geometry("CubeGeometry", 2.0, meshPos);
 
 	meshPos = glm::vec3(0.0, -3.0 + y_translate, 0.0);
-	OpenGLEngine::Geometry mesh_geometry("Resources/Models/clumsy-dragon.obj", meshPos, 5.0);
+	OpenGLEngine::GeometryOptions meshOptions;
+	meshOptions.vertexFormat = OpenGLEngine::VERTEX_FORMAT_PACKED_NO_TANGENT; // the SSAO shaders never read tangents
+	OpenGLEngine::Geometry mesh_geometry;
+	mesh_geometry.loadOBJ("Resources/Models/clumsy-dragon.obj", meshPos, 5.0, meshOptions);
 
-	OpenGLEngine::Geometry mesh2_geometry("Resources/Models/stanford-dragon.obj", meshPos, 1.0);
+	OpenGLEngine::Geometry mesh2_geometry;
+	mesh2_geometry.loadOBJ("Resources/Models/stanford-dragon.obj", meshPos, 1.0, meshOptions);
 	mesh2_geometry.setWorldSpacePosition(glm::vec3(-5.5, -2.0 + y_translate, 0.0));
 
 	OpenGLEngine::Geometry plane_geometry("PlaneGeometry", 20.0, glm::vec3(0.0, -2.0 + y_translate, 0.0));
@@ -267,9 +221,9 @@ int main(int argc, char ** argv)
 	//
 	// Memory managment is left to the user. No copies are done
 	//
-	// => <OpenGLEngine\scene.hpp>
+	// => <OpenGLEngine\sceneRenderer.hpp>
 	////////////////////////
-	OpenGLEngine::Scene scene;
+	OpenGLEngine::SceneRenderer scene;
 	scene.addMesh(&cube);
 	scene.addMesh(&clumbsy_dragon);
 	scene.addMesh(&standford_dragon_bunny);
@@ -325,11 +279,15 @@ int main(int argc, char ** argv)
 	////////////////////////
 
 	stopWatch timer; // FPS counter
+	OpenGLEngine::GPUProfiler profiler; // GPU time per pass, read back a few frames later (no glFinish)
+	OpenGLEngine::GLState & glState = OpenGLEngine::GLState::get(); // state cache: redundant state calls are dropped
 
 	// Render loop
 	while (window.isOpen())
 	{
 		timer.start();
+		profiler.beginFrame();
+		glState.beginFrame();
 
 		////////////////////////
 		//	- Update Events
@@ -338,6 +296,17 @@ int main(int argc, char ** argv)
 		window.updateEvents();
 		//window::mouse.inertia();
 		window.getControler()->inertia();
+		// 1, 2, 3: low, medium or high quality tier (one precompiled variant each)
+		for (int t = 0; t < 3; ++t)
+		{
+			const OpenGLEngine::ShaderDefines tier = { { "SSAO_SAMPLES", ssaoSamples[t] } };
+			if (glfwGetKey(window.getWindow(), GLFW_KEY_1 + t) != GLFW_PRESS || ssaoShaders.getCurrent() == ssaoShaders.get(tier))
+				continue;
+			ssaoShaders.select(tier);
+			blurPassShaders.select({ { "BLUR_SIZE", blurSizes[t] } });
+		}
+		OpenGLEngine::Shader & ssaoShader = *ssaoShaders.getCurrent();
+		OpenGLEngine::Shader & blurPassShader = *blurPassShaders.getCurrent();
 
 		////////////////////////
 		//	- Render
@@ -347,87 +316,104 @@ int main(int argc, char ** argv)
 		// 3 SSAO Pass
 		// 2 Blur Pass
 
-		// => G-Buffer Pass
-		geometryBufferPassFBO.bindFBO();
+		{
+			OpenGLEngine::GPUProfiler::Scope pass(profiler, "G-Buffer");
+			// => G-Buffer Pass
+			geometryBufferPassFBO.bindFBO();
 
-		// Clear the colorbuffer
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-		glEnable(GL_DEPTH_TEST);
+			// Clear the colorbuffer
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+			glEnable(GL_DEPTH_TEST);
 
 
-		////////////////////
-		// Render Object
-		////////////////////
-		// 1st render pass: draw object as normal and fill stencil buffer
-		scene.drawMeshes(&camera, &window);
+			////////////////////
+			// Render Object
+			////////////////////
+			// 1st render pass: draw object as normal and fill stencil buffer
+			scene.drawMeshes(&camera, &window);
 		
-		// Optional
-		// 2nd render pass: now draw slightly scaled versions of the objects, this time disabling stencil writing.
-		// Because stencil buffer is now filled with several 1s. The parts of the buffer that are 1 are now not drawn, thus only drawing 
-		// the objects' size differences, making it look like borders.
-		//		scene.outlineMeshes(&stencilShader, &camera, &window);
-
-		geometryBufferPassFBO.unbindFBO();
-
-		// => SSAO pass:
-		// sample G-Buffer and render scene to quad spaning the whole window
-		// Clear all relevant buffers
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-		glDisable(GL_DEPTH_TEST); // We don't care about depth information when rendering a single quad
+			// Optional
+			// 2nd render pass: now draw slightly scaled versions of the objects, this time disabling stencil writing.
+			// Because stencil buffer is now filled with several 1s. The parts of the buffer that are 1 are now not drawn, thus only drawing 
+			// the objects' size differences, making it look like borders.
+			//		scene.outlineMeshes(&stencilShader, &camera, &window);
+
+			geometryBufferPassFBO.unbindFBO();
+		}
+
+		{
+			OpenGLEngine::GPUProfiler::Scope pass(profiler, "SSAO");
+			// => SSAO pass:
+			// sample G-Buffer and render scene to quad spaning the whole window
+			// Clear all relevant buffers
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+			glDisable(GL_DEPTH_TEST); // We don't care about depth information when rendering a single quad
 		
-		finalPassFBO.bindFBO();
+			finalPassFBO.bindFBO();
+			glState.invalidate(); // framebuffer and viewport set by the engine library, behind the state cache
 
 
-		ssaoShader.Use();
-		// Pass G-Buffer to render target
-		geometryBufferPassFBO.bindTextureTargets();
-		geometryBufferPassFBO.linkTextureTargets(&std::vector<std::string>{ "G_PositionDepth" , "G_Normal" , "G_Color" }, &ssaoShader);
+			ssaoShader.Use();
+			// Pass G-Buffer to render target
+			geometryBufferPassFBO.bindTextureTargets();
+			glState.invalidateTextures(); // bound by the engine library as well
+			geometryBufferPassFBO.linkTextureTargets(&std::vector<std::string>{ "G_PositionDepth" , "G_Normal" , "G_Color" }, &ssaoShader);
 
-		// use different shader that current associated material, for this pass
-		samples.linkUniform(&ssaoShader);
+			// Bind & link uniforms
+			scene.linkUniformBlocks(&ssaoShader, &camera, &window);
 
-		// Bind & link uniforms
-		uNoiseScale.linkUniform(&ssaoShader);
-		tex_noise.bindTexture(3, &ssaoShader);
-		scene.linkDefaultUniforms(&ssaoShader, &camera, &window);
+			screenQuadGeometry.drawGeometry();
 
-		screenQuadGeometry.draw();
+			finalPassFBO.unbindFBO();
+			glState.invalidate();
+		}
 
-		finalPassFBO.unbindFBO();
+		{
+			OpenGLEngine::GPUProfiler::Scope pass(profiler, "Blur");
+			// => Blur Pass
+			// Bi-Lateral blur or simple Gaussian blur
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-		// => Blur Pass
-		// Bi-Lateral blur or simple Gaussian blur
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+			blurPassShader.Use();
 
-		blurPassShader.Use();
+			// Active proper texture unit before binding
+			finalPassFBO.bindTextureTargets();
+			glState.invalidateTextures();
+			finalPassFBO.linkTextureTargets(&std::vector<std::string>{ "screenTexture" }, &blurPassShader);
 
-		// Active proper texture unit before binding
-		finalPassFBO.bindTextureTargets();
-		finalPassFBO.linkTextureTargets(&std::vector<std::string>{ "screenTexture" }, &blurPassShader);
+			screenQuadGeometry.drawGeometry();
+		}
 
-		screenQuadGeometry.draw();
 
 
 
 
 
+		profiler.endFrame();
 
 		// Swap the screen buffers
 		window.draw();
 
-		// Syncronyse
-		glFinish();
-
 
 		timer.end();
 		double render_time = timer.time();
-		std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+		// every 120 frames: CPU frame time and GPU time of each pass
+		if (profiler.getFrameCount() % 120 == 0)
+		{
+			std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+			profiler.print(std::cout);
+		}
 	}
 
 	// Melete meshes
 	// Properly de-allocate all resources once they've outlived their purpose
 	// => done in mesh desctuctor
 
+	// GPU time statistics of the last frames
+	profiler.flush();
+	profiler.writeCSV("gpuProfile.csv");
+	profiler.writeJSON("gpuProfile.json");
+
 	window.isClosed();
 
 
@@ -6,14 +6,38 @@ uniform sampler2D G_PositionDepth;
 uniform sampler2D G_Normal;
 uniform sampler2D G_Color;
 
-const int MAX_SAMPLE_SIZE = 16;
-uniform vec3 samples[MAX_SAMPLE_SIZE];
-
-uniform sampler2D noiseTexture;
-
-uniform vec2 uNoiseScale; 
-
-uniform mat4 projectionMatrix;
+// quality tier, chosen at compile time (cf OpenGLEngine::ShaderPermutations): kernel size and sampling radius
+#ifndef SSAO_SAMPLES
+#define SSAO_SAMPLES 16
+#endif
+#ifndef SSAO_RADIUS
+#define SSAO_RADIUS 1.0
+#endif
+const int MAX_SAMPLE_SIZE = SSAO_SAMPLES;
+
+// sample kernels and rotations, precomputed (cf OpenGLEngine::lowDiscrepancy, bound by OpenGLEngine::SampleTables):
+//	- ssaoKernel: the kernels of 8, 16 and 32 samples one after the other (the kernel of n samples starts at record n - 8)
+//	- blueNoise: (u, v, cos(2*pi*u), sin(2*pi*u)), the first 16 tile the screen with 4x4 evenly spread rotations
+#if SSAO_SAMPLES != 8 && SSAO_SAMPLES != 16 && SSAO_SAMPLES != 32
+#error SSAO_SAMPLES has to be 8, 16 or 32 (precomputed kernels)
+#endif
+const int KERNEL_OFFSET = SSAO_SAMPLES - 8;
+layout (std140) uniform SSAOKernel {
+	vec4 ssaoKernel[56];
+};
+layout (std140) uniform BlueNoiseTable {
+	vec4 blueNoise[64];
+};
+
+
+// default uniforms (cf OpenGLEngine::UniformBlocks)
+layout (std140) uniform FrameUniforms {
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	mat4 cameraMovment;
+	vec4 cameraPosition;
+	vec4 viewport;
+};
 
 void main()
 { 
@@ -29,7 +53,8 @@ void main()
 	float fragDepth = texture(G_PositionDepth,TexCoords).w;
 	vec3 fragNormal = texture(G_Normal,TexCoords).rgb;
 
-	vec3 rvec = 2.0 * texture(noiseTexture, TexCoords * uNoiseScale).xyz - 1.0; // random rotation vector
+	ivec2 tile = ivec2(gl_FragCoord.xy) & 3;
+	vec3 rvec = vec3(blueNoise[tile.x + 4 * tile.y].zw, 0.0); // rotation vector of the pixel (4x4 tile)
 
 	// sample kernel position is in world space in the unit sphere (or hemisphere).
 	// we need to position this kernel around fragment normal:
@@ -41,13 +66,13 @@ void main()
 	mat3 TBN = mat3(fragTangent, fragBitangent, fragNormal);
 
 	float occlusion = 0.0;
-	float uRadius = 1.0; // sampling radius
+	const float uRadius = SSAO_RADIUS; // sampling radius
 
 	// for each sample check if they occule fragment
 	for (int i = 0; i < MAX_SAMPLE_SIZE; ++i) {
 		// get sample position:
 		// [0,1]^3 => fragment local space (0,0,0 = frag positon (world space), x = frag normal, y = frag tangent, z = frag bi-tangent)
-		vec3 sample = TBN * samples[i];
+		vec3 sample = TBN * ssaoKernel[KERNEL_OFFSET + i].xyz;
 		// scale sample position vector and get sample world space position 
 		sample = sample * uRadius + fragPos;
 
@@ -0,0 +1,467 @@
+#ifndef COMPILEDMATERIAL_HPP
+#define COMPILEDMATERIAL_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+#include <glm\gtc\type_ptr.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "modelMaterial.hpp"
+#include "programReflection.hpp"
+#include "glState.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file compiledMaterial.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup MESH */
+/*@{*/
+
+
+/*!
+*  \brief Value type of a CompiledMaterial parameter
+*/
+enum ParameterType
+{
+	PARAMETER_FLOAT,
+	PARAMETER_INT,
+	PARAMETER_VEC2,
+	PARAMETER_VEC3,
+	PARAMETER_MAT4,
+	PARAMETER_VEC3_ARRAY
+};
+
+
+/*!
+*  \brief Compiled Material: \n
+*		The flat form of a Material for one shader, built once from its Uniform map and Texture list: \n
+*			- parameters: every Uniform the program actually reads, with a fixed place in one contiguous data block. \n
+*			  Members of the program's MaterialUniforms block (std140, offsets from ProgramReflection) are sent as one \n
+*			  uniform buffer per material, bound to MATERIAL_BINDING; plain uniforms are sent from the block by location, \n
+*			  when the program does not already hold their version (cf ProgramReflection::changed) \n
+*			- textures: texture ID, target and sampler slot, the n-th on GL_TEXTUREn (cf Material) \n
+*
+*		Names are only used by the constructor and getHandle: updates go through integer handles (set), \n
+*		or are picked up from the source Uniform objects by sync(), a comparison with the stored value per parameter.
+*
+*	\code{.cpp}
+*		CompiledMaterial compiled(mesh.getMaterial());
+*		const int roughness = compiled.getHandle("uRoughness");
+*		...
+*		compiled.set(roughness, 0.3f);
+*		compiled.bindParameters();
+*		compiled.bindTextures();
+*		mesh.getGeometry()->drawGeometry();
+*	\endcode
+*
+*	\note values set through a handle are not written back to the Material's Uniform objects. \n
+*		Uniform types other than those of uniformInterface.hpp are linked through Uniform::linkUniform
+*/
+class CompiledMaterial
+{
+public:
+	//! binding point of MaterialUniforms (0 and 1 are the UniformBlocks)
+	static const GLuint MATERIAL_BINDING = 2;
+
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Constructor: \n
+	*		lays out the parameters of the uniforms input shader reads, snapshots their values and the textures
+	* \param Material * material : source material (its uniforms and textures have to outlive this object for sync)
+	* \param Shader * shader : linked program the material is drawn with, NULL => the material's shader
+	*/
+	explicit CompiledMaterial(Material * material, Shader * shader = NULL)
+	{
+		linkShader = shader != NULL ? shader : material->getShader();
+		program = linkShader->Program;
+		ProgramReflection & reflection = ProgramReflection::of(program);
+
+		const GLuint blockIndex = glGetUniformBlockIndex(program, "MaterialUniforms");
+		GLint blockSize = 0;
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+			glUniformBlockBinding(program, blockIndex, MATERIAL_BINDING);
+		}
+		data.assign(static_cast<size_t>(blockSize), 0);
+		blockBytes = static_cast<unsigned int>(blockSize);
+
+		const std::unordered_map<std::string, Uniform *> & uniforms = material->getUniforms();
+		for (std::unordered_map<std::string, Uniform *>::const_iterator it = uniforms.begin(); it != uniforms.end(); ++it)
+		{
+			Uniform * uniform = it->second;
+			sources.push_back(uniform);
+			addParameter(reflection, blockIndex, uniform);
+		}
+
+		const std::vector<Texture *> & textureList = material->getTextures();
+		for (size_t i = 0; i < textureList.size(); ++i)
+		{
+			BoundTexture texture;
+			texture.ID = textureList[i]->ID;
+			texture.target = dynamic_cast<TextureCube *>(textureList[i]) != NULL ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+			texture.slot = ProgramReflection::slotOf(textureList[i]->name);
+			textures.push_back(texture);
+			textureSources.push_back(textureList[i]);
+		}
+
+		if (blockBytes != 0)
+		{
+			glGenBuffers(1, &UBO);
+			glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+			glBufferData(GL_UNIFORM_BUFFER, blockBytes, &data[0], GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+		blockDirty = false;
+	}
+
+	/*!
+	*  \brief Destructor: \n
+	*		deletes the uniform buffer
+	*/
+	~CompiledMaterial()
+	{
+		if (UBO != 0)
+			glDeleteBuffers(1, &UBO);
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	GLuint getProgram() const
+	{
+		return program;
+	}
+	/*!
+	*  \brief Returns the uniform buffer of the material (0 if the program declares no MaterialUniforms block)
+	*/
+	GLuint getUBO() const
+	{
+		return UBO;
+	}
+	size_t getTextureCount() const
+	{
+		return textures.size();
+	}
+	/*!
+	*  \brief Returns the handle of a parameter (build time lookup)
+	* \return -1 if the program does not read this uniform
+	*/
+	int getHandle(const std::string & name) const
+	{
+		const unsigned int slot = ProgramReflection::slotOf(name);
+		for (size_t p = 0; p < parameters.size(); ++p)
+			if (parameters[p].slot == slot)
+				return static_cast<int>(p);
+		return -1;
+	}
+
+	/*!
+	*  \brief Checks that the compiled form still matches its source: same program, Uniform objects and textures
+	* \return false if the material was edited (addUniform, updateUniform, addTexture, setShader...): compile it again
+	*/
+	bool matches(Material * material) const
+	{
+		if (material->getShader()->Program != program)
+			return false;
+		const std::unordered_map<std::string, Uniform *> & uniforms = material->getUniforms();
+		if (uniforms.size() != sources.size())
+			return false;
+		size_t i = 0;
+		for (std::unordered_map<std::string, Uniform *>::const_iterator it = uniforms.begin(); it != uniforms.end(); ++it, ++i)
+			if (it->second != sources[i])
+				return false;
+		const std::vector<Texture *> & textureList = material->getTextures();
+		if (textureList.size() != textures.size())
+			return false;
+		for (size_t t = 0; t < textures.size(); ++t)
+			if (textureList[t] != textureSources[t] || textureList[t]->ID != textures[t].ID)
+				return false;
+		return true;
+	}
+
+
+	///////////////////////////////////////////
+	//	SETTERS
+	///////////////////////////////////////////
+	void set(int handle, float value)
+	{
+		store(handle, PARAMETER_FLOAT, &value, 1);
+	}
+	void set(int handle, int value)
+	{
+		store(handle, PARAMETER_INT, &value, 1);
+	}
+	void set(int handle, const glm::vec2 & value)
+	{
+		store(handle, PARAMETER_VEC2, glm::value_ptr(value), 1);
+	}
+	void set(int handle, const glm::vec3 & value)
+	{
+		store(handle, PARAMETER_VEC3, glm::value_ptr(value), 1);
+	}
+	void set(int handle, const glm::mat4 & value)
+	{
+		store(handle, PARAMETER_MAT4, glm::value_ptr(value), 1);
+	}
+	void set(int handle, const std::vector<glm::vec3> & value)
+	{
+		if (!value.empty())
+			store(handle, PARAMETER_VEC3_ARRAY, &value[0][0], value.size());
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Copies the source Uniform values changed since the last sync (compared with the stored ones): once per frame, not per draw
+	*/
+	void sync()
+	{
+		for (size_t p = 0; p < parameters.size(); ++p)
+		{
+			Uniform * source = sources[parameters[p].source];
+			switch (parameters[p].type)
+			{
+			case PARAMETER_FLOAT: write(p, PARAMETER_FLOAT, &static_cast<fUniform *>(source)->value, 1); break;
+			case PARAMETER_INT: write(p, PARAMETER_INT, &static_cast<iUniform *>(source)->value, 1); break;
+			case PARAMETER_VEC2: write(p, PARAMETER_VEC2, glm::value_ptr(static_cast<f2vUniform *>(source)->value), 1); break;
+			case PARAMETER_VEC3: write(p, PARAMETER_VEC3, glm::value_ptr(static_cast<f3vUniform *>(source)->value), 1); break;
+			case PARAMETER_MAT4: write(p, PARAMETER_MAT4, glm::value_ptr(static_cast<m4fUniform *>(source)->value), 1); break;
+			case PARAMETER_VEC3_ARRAY:
+			{
+				const std::vector<glm::vec3> & value = static_cast<af3vUniform *>(source)->value;
+				if (!value.empty())
+					write(p, PARAMETER_VEC3_ARRAY, &value[0][0], value.size());
+				break;
+			}
+			}
+		}
+	}
+
+	/*!
+	*  \brief Sends the parameters (the program has to be in use): \n
+	*		the uniform buffer (uploaded if a value changed, then bound to MATERIAL_BINDING), \n
+	*		then the plain uniforms the program does not already hold
+	*/
+	void bindParameters()
+	{
+		if (UBO != 0)
+		{
+			if (blockDirty)
+			{
+				glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+				glBufferSubData(GL_UNIFORM_BUFFER, 0, blockBytes, &data[0]);
+				glBindBuffer(GL_UNIFORM_BUFFER, 0);
+				blockDirty = false;
+			}
+			glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BINDING, UBO);
+		}
+
+		if (firstPlain < parameters.size())
+		{
+			ProgramReflection & reflection = ProgramReflection::of(program);
+			for (size_t p = firstPlain; p < parameters.size(); ++p)
+			{
+				const Parameter & parameter = parameters[p];
+				if (!reflection.changed(parameter.slot, parameter.version))
+					continue;
+				const GLfloat * value = reinterpret_cast<const GLfloat *>(&data[parameter.offset]);
+				switch (parameter.type)
+				{
+				case PARAMETER_FLOAT: glUniform1fv(parameter.location, parameter.count, value); break;
+				case PARAMETER_INT: glUniform1iv(parameter.location, parameter.count, reinterpret_cast<const GLint *>(value)); break;
+				case PARAMETER_VEC2: glUniform2fv(parameter.location, parameter.count, value); break;
+				case PARAMETER_VEC3:
+				case PARAMETER_VEC3_ARRAY: glUniform3fv(parameter.location, parameter.count, value); break;
+				case PARAMETER_MAT4: glUniformMatrix4fv(parameter.location, parameter.count, GL_FALSE, value); break;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < others.size(); ++i)
+			others[i]->linkUniform(linkShader);
+	}
+
+	/*!
+	*  \brief Binds the textures, the n-th to GL_TEXTUREn, and points the samplers to their unit (the program has to be in use)
+	*/
+	void bindTextures()
+	{
+		ProgramReflection & reflection = ProgramReflection::of(program);
+		GLState & state = GLState::get();
+		for (size_t i = 0; i < textures.size(); ++i)
+		{
+			state.bindTexture(static_cast<GLuint>(i), textures[i].target, textures[i].ID);
+			if (reflection.samplerChanged(textures[i].slot, static_cast<GLint>(i)))
+				glUniform1i(reflection.location(textures[i].slot), static_cast<GLint>(i));
+		}
+	}
+
+
+private:
+	/*!
+	*  \brief Place of a parameter in data
+	*/
+	struct Parameter
+	{
+		unsigned int slot; /**< ProgramReflection slot */
+		GLint location; /**< plain uniform location, -1 for a MaterialUniforms member */
+		ParameterType type;
+		GLsizei count; /**< array elements (1 otherwise) */
+		unsigned int offset; /**< byte offset in data */
+		unsigned int stride; /**< bytes between array elements in data */
+		unsigned int version; /**< version of the value in data (cf ProgramReflection::nextVersion) */
+		unsigned int source; /**< index in sources */
+	};
+	/*!
+	*  \brief Texture of the material, bound on the unit of its index
+	*/
+	struct BoundTexture
+	{
+		GLuint ID;
+		GLenum target;
+		unsigned int slot; /**< sampler slot */
+	};
+
+	// per draw data first: program, buffer, then the arrays
+	GLuint program = 0;
+	GLuint UBO = 0;
+	unsigned int blockBytes = 0;
+	bool blockDirty = false;
+	//! MaterialUniforms members first, then plain uniforms from firstPlain
+	std::vector<Parameter> parameters;
+	size_t firstPlain = 0;
+	std::vector<BoundTexture> textures;
+	//! MaterialUniforms block (blockBytes, std140), then the plain uniform values, tightly packed
+	std::vector<unsigned char> data;
+
+	// build and sync data
+	std::vector<Uniform *> sources;
+	std::vector<Texture *> textureSources;
+	//! uniforms of other types, linked by name
+	std::vector<Uniform *> others;
+	Shader * linkShader = NULL;
+
+	/*!
+	*  \brief Lays out a Uniform the program reads, and stores its value
+	*/
+	void addParameter(ProgramReflection & reflection, GLuint blockIndex, Uniform * uniform)
+	{
+		Parameter parameter;
+		parameter.slot = uniform->getSlot();
+		parameter.source = static_cast<unsigned int>(sources.size() - 1);
+		parameter.count = 1;
+
+		unsigned int elementBytes = 0;
+		if (dynamic_cast<fUniform *>(uniform) != NULL) { parameter.type = PARAMETER_FLOAT; elementBytes = sizeof(float); }
+		else if (dynamic_cast<iUniform *>(uniform) != NULL) { parameter.type = PARAMETER_INT; elementBytes = sizeof(int); }
+		else if (dynamic_cast<f2vUniform *>(uniform) != NULL) { parameter.type = PARAMETER_VEC2; elementBytes = sizeof(glm::vec2); }
+		else if (dynamic_cast<f3vUniform *>(uniform) != NULL) { parameter.type = PARAMETER_VEC3; elementBytes = sizeof(glm::vec3); }
+		else if (dynamic_cast<m4fUniform *>(uniform) != NULL) { parameter.type = PARAMETER_MAT4; elementBytes = sizeof(glm::mat4); }
+		else if (dynamic_cast<af3vUniform *>(uniform) != NULL) { parameter.type = PARAMETER_VEC3_ARRAY; elementBytes = sizeof(glm::vec3); }
+		else
+		{
+			others.push_back(uniform);
+			return;
+		}
+
+		const ActiveUniform * active = reflection.uniform(parameter.slot);
+		if (active == NULL)
+			return; // not read by the program
+		parameter.count = active->size;
+		parameter.version = ProgramReflection::nextVersion(); // of the zeroed value, until sync copies the source
+		if (active->block >= 0)
+		{
+			if (static_cast<GLuint>(active->block) != blockIndex)
+				return; // member of another block (e.g. FrameUniforms)
+			parameter.location = -1;
+			parameter.offset = static_cast<unsigned int>(active->offset);
+			parameter.stride = static_cast<unsigned int>(active->arrayStride);
+			if (parameter.type == PARAMETER_MAT4 && active->matrixStride != static_cast<GLint>(sizeof(glm::vec4)))
+				return; // row major or padded matrices are not supported
+			parameters.insert(parameters.begin() + firstPlain, parameter);
+			++firstPlain;
+		}
+		else
+		{
+			parameter.location = active->location;
+			parameter.offset = static_cast<unsigned int>(data.size());
+			parameter.stride = elementBytes;
+			data.resize(data.size() + elementBytes * parameter.count, 0);
+			parameters.push_back(parameter);
+		}
+		sync();
+	}
+
+	/*!
+	*  \brief Writes count elements into a parameter (clamped to its array size), and gives it a new version if they differ
+	*/
+	void write(size_t p, ParameterType type, const void * value, size_t count)
+	{
+		Parameter & parameter = parameters[p];
+		if (parameter.type != type)
+			return;
+		const size_t elementBytes = type == PARAMETER_FLOAT ? sizeof(float) : type == PARAMETER_INT ? sizeof(int) : type == PARAMETER_VEC2 ? sizeof(glm::vec2) :
+			type == PARAMETER_MAT4 ? sizeof(glm::mat4) : sizeof(glm::vec3);
+		const size_t n = std::min(count, static_cast<size_t>(parameter.count));
+		bool differs = false;
+		for (size_t i = 0; i < n; ++i)
+		{
+			unsigned char * element = &data[parameter.offset + i * parameter.stride];
+			const unsigned char * source = static_cast<const unsigned char *>(value) + i * elementBytes;
+			if (std::memcmp(element, source, elementBytes) == 0)
+				continue;
+			std::memcpy(element, source, elementBytes);
+			differs = true;
+		}
+		if (!differs)
+			return;
+		parameter.version = ProgramReflection::nextVersion();
+		if (parameter.location < 0)
+			blockDirty = true;
+	}
+	void store(int handle, ParameterType type, const void * value, size_t count)
+	{
+		if (handle >= 0 && static_cast<size_t>(handle) < parameters.size())
+			write(static_cast<size_t>(handle), type, value, count);
+	}
+
+	CompiledMaterial(const CompiledMaterial &);
+	CompiledMaterial & operator=(const CompiledMaterial &);
+};
+
+/*@}*/
+
+}
+
+#endif
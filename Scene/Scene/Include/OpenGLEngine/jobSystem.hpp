@@ -0,0 +1,303 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+
+namespace OpenGLEngine
+{
+
+/**
+* \file jobSystem.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SCENE */
+/*@{*/
+
+
+/*!
+*  \brief Job System: \n
+*		The engine's pool of worker threads, one per core minus the calling (GL) thread. \n
+*		Every thread owns a queue of jobs: it takes its own jobs from the back (last pushed, still in cache), \n
+*		and once it runs out, steals from the front of the other queues (the largest remaining share of a loop). \n
+*
+*		parallelFor cuts a range in chunks of grain elements, queues them on the calling thread, and runs chunks \n
+*		until all of them are done: the calling thread works too, idle workers steal what it has not reached yet. \n
+*		Each chunk gets the index of the thread running it, in [0, getThreadCount()): per thread buffers need no lock. \n
+*		Thread 0 is any thread outside the pool (the GL thread).
+*
+*	\code{.cpp}
+*		JobSystem & jobs = JobSystem::get();
+*		std::vector<std::vector<Command> > commands(jobs.getThreadCount());
+*		jobs.parallelFor(meshes.size(), 256, [&](size_t first, size_t last, unsigned int thread) {
+*			for (size_t i = first; i < last; ++i)
+*				commands[thread].push_back(...);
+*		});
+*	\endcode
+*
+*	\note one instance for the engine. Only one thread outside the pool may call parallelFor at a time; \n
+*		jobs may call parallelFor themselves (the waiting thread runs other jobs meanwhile)
+*/
+class JobSystem
+{
+public:
+	/*!
+	*  \brief Returns the engine's job system (the workers start on first use)
+	*/
+	static JobSystem & get()
+	{
+		static JobSystem jobs;
+		return jobs;
+	}
+
+	/*!
+	*  \brief Destructor: \n
+	*		stops and joins the workers
+	*/
+	~JobSystem()
+	{
+		stop();
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Returns the number of threads running jobs: the workers plus the calling thread
+	*/
+	unsigned int getThreadCount() const
+	{
+		return static_cast<unsigned int>(queues.size());
+	}
+
+
+	///////////////////////////////////////////
+	//	SETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Restarts the pool with another number of threads (e.g. to measure scaling)
+	* \param unsigned int nbThreads : threads running jobs, calling thread included (0 => one per core, 1 => no worker)
+	* \note not while a parallelFor is running
+	*/
+	void resize(unsigned int nbThreads)
+	{
+		stop();
+		start(nbThreads);
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Runs f on every chunk of [0, count), on all threads, and returns once every chunk is done
+	*
+	* \param size_t count : number of elements
+	* \param size_t grain : elements per chunk (a job), 0 => 1
+	* \param F f : callable taking (size_t first, size_t last, unsigned int thread), called once per chunk
+	* \return a single chunk, or a pool without workers, runs on the calling thread without queuing
+	*/
+	template <typename F>
+	void parallelFor(size_t count, size_t grain, F f)
+	{
+		if (count == 0)
+			return;
+		grain = std::max<size_t>(grain, 1);
+		const size_t nbJobs = (count + grain - 1) / grain;
+		const unsigned int thread = currentThread();
+		if (nbJobs == 1 || queues.size() == 1)
+		{
+			f(0, count, thread);
+			return;
+		}
+
+		std::atomic<size_t> pending(nbJobs);
+		{
+			WorkQueue & queue = *queues[thread];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			// pushed last to first: the owner pops the first chunk, thieves steal the last ones
+			for (size_t j = nbJobs; j-- > 0;)
+			{
+				Job job;
+				job.invoke = &invokeRange<F>;
+				job.context = &f;
+				job.first = j * grain;
+				job.last = std::min(count, (j + 1) * grain);
+				job.pending = &pending;
+				queue.jobs.push_back(job);
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			queued += static_cast<long>(nbJobs);
+		}
+		wakeUp.notify_all();
+
+		while (pending.load(std::memory_order_acquire) != 0)
+		{
+			Job job;
+			if (take(thread, &job))
+				run(job, thread);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+
+private:
+	/*!
+	*  \brief One chunk of a parallelFor
+	*/
+	struct Job
+	{
+		void (*invoke)(void * context, size_t first, size_t last, unsigned int thread);
+		void * context;
+		size_t first, last;
+		std::atomic<size_t> * pending;
+	};
+	/*!
+	*  \brief Jobs of one thread
+	*/
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	std::vector<std::unique_ptr<WorkQueue> > queues;
+	std::vector<std::thread> workers;
+
+	//! idle workers wait for queued jobs
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	//! jobs in the queues (signed: a job may be taken before its parallelFor counts it)
+	long queued = 0;
+	bool stopping = false;
+
+	JobSystem()
+	{
+		start(0);
+	}
+	JobSystem(const JobSystem &);
+	JobSystem & operator=(const JobSystem &);
+
+	void start(unsigned int nbThreads)
+	{
+		if (nbThreads == 0)
+			nbThreads = std::max(1u, std::thread::hardware_concurrency());
+		stopping = false;
+		queued = 0;
+		queues.clear();
+		for (unsigned int t = 0; t < nbThreads; ++t)
+			queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+		for (unsigned int t = 1; t < nbThreads; ++t)
+			workers.push_back(std::thread(&JobSystem::workerLoop, this, t));
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		for (size_t t = 0; t < workers.size(); ++t)
+			workers[t].join();
+		workers.clear();
+	}
+
+	/*!
+	*  \brief Index of the calling thread: its worker index, 0 outside the pool
+	*	\note thread_local came with VS2015: the v120 toolset uses __declspec(thread) (fine for a constant initialized int)
+	*/
+	static unsigned int & currentThread()
+	{
+#if defined(_MSC_VER) && _MSC_VER < 1900
+		static __declspec(thread) unsigned int index = 0;
+#else
+		static thread_local unsigned int index = 0;
+#endif
+		return index;
+	}
+
+	template <typename F>
+	static void invokeRange(void * context, size_t first, size_t last, unsigned int thread)
+	{
+		(*static_cast<F *>(context))(first, last, thread);
+	}
+
+	void run(const Job & job, unsigned int thread)
+	{
+		job.invoke(job.context, job.first, job.last, thread);
+		job.pending->fetch_sub(1, std::memory_order_release);
+	}
+
+	/*!
+	*  \brief Takes a job: the back of the thread's own queue, else the front of another one
+	* \return false if every queue is empty
+	*/
+	bool take(unsigned int thread, Job * job)
+	{
+		const size_t nbQueues = queues.size();
+		for (size_t k = 0; k < nbQueues; ++k)
+		{
+			WorkQueue & queue = *queues[(thread + k) % nbQueues];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.jobs.empty())
+				continue;
+			if (k == 0)
+			{
+				*job = queue.jobs.back();
+				queue.jobs.pop_back();
+			}
+			else
+			{
+				*job = queue.jobs.front();
+				queue.jobs.pop_front();
+			}
+			std::lock_guard<std::mutex> sleepLock(sleepMutex);
+			--queued;
+			return true;
+		}
+		return false;
+	}
+
+	void workerLoop(unsigned int thread)
+	{
+		currentThread() = thread;
+		for (;;)
+		{
+			Job job;
+			if (take(thread, &job))
+			{
+				run(job, thread);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wakeUp.wait(lock, [&]() { return stopping || queued > 0; });
+			if (stopping)
+				return;
+		}
+	}
+};
+
+/*@}*/
+
+}
+
+#endif
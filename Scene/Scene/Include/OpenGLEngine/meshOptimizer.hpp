@@ -0,0 +1,325 @@
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <cmath>
+#include <cstddef>
+
+namespace OpenGLEngine
+{
+
+/**
+* \file meshOptimizer.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup MESH */
+/*@{*/
+
+
+/*!
+*  \brief Mesh optimization: \n
+*		CPU only passes working on an indexed triangle list (three consecutive indices per face) \n
+*		No OpenGL call is made: every function can run (and be measured) without a context \n
+*
+*		-# optimizeVertexCache : reorders the triangles so that the GPU post-transform cache hits more often (Forsyth)
+*		-# optimizeVertexFetch : reorders the vertices in the order they are first referenced (linear vertex fetch)
+*		-# analyzeVertexCache : ACMR / ATVR of an index buffer on a simulated FIFO cache
+*
+*	\code{.cpp}
+*		meshOptimizer::VertexCacheStats before = meshOptimizer::analyzeVertexCache(indices, vertices.size());
+*		meshOptimizer::optimizeVertexCache(&indices, vertices.size());
+*		meshOptimizer::optimizeVertexFetch(&vertices, &indices);
+*		meshOptimizer::VertexCacheStats after = meshOptimizer::analyzeVertexCache(indices, vertices.size());
+*	\endcode
+*/
+namespace meshOptimizer
+{
+	/*!
+	*  \brief Size of the simulated post-transform caches
+	*/
+	const unsigned int FIFO_CACHE_SIZE = 16; /**< analyzeVertexCache: FIFO size (conservative estimate of current GPUs) */
+	const unsigned int LRU_CACHE_SIZE = 32; /**< optimizeVertexCache: LRU size used for vertex scoring */
+
+	/*!
+	*  \brief VertexCacheStats: \n
+	*		Efficiency of an index buffer on a simulated FIFO post-transform cache
+	*/
+	struct VertexCacheStats
+	{
+		size_t vertexTransforms = 0; /**< number of cache misses (vertex shader invocations) */
+		double acmr = 0.0; /**< Average Cache Miss Ratio: transforms per triangle (0.5 ideal for a regular grid, 3.0 worst) */
+		double atvr = 0.0; /**< Average Transform to Vertex Ratio: transforms per referenced vertex (1.0 ideal) */
+	};
+
+	/*!
+	*  \brief Report: \n
+	*		Vertex cache efficiency before and after optimization
+	*/
+	struct Report
+	{
+		VertexCacheStats before; /**< stats of the input index buffer */
+		VertexCacheStats after; /**< stats of the optimized index buffer */
+	};
+
+	/*!
+	*  \brief Simulates a FIFO post-transform cache on an index buffer
+	* \param const std::vector<unsigned int> & indices : triangle list
+	* \param size_t vertexCount : number of vertices referenced by indices
+	* \param unsigned int cacheSize : number of cache entries
+	* \return ACMR and ATVR of the index buffer
+	*/
+	inline VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> & indices, size_t vertexCount, unsigned int cacheSize = FIFO_CACHE_SIZE)
+	{
+		VertexCacheStats stats;
+		stats.vertexTransforms = 0;
+
+		// cacheTimestamps[v] : value of vertexTransforms when v entered the cache
+		// v is still cached while fewer than cacheSize vertices were transformed since
+		std::vector<size_t> cacheTimestamps(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+		size_t nbReferenced = 0;
+
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			const unsigned int v = indices[i];
+			if (v >= vertexCount)
+				continue;
+			if (!referenced[v])
+			{
+				referenced[v] = true;
+				++nbReferenced;
+			}
+			if (stats.vertexTransforms - cacheTimestamps[v] >= cacheSize || cacheTimestamps[v] == 0)
+				cacheTimestamps[v] = ++stats.vertexTransforms;
+		}
+
+		const size_t nbTriangles = indices.size() / 3;
+		stats.acmr = nbTriangles != 0 ? static_cast<double>(stats.vertexTransforms) / nbTriangles : 0.0;
+		stats.atvr = nbReferenced != 0 ? static_cast<double>(stats.vertexTransforms) / nbReferenced : 0.0;
+		return stats;
+	}
+
+	/*!
+	*  \brief Forsyth's vertex score
+	* \param int cachePosition : position in the LRU cache (-1 if not cached)
+	* \param unsigned int remainingTriangles : number of triangles not emitted yet using the vertex
+	* \return score of the vertex (the higher, the sooner its triangles should be emitted)
+	* \note "Linear-Speed Vertex Cache Optimisation" by Tom Forsyth
+	*		C.f: https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+	*/
+	inline float forsythVertexScore(int cachePosition, unsigned int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// the last triangle's vertices get a fixed score, so that no strip direction is favoured
+			if (cachePosition < 3)
+				score = 0.75f;
+			else
+				score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / (LRU_CACHE_SIZE - 3), 1.5f);
+		}
+
+		// boost vertices with few triangles left, to avoid leaving isolated triangles behind
+		return score + 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+	}
+
+	/*!
+	*  \brief Reorders triangles for post-transform cache locality (Forsyth) \n
+	*		Greedy: emits the best scoring triangle among those touching the cache, then updates the scores of the cached vertices
+	* \param std::vector<unsigned int> * indices : triangle list, reordered in place (each triangle keeps its winding)
+	* \param size_t vertexCount : number of vertices referenced by indices
+	* \return indices are reordered
+	*/
+	inline void optimizeVertexCache(std::vector<unsigned int> * indices, size_t vertexCount)
+	{
+		std::vector<unsigned int> & idx = *indices;
+		const size_t nbTriangles = idx.size() / 3;
+		if (nbTriangles == 0)
+			return;
+
+		// vertex -> triangles adjacency (CSR: triangles of v are adjacency[offsets[v] .. offsets[v] + remaining[v]])
+		std::vector<unsigned int> remaining(vertexCount, 0);
+		for (size_t i = 0; i < 3 * nbTriangles; ++i)
+			++remaining[idx[i]];
+
+		std::vector<size_t> offsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v)
+			offsets[v + 1] = offsets[v] + remaining[v];
+
+		std::vector<unsigned int> adjacency(3 * nbTriangles);
+		std::vector<unsigned int> fill(vertexCount, 0);
+		for (size_t t = 0; t < nbTriangles; ++t)
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const unsigned int v = idx[3 * t + k];
+				adjacency[offsets[v] + fill[v]++] = static_cast<unsigned int>(t);
+			}
+
+		// scores
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v)
+			vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+
+		std::vector<float> triangleScore(nbTriangles);
+		std::vector<bool> emitted(nbTriangles, false);
+		for (size_t t = 0; t < nbTriangles; ++t)
+			triangleScore[t] = vertexScore[idx[3 * t]] + vertexScore[idx[3 * t + 1]] + vertexScore[idx[3 * t + 2]];
+
+		std::vector<unsigned int> result;
+		result.reserve(3 * nbTriangles);
+
+		// LRU cache, with room for the 3 vertices pushed by the emitted triangle
+		std::vector<unsigned int> cache, nextCache;
+		cache.reserve(LRU_CACHE_SIZE + 3);
+		nextCache.reserve(LRU_CACHE_SIZE + 3);
+
+		size_t bestTriangle = 0;
+		for (size_t t = 1; t < nbTriangles; ++t)
+			if (triangleScore[t] > triangleScore[bestTriangle])
+				bestTriangle = t;
+		size_t scanCursor = 0;
+
+		for (size_t n = 0; n < nbTriangles; ++n)
+		{
+			// no candidate in the cache: next triangle not emitted yet, in input order
+			if (bestTriangle == nbTriangles)
+			{
+				while (emitted[scanCursor])
+					++scanCursor;
+				bestTriangle = scanCursor;
+			}
+
+			// emit
+			const unsigned int * triangle = &idx[3 * bestTriangle];
+			emitted[bestTriangle] = true;
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const unsigned int v = triangle[k];
+				result.push_back(v);
+
+				// remove the triangle from the vertex adjacency
+				unsigned int * begin = &adjacency[offsets[v]];
+				for (unsigned int a = 0; a < remaining[v]; ++a)
+					if (begin[a] == bestTriangle)
+					{
+						begin[a] = begin[remaining[v] - 1];
+						break;
+					}
+				--remaining[v];
+			}
+
+			// update the LRU cache: triangle vertices first, then the previous content
+			nextCache.clear();
+			nextCache.push_back(triangle[0]);
+			nextCache.push_back(triangle[1]);
+			nextCache.push_back(triangle[2]);
+			for (size_t c = 0; c < cache.size(); ++c)
+			{
+				const unsigned int v = cache[c];
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+					nextCache.push_back(v);
+			}
+			cache.swap(nextCache);
+
+			// update vertex scores (evicted vertices leave the cache)
+			for (size_t c = 0; c < cache.size(); ++c)
+			{
+				const unsigned int v = cache[c];
+				cachePosition[v] = c < LRU_CACHE_SIZE ? static_cast<int>(c) : -1;
+				vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+			}
+
+			// update the scores of the triangles touching the cache, and pick the best one
+			bestTriangle = nbTriangles;
+			float bestScore = -1.0f;
+			for (size_t c = 0; c < cache.size(); ++c)
+			{
+				const unsigned int v = cache[c];
+				for (unsigned int a = 0; a < remaining[v]; ++a)
+				{
+					const unsigned int t = adjacency[offsets[v] + a];
+					const float score = vertexScore[idx[3 * t]] + vertexScore[idx[3 * t + 1]] + vertexScore[idx[3 * t + 2]];
+					triangleScore[t] = score;
+					if (score > bestScore)
+					{
+						bestScore = score;
+						bestTriangle = t;
+					}
+				}
+			}
+			if (cache.size() > LRU_CACHE_SIZE)
+				cache.resize(LRU_CACHE_SIZE);
+		}
+
+		idx.swap(result);
+	}
+
+	/*!
+	*  \brief Reorders vertices in the order the index buffer first references them, and rewrites the indices accordingly \n
+	*		Vertex fetches then walk the vertex buffer (almost) linearly. Unreferenced vertices are dropped.
+	* \param std::vector<V> * vertices : vertex array (any vertex type), reordered in place
+	* \param std::vector<unsigned int> * indices : triangle list, remapped in place
+	* \return number of vertices kept
+	*/
+	template<typename V>
+	size_t optimizeVertexFetch(std::vector<V> * vertices, std::vector<unsigned int> * indices)
+	{
+		const unsigned int UNUSED = ~0u;
+		std::vector<unsigned int> remap(vertices->size(), UNUSED);
+		std::vector<V> reordered;
+		reordered.reserve(vertices->size());
+
+		std::vector<unsigned int> & idx = *indices;
+		for (size_t i = 0; i < idx.size(); ++i)
+		{
+			unsigned int & newIndex = remap[idx[i]];
+			if (newIndex == UNUSED)
+			{
+				newIndex = static_cast<unsigned int>(reordered.size());
+				reordered.push_back((*vertices)[idx[i]]);
+			}
+			idx[i] = newIndex;
+		}
+
+		vertices->swap(reordered);
+		return vertices->size();
+	}
+
+	/*!
+	*  \brief Runs the whole optimization stage: vertex cache, then vertex fetch \n
+	*		The triangle order is kept if it already does better on the FIFO cache than Forsyth's (an LRU model) order
+	* \param std::vector<V> * vertices : vertex array (any vertex type), reordered in place
+	* \param std::vector<unsigned int> * indices : triangle list, reordered and remapped in place
+	* \return ACMR / ATVR before and after (after.acmr <= before.acmr)
+	*/
+	template<typename V>
+	Report optimize(std::vector<V> * vertices, std::vector<unsigned int> * indices)
+	{
+		Report report;
+		report.before = analyzeVertexCache(*indices, vertices->size());
+		const std::vector<unsigned int> input = *indices;
+		optimizeVertexCache(indices, vertices->size());
+		if (analyzeVertexCache(*indices, vertices->size()).acmr > report.before.acmr)
+			*indices = input;
+		optimizeVertexFetch(vertices, indices);
+		report.after = analyzeVertexCache(*indices, vertices->size());
+		return report;
+	}
+}
+
+/*@}*/
+
+}
+
+#endif
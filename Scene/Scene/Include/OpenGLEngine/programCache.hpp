@@ -0,0 +1,244 @@
+#ifndef PROGRAMCACHE_HPP
+#define PROGRAMCACHE_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// STL
+////////////////////////
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+namespace OpenGLEngine
+{
+
+/**
+* \file programCache.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SHADER */
+/*@{*/
+
+
+/*!
+*  \brief Program binary cache: \n
+*		Linked programs are saved with glGetProgramBinary the first time they are built, and reloaded with glProgramBinary: \n
+*		warm starts skip GLSL compilation and linking entirely (cf Shader) \n
+*
+*	File layout:
+*		-# Header
+*		-# program binary : binarySize bytes, in the driver's binaryFormat
+*
+*	A cache file is named after the stage paths (cachePath), and its header holds a key hashing every stage type and source \n
+*	(defines included, they are part of the sources) with the driver strings (vendor, renderer, versions). \n
+*	Any mismatch, a truncated/foreign file, or a binary the driver refuses (glProgramBinary fails to link) makes the Shader \n
+*	compile the sources again and rewrite the cache.
+*
+*	\code{.cpp}
+*		unsigned long long key = programCache::hash(programCache::driverString());
+*		key = programCache::hash(vertexSource, key); ...
+*		if (!programCache::load(path, key, program))
+*		{
+*			... // compile, glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE), link
+*			programCache::store(path, key, program);
+*		}
+*	\endcode
+*
+*	\note requires OpenGL 4.1 (or ARB_get_program_binary) and at least one binary format, cf isSupported
+*/
+namespace programCache
+{
+	/*!
+	*  \brief Cache file format identification
+	*/
+	const char MAGIC[4] = { 'O', 'G', 'E', 'P' }; /**< first four bytes of every cache file */
+	const unsigned int VERSION = 1; /**< bumped whenever the layout below changes */
+
+	/*!
+	*  \brief Header: \n
+	*		first bytes of a cache file (fixed size)
+	*/
+	struct Header
+	{
+		char magic[4]; /**< MAGIC */
+		unsigned int version; /**< VERSION */
+		unsigned long long key; /**< hash of the stage sources and driver strings the binary was built from */
+		unsigned int binaryFormat; /**< format returned by glGetProgramBinary */
+		unsigned int binarySize; /**< size of the binary following the header, in bytes */
+	};
+
+	/*!
+	*  \brief Counters of the cache since the start of the program (cf Shader)
+	*/
+	struct Stats
+	{
+		unsigned int hits = 0; /**< programs loaded from a binary */
+		unsigned int misses = 0; /**< programs compiled: no cache file, or a stale one */
+		unsigned int rejected = 0; /**< valid cache files whose binary the driver refused (e.g. after a driver update) */
+	};
+
+	/*!
+	*  \brief Returns the cache counters
+	*/
+	inline Stats & getStats()
+	{
+		static Stats stats;
+		return stats;
+	}
+
+	/*!
+	*  \brief Returns the cache switch (enabled by default): false => every Shader compiles its sources
+	*/
+	inline bool & enabled()
+	{
+		static bool isEnabled = true;
+		return isEnabled;
+	}
+
+	/*!
+	*  \brief Returns true if the context can save and reload program binaries
+	*/
+	inline bool isSupported()
+	{
+		if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+			return false;
+		GLint nbFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nbFormats);
+		return nbFormats > 0;
+	}
+
+	/*!
+	*  \brief Hashes bytes (FNV-1a, 64 bits)
+	* \param const void * data : bytes to hash
+	* \param size_t size : number of bytes
+	* \param unsigned long long seed : hash of the previous data, to chain several calls
+	*/
+	inline unsigned long long hash(const void * data, size_t size, unsigned long long seed = 14695981039346656037ull)
+	{
+		const unsigned char * bytes = static_cast<const unsigned char *>(data);
+		for (size_t i = 0; i < size; ++i)
+			seed = (seed ^ bytes[i]) * 1099511628211ull;
+		return seed;
+	}
+	inline unsigned long long hash(const std::string & text, unsigned long long seed = 14695981039346656037ull)
+	{
+		// the size first: "ab" + "c" and "a" + "bc" hash differently
+		const unsigned long long size = text.size();
+		return hash(text.data(), text.size(), hash(&size, sizeof(size), seed));
+	}
+
+	/*!
+	*  \brief Returns the strings identifying the driver: a binary is only valid for the driver that built it
+	*/
+	inline std::string driverString()
+	{
+		const GLenum names[4] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+		std::string driver;
+		for (int i = 0; i < 4; ++i)
+		{
+			const GLubyte * value = glGetString(names[i]);
+			if (value != NULL)
+				driver += reinterpret_cast<const char *>(value);
+			driver += '\n';
+		}
+		return driver;
+	}
+
+	/*!
+	*  \brief Returns the path of the cache of a program (written next to its first stage)
+	* \param const std::string sourcePath : path to the first stage (e.g. the vertex shader)
+	* \param unsigned long long identity : hash of every stage path, so that programs sharing a stage get their own files
+	* \return sourcePath + "." + 16 hexadecimal digits + ".pbin"
+	*/
+	inline std::string cachePath(const std::string sourcePath, unsigned long long identity)
+	{
+		char digits[17];
+		std::snprintf(digits, sizeof(digits), "%016llx", identity);
+		return sourcePath + "." + digits + ".pbin";
+	}
+
+	/*!
+	*  \brief Loads a program from its cache file
+	*
+	* \param const std::string path : cache file
+	* \param unsigned long long key : expected key (hash of the current sources and driver)
+	* \param GLuint program : program object receiving the binary
+	* \return true if the file matches the key and the driver accepted the binary (the program is linked), \n
+	*		false otherwise: the program has to be compiled (a refused binary leaves it unlinked)
+	*/
+	inline bool load(const std::string path, unsigned long long key, GLuint program)
+	{
+		std::ifstream file(path.c_str(), std::ios::binary);
+		if (!file.good())
+			return false;
+
+		Header header;
+		if (!file.read(reinterpret_cast<char *>(&header), sizeof(Header)))
+			return false;
+		if (std::memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION || header.key != key || header.binarySize == 0)
+			return false;
+		std::vector<char> binary(header.binarySize);
+		if (!file.read(&binary[0], header.binarySize))
+			return false;
+
+		glProgramBinary(program, header.binaryFormat, &binary[0], static_cast<GLsizei>(header.binarySize));
+		GLint success = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+			++getStats().rejected;
+		return success == GL_TRUE;
+	}
+
+	/*!
+	*  \brief Writes the cache file of a linked program
+	*
+	* \param const std::string path : cache file to (over)write
+	* \param unsigned long long key : hash of the sources and driver the program was built from
+	* \param GLuint program : linked program (preferably linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+	* \return true if the driver returned a binary and the whole file could be written
+	*/
+	inline bool store(const std::string path, unsigned long long key, GLuint program)
+	{
+		GLint binarySize = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+		if (binarySize <= 0)
+			return false;
+		std::vector<char> binary(binarySize);
+		GLenum binaryFormat = 0;
+		GLsizei length = 0;
+		glGetProgramBinary(program, binarySize, &length, &binaryFormat, &binary[0]);
+		if (length <= 0)
+			return false;
+
+		Header header;
+		std::memset(&header, 0, sizeof(Header));
+		std::memcpy(header.magic, MAGIC, 4);
+		header.version = VERSION;
+		header.key = key;
+		header.binaryFormat = binaryFormat;
+		header.binarySize = static_cast<unsigned int>(length);
+
+		std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file.good())
+			return false;
+		file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+		file.write(&binary[0], length);
+		return file.good();
+	}
+}
+
+/*@}*/
+
+}
+
+#endif
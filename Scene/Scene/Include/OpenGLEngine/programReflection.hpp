@@ -0,0 +1,345 @@
+#ifndef PROGRAMREFLECTION_HPP
+#define PROGRAMREFLECTION_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// STL
+////////////////////////
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+
+namespace OpenGLEngine
+{
+
+/**
+* \file programReflection.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup UNIFORMS */
+/*@{*/
+
+
+/*!
+*  \brief Active uniform of a linked program, as reported by glGetActiveUniform \n
+*		arrays are listed once, under their name without "[0]" (size elements, consecutive locations). \n
+*		Members of uniform blocks have no location: they are placed by block, offset and strides instead
+*/
+struct ActiveUniform
+{
+	std::string name; /**< uniform name (arrays without "[0]") */
+	GLint location = -1; /**< location of the uniform (of its first element for arrays) */
+	GLint size = 0; /**< number of array elements, 1 otherwise */
+	GLenum type = 0; /**< GL_FLOAT_VEC3, GL_SAMPLER_2D... */
+	GLint block = -1; /**< index of the uniform block holding it, -1 for a plain uniform */
+	GLint offset = -1; /**< byte offset in the block */
+	GLint arrayStride = 0; /**< bytes between array elements in the block */
+	GLint matrixStride = 0; /**< bytes between matrix columns in the block */
+
+	bool isSampler() const
+	{
+		switch (type)
+		{
+		case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+		case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_ARRAY_SHADOW:
+		case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_BUFFER:
+		case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D:
+			return true;
+		default:
+			return false;
+		}
+	}
+};
+
+
+/*!
+*  \brief Program Reflection: \n
+*		The active uniforms and samplers of a program are enumerated once (glGetProgramiv / glGetActiveUniform) into a table. \n
+*		Uniform names are turned into slots, integers shared by every program (slotOf): a name is looked up once per link \n
+*		in a hash table, then its location in any program is found by indexing an array, without a glGetUniformLocation. \n
+*
+*		Each slot also remembers the last value sent to the program: the value itself for a Uniform (compared byte per byte, \n
+*		so that values written directly, e.g. by the engine library, are seen), a version for a CompiledMaterial parameter \n
+*		(a number taken from one global counter every time its value changes), or the texture unit of a sampler. \n
+*		An unchanged value is not sent again (uniforms are program state, they persist across draws and glUseProgram).
+*
+*	\code{.cpp}
+*		ProgramReflection & program = ProgramReflection::of(shader->Program);
+*		const unsigned int slot = ProgramReflection::slotOf("uRoughness");
+*		if (program.changed(slot, &roughness.value, sizeof(float)))
+*			glUniform1f(program.location(slot), roughness.value);
+*	\endcode
+*
+*	\note the table is built by the first of() (glGetActiveUniform needs the program linked). A program name deleted, \n
+*		created or linked again must be forgotten (cf forget: Shader does it on glCreateProgram and on every link), \n
+*		and a uniform set with a direct glUniform* call outside of this table is not seen
+*/
+class ProgramReflection
+{
+public:
+	///////////////////////////////////////////
+	//	REGISTRY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Returns the reflection of a program, reflected on first use
+	* \param GLuint program : linked program
+	*/
+	static ProgramReflection & of(GLuint program)
+	{
+		std::unordered_map<GLuint, ProgramReflection> & programs = registry();
+		std::unordered_map<GLuint, ProgramReflection>::iterator it = programs.find(program);
+		if (it == programs.end())
+		{
+			it = programs.insert(std::make_pair(program, ProgramReflection())).first;
+			it->second.reflect(program);
+		}
+		return it->second;
+	}
+
+	/*!
+	*  \brief Drops the table of a program name: deleted, linked again, or just returned by glCreateProgram \n
+	*		(a deleted name may be reused by the new program). It is reflected again by the next of()
+	*/
+	static void forget(GLuint program)
+	{
+		registry().erase(program);
+	}
+
+	/*!
+	*  \brief Returns the slot of a uniform name (the same in every program)
+	*/
+	static unsigned int slotOf(const std::string & name)
+	{
+		std::unordered_map<std::string, unsigned int> & slots = slotTable();
+		std::unordered_map<std::string, unsigned int>::const_iterator it = slots.find(name);
+		if (it != slots.end())
+			return it->second;
+		const unsigned int slot = static_cast<unsigned int>(slotNames().size());
+		slotNames().push_back(name);
+		return slots[name] = slot;
+	}
+
+	/*!
+	*  \brief Returns a new value version (0 is never returned: it stands for "nothing sent yet")
+	*/
+	static unsigned int nextVersion()
+	{
+		static unsigned int counter = 0;
+		if (++counter == 0)
+			++counter;
+		return counter;
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Returns every active uniform (samplers included)
+	*/
+	const std::vector<ActiveUniform> & getUniforms() const
+	{
+		return uniforms;
+	}
+	/*!
+	*  \brief Returns the location of a slot in the program
+	* \return -1 if the program has no such active uniform
+	*/
+	GLint location(unsigned int slot)
+	{
+		return state(slot).location;
+	}
+	/*!
+	*  \brief Returns the active uniform of a slot
+	* \return NULL if the program has no such uniform (plain or block member)
+	*/
+	const ActiveUniform * uniform(unsigned int slot)
+	{
+		SlotState & s = state(slot);
+		return s.uniform >= 0 ? &uniforms[s.uniform] : NULL;
+	}
+	/*!
+	*  \brief Returns the number of array elements of a slot (0 if it is not active)
+	*/
+	GLint size(unsigned int slot)
+	{
+		SlotState & s = state(slot);
+		return s.uniform >= 0 ? uniforms[s.uniform].size : 0;
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Dirty test of a uniform value, by version
+	* \param unsigned int slot : uniform slot (cf slotOf)
+	* \param unsigned int version : version of the value about to be sent
+	* \return true if the caller has to send it (the version is then recorded as sent), \n
+	*		false if the program already holds it or has no such uniform
+	*/
+	bool changed(unsigned int slot, unsigned int version)
+	{
+		SlotState & s = state(slot);
+		if (s.location < 0 || s.version == version)
+			return false;
+		s.version = version;
+		s.value.clear();
+		s.unit = -1;
+		return true;
+	}
+
+	/*!
+	*  \brief Dirty test of a uniform value, by content
+	* \param unsigned int slot : uniform slot (cf slotOf)
+	* \param const void * value : value about to be sent
+	* \param size_t bytes : size of the value
+	* \return true if the caller has to send it (a copy is then recorded as sent), \n
+	*		false if the program already holds the same bytes or has no such uniform
+	*/
+	bool changed(unsigned int slot, const void * value, size_t bytes)
+	{
+		SlotState & s = state(slot);
+		if (s.location < 0 || (s.value.size() == bytes && std::memcmp(&s.value[0], value, bytes) == 0))
+			return false;
+		s.value.assign(static_cast<const unsigned char *>(value), static_cast<const unsigned char *>(value) + bytes);
+		s.version = 0;
+		s.unit = -1;
+		return true;
+	}
+
+	/*!
+	*  \brief Dirty test of a sampler
+	* \param unsigned int slot : sampler slot (cf slotOf)
+	* \param GLint unit : texture unit about to be set
+	* \return true if the caller has to send it (glUniform1i), false if the sampler already reads this unit
+	*/
+	bool samplerChanged(unsigned int slot, GLint unit)
+	{
+		SlotState & s = state(slot);
+		if (s.location < 0 || s.unit == unit)
+			return false;
+		s.unit = unit;
+		s.version = 0;
+		s.value.clear();
+		return true;
+	}
+
+
+private:
+	//! per slot state of the program: location, index in uniforms, last value sent (Uniform bytes, a version or a texture unit)
+	struct SlotState
+	{
+		GLint location = -1;
+		int uniform = -1;
+		unsigned int version = 0; /**< 0: no versioned value sent */
+		std::vector<unsigned char> value; /**< empty: no Uniform value sent */
+		GLint unit = -1; /**< -1: no texture unit sent */
+	};
+
+	std::vector<ActiveUniform> uniforms;
+	std::unordered_map<std::string, int> byName;
+	std::vector<SlotState> slots;
+	//! slots [0, nbResolved) have been looked up in byName
+	size_t nbResolved = 0;
+
+	static std::unordered_map<GLuint, ProgramReflection> & registry()
+	{
+		static std::unordered_map<GLuint, ProgramReflection> programs;
+		return programs;
+	}
+	static std::unordered_map<std::string, unsigned int> & slotTable()
+	{
+		static std::unordered_map<std::string, unsigned int> slots;
+		return slots;
+	}
+	static std::vector<std::string> & slotNames()
+	{
+		static std::vector<std::string> names;
+		return names;
+	}
+
+	/*!
+	*  \brief Enumerates the active uniforms of the program
+	*/
+	void reflect(GLuint program)
+	{
+		GLint nbUniforms = 0, maxLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &nbUniforms);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		if (nbUniforms <= 0 || maxLength <= 0)
+			return;
+
+		std::vector<GLuint> indices(static_cast<size_t>(nbUniforms));
+		for (GLint i = 0; i < nbUniforms; ++i)
+			indices[i] = static_cast<GLuint>(i);
+		std::vector<GLint> blocks(indices.size()), offsets(indices.size()), arrayStrides(indices.size()), matrixStrides(indices.size());
+		glGetActiveUniformsiv(program, nbUniforms, &indices[0], GL_UNIFORM_BLOCK_INDEX, &blocks[0]);
+		glGetActiveUniformsiv(program, nbUniforms, &indices[0], GL_UNIFORM_OFFSET, &offsets[0]);
+		glGetActiveUniformsiv(program, nbUniforms, &indices[0], GL_UNIFORM_ARRAY_STRIDE, &arrayStrides[0]);
+		glGetActiveUniformsiv(program, nbUniforms, &indices[0], GL_UNIFORM_MATRIX_STRIDE, &matrixStrides[0]);
+
+		std::vector<GLchar> buffer(static_cast<size_t>(maxLength) + 1);
+		for (GLint i = 0; i < nbUniforms; ++i)
+		{
+			ActiveUniform uniform;
+			GLsizei length = 0;
+			glGetActiveUniform(program, static_cast<GLuint>(i), maxLength, &length, &uniform.size, &uniform.type, &buffer[0]);
+			uniform.name.assign(&buffer[0], length);
+			const bool isArray = uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0;
+			uniform.block = blocks[i];
+			if (uniform.block >= 0)
+			{
+				uniform.offset = offsets[i];
+				uniform.arrayStride = arrayStrides[i];
+				uniform.matrixStride = matrixStrides[i];
+			}
+			else
+				uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+			if (isArray)
+				uniform.name.resize(uniform.name.size() - 3);
+
+			byName[uniform.name] = static_cast<int>(uniforms.size());
+			if (isArray) // "samples[0]" is also a valid name for the first element
+				byName[uniform.name + "[0]"] = static_cast<int>(uniforms.size());
+			uniforms.push_back(uniform);
+		}
+	}
+
+	/*!
+	*  \brief Returns the state of a slot, resolving the slots named since the last call
+	*/
+	SlotState & state(unsigned int slot)
+	{
+		if (slot >= nbResolved)
+		{
+			const std::vector<std::string> & names = slotNames();
+			slots.resize(names.size());
+			for (; nbResolved < names.size(); ++nbResolved)
+			{
+				std::unordered_map<std::string, int>::const_iterator it = byName.find(names[nbResolved]);
+				if (it == byName.end())
+					continue;
+				slots[nbResolved].uniform = it->second;
+				slots[nbResolved].location = uniforms[it->second].location;
+			}
+		}
+		return slots[slot];
+	}
+};
+
+/*@}*/
+
+}
+
+#endif
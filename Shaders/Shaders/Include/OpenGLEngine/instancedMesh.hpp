@@ -0,0 +1,347 @@
+#ifndef INSTANCEDMESH_HPP
+#define INSTANCEDMESH_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "modelGeometry.hpp"
+#include "modelMaterial.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file instancedMesh.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup MESH */
+/*@{*/
+
+
+/*!
+*  \brief Per instance record of an InstancedMesh (84 bytes, read as vertex attributes): \n
+*			- location 8 to 11 : instanceModelMatrix (one column per location) \n
+*			- location 12 : instanceF_0 (replaces uF_0) \n
+*			- location 13 : instanceRoughnessMetalness (replace uRoughness, uMaterialMetalness)
+*/
+struct MeshInstance
+{
+	glm::mat4 modelMatrix;
+	glm::vec3 F_0;
+	float roughness;
+	float metalness;
+};
+
+
+/*!
+*	Many copies of the same Geometry, drawn with the same Material in a single glDrawElementsInstanced / glDrawArraysInstanced call. \n
+*	Every instance has its own model matrix and, optionally, its own material parameters (uF_0, uRoughness, uMaterialMetalness). \n
+*	The records live in a CPU array mirrored by an instance buffer: only the instances changed since the last draw are sent, \n
+*	merged into contiguous ranges (cf update)
+*
+*	\code{.cpp}
+*		Shader pbrInstancedShader("pbrInstanced.vert", "pbr.frag");
+*		Material material(&textureVec, &uniformVec, &pbrInstancedShader);
+*		InstancedMesh field(&cubeGeometry, &material, true);
+*		for (...)
+*			field.addInstance(glm::translate(glm::mat4(1.0f), position), F0, roughness, metalness);
+*		scene.addInstancedMesh(&field);
+*		...
+*		field.setTransform(i, model); // moving a few instances re-sends a few records
+*		scene.drawMeshes(&camera, &window);
+*	\endcode
+*
+*	\note shaders: pbrInstanced.vert and geometryPassInstanced.vert apply modelMatrix * instanceModelMatrix. \n
+*		Normals are transformed by normalMatrix * instanceModelMatrix: instance transforms should be rotations, translations and uniform scales. \n
+*		With per instance material parameters disabled, the material uniforms apply to every instance (useInstanceMaterial = 0)
+*/
+class InstancedMesh
+{
+public:
+	//! first attribute location of the instance record (locations 0 to 4 are the vertex layout, cf Geometry::vertexLayout)
+	static const unsigned int FIRST_INSTANCE_LOCATION = 8;
+	//! dirty instances closer than this are sent in the same range (one glBufferSubData is cheaper than re-sending a few records)
+	static const size_t MERGE_GAP = 8;
+	//! beyond this many ranges, the dirty span is sent in one call
+	static const size_t MAX_RANGES = 16;
+
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Constructor
+	* \param Geometry * const geometry : geometry shared by every instance (copied, the OpenGL objects are shared)
+	* \param const Material * const material : material shared by every instance (copied), its shader must be an instanced one
+	* \param bool instanceMaterial : true => every instance has its own uF_0, uRoughness and uMaterialMetalness
+	*/
+	InstancedMesh(Geometry * const geometry, const Material * const material, bool instanceMaterial = false)
+		: geometry(*geometry), material(*material), instanceMaterial(instanceMaterial)
+	{}
+
+	/*!
+	*  \brief Destructor: \n
+	*		deletes the instance buffer (the geometry is not deallocated)
+	*/
+	~InstancedMesh()
+	{
+		if (instanceBuffer != 0)
+			glDeleteBuffers(1, &instanceBuffer);
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	Geometry * getGeometry()
+	{
+		return &geometry;
+	}
+	Material * getMaterial()
+	{
+		return &material;
+	}
+	size_t getInstanceCount() const
+	{
+		return instances.size();
+	}
+	const MeshInstance & getInstance(size_t i) const
+	{
+		return instances[i];
+	}
+	/*!
+	*  \brief Returns the number of bytes sent to the instance buffer by the last update()
+	*/
+	size_t getUploadedBytes() const
+	{
+		return uploadedBytes;
+	}
+
+
+	///////////////////////////////////////////
+	//	SETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Appends an instance
+	* \param const glm::mat4 modelMatrix : instance transform (applied before the mesh modelMatrix)
+	* \param const glm::vec3 F_0, float roughness, float metalness : instance material (ignored unless instanceMaterial was set)
+	* \return index of the new instance
+	*/
+	size_t addInstance(const glm::mat4 modelMatrix, const glm::vec3 F_0 = glm::vec3(0.04f), float roughness = 0.5f, float metalness = 0.0f)
+	{
+		MeshInstance instance;
+		instance.modelMatrix = modelMatrix;
+		instance.F_0 = F_0;
+		instance.roughness = roughness;
+		instance.metalness = metalness;
+		instances.push_back(instance);
+		dirtyFlags.push_back(0);
+		markDirty(instances.size() - 1);
+		return instances.size() - 1;
+	}
+	/*!
+	*  \brief Moves an instance
+	*/
+	void setTransform(size_t i, const glm::mat4 modelMatrix)
+	{
+		instances[i].modelMatrix = modelMatrix;
+		markDirty(i);
+	}
+	/*!
+	*  \brief Changes the material parameters of an instance
+	*/
+	void setInstanceMaterial(size_t i, const glm::vec3 F_0, float roughness, float metalness)
+	{
+		instances[i].F_0 = F_0;
+		instances[i].roughness = roughness;
+		instances[i].metalness = metalness;
+		markDirty(i);
+	}
+	/*!
+	*  \brief Removes an instance: the last one takes its place (instance order is not kept)
+	*/
+	void removeInstance(size_t i)
+	{
+		instances[i] = instances.back();
+		instances.pop_back();
+		dirtyFlags.pop_back();
+		if (i < instances.size())
+			markDirty(i);
+	}
+	/*!
+	*  \brief Removes every instance
+	*/
+	void clearInstances()
+	{
+		instances.clear();
+		dirtyFlags.clear();
+		dirtyInstances.clear();
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Sends the changed instances to the instance buffer (called by draw) \n
+	*		The buffer grows by doubling (everything is sent again). Otherwise the dirty instances are sorted and merged \n
+	*		into ranges (gaps under MERGE_GAP records are sent too), one glBufferSubData per range
+	* \return number of bytes sent
+	*/
+	size_t update()
+	{
+		uploadedBytes = 0;
+		if (instances.empty())
+		{
+			dirtyInstances.clear();
+			return 0;
+		}
+
+		if (instanceBuffer == 0)
+			glGenBuffers(1, &instanceBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+		if (instances.size() > capacity)
+		{
+			capacity = std::max(instances.size(), 2 * capacity);
+			glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity * sizeof(MeshInstance)), NULL, GL_DYNAMIC_DRAW);
+			uploadRange(0, instances.size());
+		}
+		else if (!dirtyInstances.empty())
+		{
+			std::sort(dirtyInstances.begin(), dirtyInstances.end());
+			ranges.clear();
+			size_t first = dirtyInstances[0], last = first + 1;
+			for (size_t k = 1; k < dirtyInstances.size(); ++k)
+			{
+				if (dirtyInstances[k] >= instances.size())
+					break;
+				if (dirtyInstances[k] > last + MERGE_GAP)
+				{
+					ranges.push_back(std::make_pair(first, last));
+					first = dirtyInstances[k];
+				}
+				last = dirtyInstances[k] + 1;
+			}
+			ranges.push_back(std::make_pair(first, std::min(last, instances.size())));
+
+			if (ranges.size() > MAX_RANGES)
+				uploadRange(ranges.front().first, ranges.back().second);
+			else
+				for (size_t r = 0; r < ranges.size(); ++r)
+					uploadRange(ranges[r].first, ranges[r].second);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		for (size_t k = 0; k < dirtyInstances.size(); ++k)
+			if (dirtyInstances[k] < dirtyFlags.size())
+				dirtyFlags[dirtyInstances[k]] = 0;
+		dirtyInstances.clear();
+		return uploadedBytes;
+	}
+
+	/*!
+	*  \brief Draws every instance (the material's shader has to be in use, with its default uniforms linked)
+	* \return sends the changed instances, sets useInstanceMaterial and issues a single instanced draw call
+	*/
+	void draw()
+	{
+		update();
+
+		Shader * shader = material.getShader();
+		static const unsigned int slot = ProgramReflection::slotOf("useInstanceMaterial");
+		const GLint location = ProgramReflection::of(shader->Program).location(slot);
+		if (location >= 0)
+			glUniform1i(location, instanceMaterial ? 1 : 0);
+
+		const VertexAttribute attributes[] = {
+			{ FIRST_INSTANCE_LOCATION + 0, 4, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(MeshInstance, modelMatrix)) },
+			{ FIRST_INSTANCE_LOCATION + 1, 4, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(MeshInstance, modelMatrix) + sizeof(glm::vec4)) },
+			{ FIRST_INSTANCE_LOCATION + 2, 4, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(MeshInstance, modelMatrix) + 2 * sizeof(glm::vec4)) },
+			{ FIRST_INSTANCE_LOCATION + 3, 4, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(MeshInstance, modelMatrix) + 3 * sizeof(glm::vec4)) },
+			{ FIRST_INSTANCE_LOCATION + 4, 3, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(MeshInstance, F_0)) },
+			{ FIRST_INSTANCE_LOCATION + 5, 2, GL_FLOAT, GL_FALSE, static_cast<unsigned int>(offsetof(MeshInstance, roughness)) }
+		};
+		geometry.drawInstanced(static_cast<GLsizei>(instances.size()), instanceBuffer, sizeof(MeshInstance), attributes, instanceMaterial ? 6 : 4);
+	}
+
+	/*!
+	*  \brief Draws every instance with the material: its uniforms and textures are bound, then unbound
+	* \note the default uniforms (matrices) are left to the caller (cf Scene::linkDefaultUniforms)
+	*/
+	void render()
+	{
+		Shader * shader = material.getShader();
+		material.linkUniforms(shader);
+		material.bindTextures(shader);
+		draw();
+		material.unbindMaterial();
+		GLState::get().invalidateTextures();
+	}
+
+
+private:
+	Geometry geometry;
+	Material material;
+	bool instanceMaterial;
+
+	//! CPU side records, mirrored by instanceBuffer (capacity records allocated)
+	std::vector<MeshInstance> instances;
+	GLuint instanceBuffer = 0;
+	size_t capacity = 0;
+
+	//! instances changed since the last update (each listed once, cf dirtyFlags)
+	std::vector<size_t> dirtyInstances;
+	std::vector<unsigned char> dirtyFlags;
+	std::vector<std::pair<size_t, size_t> > ranges;
+	size_t uploadedBytes = 0;
+
+	void markDirty(size_t i)
+	{
+		if (dirtyFlags[i])
+			return;
+		dirtyFlags[i] = 1;
+		dirtyInstances.push_back(i);
+	}
+
+	/*!
+	*  \brief Sends records [first, last) (the buffer is bound)
+	*/
+	void uploadRange(size_t first, size_t last)
+	{
+		if (last <= first)
+			return;
+		const size_t bytes = (last - first) * sizeof(MeshInstance);
+		glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(first * sizeof(MeshInstance)), static_cast<GLsizeiptr>(bytes), &instances[first]);
+		uploadedBytes += bytes;
+	}
+
+	InstancedMesh(const InstancedMesh &);
+	InstancedMesh & operator=(const InstancedMesh &);
+};
+
+/*@}*/
+
+}
+
+#endif
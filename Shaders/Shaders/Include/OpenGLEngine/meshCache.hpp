@@ -0,0 +1,365 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <iostream>
+
+////////////////////////
+// OS (file size & modification time)
+////////////////////////
+#include <sys/types.h>
+#include <sys/stat.h>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "parser.hpp"
+#include "vertexFormat.hpp"
+#include "meshSimplifier.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file meshCache.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup MESH */
+/*@{*/
+
+
+/*!
+*  \brief Baked mesh cache: \n
+*		Compact binary image of a Geometry, written next to its source file the first time the source is loaded \n
+*		Later loads map the cache and hand its bytes straight to glBufferData: no parsing, no intermediate std::vector<Vertex> \n
+*
+*	File layout (little endian, every section 16 bytes aligned):
+*		-# Header
+*		-# VertexAttribute[attributeCount] : vertex layout descriptor
+*		-# LevelOfDetail[lodCount] : LOD chain (ranges of the index data), optional
+*		-# vertex data : vertexCount * vertexStride bytes, interleaved
+*		-# index data : indexCount * 4 bytes (GL_UNSIGNED_INT, every LOD level), optional
+*
+*	The cache is valid as long as the source file has the same size and modification time, and the same loading scale, VertexFormat and LOD ratios were used. \n
+*	Any mismatch (or a truncated/foreign/corrupt file, cf CachedMesh::open) makes the loader fall back to the source and rewrite the cache.
+*
+*	\code{.cpp}
+*		meshCache::CachedMesh cache;
+*		if (cache.open(meshCache::cachePath(filename), filename, scale, VERTEX_FORMAT_FULL, std::vector<float>()))
+*			... // cache.vertexData(), cache.attributes(), cache.indexData(), cache.lods()
+*	\endcode
+*/
+namespace meshCache
+{
+	/*!
+	*  \brief Cache file format identification
+	*/
+	const char MAGIC[4] = { 'O', 'G', 'E', 'M' }; /**< first four bytes of every cache file */
+	const unsigned int VERSION = 6; /**< bumped whenever the layout below or the baked content changes (2: optimized triangle/vertex order, 3: vertex format, 4: tangent frames, 5: LOD chain, 6: bounding sphere) */
+
+	/*!
+	*  \brief Header: \n
+	*		first bytes of a cache file (fixed size)
+	*/
+	struct Header
+	{
+		char magic[4]; /**< MAGIC */
+		unsigned int version; /**< VERSION */
+
+		long long sourceSize; /**< size of the source file in bytes */
+		long long sourceTime; /**< modification time of the source file */
+		float scale; /**< scaling factor baked into the positions */
+		unsigned int format; /**< VertexFormat of the vertex data */
+
+		unsigned int vertexCount; /**< number of vertices */
+		unsigned int vertexStride; /**< size of a vertex in bytes */
+		unsigned int attributeCount; /**< number of VertexAttribute following the header */
+		unsigned int indexCount; /**< number of GL_UNSIGNED_INT indices, 0 if the geometry is not indexed */
+		unsigned int lodCount; /**< number of LevelOfDetail following the vertex layout, 0 if no LOD chain was built */
+		unsigned int lodRatioCount; /**< number of requested LOD ratios */
+		float lodRatios[meshSimplifier::MAX_LOD_LEVELS]; /**< requested LOD ratios (levels that could not be simplified further are not in the chain) */
+
+		float boundsMin[3]; /**< object space axis aligned bounding box (min corner) */
+		float boundsMax[3]; /**< object space axis aligned bounding box (max corner) */
+		float boundsRadius; /**< object space bounding sphere radius, around the bounding box center */
+
+		unsigned long long vertexOffset; /**< byte offset of the vertex data from the start of the file */
+		unsigned long long indexOffset; /**< byte offset of the index data from the start of the file */
+	};
+
+	/*!
+	*  \brief Rounds a byte offset up to the next section alignment (16 bytes)
+	*/
+	inline unsigned long long align(unsigned long long offset)
+	{
+		return (offset + 15) & ~static_cast<unsigned long long>(15);
+	}
+
+	/*!
+	*  \brief Returns the path of the cache associated with a source file (written next to it)
+	* \param const std::string sourcePath : path to the source mesh file
+	* \return sourcePath + ".mbin"
+	*/
+	inline std::string cachePath(const std::string sourcePath)
+	{
+		return sourcePath + ".mbin";
+	}
+
+	/*!
+	*  \brief Reads the size and modification time of a file
+	* \param const std::string path : file path
+	* \param long long * size : file size in bytes
+	* \param long long * time : file modification time (seconds)
+	* \return false if the file does not exist
+	*/
+	inline bool fileStamp(const std::string path, long long * size, long long * time)
+	{
+#ifdef _WIN32
+		struct _stat64 st;
+		if (_stat64(path.c_str(), &st) != 0)
+			return false;
+#else
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0)
+			return false;
+#endif
+		*size = static_cast<long long>(st.st_size);
+		*time = static_cast<long long>(st.st_mtime);
+		return true;
+	}
+
+	/*!
+	*  \brief Writes a cache file
+	*
+	* \param const std::string path : cache file to (over)write
+	* \param const std::string sourcePath : source mesh file (its size and modification time are stamped in the header)
+	* \param const float scale : scaling factor baked into the positions
+	* \param VertexFormat format : format of the vertex data
+	* \param const std::vector<VertexAttribute> & attributes : vertex layout
+	* \param const void * vertexData : interleaved vertex data
+	* \param unsigned int vertexCount : number of vertices
+	* \param unsigned int vertexStride : size of a vertex in bytes
+	* \param const unsigned int * indexData : index data (NULL if the geometry is not indexed)
+	* \param unsigned int indexCount : number of indices
+	* \param const glm::vec3 boundsMin : object space bounding box min corner
+	* \param const glm::vec3 boundsMax : object space bounding box max corner
+	* \param const float boundsRadius : object space bounding sphere radius (around the box center)
+	* \param const std::vector<float> & lodRatios : requested LOD ratios
+	* \param const std::vector<LevelOfDetail> & lods : LOD chain (empty if none)
+	* \return true if the whole file could be written
+	*/
+	inline bool write(const std::string path, const std::string sourcePath, const float scale, VertexFormat format,
+		const std::vector<VertexAttribute> & attributes, const void * vertexData, unsigned int vertexCount, unsigned int vertexStride,
+		const unsigned int * indexData, unsigned int indexCount, const glm::vec3 boundsMin, const glm::vec3 boundsMax, const float boundsRadius,
+		const std::vector<float> & lodRatios, const std::vector<LevelOfDetail> & lods)
+	{
+		if (lodRatios.size() > meshSimplifier::MAX_LOD_LEVELS)
+			return false;
+
+		Header header;
+		std::memset(&header, 0, sizeof(Header));
+		std::memcpy(header.magic, MAGIC, 4);
+		header.version = VERSION;
+		if (!fileStamp(sourcePath, &header.sourceSize, &header.sourceTime))
+			return false;
+		header.scale = scale;
+		header.format = static_cast<unsigned int>(format);
+		header.vertexCount = vertexCount;
+		header.vertexStride = vertexStride;
+		header.attributeCount = static_cast<unsigned int>(attributes.size());
+		header.indexCount = indexData != NULL ? indexCount : 0;
+		header.lodCount = header.indexCount != 0 ? static_cast<unsigned int>(lods.size()) : 0;
+		header.lodRatioCount = static_cast<unsigned int>(lodRatios.size());
+		for (size_t l = 0; l < lodRatios.size(); ++l)
+			header.lodRatios[l] = lodRatios[l];
+		for (int k = 0; k < 3; ++k)
+		{
+			header.boundsMin[k] = boundsMin[k];
+			header.boundsMax[k] = boundsMax[k];
+		}
+		header.boundsRadius = boundsRadius;
+		const unsigned long long descriptorSize = attributes.size() * sizeof(VertexAttribute) + header.lodCount * sizeof(LevelOfDetail);
+		header.vertexOffset = align(sizeof(Header) + descriptorSize);
+		header.indexOffset = align(header.vertexOffset + static_cast<unsigned long long>(vertexCount) * vertexStride);
+
+		std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file.good())
+			return false;
+
+		const char padding[16] = { 0 };
+		file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+		if (!attributes.empty())
+			file.write(reinterpret_cast<const char *>(&attributes[0]), attributes.size() * sizeof(VertexAttribute));
+		if (header.lodCount != 0)
+			file.write(reinterpret_cast<const char *>(&lods[0]), header.lodCount * sizeof(LevelOfDetail));
+		file.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(Header) - descriptorSize));
+		file.write(static_cast<const char *>(vertexData), static_cast<std::streamsize>(vertexCount) * vertexStride);
+		if (header.indexCount != 0)
+		{
+			file.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - static_cast<unsigned long long>(vertexCount) * vertexStride));
+			file.write(reinterpret_cast<const char *>(indexData), static_cast<std::streamsize>(indexCount) * sizeof(unsigned int));
+		}
+		return file.good();
+	}
+
+
+	/*!
+	*  \brief CachedMesh: \n
+	*		Read-only view of a validated cache file \n
+	*		The pointers returned by the getters point inside the mapping and stay valid until the object is destroyed
+	*/
+	class CachedMesh
+	{
+	public:
+		/*!
+		*  \brief Default Constructor: \n
+		*		nothing is opened
+		*/
+		CachedMesh() : header(NULL)
+		{
+		}
+
+		/*!
+		*  \brief Maps and validates a cache file against its source
+		*
+		* \param const std::string path : cache file
+		* \param const std::string sourcePath : source mesh file the cache was baked from
+		* \param const float scale : expected scaling factor
+		* \param VertexFormat format : expected vertex format
+		* \param const std::vector<float> & lodRatios : expected LOD ratios
+		* \return true if the cache exists, is complete and matches the source (size, modification time), scale, format and LOD ratios, \n
+		*		and its content is consistent (cf consistent): nothing read from it can point outside of the file or of the vertex buffer
+		*/
+		bool open(const std::string path, const std::string sourcePath, const float scale, VertexFormat format, const std::vector<float> & lodRatios)
+		{
+			header = NULL;
+			long long sourceSize, sourceTime;
+			if (!fileStamp(sourcePath, &sourceSize, &sourceTime))
+				return false;
+
+			long long cacheSize, cacheTime;
+			if (!fileStamp(path, &cacheSize, &cacheTime) || static_cast<size_t>(cacheSize) < sizeof(Header))
+				return false;
+			if (!file.open(path))
+				return false;
+
+			const Header * h = reinterpret_cast<const Header *>(file.begin());
+			const unsigned long long size = file.size();
+			if (std::memcmp(h->magic, MAGIC, 4) != 0 || h->version != VERSION)
+				return false;
+			if (h->sourceSize != sourceSize || h->sourceTime != sourceTime || h->scale != scale || h->format != static_cast<unsigned int>(format))
+				return false;
+			if (h->lodRatioCount != lodRatios.size() || (!lodRatios.empty() && std::memcmp(h->lodRatios, &lodRatios[0], lodRatios.size() * sizeof(float)) != 0))
+				return false;
+			if (!consistent(h, size, format))
+			{
+				std::cout << "WARNING::MESHCACHE::INVALID_FILE: " << path << std::endl;
+				return false;
+			}
+
+			header = h;
+			return true;
+		}
+
+		/*!
+		*  \brief Returns the validated header (NULL if open failed)
+		*/
+		const Header * getHeader() const { return header; }
+		/*!
+		*  \brief Returns the vertex layout descriptor (header->attributeCount entries)
+		*/
+		const VertexAttribute * attributes() const { return reinterpret_cast<const VertexAttribute *>(file.begin() + sizeof(Header)); }
+		/*!
+		*  \brief Returns the LOD chain (header->lodCount entries)
+		*/
+		const LevelOfDetail * lods() const { return reinterpret_cast<const LevelOfDetail *>(file.begin() + sizeof(Header) + header->attributeCount * sizeof(VertexAttribute)); }
+		/*!
+		*  \brief Returns the interleaved vertex data (header->vertexCount * header->vertexStride bytes)
+		*/
+		const void * vertexData() const { return file.begin() + header->vertexOffset; }
+		/*!
+		*  \brief Returns the index data (header->indexCount indices), NULL if the geometry is not indexed
+		*/
+		const unsigned int * indexData() const { return header->indexCount != 0 ? reinterpret_cast<const unsigned int *>(file.begin() + header->indexOffset) : NULL; }
+
+	private:
+		/*!
+		*  \brief Checks the layout of a mapped cache file (header already matched against the source)
+		*
+		* \param const Header * h : header of the mapping
+		* \param unsigned long long size : size of the mapping in bytes
+		* \param VertexFormat format : vertex format of the cache
+		* \return false if a section overlaps another or the end of the file, if the vertex layout does not fit the stride, \n
+		*		or if a LOD range or an index points outside of the index or vertex data
+		*/
+		static bool consistent(const Header * h, unsigned long long size, VertexFormat format)
+		{
+			// sections: header, descriptors, vertex data, index data, in this order and inside the file (sizes fit in 64 bits)
+			const unsigned long long descriptorEnd = sizeof(Header) + static_cast<unsigned long long>(h->attributeCount) * sizeof(VertexAttribute) +
+				static_cast<unsigned long long>(h->lodCount) * sizeof(LevelOfDetail);
+			const unsigned long long vertexBytes = static_cast<unsigned long long>(h->vertexCount) * h->vertexStride;
+			const unsigned long long indexBytes = static_cast<unsigned long long>(h->indexCount) * sizeof(unsigned int);
+			if (h->vertexOffset != align(h->vertexOffset) || h->vertexOffset < descriptorEnd || h->vertexOffset > size || vertexBytes > size - h->vertexOffset)
+				return false;
+			if (h->indexCount != 0 && (h->indexOffset != align(h->indexOffset) || h->indexOffset < h->vertexOffset + vertexBytes || h->indexOffset > size || indexBytes > size - h->indexOffset))
+				return false;
+
+			// vertex layout: the stride of the format, every attribute inside it
+			if (h->attributeCount == 0 || h->attributeCount > 16 || h->vertexStride != vertexPacking::vertexSize(format))
+				return false;
+			const VertexAttribute * attributes = reinterpret_cast<const VertexAttribute *>(reinterpret_cast<const char *>(h) + sizeof(Header));
+			for (unsigned int a = 0; a < h->attributeCount; ++a)
+			{
+				const unsigned int attributeBytes = vertexPacking::attributeSize(attributes[a]);
+				if (attributeBytes == 0 || attributeBytes > h->vertexStride || attributes[a].offset > h->vertexStride - attributeBytes || attributes[a].location >= 16)
+					return false;
+			}
+
+			// LOD chain: whole triangles of the index data, at most one level per ratio besides the full resolution
+			if (h->lodCount != 0 && (h->indexCount == 0 || h->lodCount > h->lodRatioCount + 1))
+				return false;
+			const LevelOfDetail * lods = reinterpret_cast<const LevelOfDetail *>(attributes + h->attributeCount);
+			for (unsigned int l = 0; l < h->lodCount; ++l)
+				if (lods[l].indexCount % 3 != 0 || lods[l].firstIndex > h->indexCount || lods[l].indexCount > h->indexCount - lods[l].firstIndex)
+					return false;
+
+			// indices: inside the vertex data (the GPU would read past the VBO)
+			const unsigned int * indices = reinterpret_cast<const unsigned int *>(reinterpret_cast<const char *>(h) + h->indexOffset);
+			for (unsigned int i = 0; i < h->indexCount; ++i)
+				if (indices[i] >= h->vertexCount)
+					return false;
+			return true;
+		}
+
+		//! read-only mapping of the cache file
+		parser::MappedFile file;
+		//! header of the mapped file, NULL until validated
+		const Header * header;
+	};
+}
+
+/*@}*/
+
+}
+
+#endif
\ No newline at end of file
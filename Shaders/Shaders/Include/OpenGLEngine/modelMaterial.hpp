@@ -161,6 +161,31 @@ public:
 	* \return returns a pointer to currently used Shader
 	*/
 	Shader * getShader();
+	/*!
+	*	\brief returns the Texture list (the n-th texture is bound to GL_TEXTUREn)
+	*/
+	const std::vector<Texture *> & getTextures() const
+	{
+		return textures;
+	}
+	/*!
+	*	\brief returns the Uniform map, by name
+	*/
+	const std::unordered_map<std::string, Uniform *> & getUniforms() const
+	{
+		return uniforms;
+	}
+	/*!
+	*	\brief returns the Uniform of a given name
+	*
+	* \param const std::string name : uniform name
+	* \return NULL if the material has no such Uniform
+	*/
+	Uniform * getUniform(const std::string name)
+	{
+		std::unordered_map<std::string, Uniform *>::iterator it = uniforms.find(name);
+		return it != uniforms.end() ? it->second : NULL;
+	}
 	
 
 
@@ -190,6 +215,30 @@ public:
 	*	- link Texture
 	*/
 	void bindMaterial(Shader * shader);
+	/*!
+	*	\brief Links the Uniforms only (half of bindMaterial): \n
+	*			lets a caller skip the texture binds when the previous draw used the same textures (cf RenderQueue)
+	*
+	* \param Shader * shader : shader in use
+	* \return links every Uniform to input shader, through its ProgramReflection (cf Uniform::linkCached)
+	*/
+	void linkUniforms(Shader * shader)
+	{
+		ProgramReflection & program = ProgramReflection::of(shader->Program);
+		for (std::unordered_map<std::string, Uniform *>::iterator it = uniforms.begin(); it != uniforms.end(); ++it)
+			it->second->linkCached(shader, program);
+	}
+	/*!
+	*	\brief Binds the Textures only (other half of bindMaterial), the n-th texture to GL_TEXTUREn
+	*
+	* \param Shader * shader : shader in use
+	* \return binds every Texture and sets its sampler in input shader, through the state cache (cf Texture::bindCached)
+	*/
+	void bindTextures(Shader * shader)
+	{
+		for (size_t i = 0; i < textures.size(); ++i)
+			textures[i]->bindCached(static_cast<GLuint>(i), shader);
+	}
 
 	/*!
 	*	\brief set texture to previous state
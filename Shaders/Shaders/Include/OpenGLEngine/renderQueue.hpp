@@ -0,0 +1,613 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+#include <glm\gtc\type_ptr.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "mesh.hpp"
+#include "uniformBlocks.hpp"
+#include "compiledMaterial.hpp"
+#include "glState.hpp"
+#include "jobSystem.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file renderQueue.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SCENE */
+/*@{*/
+
+
+/*!
+*  \brief Per frame submission counters of a RenderQueue \n
+*		"skipped" counts the binds a mesh by mesh submission would have made
+*/
+struct RenderStats
+{
+	unsigned int draws = 0; /**< draw calls */
+	unsigned int objects = 0; /**< meshes drawn (several per call with multi-draw indirect, cf IndirectRenderer) */
+	unsigned int programBinds = 0; /**< glUseProgram + default uniforms (cf Scene::linkDefaultUniforms) */
+	unsigned int programBindsSkipped = 0;
+	unsigned int textureBinds = 0; /**< texture units bound */
+	unsigned int textureBindsSkipped = 0;
+	unsigned int materialBinds = 0; /**< materials whose uniforms were linked */
+	unsigned int materialBindsSkipped = 0;
+
+	//! adds the counters of another submission
+	RenderStats & operator+=(const RenderStats & other)
+	{
+		draws += other.draws;
+		objects += other.objects;
+		programBinds += other.programBinds;
+		programBindsSkipped += other.programBindsSkipped;
+		textureBinds += other.textureBinds;
+		textureBindsSkipped += other.textureBindsSkipped;
+		materialBinds += other.materialBinds;
+		materialBindsSkipped += other.materialBindsSkipped;
+		return *this;
+	}
+};
+
+
+/*!
+*  \brief Render Queue: \n
+*		Draws are pushed in any order with a 64 bit sort key, radix sorted, then submitted so that \n
+*		consecutive draws sharing a shader program, a texture set or a material do not bind them again \n
+*
+*		key, from the most significant bits: \n
+*			- pass (4 bits): passes are submitted in increasing order \n
+*			- shader program (12 bits) \n
+*			- texture set (12 bits): materials binding the same texture IDs \n
+*			- material (16 bits) \n
+*			- depth (20 bits): front to back within a material \n
+*		Key fields only drive the order: submission compares the actual program, textures and material, \n
+*		so ids wrapping around their bit width cost binds, never correctness. Ids are given to a material when it is \n
+*		compiled, and kept across frames \n
+*
+*		Draws are either pushed on the GL thread (push, then sort), or recorded by several threads at once into \n
+*		per thread command buffers (beginRecording, record, endRecording): each buffer is sorted on its own thread, \n
+*		then the sorted runs are merged. A recorded mesh whose material is not compiled yet is pushed by endRecording
+*
+*	\code{.cpp}
+*		queue.clear();
+*		for (...)
+*			queue.push(&mesh, distance / farPlane);
+*		queue.sort();
+*		queue.submit([&](Shader * shader) { scene.linkDefaultUniforms(shader, &camera, &window); });
+*		const RenderStats & stats = queue.getStats();
+*
+*		queue.beginRecording(jobs.getThreadCount());
+*		jobs.parallelFor(meshes.size(), 256, [&](size_t first, size_t last, unsigned int thread) {
+*			for (size_t i = first; i < last; ++i)
+*				queue.record(thread, meshes[i], distance(i) / farPlane);
+*		});
+*		queue.endRecording(); // sorted
+*	\endcode
+*
+*	\note materials are bound in their compiled form (cf CompiledMaterial): built the first time a material is pushed, kept \n
+*		across frames, synced with its Uniform values once per frame, and built again if the material was edited. \n
+*		Per draw, modelMatrix is the one set by the program callback, translated to the mesh world space position. \n
+*		With UniformBlocks, programs reading ObjectUniforms skip the callback: every draw gets its own object record, \n
+*		sent in one upload before the first draw and bound by offset (the records are filled by the JobSystem)
+*/
+class RenderQueue
+{
+public:
+	static const unsigned int PASS_BITS = 4;
+	static const unsigned int PROGRAM_BITS = 12;
+	static const unsigned int TEXTURE_SET_BITS = 12;
+	static const unsigned int MATERIAL_BITS = 16;
+	static const unsigned int DEPTH_BITS = 20;
+	//! object records computed per job in submit
+	static const size_t OBJECTS_PER_JOB = 512;
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Returns the counters of the last submit()
+	*/
+	const RenderStats & getStats() const
+	{
+		return stats;
+	}
+	/*!
+	*  \brief Returns the number of draws pushed since clear()
+	*/
+	size_t size() const
+	{
+		return draws.size();
+	}
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Empties the queue for a new frame (allocations are kept): materials are synced again on their first draw
+	*/
+	void clear()
+	{
+		draws.clear();
+		keys.clear();
+		for (size_t t = 0; t < commandBuffers.size(); ++t)
+			commandBuffers[t]->clear();
+		++frame;
+	}
+
+	/*!
+	*  \brief Drops the compiled materials (e.g. once their meshes are destroyed): they are built again on next use
+	*/
+	void releaseMaterials()
+	{
+		materialRecords.clear();
+	}
+
+	/*!
+	*  \brief Queues a mesh, drawn with its material
+	*
+	* \param Mesh * mesh : mesh to draw (has to stay alive until submit)
+	* \param float depth : normalized view distance in [0, 1] (e.g. distance / far plane)
+	* \param unsigned int pass : pass index, in [0, 16)
+	* \param unsigned int lod : level of detail of the mesh geometry (cf Geometry::drawGeometry)
+	*/
+	void push(Mesh * mesh, float depth, unsigned int pass = 0, unsigned int lod = 0)
+	{
+		push(mesh, mesh->getGeometry()->getRecord().get(), depth, pass, lod);
+	}
+	/*!
+	*  \brief Queues a mesh with the record of its geometry, resolved by the caller (cf SceneRenderer): submit does no registry lookup
+	*
+	* \param const GeometryRecord * geometry : record of the mesh geometry (cf Geometry::getRecord), alive until submit
+	*/
+	void push(Mesh * mesh, const GeometryRecord * geometry, float depth, unsigned int pass = 0, unsigned int lod = 0)
+	{
+		append(mesh, geometry, compile(mesh->getMaterial()), depth, pass, lod, &draws, &keys);
+	}
+
+	/*!
+	*  \brief Starts recording draws from several threads (after clear)
+	* \param unsigned int nbThreads : number of threads calling record (e.g. JobSystem::getThreadCount)
+	*/
+	void beginRecording(unsigned int nbThreads)
+	{
+		while (commandBuffers.size() < nbThreads)
+			commandBuffers.push_back(std::unique_ptr<CommandBuffer>(new CommandBuffer()));
+	}
+
+	/*!
+	*  \brief Queues a mesh from a recording thread: no OpenGL call, no lock \n
+	*		the material is looked up among the compiled ones (and synced by the first thread drawing it this frame); \n
+	*		a material that is not compiled, or was edited, is left to endRecording
+	*
+	* \param unsigned int thread : index of the calling thread, in [0, nbThreads) (cf beginRecording), one thread per index at a time
+	* \param Mesh * mesh : mesh to draw (has to stay alive until submit)
+	* \param const GeometryRecord * geometry : record of the mesh geometry, resolved on the GL thread (cf Geometry::getRecord), alive until submit
+	* \param float depth : normalized view distance in [0, 1]
+	* \param unsigned int pass : pass index, in [0, 16)
+	* \param unsigned int lod : level of detail of the mesh geometry
+	*/
+	void record(unsigned int thread, Mesh * mesh, const GeometryRecord * geometry, float depth, unsigned int pass = 0, unsigned int lod = 0)
+	{
+		CommandBuffer & buffer = *commandBuffers[thread];
+		Material * material = mesh->getMaterial();
+		std::unordered_map<Material *, std::unique_ptr<MaterialRecord> >::const_iterator found = materialRecords.find(material);
+		if (found == materialRecords.end() || !found->second->compiled->matches(material))
+		{
+			PendingDraw pending;
+			pending.mesh = mesh;
+			pending.geometry = geometry;
+			pending.depth = depth;
+			pending.pass = pass;
+			pending.lod = lod;
+			buffer.pending.push_back(pending);
+			return;
+		}
+
+		MaterialRecord * materialRecord = found->second.get();
+		if (materialRecord->syncedFrame.exchange(frame) != frame)
+			materialRecord->compiled->sync();
+		append(mesh, geometry, materialRecord, depth, pass, lod, &buffer.draws, &buffer.keys);
+	}
+
+	/*!
+	*  \brief Ends a recording (on the GL thread): compiles the materials left by record and pushes their draws, \n
+	*		sorts every command buffer on the JobSystem, then merges them with the pushed draws
+	* \return the queue is sorted (no sort() needed)
+	*/
+	void endRecording()
+	{
+		for (size_t t = 0; t < commandBuffers.size(); ++t)
+		{
+			const std::vector<PendingDraw> & pending = commandBuffers[t]->pending;
+			for (size_t i = 0; i < pending.size(); ++i)
+				push(pending[i].mesh, pending[i].geometry, pending[i].depth, pending[i].pass, pending[i].lod);
+		}
+
+		// run 0: the pushed draws, then one run per command buffer
+		JobSystem & jobs = JobSystem::get();
+		jobs.parallelFor(commandBuffers.size() + 1, 1, [&](size_t first, size_t last, unsigned int) {
+			for (size_t b = first; b < last; ++b)
+			{
+				if (b == 0)
+					radixSort(&keys, &scratch);
+				else
+					radixSort(&commandBuffers[b - 1]->keys, &commandBuffers[b - 1]->scratch);
+			}
+		});
+
+		runs.assign(1, 0);
+		runs.push_back(keys.size());
+		for (size_t t = 0; t < commandBuffers.size(); ++t)
+		{
+			const CommandBuffer & buffer = *commandBuffers[t];
+			if (buffer.keys.empty())
+				continue;
+			const unsigned int offset = static_cast<unsigned int>(draws.size());
+			draws.insert(draws.end(), buffer.draws.begin(), buffer.draws.end());
+			for (size_t k = 0; k < buffer.keys.size(); ++k)
+			{
+				SortKey key = buffer.keys[k];
+				key.draw += offset;
+				keys.push_back(key);
+			}
+			runs.push_back(keys.size());
+		}
+
+		// pairs of neighbouring runs are merged in parallel, until one run is left
+		while (runs.size() > 2)
+		{
+			scratch.resize(keys.size());
+			const size_t nbRuns = runs.size() - 1;
+			jobs.parallelFor((nbRuns + 1) / 2, 1, [&](size_t first, size_t last, unsigned int) {
+				for (size_t p = first; p < last; ++p)
+				{
+					const size_t begin = runs[2 * p];
+					const size_t middle = runs[2 * p + 1];
+					const size_t end = 2 * p + 2 < runs.size() ? runs[2 * p + 2] : middle;
+					std::merge(keys.begin() + begin, keys.begin() + middle, keys.begin() + middle, keys.begin() + end, scratch.begin() + begin, lessKey);
+				}
+			});
+			keys.swap(scratch);
+			size_t merged = 0;
+			for (size_t r = 0; r < runs.size(); r += 2)
+				runs[merged++] = runs[r];
+			if (runs[merged - 1] != keys.size())
+				runs[merged++] = keys.size();
+			runs.resize(merged);
+		}
+	}
+
+	/*!
+	*  \brief Sorts the queued draws on their keys: LSD radix sort, 8 bits per pass \n
+	*		passes where every key has the same digit are skipped (e.g. the pass bits of a single pass frame)
+	*/
+	void sort()
+	{
+		radixSort(&keys, &scratch);
+	}
+
+	/*!
+	*  \brief Draws the queue in key order, binding only what changes from one draw to the next: \n
+	*			- program: glUseProgram, then linkDefaults (view/projection/model matrices, once per program and frame), \n
+	*			  or its uniform blocks if it reads ObjectUniforms \n
+	*			- material: its parameters (CompiledMaterial::bindParameters) \n
+	*			- texture set: its textures (CompiledMaterial::bindTextures), again after every program change (samplers are program state) \n
+	*			- modelMatrix, translated to the mesh world space position and times the geometry's dequantization (VERTEX_FORMAT_QUANTIZED), \n
+	*			  as glUniformMatrix4fv or the draw's object record, and the geometry draw call. \n
+	*			  Normals are packed in object space, not quantized: normalMatrix stays the default one
+	*
+	* \param std::function<void(Shader *)> linkDefaults : links the default uniforms of a program (cf Scene::linkDefaultUniforms)
+	* \param UniformBlocks * blocks : uniform blocks of the frame (cf UniformBlocks::setFrame), NULL => plain uniforms only
+	* \return draws every queued mesh, updates getStats()
+	*/
+	void submit(std::function<void(Shader *)> linkDefaults, UniformBlocks * blocks = NULL)
+	{
+		stats = RenderStats();
+
+		// one object record per draw, in submission order, computed on the JobSystem
+		size_t firstObject = 0;
+		if (blocks != NULL && !keys.empty())
+		{
+			const ObjectUniforms defaultObject = blocks->getDefaultObject();
+			firstObject = blocks->reserveObjects(keys.size());
+			JobSystem::get().parallelFor(keys.size(), OBJECTS_PER_JOB, [&](size_t first, size_t last, unsigned int) {
+				ObjectUniforms object = defaultObject;
+				for (size_t k = first; k < last; ++k)
+				{
+					const Draw & draw = draws[keys[k].draw];
+					object.modelMatrix = glm::translate(glm::mat4(1.0f), draw.mesh->getWorldSpacePosition()) * defaultObject.modelMatrix * draw.geometry->getDequantizationMatrix();
+					blocks->writeObject(firstObject + k, object);
+				}
+			});
+			blocks->uploadObjects();
+		}
+
+		Shader * shader = NULL;
+		Material * material = NULL;
+		unsigned int textureSet = 0;
+		bool texturesBound = false;
+		bool objectBlock = false;
+		GLint modelLocation = -1;
+		static const unsigned int modelSlot = ProgramReflection::slotOf("modelMatrix");
+		glm::mat4 defaultModel(1.0f);
+		GLState & state = GLState::get();
+
+		for (size_t k = 0; k < keys.size(); ++k)
+		{
+			const Draw & draw = draws[keys[k].draw];
+			const size_t nbTextures = draw.compiled->getTextureCount();
+			++stats.draws;
+			++stats.objects;
+
+			if (shader == NULL || draw.shader->Program != shader->Program)
+			{
+				shader = draw.shader;
+				state.useProgram(shader->Program);
+				objectBlock = blocks != NULL && blocks->bindProgram(shader);
+				modelLocation = -1;
+				if (!objectBlock)
+				{
+					linkDefaults(shader);
+					modelLocation = ProgramReflection::of(shader->Program).location(modelSlot);
+					if (modelLocation >= 0)
+						glGetUniformfv(shader->Program, modelLocation, glm::value_ptr(defaultModel));
+				}
+				material = NULL;
+				texturesBound = false;
+				++stats.programBinds;
+			}
+			else
+				++stats.programBindsSkipped;
+
+			if (draw.material != material)
+			{
+				draw.compiled->bindParameters();
+				material = draw.material;
+				++stats.materialBinds;
+			}
+			else
+				++stats.materialBindsSkipped;
+
+			if (!texturesBound || draw.textureSet != textureSet)
+			{
+				draw.compiled->bindTextures();
+				textureSet = draw.textureSet;
+				texturesBound = true;
+				stats.textureBinds += static_cast<unsigned int>(nbTextures);
+			}
+			else
+				stats.textureBindsSkipped += static_cast<unsigned int>(nbTextures);
+
+			if (objectBlock)
+				blocks->bindObject(firstObject + k);
+			else if (modelLocation >= 0)
+			{
+				const glm::mat4 model = glm::translate(glm::mat4(1.0f), draw.mesh->getWorldSpacePosition()) * defaultModel * draw.geometry->getDequantizationMatrix();
+				glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+			}
+			draw.geometry->draw(draw.lod);
+		}
+
+		if (material != NULL)
+		{
+			material->unbindMaterial();
+			state.invalidateTextures();
+		}
+	}
+
+
+private:
+	/*!
+	*  \brief One queued draw
+	*/
+	struct Draw
+	{
+		Mesh * mesh;
+		const GeometryRecord * geometry; /**< resolved when queued: no registry lookup in submit */
+		Material * material;
+		CompiledMaterial * compiled;
+		Shader * shader;
+		unsigned int textureSet;
+		unsigned int lod;
+	};
+	/*!
+	*  \brief Sort key of a draw (index in draws)
+	*/
+	struct SortKey
+	{
+		unsigned long long key;
+		unsigned int draw;
+	};
+	/*!
+	*  \brief Compiled form of a material and its key ids, kept across frames
+	*/
+	struct MaterialRecord
+	{
+		std::unique_ptr<CompiledMaterial> compiled;
+		unsigned int program = 0;
+		unsigned int textureSet = 0;
+		unsigned int material = 0;
+		//! last frame the compiled form was synced (claimed by the first thread drawing it)
+		std::atomic<unsigned int> syncedFrame;
+
+		MaterialRecord() : syncedFrame(0)
+		{}
+	};
+	/*!
+	*  \brief Draw recorded with a material that is not compiled (cf endRecording)
+	*/
+	struct PendingDraw
+	{
+		Mesh * mesh;
+		const GeometryRecord * geometry;
+		float depth;
+		unsigned int pass;
+		unsigned int lod;
+	};
+	/*!
+	*  \brief Draws recorded by one thread (cf record)
+	*/
+	struct CommandBuffer
+	{
+		std::vector<Draw> draws;
+		std::vector<SortKey> keys;
+		std::vector<SortKey> scratch;
+		std::vector<PendingDraw> pending;
+
+		void clear()
+		{
+			draws.clear();
+			keys.clear();
+			pending.clear();
+		}
+	};
+
+	std::vector<Draw> draws;
+	std::vector<SortKey> keys;
+	std::vector<SortKey> scratch;
+	std::vector<std::unique_ptr<CommandBuffer> > commandBuffers;
+	//! bounds of the sorted runs merged by endRecording
+	std::vector<size_t> runs;
+
+	//! compiled form of every material pushed so far, ids in order of first compilation
+	std::unordered_map<Material *, std::unique_ptr<MaterialRecord> > materialRecords;
+	std::unordered_map<GLuint, unsigned int> programs;
+	std::map<std::vector<unsigned int>, unsigned int> textureSets;
+	unsigned int frame = 1;
+
+	/*!
+	*  \brief Returns the record of a material (GL thread): compiled on first use or if it was edited, synced once per frame
+	*/
+	MaterialRecord * compile(Material * material)
+	{
+		std::unique_ptr<MaterialRecord> & materialRecord = materialRecords[material];
+		if (!materialRecord)
+		{
+			materialRecord.reset(new MaterialRecord());
+			materialRecord->material = static_cast<unsigned int>(materialRecords.size() - 1);
+		}
+		if (!materialRecord->compiled || !materialRecord->compiled->matches(material))
+		{
+			materialRecord->compiled.reset(new CompiledMaterial(material));
+			materialRecord->program = programs.insert(std::make_pair(material->getShader()->Program, static_cast<unsigned int>(programs.size()))).first->second;
+
+			std::vector<unsigned int> textureIDs;
+			const std::vector<Texture *> & textures = material->getTextures();
+			for (size_t i = 0; i < textures.size(); ++i)
+				textureIDs.push_back(textures[i]->ID);
+			materialRecord->textureSet = textureSets.insert(std::make_pair(textureIDs, static_cast<unsigned int>(textureSets.size()))).first->second;
+			materialRecord->syncedFrame = frame;
+		}
+		else if (materialRecord->syncedFrame.exchange(frame) != frame)
+			materialRecord->compiled->sync();
+		return materialRecord.get();
+	}
+
+	/*!
+	*  \brief Appends a draw and its sort key
+	*/
+	static void append(Mesh * mesh, const GeometryRecord * geometry, const MaterialRecord * materialRecord, float depth, unsigned int pass, unsigned int lod, std::vector<Draw> * drawList, std::vector<SortKey> * keyList)
+	{
+		Draw draw;
+		draw.mesh = mesh;
+		draw.geometry = geometry;
+		draw.material = mesh->getMaterial();
+		draw.shader = draw.material->getShader();
+		draw.compiled = materialRecord->compiled.get();
+		draw.textureSet = materialRecord->textureSet;
+		draw.lod = lod;
+
+		const float d = std::min(std::max(depth, 0.0f), 1.0f);
+		const unsigned long long depthBits = static_cast<unsigned long long>(d * static_cast<float>((1 << DEPTH_BITS) - 1));
+
+		SortKey key;
+		key.key = (static_cast<unsigned long long>(pass & ((1 << PASS_BITS) - 1)) << (PROGRAM_BITS + TEXTURE_SET_BITS + MATERIAL_BITS + DEPTH_BITS)) |
+			(static_cast<unsigned long long>(materialRecord->program & ((1 << PROGRAM_BITS) - 1)) << (TEXTURE_SET_BITS + MATERIAL_BITS + DEPTH_BITS)) |
+			(static_cast<unsigned long long>(materialRecord->textureSet & ((1 << TEXTURE_SET_BITS) - 1)) << (MATERIAL_BITS + DEPTH_BITS)) |
+			(static_cast<unsigned long long>(materialRecord->material & ((1 << MATERIAL_BITS) - 1)) << DEPTH_BITS) |
+			depthBits;
+		key.draw = static_cast<unsigned int>(drawList->size());
+
+		drawList->push_back(draw);
+		keyList->push_back(key);
+	}
+
+	static bool lessKey(const SortKey & a, const SortKey & b)
+	{
+		return a.key < b.key;
+	}
+
+	/*!
+	*  \brief Sorts keys: LSD radix sort, 8 bits per pass \n
+	*		passes where every key has the same digit are skipped (e.g. the pass bits of a single pass frame)
+	*/
+	static void radixSort(std::vector<SortKey> * keyList, std::vector<SortKey> * scratchList)
+	{
+		const size_t n = keyList->size();
+		if (n < 2)
+			return;
+
+		scratchList->resize(n);
+		SortKey * source = &(*keyList)[0];
+		SortKey * destination = &(*scratchList)[0];
+		for (unsigned int shift = 0; shift < 64; shift += 8)
+		{
+			size_t offsets[256] = { 0 };
+			for (size_t i = 0; i < n; ++i)
+				++offsets[(source[i].key >> shift) & 0xFF];
+			if (offsets[(source[0].key >> shift) & 0xFF] == n)
+				continue;
+
+			size_t sum = 0;
+			for (unsigned int digit = 0; digit < 256; ++digit)
+			{
+				const size_t count = offsets[digit];
+				offsets[digit] = sum;
+				sum += count;
+			}
+			for (size_t i = 0; i < n; ++i)
+				destination[offsets[(source[i].key >> shift) & 0xFF]++] = source[i];
+			std::swap(source, destination);
+		}
+		if (source != &(*keyList)[0])
+			keyList->swap(*scratchList);
+	}
+
+	RenderStats stats;
+};
+
+/*@}*/
+
+}
+
+#endif
@@ -13,6 +13,18 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <future>
+#include <algorithm>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "programCache.hpp"
+#include "programReflection.hpp"
+#include "glState.hpp"
 
 
 namespace OpenGLEngine
@@ -33,6 +45,113 @@ namespace OpenGLEngine
 /** @addtogroup SHADER */
 /*@{*/
 
+class ShaderBatch;
+
+/*!
+*  \brief Preprocessor definitions of a program: name => value, sorted by name (cf Shader, ShaderPermutations)
+*/
+typedef std::map<std::string, std::string> ShaderDefines;
+
+/*!
+*  \brief ShaderBuild: \n
+*		How a program is built: its stages and definitions, and the state of a build started without waiting for the driver \n
+*		(cf Shader::beginBuild, Shader::endBuild). Kept out of Shader (cf ShaderRegistry): the engine library copies Shaders by value \n
+*		(Material, Mesh::getShader), a Shader has to stay a single program name
+*/
+struct ShaderBuild
+{
+	//! type, path and source of every stage (kept to rebuild the program, and to key its binary cache)
+	struct Stage
+	{
+		GLenum type;
+		std::string path;
+		std::string source;
+	};
+	std::vector<Stage> stages;
+	//! definitions added to every stage (cf Shader::specialize)
+	ShaderDefines defines;
+
+	bool queued = false; /**< in a ShaderBatch, not submitted yet */
+	bool submitted = false; /**< compiled and linked, status not checked yet */
+	std::vector<GLuint> shaders; /**< compiled stages of a submitted build */
+	bool cached = false; /**< the binary is saved by endBuild (cf programCache) */
+	std::string cachePath;
+	unsigned long long key = 0;
+};
+
+
+/*!
+*  \brief ShaderRegistry: \n
+*		ShaderBuild of every program, by program name. Shaders copied from one another share it
+*
+*	\note one registry per process, used on the GL thread only
+*/
+class ShaderRegistry
+{
+public:
+	/*!
+	*  \brief Returns the registry
+	*/
+	static ShaderRegistry & get()
+	{
+		static ShaderRegistry registry;
+		return registry;
+	}
+
+	/*!
+	*  \brief Returns the build of a program
+	* \return NULL if there is none (programs created by the engine library, or by the default Shader constructor)
+	*/
+	ShaderBuild * find(GLuint program)
+	{
+		std::unordered_map<GLuint, ShaderBuild>::iterator it = builds.find(program);
+		return it != builds.end() ? &it->second : NULL;
+	}
+	/*!
+	*  \brief Starts an empty build for a name just returned by glCreateProgram (the build of a deleted program of the same name is dropped)
+	* \return build, valid until the name is reset again
+	*/
+	ShaderBuild * reset(GLuint program)
+	{
+		ShaderBuild & build = builds[program];
+		nbPending -= (build.queued ? 1 : 0) + (build.submitted ? 1 : 0);
+		build = ShaderBuild();
+		return &build;
+	}
+	/*!
+	*  \brief Marks a build queued in a ShaderBatch, or not anymore
+	*/
+	void setQueued(ShaderBuild * build, bool queued)
+	{
+		nbPending += (queued ? 1 : 0) - (build->queued ? 1 : 0);
+		build->queued = queued;
+	}
+	/*!
+	*  \brief Marks a build submitted to the driver, or finished
+	*/
+	void setSubmitted(ShaderBuild * build, bool submitted)
+	{
+		nbPending += (submitted ? 1 : 0) - (build->submitted ? 1 : 0);
+		build->submitted = submitted;
+	}
+	/*!
+	*  \brief Returns the number of builds queued or submitted, and not finished (cf Shader::wait: nothing to look up when there is none)
+	*/
+	size_t getPendingCount() const
+	{
+		return nbPending;
+	}
+
+private:
+	std::unordered_map<GLuint, ShaderBuild> builds;
+	size_t nbPending = 0;
+
+	ShaderRegistry() {}
+	ShaderRegistry(const ShaderRegistry &);
+	ShaderRegistry & operator=(const ShaderRegistry &);
+};
+
+
 /*!
 *  \brief  Shader Wrapper: utility class for shader loading and linking. \n
 *
@@ -119,7 +238,7 @@ public :
 			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
 		}
 		// Shader Program
-		this->Program = glCreateProgram();
+		createProgram();
 		glAttachShader(this->Program, vertex);
 		glAttachShader(this->Program, fragment);
 		glLinkProgram(this->Program);
@@ -144,84 +263,43 @@ public :
 	*
 	* \param const char * vertexPath : string representing to input vertex shader (must end in .vert)
 	* \param const char * fragmentPath : string representing to input fragment shader (must end in .frag)
-	* \return shader created, built and linked
+	* \return shader created, built and linked \n
+	*		(or reloaded from the binary saved by a previous run with the same sources and driver, cf programCache)
 	*
 	*/
 	Shader(const char* vertexPath, const char* fragmentPath)
 	{
-		// 1. Retrieve the vertex/fragment source code from filePath
-		std::string vertexCode;
-		std::string fragmentCode;
-		std::ifstream vShaderFile;
-		std::ifstream fShaderFile;
-		// ensures ifstream objects can throw exceptions:
-		vShaderFile.exceptions(std::ifstream::badbit);
-		fShaderFile.exceptions(std::ifstream::badbit);
-		try
-		{
-			// Open files
-			vShaderFile.open(vertexPath);
-			fShaderFile.open(fragmentPath);
-			std::stringstream vShaderStream, fShaderStream;
-			// Read file's buffer contents into streams
-			vShaderStream << vShaderFile.rdbuf();
-			fShaderStream << fShaderFile.rdbuf();
-			// close file handlers
-			vShaderFile.close();
-			fShaderFile.close();
-			// Convert stream into string
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
-		}
-		catch (std::ifstream::failure e)
-		{
-			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-		}
-		const GLchar * vShaderCode = vertexCode.c_str();
-		const GLchar * fShaderCode = fragmentCode.c_str();
-		// 2. Compile shaders
-		GLuint vertex, fragment;
-		GLint success;
-		GLchar infoLog[512];
-		// Vertex Shader
-		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &vShaderCode, NULL);
-		glCompileShader(vertex);
-		// Print compile errors if any
-		glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-		if (!success)
-		{
-			glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-		}
-		// Fragment Shader
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-		// Print compile errors if any
-		glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-		if (!success)
-		{
-			glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-		}
-		// Shader Program
-		this->Program = glCreateProgram();
-		glAttachShader(this->Program, vertex);
-		glAttachShader(this->Program, fragment);
-		glLinkProgram(this->Program);
-		// Print linking errors if any
-		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
-		if (!success)
-		{
-			glGetProgramInfoLog(this->Program, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-		}
-		// Delete the shaders as they're linked into our program now and no longer necessery
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+		createProgram();
+		addStage(GL_VERTEX_SHADER, vertexPath);
+		addStage(GL_FRAGMENT_SHADER, fragmentPath);
+		build();
 	}
 
+	/*!
+	*  \brief Deferred constructor: \n
+	*		the sources are read in the background, and compiled along with every other program of the batch (cf ShaderBatch)
+	*
+	* \param const char * vertexPath : string representing to input vertex shader (must end in .vert)
+	* \param const char * fragmentPath : string representing to input fragment shader (must end in .frag)
+	* \param ShaderBatch * batch : batch compiling the program (NULL => built at once, as the constructor above)
+	* \return Program is created, but not linked before batch->submit(), nor checked before isReady() returns true or wait()
+	*
+	*/
+	Shader(const char* vertexPath, const char* fragmentPath, ShaderBatch * batch);
+
+	/*!
+	*  \brief Specialized constructor: \n
+	*		every stage is compiled with #define NAME VALUE for each entry, inserted after its #version line
+	*
+	* \param const char * vertexPath : string representing to input vertex shader (must end in .vert)
+	* \param const char * fragmentPath : string representing to input fragment shader (must end in .frag)
+	* \param const ShaderDefines & defines : definitions of this permutation (e.g. SSAO_SAMPLES => 16)
+	* \param ShaderBatch * batch : batch compiling the program (NULL => built at once)
+	* \return shader created, built and linked (or deferred, as above). Each permutation has its own program binary cache
+	*
+	*/
+	Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines & defines, ShaderBatch * batch = NULL);
+
 	/*!
 	*  \brief Copy Constructor : \n
 	*		swaps shader Program ID
@@ -229,6 +307,8 @@ public :
 	* \param Shader * shader : input shader
 	* \return current shader now points to the same OpenGL shader ID
 	*
+	* \note both share the build of the program (cf ShaderRegistry): a copy of a shader queued in a ShaderBatch, \n
+	*		or still compiling, becomes ready along with it
 	*/
 	Shader(Shader * shader)
 	{
@@ -239,6 +319,52 @@ public :
 	///////////////////////////////////////////
 	//	GETTERS
 	///////////////////////////////////////////
+	/*!
+	*	\brief Returns the preprocessor definitions the program is compiled with
+	*/
+	const ShaderDefines & getDefines() const
+	{
+		static const ShaderDefines none;
+		const ShaderBuild * build = ShaderRegistry::get().find(this->Program);
+		return build != NULL ? build->defines : none;
+	}
+	/*!
+	*	\brief Returns true once the program is compiled and linked, without waiting for it
+	*
+	* \return false until its ShaderBatch is submitted. With parallel shader compile, polls the driver \n
+	*		(GL_COMPLETION_STATUS_KHR) and finishes the build once it is done; without it, finishes the build (the driver may block)
+	*/
+	bool isReady()
+	{
+		const ShaderBuild * build = ShaderRegistry::get().getPendingCount() != 0 ? ShaderRegistry::get().find(this->Program) : NULL;
+		if (build == NULL || !build->submitted)
+			return build == NULL || !build->queued;
+		if (hasParallelCompile())
+		{
+			GLint done = GL_TRUE;
+			glGetProgramiv(this->Program, COMPLETION_STATUS, &done);
+			if (!done)
+				return false;
+		}
+		endBuild();
+		return true;
+	}
+	/*!
+	*	\brief Returns true if the driver compiles and links in the background, and tells when it is done \n
+	*		(GL_KHR_parallel_shader_compile, or GL_ARB_parallel_shader_compile with older GLEW headers)
+	*/
+	static bool hasParallelCompile()
+	{
+#if defined(GL_KHR_parallel_shader_compile)
+		return GLEW_KHR_parallel_shader_compile != GL_FALSE;
+#elif defined(GL_ARB_parallel_shader_compile)
+		return GLEW_ARB_parallel_shader_compile != GL_FALSE;
+#else
+		return false;
+#endif
+	}
+	//! GL_COMPLETION_STATUS_KHR (same value as GL_COMPLETION_STATUS_ARB)
+	static const GLenum COMPLETION_STATUS = 0x91B1;
 
 
 	///////////////////////////////////////////
@@ -252,11 +378,22 @@ public :
 	/*!
 	*	\brief Use shader program
 	*
-	* \note glUse associated shader programm
+	* \note glUse associated shader programm, through the state cache (cf GLState::useProgram)
 	*/
 	void Use() 
 	{ 
-		glUseProgram(this->Program); 
+		wait();
+		GLState::get().useProgram(this->Program); 
+	}
+	/*!
+	*	\brief Waits until the program is linked, then reports its compilation and link errors (cf ShaderBatch)
+	*
+	* \note returns at once for the programs built by the other constructors, or already finished (no lookup once every build is)
+	*/
+	void wait()
+	{
+		if (ShaderRegistry::get().getPendingCount() != 0)
+			endBuild();
 	}
 
 
@@ -269,8 +406,380 @@ public:
 	/*! OpenGL ID for this shader's programm
 	*/
 	GLuint Program;
+
+private:
+	// stages, definitions and deferred build live in the ShaderRegistry: a Shader is its program name only
+	friend class ShaderBatch;
+
+	/*!
+	*	\brief Creates the program and its (empty) build: a new name may be the one of a deleted program
+	*/
+	void createProgram()
+	{
+		this->Program = glCreateProgram();
+		ProgramReflection::forget(this->Program);
+		ShaderRegistry::get().reset(this->Program);
+	}
+
+	/*!
+	*	\brief Reads a shader source (no OpenGL call: safe on any thread)
+	*/
+	static std::string readSource(const char * path)
+	{
+		std::string source;
+		std::ifstream shaderFile;
+		// ensures ifstream objects can throw exceptions:
+		shaderFile.exceptions(std::ifstream::badbit);
+		try
+		{
+			shaderFile.open(path);
+			std::stringstream shaderStream;
+			shaderStream << shaderFile.rdbuf();
+			shaderFile.close();
+			source = shaderStream.str();
+		}
+		catch (std::ifstream::failure e)
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+		}
+		return source;
+	}
+
+	/*!
+	*	\brief Adds a stage (compiled by the next build)
+	*/
+	void addStage(GLenum type, const char * path, const std::string & source)
+	{
+		ShaderBuild::Stage stage;
+		stage.type = type;
+		stage.path = path;
+		stage.source = source;
+		ShaderRegistry::get().find(this->Program)->stages.push_back(stage);
+	}
+	void addStage(GLenum type, const char * path)
+	{
+		addStage(type, path, readSource(path));
+	}
+
+	/*!
+	*	\brief Inserts the definitions after the #version line of a source (which has to stay first), \n
+	*		followed by a #line directive so that the error messages keep the line numbers of the file
+	*/
+	static std::string specialize(const std::string & source, const ShaderDefines & defines)
+	{
+		if (defines.empty())
+			return source;
+		size_t insert = 0;
+		const size_t version = source.find("#version");
+		if (version != std::string::npos)
+		{
+			insert = source.find('\n', version);
+			insert = insert == std::string::npos ? source.size() : insert + 1;
+		}
+		std::string block = insert != 0 && source[insert - 1] != '\n' ? "\n" : "";
+		for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); ++it)
+			block += "#define " + it->first + " " + it->second + "\n";
+		const long long nextLine = 1 + std::count(source.begin(), source.begin() + insert, '\n');
+		block += "#line " + std::to_string(nextLine) + "\n";
+		return source.substr(0, insert) + block + source.substr(insert);
+	}
+
+	/*!
+	*	\brief Name of a stage type, for the error messages
+	*/
+	static const char * stageName(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_VERTEX_SHADER: return "VERTEX";
+		case GL_FRAGMENT_SHADER: return "FRAGMENT";
+		case GL_GEOMETRY_SHADER: return "GEOMETRY";
+		case GL_TESS_CONTROL_SHADER: return "TESS_CONTROL";
+		case GL_TESS_EVALUATION_SHADER: return "TESS_EVALUATION";
+		default: return "UNKNOWN";
+		}
+	}
+
+	/*!
+	*	\brief Builds the program from every stage, and waits for it (beginBuild, endBuild)
+	*
+	* \return Program is linked, and keeps its id when rebuilt with more stages
+	*/
+	void build()
+	{
+		beginBuild();
+		endBuild();
+	}
+
+	/*!
+	*	\brief Starts building the program: \n
+	*		reloads the binary of a previous run if its key matches (cf programCache), \n
+	*		otherwise compiles the stages and links them without asking for their status: the driver is free to work in the background
+	*/
+	void beginBuild()
+	{
+		endBuild(); // a build still running is finished first (its shaders are released)
+		ShaderRegistry & registry = ShaderRegistry::get();
+		ShaderBuild & pending = *registry.find(this->Program);
+		const std::vector<ShaderBuild::Stage> & stages = pending.stages;
+		const ShaderDefines & defines = pending.defines;
+		// the program may be linked again (e.g. a stage was added): its uniforms may differ
+		ProgramReflection::forget(this->Program);
+		registry.setQueued(&pending, false);
+
+		std::vector<std::string> sources(stages.size());
+		for (size_t s = 0; s < stages.size(); ++s)
+			sources[s] = specialize(stages[s].source, defines);
+
+		// 1. Reload the binary saved by a previous run (same stage paths, defines, sources and driver)
+		pending.cached = programCache::enabled() && programCache::isSupported();
+		if (pending.cached)
+		{
+			unsigned long long identity = programCache::hash(NULL, 0);
+			pending.key = programCache::hash(programCache::driverString());
+			for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); ++it)
+				identity = programCache::hash(it->second, programCache::hash(it->first, identity));
+			for (size_t s = 0; s < stages.size(); ++s)
+			{
+				identity = programCache::hash(stages[s].path, identity);
+				pending.key = programCache::hash(&stages[s].type, sizeof(GLenum), pending.key);
+				pending.key = programCache::hash(sources[s], pending.key);
+			}
+			pending.cachePath = programCache::cachePath(stages[0].path, identity);
+			if (programCache::load(pending.cachePath, pending.key, this->Program))
+			{
+				++programCache::getStats().hits;
+				return;
+			}
+			++programCache::getStats().misses;
+		}
+
+		// 2. Compile shaders
+		pending.shaders.resize(stages.size());
+		for (size_t s = 0; s < stages.size(); ++s)
+		{
+			const GLchar * shaderCode = sources[s].c_str();
+			pending.shaders[s] = glCreateShader(stages[s].type);
+			glShaderSource(pending.shaders[s], 1, &shaderCode, NULL);
+			glCompileShader(pending.shaders[s]);
+		}
+		// Shader Program
+		if (pending.cached)
+			glProgramParameteri(this->Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		for (size_t s = 0; s < pending.shaders.size(); ++s)
+			glAttachShader(this->Program, pending.shaders[s]);
+		glLinkProgram(this->Program);
+		registry.setSubmitted(&pending, true);
+	}
+
+	/*!
+	*	\brief Finishes the build started by beginBuild: \n
+	*		prints the compilation and link errors, releases the shaders, and saves the binary for the next run
+	*
+	* \note the first status query waits for the driver if it is still compiling
+	*/
+	void endBuild()
+	{
+		ShaderRegistry & registry = ShaderRegistry::get();
+		ShaderBuild * build = registry.find(this->Program);
+		if (build == NULL || !build->submitted)
+			return;
+		ShaderBuild & pending = *build;
+		const std::vector<ShaderBuild::Stage> & stages = pending.stages;
+		registry.setSubmitted(&pending, false);
+
+		GLint success;
+		GLchar infoLog[512];
+		// Print compile errors if any
+		for (size_t s = 0; s < pending.shaders.size(); ++s)
+		{
+			glGetShaderiv(pending.shaders[s], GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(pending.shaders[s], 512, NULL, infoLog);
+				std::cout << "ERROR::SHADER::" << stageName(stages[s].type) << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+			}
+		}
+		// Print linking errors if any
+		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetProgramInfoLog(this->Program, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		}
+		// Detach and delete the shaders as they're linked into our program now and no longer necessery
+		for (size_t s = 0; s < pending.shaders.size(); ++s)
+		{
+			glDetachShader(this->Program, pending.shaders[s]);
+			glDeleteShader(pending.shaders[s]);
+		}
+		pending.shaders.clear();
+
+		// 3. Save the binary for the next run
+		if (pending.cached && success)
+			programCache::store(pending.cachePath, pending.key, this->Program);
+	}
 };
 
+// the engine library copies Shaders by value, inside Material and Mesh (cf ShaderBuild)
+static_assert(sizeof(Shader) == sizeof(GLuint), "Shader has to stay a single program name");
+
+
+/*!
+*  \brief Shader Batch: \n
+*		Compiles several programs together instead of one after the other: \n
+*		- the sources of every Shader constructed with the batch are read by background threads, while the caller loads other assets
+*		- submit() compiles every stage and links every program without asking for any status, so that the driver \n
+*		  does not serialize them (GL_KHR/ARB_parallel_shader_compile spreads them over its own threads when available)
+*		- each program then reports when it is ready (Shader::isReady), and is checked only when it is needed (Shader::wait, Shader::Use)
+*
+*	\code{.cpp}
+*		ShaderBatch batch;
+*		Shader pbrShader("pbr.vert", "pbr.frag", &batch);
+*		Shader skyboxShader("skybox.vert", "skybox.frag", &batch);
+*		... // load meshes and textures meanwhile
+*		batch.submit();
+*		skyboxShader.wait(); // first frame: only what it draws
+*		...
+*		if (pbrShader.isReady()) ...
+*	\endcode
+*
+*	\note created, submitted and destroyed on the GL thread. The shaders added must outlive the batch (not their copies). \n
+*		A program is not linked before submit(): create its Materials afterwards (they read the program's uniforms)
+*/
+class ShaderBatch
+{
+public:
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Constructor: \n
+	*		lets the driver use as many compiler threads as it wants (parallel shader compile)
+	*/
+	ShaderBatch()
+	{
+#if defined(GL_KHR_parallel_shader_compile)
+		if (Shader::hasParallelCompile())
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+#elif defined(GL_ARB_parallel_shader_compile)
+		if (Shader::hasParallelCompile())
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+#endif
+	}
+
+	/*!
+	*  \brief Destructor: \n
+	*		submits the programs left in the batch
+	*/
+	~ShaderBatch()
+	{
+		submit();
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Adds a program to the batch (cf Shader's deferred constructor)
+	*
+	* \param Shader * shader : shader whose Program receives the stages
+	* \param const std::vector<std::pair<GLenum, std::string> > & stagePaths : type and source path of every stage
+	* \return returns at once: the sources are read by a background thread
+	*/
+	void add(Shader * shader, const std::vector<std::pair<GLenum, std::string> > & stagePaths)
+	{
+		Request request;
+		request.shader = shader;
+		request.stagePaths = stagePaths;
+		request.sources = std::async(std::launch::async, [stagePaths]() {
+			std::vector<std::string> sources;
+			for (size_t s = 0; s < stagePaths.size(); ++s)
+				sources.push_back(Shader::readSource(stagePaths[s].second.c_str()));
+			return sources;
+		});
+		ShaderRegistry::get().setQueued(ShaderRegistry::get().find(shader->Program), true);
+		requests.push_back(std::move(request));
+	}
+
+	/*!
+	*  \brief Compiles and links every program of the batch, without waiting for any of them
+	*
+	* \return waits for the sources only. The batch is empty again (programs may be added and submitted later)
+	*/
+	void submit()
+	{
+		for (size_t r = 0; r < requests.size(); ++r)
+		{
+			const std::vector<std::string> sources = requests[r].sources.get();
+			Shader * shader = requests[r].shader;
+			for (size_t s = 0; s < sources.size(); ++s)
+				shader->addStage(requests[r].stagePaths[s].first, requests[r].stagePaths[s].second.c_str(), sources[s]);
+			shader->beginBuild();
+			submitted.push_back(shader);
+		}
+		requests.clear();
+	}
+
+	/*!
+	*  \brief Returns true once every submitted program is ready (cf Shader::isReady)
+	*/
+	bool isReady()
+	{
+		bool ready = requests.empty();
+		for (size_t s = 0; s < submitted.size(); ++s)
+			ready = submitted[s]->isReady() && ready;
+		return ready;
+	}
+
+	/*!
+	*  \brief Submits what is left, and waits for every program of the batch (cf Shader::wait)
+	*/
+	void wait()
+	{
+		submit();
+		for (size_t s = 0; s < submitted.size(); ++s)
+			submitted[s]->wait();
+		submitted.clear();
+	}
+
+
+private:
+	//! program whose sources are being read
+	struct Request
+	{
+		Shader * shader;
+		std::vector<std::pair<GLenum, std::string> > stagePaths;
+		std::future<std::vector<std::string> > sources;
+	};
+	std::vector<Request> requests;
+	//! programs submitted, maybe still compiling
+	std::vector<Shader *> submitted;
+};
+
+
+inline Shader::Shader(const char* vertexPath, const char* fragmentPath, ShaderBatch * batch) : Shader(vertexPath, fragmentPath, ShaderDefines(), batch)
+{
+}
+
+inline Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines & defines, ShaderBatch * batch)
+{
+	createProgram();
+	ShaderRegistry::get().find(this->Program)->defines = defines;
+	if (batch == NULL)
+	{
+		addStage(GL_VERTEX_SHADER, vertexPath);
+		addStage(GL_FRAGMENT_SHADER, fragmentPath);
+		build();
+		return;
+	}
+	std::vector<std::pair<GLenum, std::string> > stagePaths;
+	stagePaths.push_back(std::make_pair(GLenum(GL_VERTEX_SHADER), std::string(vertexPath)));
+	stagePaths.push_back(std::make_pair(GLenum(GL_FRAGMENT_SHADER), std::string(fragmentPath)));
+	batch->add(this, stagePaths);
+}
+
 /*@}*/
 
 
@@ -0,0 +1,326 @@
+#ifndef MESHLOADER_HPP
+#define MESHLOADER_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// STL
+////////////////////////
+#include <string>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "modelGeometry.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file meshLoader.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup MESH */
+/*@{*/
+
+
+/*!
+*  \brief Background mesh loader: \n
+*		loadOBJ returns at once: the Geometry becomes a handle that is not ready yet (cf Geometry::isReady) \n
+*		A worker thread reads the baked cache or parses the file (cf Geometry::prepareOBJ) \n
+*		The GL thread then streams the result into the VBO/EBO through update(), a bounded number of bytes per frame \n
+*		Until then, drawGeometry() and SceneRenderer::drawMeshes skip the geometry: the render loop starts immediately \n
+*
+*	\code{.cpp}
+*		MeshLoader loader;
+*		Geometry dragon;
+*		loader.loadOBJ(&dragon, "Resources/Models/dragon-xyz-rgb-scan.obj", meshPos, 1.0);
+*		Mesh mesh(&dragon, &material); // copies share the pending upload (cf GeometryRecord)
+*		...
+*		while (window.isOpen())
+*		{
+*			loader.update(); // at most DEFAULT_UPLOAD_BUDGET bytes
+*			scene.drawMeshes(&camera, &window);
+*			...
+*		}
+*	\endcode
+*
+*	\note the MeshLoader has to be created, updated and destroyed on the GL thread. \n
+*		Destroying it drops the loads that are not complete (their geometry never becomes ready)
+*/
+class MeshLoader
+{
+public:
+	//! bytes uploaded per update() by default
+	static const size_t DEFAULT_UPLOAD_BUDGET = 8 << 20;
+
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Constructor: \n
+	*		starts the worker thread
+	*
+	* \param unsigned int nbParseThreads : threads used to parse a single file (0 => one per core, minus the GL thread)
+	*/
+	explicit MeshLoader(unsigned int nbParseThreads = 0) : nbParseThreads(nbParseThreads), stopping(false), nbWorking(0)
+	{
+		if (this->nbParseThreads == 0)
+		{
+			const unsigned int nbCores = std::thread::hardware_concurrency();
+			this->nbParseThreads = nbCores > 1 ? nbCores - 1 : 1;
+		}
+		worker = std::thread(&MeshLoader::workerLoop, this);
+	}
+
+	/*!
+	*  \brief Destructor: \n
+	*		stops the worker thread once its current file is done, \n
+	*		then frees the CPU data of every load not uploaded (its geometry is marked failed: it will never be ready)
+	*/
+	~MeshLoader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		worker.join();
+
+		abandon(&queued);
+		abandon(&parsed);
+	}
+
+
+	///////////////////////////////////////////
+	//	LOADING
+	///////////////////////////////////////////
+	/*!
+	*  \brief Starts loading an .obj file in the background (same result as Geometry::loadOBJ)
+	*
+	* \param Geometry * geometry : handle, not ready until the upload is complete (its VAO and VBO names are generated at once)
+	* \param const std::string filename : .obj file
+	* \param const glm::vec3 worldSpacePosition : mesh's referntial world space position (applied immediately)
+	* \param const float scale : geometry scaling factor
+	* \param const GeometryOptions & options : vertex format, LOD chain and baked cache (the parsing threads are the loader's)
+	* \return returns immediately. The geometry keeps no CPU side vertex/index arrays
+	*/
+	void loadOBJ(Geometry * geometry, const std::string filename, const glm::vec3 worldSpacePosition = glm::vec3(0, 0, 0), const float scale = 1.0, const GeometryOptions & options = GeometryOptions())
+	{
+		std::shared_ptr<Job> job = std::make_shared<Job>();
+		job->filename = filename;
+		job->scale = scale;
+		job->options = options;
+		job->options.nbThreads = nbParseThreads;
+
+		geometry->worldSpacePosition = worldSpacePosition;
+		geometry->createRecord(options.vertexFormat)->ready = false;
+		job->record = GeometryRegistry::get().find(geometry->VAO);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queued.push_back(job);
+		}
+		wakeUp.notify_one();
+	}
+
+	/*!
+	*  \brief Uploads parsed meshes to the GPU, to be called once per frame on the GL thread \n
+	*		Vertex and index data are streamed with glBufferSubData, in file order, until the budget is spent. \n
+	*		A geometry becomes ready once both its buffers are complete
+	*
+	* \param size_t uploadBudget : maximum number of bytes sent this frame
+	* \return number of bytes sent
+	*/
+	size_t update(size_t uploadBudget = DEFAULT_UPLOAD_BUDGET)
+	{
+		size_t uploaded = 0;
+		while (uploaded < uploadBudget)
+		{
+			std::shared_ptr<Job> job;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (parsed.empty())
+					break;
+				job = parsed.front();
+			}
+			GeometryRecord & record = *job->record;
+
+			// failed or abandoned (geometry released in the meantime): drop it
+			if (!job->loaded || record.released)
+			{
+				if (!job->loaded)
+				{
+					record.failed = true;
+					std::cout << "ERROR::MESHLOADER::FILE_NOT_LOADED: " << job->filename << std::endl;
+				}
+				popParsed();
+				continue;
+			}
+
+			const GeometryData & data = job->data;
+			const size_t vertexBytes = static_cast<size_t>(data.vertexCount) * data.vertexStride;
+			const size_t indexBytes = data.indexData != NULL ? static_cast<size_t>(data.indexCount) * sizeof(unsigned int) : 0;
+
+			// allocate the buffers, the data follows in chunks (GL_COPY_WRITE_BUFFER leaves the bound VAO untouched)
+			if (!job->allocated)
+			{
+				glBindBuffer(GL_COPY_WRITE_BUFFER, record.VBO);
+				glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertexBytes), NULL, GL_STATIC_DRAW);
+				if (indexBytes != 0)
+				{
+					glGenBuffers(1, &record.EBO);
+					glBindBuffer(GL_COPY_WRITE_BUFFER, record.EBO);
+					glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(indexBytes), NULL, GL_STATIC_DRAW);
+				}
+				job->allocated = true;
+			}
+
+			uploaded += uploadChunk(record.VBO, data.vertexData, vertexBytes, &job->uploadedVertexBytes, uploadBudget - uploaded);
+			if (job->uploadedVertexBytes == vertexBytes)
+				uploaded += uploadChunk(record.EBO, data.indexData, indexBytes, &job->uploadedIndexBytes, uploadBudget - uploaded);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+			if (job->uploadedVertexBytes < vertexBytes || job->uploadedIndexBytes < indexBytes)
+				break;
+
+			// complete: record the layout, the geometry handles can draw it
+			Geometry::completeRecord(&record, &data);
+			record.ready = true;
+			popParsed();
+		}
+		return uploaded;
+	}
+
+	/*!
+	*  \brief Returns the number of loads not complete yet (queued, being parsed or being uploaded)
+	*/
+	size_t getPendingCount()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return queued.size() + nbWorking + parsed.size();
+	}
+
+
+private:
+	/*!
+	*  \brief Job: one background load
+	*/
+	struct Job
+	{
+		std::shared_ptr<GeometryRecord> record; /**< shared with the geometry handles (cf GeometryRegistry) */
+		std::string filename;
+		float scale = 1.0f;
+		GeometryOptions options;
+
+		GeometryData data; /**< data to upload: owns the CPU arrays until the upload is complete */
+		bool loaded = false; /**< false if the file could not be read */
+		bool allocated = false; /**< VBO and EBO storage allocated */
+
+		size_t uploadedVertexBytes = 0; /**< upload progress */
+		size_t uploadedIndexBytes = 0;
+	};
+
+	//! threads used to parse a file
+	unsigned int nbParseThreads;
+
+	//! worker thread, parsing queued files one after the other
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	bool stopping;
+	size_t nbWorking;
+
+	//! jobs waiting for the worker, and parsed jobs waiting for (or being in) upload
+	std::deque<std::shared_ptr<Job> > queued;
+	std::deque<std::shared_ptr<Job> > parsed;
+
+	/*!
+	*  \brief Worker thread: runs Geometry::prepareOBJ on queued jobs (no OpenGL call)
+	*/
+	void workerLoop()
+	{
+		for (;;)
+		{
+			std::shared_ptr<Job> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (!stopping && queued.empty())
+					wakeUp.wait(lock);
+				if (stopping)
+					return;
+				job = queued.front();
+				queued.pop_front();
+				++nbWorking;
+			}
+
+			job->loaded = Geometry::prepareOBJ(job->filename, job->scale, job->options, &job->data);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			--nbWorking;
+			parsed.push_back(job);
+		}
+	}
+
+	/*!
+	*  \brief Sends the next bytes of a buffer
+	* \param GLuint buffer : destination buffer
+	* \param const void * data : source data
+	* \param size_t size : total size of data
+	* \param size_t * uploaded : bytes already sent (updated)
+	* \param size_t budget : maximum bytes to send
+	* \return number of bytes sent
+	*/
+	static size_t uploadChunk(GLuint buffer, const void * data, size_t size, size_t * uploaded, size_t budget)
+	{
+		const size_t chunk = std::min(size - *uploaded, budget);
+		if (chunk == 0)
+			return 0;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(*uploaded), static_cast<GLsizeiptr>(chunk), static_cast<const char *>(data) + *uploaded);
+		*uploaded += chunk;
+		return chunk;
+	}
+
+	/*!
+	*  \brief Removes the front parsed job (its CPU data is freed)
+	*/
+	void popParsed()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		parsed.pop_front();
+	}
+
+	/*!
+	*  \brief Drops jobs that will not be uploaded: their records fail, the jobs and their parsed data (or baked cache mapping) are freed
+	*/
+	static void abandon(std::deque<std::shared_ptr<Job> > * jobs)
+	{
+		for (size_t i = 0; i < jobs->size(); ++i)
+			(*jobs)[i]->record->failed = true;
+		jobs->clear();
+	}
+
+	MeshLoader(const MeshLoader &);
+	MeshLoader & operator=(const MeshLoader &);
+};
+
+/*@}*/
+
+}
+
+#endif
@@ -0,0 +1,612 @@
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "meshOptimizer.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file meshSimplifier.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup MESH */
+/*@{*/
+
+
+/*!
+*  \brief LevelOfDetail: \n
+*		One level of a Geometry's LOD chain: a range of its index buffer \n
+*		Every level indexes the same vertex buffer, level 0 is the full resolution mesh
+*/
+struct LevelOfDetail
+{
+	float ratio; /**< requested fraction of the full resolution triangle count (1 for level 0) */
+	float error; /**< object space geometric error bound: no full resolution vertex is farther from the level's surface (0 for level 0) */
+	unsigned int firstIndex; /**< first index of the level in the index buffer */
+	unsigned int indexCount; /**< number of indices of the level */
+};
+
+
+/*!
+*  \brief Mesh simplification: \n
+*		"Surface Simplification Using Quadric Error Metrics" by Michael Garland and Paul S. Heckbert \n
+*		Works on an indexed triangle list, no OpenGL call is made \n
+*
+*		-# every position gets the quadric of the planes of its triangles (open borders add a perpendicular plane)
+*		-# edges are collapsed onto one of their end points (half-edge collapse), cheapest first, by passes
+*		-# a collapse is rejected when it flips (or nearly flips) a triangle, or folds the surface (link condition)
+*		-# the error of a level is measured: largest distance from a full resolution vertex to the faces around the vertex it collapsed onto
+*
+*	Attributes are preserved: the collapsed vertex takes the normal, uv and tangent frame of the vertex it collapses onto, \n
+*	attribute changes are added to the collapse cost, and vertices on attribute seams (same position, different attributes) never move. \n
+*	The simplified index lists reference the source vertices: all levels share one vertex buffer.
+*
+*	\code{.cpp}
+*		const float ratios[] = { 0.5f, 0.25f, 0.1f, 0.03f };
+*		std::vector<LevelOfDetail> lods;
+*		meshSimplifier::buildChain(vertices, &indices, ratios, 4, &lods); // indices: level 0 followed by the 4 simplified levels
+*	\endcode
+*/
+namespace meshSimplifier
+{
+	/*!
+	*  \brief Default LOD chain: fraction of the full resolution triangle count of each level
+	*/
+	const float DEFAULT_LOD_RATIOS[] = { 0.5f, 0.25f, 0.1f, 0.03f };
+	const unsigned int DEFAULT_LOD_COUNT = 4;
+	const unsigned int MAX_LOD_LEVELS = 8; /**< maximum number of simplified levels */
+
+	/*!
+	*  \brief Weights of the collapse cost terms
+	*/
+	const double BORDER_WEIGHT = 10.0; /**< weight of the planes keeping open borders in place */
+	const double ATTRIBUTE_WEIGHT = 0.5; /**< weight of the normal/uv change (relative to the squared edge length) */
+	const float FLIP_COSINE = 0.25f; /**< a collapse is rejected if a face normal turns by more than acos(FLIP_COSINE) (~75 degrees) */
+
+	/*!
+	*  \brief Quadric: \n
+	*		symmetric 4x4 matrix of a weighted sum of squared plane distances: Q(p) = p^T A p + 2 b.p + c \n
+	*		planes are weighted by the area of their triangle, w is the sum of the weights
+	*/
+	struct Quadric
+	{
+		double a00, a11, a22, a01, a02, a12;
+		double b0, b1, b2;
+		double c;
+		double w;
+
+		Quadric() : a00(0), a11(0), a22(0), a01(0), a02(0), a12(0), b0(0), b1(0), b2(0), c(0), w(0) {}
+
+		/*!
+		*  \brief Quadric of the plane dot(n, p) + d = 0 (n unit length), scaled by weight
+		*/
+		Quadric(const glm::vec3 n, float d, double weight) :
+			a00(weight * n.x * n.x), a11(weight * n.y * n.y), a22(weight * n.z * n.z),
+			a01(weight * n.x * n.y), a02(weight * n.x * n.z), a12(weight * n.y * n.z),
+			b0(weight * n.x * d), b1(weight * n.y * d), b2(weight * n.z * d),
+			c(weight * d * d), w(weight)
+		{
+		}
+
+		Quadric & operator+=(const Quadric & q)
+		{
+			a00 += q.a00; a11 += q.a11; a22 += q.a22; a01 += q.a01; a02 += q.a02; a12 += q.a12;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			w += q.w;
+			return *this;
+		}
+
+		/*!
+		*  \brief Weighted mean of the squared distances from p to the planes
+		*/
+		double evaluate(const glm::vec3 p) const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			const double error = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return error > 0.0 && w > 0.0 ? error / w : 0.0;
+		}
+	};
+
+	/*!
+	*  \brief Vertex classification: what a vertex may collapse onto
+	*/
+	enum VertexKind
+	{
+		VERTEX_MANIFOLD = 0, /**< interior vertex: collapses onto any neighbour */
+		VERTEX_BORDER = 1, /**< vertex on an open border: only collapses along that border */
+		VERTEX_LOCKED = 2 /**< attribute seam or non manifold: never collapses */
+	};
+
+	/*!
+	*  \brief Collapse: \n
+	*		candidate half-edge collapse (from moves onto to)
+	*/
+	struct Collapse
+	{
+		unsigned int from, to;
+		double cost; /**< ordering cost (geometric + attribute terms) */
+		double error; /**< geometric term (squared distance) */
+
+		bool operator<(const Collapse & other) const { return cost < other.cost; }
+	};
+
+	/*!
+	*  \brief PositionKey: \n
+	*		Hash map key of a position: the bit patterns of its coordinates (-0.0 is folded onto 0.0)
+	*/
+	struct PositionKey
+	{
+		unsigned int bits[3];
+
+		explicit PositionKey(const glm::vec3 p)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				const float value = p[k] + 0.0f;
+				std::memcpy(&bits[k], &value, sizeof(float));
+			}
+		}
+
+		bool operator==(const PositionKey & other) const
+		{
+			return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+		}
+	};
+
+	/*!
+	*  \brief Hashes a PositionKey (FNV-1a over its 32 bits words)
+	*/
+	struct PositionKeyHash
+	{
+		size_t operator()(const PositionKey & key) const
+		{
+			size_t hash = 2166136261u;
+			for (int k = 0; k < 3; ++k)
+				hash = (hash ^ key.bits[k]) * 16777619u;
+			return hash;
+		}
+	};
+
+	/*!
+	*  \brief Returns a hash map key of a directed edge
+	*/
+	inline unsigned long long edgeKey(unsigned int a, unsigned int b)
+	{
+		return (static_cast<unsigned long long>(a) << 32) | b;
+	}
+
+	/*!
+	*  \brief Sorted positions of the vertices sharing a face with v, v and other excluded (cf simplify's link condition)
+	* \param const std::vector<unsigned int> & offsets, adjacency : faces of each vertex (CSR) of the triangle list tri, remapped by remap
+	*/
+	inline void ring(const std::vector<unsigned int> & tri, const std::vector<unsigned int> & remap, const std::vector<unsigned int> & position,
+		const std::vector<unsigned int> & offsets, const std::vector<unsigned int> & adjacency, unsigned int v, unsigned int other, std::vector<unsigned int> * out)
+	{
+		out->clear();
+		for (unsigned int a = offsets[v]; a < offsets[v + 1]; ++a)
+			for (int k = 0; k < 3; ++k)
+			{
+				const unsigned int w = position[remap[tri[3 * adjacency[a] + k]]];
+				if (w != position[v] && w != position[other])
+					out->push_back(w);
+			}
+		std::sort(out->begin(), out->end());
+		out->erase(std::unique(out->begin(), out->end()), out->end());
+	}
+
+	/*!
+	*  \brief Area weighted geometric normals of a triangle list, one per vertex (not normalized, null for unused vertices)
+	*/
+	template<typename V>
+	void faceNormalSums(const std::vector<V> & vertices, const unsigned int * indices, size_t indexCount, std::vector<glm::vec3> * normals)
+	{
+		normals->assign(vertices.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const glm::vec3 p0 = vertices[indices[i]].Position;
+			const glm::vec3 n = glm::cross(vertices[indices[i + 1]].Position - p0, vertices[indices[i + 2]].Position - p0);
+			for (int k = 0; k < 3; ++k)
+				(*normals)[indices[i + k]] += n;
+		}
+	}
+
+	/*!
+	*  \brief Distance from a point to a triangle
+	* \note "Real-Time Collision Detection" by Christer Ericson, 5.1.5
+	*/
+	inline float distanceToTriangle(const glm::vec3 p, const glm::vec3 a, const glm::vec3 b, const glm::vec3 c)
+	{
+		const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+		const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return glm::length(ap);
+		const glm::vec3 bp = p - b;
+		const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3)
+			return glm::length(bp);
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return glm::length(ap - ab * (d1 / (d1 - d3)));
+		const glm::vec3 cp = p - c;
+		const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6)
+			return glm::length(cp);
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return glm::length(ap - ac * (d2 / (d2 - d6)));
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+			return glm::length(bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+		const float denom = va + vb + vc;
+		if (denom <= 0.0f) // degenerate triangle: its edges were handled above
+			return glm::length(ap);
+		return glm::length(ap - ab * (vb / denom) - ac * (vc / denom));
+	}
+
+	/*!
+	*  \brief Measured error of a level: largest distance from a full resolution vertex to the faces of the level \n
+	*		around the vertex it collapsed onto (an upper bound of its distance to the level's surface)
+	* \param const unsigned int * fullIndices : full resolution triangle list
+	* \param size_t fullCount : its number of indices
+	* \param const std::vector<unsigned int> & level : simplified triangle list
+	* \param const std::vector<unsigned int> & collapsedOnto : vertex of the level replacing each vertex (cf simplify)
+	*/
+	template<typename V>
+	float deviation(const std::vector<V> & vertices, const unsigned int * fullIndices, size_t fullCount, const std::vector<unsigned int> & level, const std::vector<unsigned int> & collapsedOnto)
+	{
+		const size_t nbVertices = vertices.size();
+		std::vector<unsigned int> offsets(nbVertices + 1, 0);
+		for (size_t i = 0; i < level.size(); ++i)
+			++offsets[level[i] + 1];
+		for (size_t v = 0; v < nbVertices; ++v)
+			offsets[v + 1] += offsets[v];
+		std::vector<unsigned int> adjacency(level.size());
+		{
+			std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < level.size(); ++i)
+				adjacency[fill[level[i]]++] = static_cast<unsigned int>(i / 3);
+		}
+
+		float maxDistance = 0.0f;
+		std::vector<unsigned char> measured(nbVertices, 0);
+		for (size_t i = 0; i < fullCount; ++i)
+		{
+			const unsigned int v = fullIndices[i];
+			if (measured[v])
+				continue;
+			measured[v] = 1;
+
+			const glm::vec3 p = vertices[v].Position;
+			const unsigned int r = collapsedOnto[v];
+			float distance = glm::length(p - vertices[r].Position);
+			for (unsigned int a = offsets[r]; a < offsets[r + 1]; ++a)
+			{
+				const unsigned int * f = &level[3 * adjacency[a]];
+				distance = std::min(distance, distanceToTriangle(p, vertices[f[0]].Position, vertices[f[1]].Position, vertices[f[2]].Position));
+			}
+			maxDistance = std::max(maxDistance, distance);
+		}
+		return maxDistance;
+	}
+
+	/*!
+	*  \brief Simplifies an indexed triangle list down to a target number of indices
+	*
+	* \param const std::vector<V> & vertices : vertices (struct with Position, Normal, TexCoords members)
+	* \param const unsigned int * indices : source triangle list
+	* \param size_t indexCount : number of source indices
+	* \param size_t targetIndexCount : wanted number of indices (upper bound, not always reached: locked vertices and flips stop the collapses)
+	* \param std::vector<unsigned int> * out : simplified triangle list (references the same vertices)
+	* \param std::vector<unsigned int> * collapsedOnto : optional, one entry per vertex: a vertex of the input is replaced by the vertex it collapsed onto \n
+	*		(entries may point to vertices removed earlier, cf buildChain: they follow them)
+	* \param const std::vector<glm::vec3> * referenceNormals : optional, one per vertex (cf faceNormalSums): no face may end up facing away from \n
+	*		the reference normal of one of its corners. Defaults to the normals of the input, buildChain passes the full resolution ones
+	* \return estimate of the object space geometric error (distance: largest area weighted RMS distance of a collapsed vertex to its original planes)
+	*/
+	template<typename V>
+	float simplify(const std::vector<V> & vertices, const unsigned int * indices, size_t indexCount, size_t targetIndexCount, std::vector<unsigned int> * out,
+		std::vector<unsigned int> * collapsedOnto = NULL, const std::vector<glm::vec3> * referenceNormals = NULL)
+	{
+		const size_t nbVertices = vertices.size();
+		out->assign(indices, indices + indexCount);
+		if (indexCount <= targetIndexCount || nbVertices == 0)
+			return 0.0f;
+
+		std::vector<glm::vec3> inputNormals;
+		if (referenceNormals == NULL)
+		{
+			faceNormalSums(vertices, indices, indexCount, &inputNormals);
+			referenceNormals = &inputNormals;
+		}
+
+		// 1. positions shared by several vertices (attribute seams) and open borders
+		std::vector<unsigned int> position(nbVertices);
+		std::vector<unsigned int> nbWedges(nbVertices, 0);
+		{
+			std::unordered_map<PositionKey, unsigned int, PositionKeyHash> firstVertex;
+			firstVertex.reserve(nbVertices);
+			for (size_t v = 0; v < nbVertices; ++v)
+			{
+				std::pair<std::unordered_map<PositionKey, unsigned int, PositionKeyHash>::iterator, bool> inserted =
+					firstVertex.insert(std::make_pair(PositionKey(vertices[v].Position), static_cast<unsigned int>(v)));
+				position[v] = inserted.first->second;
+				++nbWedges[position[v]];
+			}
+		}
+
+		std::unordered_map<unsigned long long, unsigned int> edges;
+		edges.reserve(indexCount);
+		for (size_t i = 0; i < indexCount; i += 3)
+			for (int k = 0; k < 3; ++k)
+				++edges[edgeKey(position[indices[i + k]], position[indices[i + (k + 1) % 3]])];
+
+		std::vector<unsigned char> kind(nbVertices, VERTEX_MANIFOLD);
+		for (size_t v = 0; v < nbVertices; ++v)
+			if (nbWedges[position[v]] > 1)
+				kind[v] = VERTEX_LOCKED;
+		for (std::unordered_map<unsigned long long, unsigned int>::const_iterator it = edges.begin(); it != edges.end(); ++it)
+		{
+			const unsigned int a = static_cast<unsigned int>(it->first >> 32), b = static_cast<unsigned int>(it->first & 0xFFFFFFFFu);
+			const bool nonManifold = it->second > 1;
+			const bool border = edges.find(edgeKey(b, a)) == edges.end();
+			if (nonManifold)
+				kind[a] = kind[b] = VERTEX_LOCKED;
+			else if (border)
+			{
+				kind[a] = std::max<unsigned char>(kind[a], VERTEX_BORDER);
+				kind[b] = std::max<unsigned char>(kind[b], VERTEX_BORDER);
+			}
+		}
+
+		// 2. quadrics (per vertex: non locked vertices own their position)
+		std::vector<Quadric> quadrics(nbVertices);
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			const glm::vec3 p[3] = { vertices[indices[i]].Position, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position };
+			glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+			const float length = glm::length(n);
+			if (length == 0.0f)
+				continue;
+			n /= length;
+			const double area = 0.5 * length;
+			const Quadric plane(n, -glm::dot(n, p[0]), area);
+			for (int k = 0; k < 3; ++k)
+			{
+				quadrics[indices[i + k]] += plane;
+
+				// open border: plane through the edge, perpendicular to the face
+				const unsigned int a = position[indices[i + k]], b = position[indices[i + (k + 1) % 3]];
+				if (edges.find(edgeKey(b, a)) == edges.end())
+				{
+					const glm::vec3 edge = p[(k + 1) % 3] - p[k];
+					glm::vec3 side = glm::cross(edge, n);
+					const float sideLength = glm::length(side);
+					if (sideLength == 0.0f)
+						continue;
+					side /= sideLength;
+					const Quadric border(side, -glm::dot(side, p[k]), BORDER_WEIGHT * area);
+					quadrics[indices[i + k]] += border;
+					quadrics[indices[i + (k + 1) % 3]] += border;
+				}
+			}
+		}
+
+		// 3. collapse passes
+		double maxError = 0.0;
+		std::vector<unsigned int> remap(nbVertices);
+		std::vector<unsigned char> touched(nbVertices);
+		std::vector<unsigned int> offsets(nbVertices + 1);
+		std::vector<unsigned int> adjacency;
+		std::vector<Collapse> collapses;
+		std::vector<unsigned int> fromRing, toRing, sharedRing;
+
+		while (out->size() > targetIndexCount)
+		{
+			std::vector<unsigned int> & tri = *out;
+			const size_t nbIndices = tri.size();
+
+			// vertex -> triangles adjacency (CSR)
+			std::fill(offsets.begin(), offsets.end(), 0u);
+			for (size_t i = 0; i < nbIndices; ++i)
+				++offsets[tri[i] + 1];
+			for (size_t v = 0; v < nbVertices; ++v)
+				offsets[v + 1] += offsets[v];
+			adjacency.resize(nbIndices);
+			{
+				std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+				for (size_t i = 0; i < nbIndices; ++i)
+					adjacency[fill[tri[i]]++] = static_cast<unsigned int>(i / 3);
+			}
+
+			// candidate collapses of every edge, in its allowed direction(s)
+			collapses.clear();
+			for (size_t i = 0; i < nbIndices; i += 3)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					const unsigned int a = tri[i + k], b = tri[i + (k + 1) % 3];
+					const bool border = edges.find(edgeKey(position[b], position[a])) == edges.end();
+					// interior edges are seen twice (once per face): keep one
+					if (!border && position[a] > position[b])
+						continue;
+
+					for (int direction = 0; direction < 2; ++direction)
+					{
+						const unsigned int from = direction == 0 ? a : b;
+						const unsigned int to = direction == 0 ? b : a;
+						if (kind[from] == VERTEX_LOCKED || (kind[from] == VERTEX_BORDER && (!border || kind[to] == VERTEX_MANIFOLD)))
+							continue;
+
+						Quadric q = quadrics[from];
+						q += quadrics[to];
+						const V & vf = vertices[from];
+						const V & vt = vertices[to];
+						const glm::vec3 edge = vt.Position - vf.Position;
+						const glm::vec3 dn = vt.Normal - vf.Normal;
+						const glm::vec2 duv = vt.TexCoords - vf.TexCoords;
+
+						Collapse collapse;
+						collapse.from = from;
+						collapse.to = to;
+						collapse.error = q.evaluate(vt.Position);
+						collapse.cost = collapse.error + ATTRIBUTE_WEIGHT * glm::dot(edge, edge) * (glm::dot(dn, dn) + glm::dot(duv, duv));
+						collapses.push_back(collapse);
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end());
+
+			// apply the cheapest ones: a vertex is moved or used as a target at most once per pass
+			for (size_t v = 0; v < nbVertices; ++v)
+				remap[v] = static_cast<unsigned int>(v);
+			std::fill(touched.begin(), touched.end(), 0);
+
+			size_t nbRemovedTriangles = 0;
+			const size_t nbTrianglesToRemove = (nbIndices - targetIndexCount) / 3;
+			for (size_t c = 0; c < collapses.size() && nbRemovedTriangles < nbTrianglesToRemove; ++c)
+			{
+				const Collapse & collapse = collapses[c];
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				// reject flips: every remaining face of from must keep its orientation once from sits on to
+				const glm::vec3 target = vertices[collapse.to].Position;
+				bool flips = false;
+				size_t nbCollapsedFaces = 0;
+				for (unsigned int a = offsets[collapse.from]; a < offsets[collapse.from + 1] && !flips; ++a)
+				{
+					const unsigned int face = adjacency[a];
+					const unsigned int f[3] = { remap[tri[3 * face]], remap[tri[3 * face + 1]], remap[tri[3 * face + 2]] };
+					if (f[0] == collapse.to || f[1] == collapse.to || f[2] == collapse.to)
+					{
+						++nbCollapsedFaces;
+						continue;
+					}
+					const glm::vec3 p0 = vertices[f[0]].Position, p1 = vertices[f[1]].Position, p2 = vertices[f[2]].Position;
+					const glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+					const glm::vec3 q0 = f[0] == collapse.from ? target : p0;
+					const glm::vec3 q1 = f[1] == collapse.from ? target : p1;
+					const glm::vec3 q2 = f[2] == collapse.from ? target : p2;
+					const glm::vec3 after = glm::cross(q1 - q0, q2 - q0);
+					flips = glm::dot(before, after) <= FLIP_COSINE * glm::length(before) * glm::length(after);
+					// small turns add up over the collapses (and over the levels): check against the reference surface too
+					for (int k = 0; k < 3 && !flips; ++k)
+						flips = glm::dot(after, (*referenceNormals)[f[k] == collapse.from ? collapse.to : f[k]]) <= 0.0f;
+				}
+				if (flips)
+					continue;
+
+				// link condition: from and to only share the third vertices of their common faces, otherwise the collapse
+				// folds the surface (two faces end up on the same three positions, back to back)
+				ring(tri, remap, position, offsets, adjacency, collapse.from, collapse.to, &fromRing);
+				ring(tri, remap, position, offsets, adjacency, collapse.to, collapse.from, &toRing);
+				sharedRing.clear();
+				std::set_intersection(fromRing.begin(), fromRing.end(), toRing.begin(), toRing.end(), std::back_inserter(sharedRing));
+				if (sharedRing.size() > nbCollapsedFaces)
+					continue;
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to] += quadrics[collapse.from];
+				touched[collapse.from] = touched[collapse.to] = 1;
+				maxError = std::max(maxError, collapse.error);
+				nbRemovedTriangles += nbCollapsedFaces;
+			}
+			if (nbRemovedTriangles == 0)
+				break;
+
+			// a target never moves in the pass of its collapse: one step of remap per pass
+			if (collapsedOnto != NULL)
+				for (size_t v = 0; v < nbVertices; ++v)
+					(*collapsedOnto)[v] = remap[(*collapsedOnto)[v]];
+
+			// remap, and drop the degenerate triangles
+			size_t nbKept = 0;
+			for (size_t i = 0; i < nbIndices; i += 3)
+			{
+				const unsigned int i0 = remap[tri[i]], i1 = remap[tri[i + 1]], i2 = remap[tri[i + 2]];
+				if (position[i0] == position[i1] || position[i1] == position[i2] || position[i0] == position[i2])
+					continue;
+				tri[nbKept++] = i0;
+				tri[nbKept++] = i1;
+				tri[nbKept++] = i2;
+			}
+			tri.resize(nbKept);
+		}
+
+		return static_cast<float>(std::sqrt(maxError));
+	}
+
+	/*!
+	*  \brief Builds a LOD chain: each level simplifies the previous one, and is reordered for the vertex cache
+	*
+	* \param const std::vector<V> & vertices : vertices (struct with Position, Normal, TexCoords members)
+	* \param std::vector<unsigned int> * indices : full resolution triangle list, the simplified levels are appended to it
+	* \param const float * ratios : fraction of the full resolution triangle count of each level (decreasing)
+	* \param unsigned int nbLevels : number of ratios
+	* \param std::vector<LevelOfDetail> * lods : level 0 (full resolution) followed by one entry per ratio
+	* \return fills lods. A level that could not go below the previous one is dropped (along with the following ones). \n
+	*		The error of a level is measured against the full resolution vertices (cf deviation), and never decreases along the chain
+	*/
+	template<typename V>
+	void buildChain(const std::vector<V> & vertices, std::vector<unsigned int> * indices, const float * ratios, unsigned int nbLevels, std::vector<LevelOfDetail> * lods)
+	{
+		lods->clear();
+		const size_t fullCount = indices->size();
+		const LevelOfDetail full = { 1.0f, 0.0f, 0, static_cast<unsigned int>(fullCount) };
+		lods->push_back(full);
+
+		std::vector<unsigned int> level;
+		std::vector<unsigned int> collapsedOnto(vertices.size());
+		for (size_t v = 0; v < collapsedOnto.size(); ++v)
+			collapsedOnto[v] = static_cast<unsigned int>(v);
+		std::vector<glm::vec3> fullNormals;
+		faceNormalSums(vertices, &(*indices)[0], fullCount, &fullNormals);
+		for (unsigned int l = 0; l < nbLevels; ++l)
+		{
+			const LevelOfDetail previous = lods->back();
+			const size_t target = 3 * static_cast<size_t>(ratios[l] * (fullCount / 3));
+			simplify(vertices, &(*indices)[previous.firstIndex], previous.indexCount, target, &level, &collapsedOnto, &fullNormals);
+			if (level.empty() || level.size() >= previous.indexCount)
+				break;
+			meshOptimizer::optimizeVertexCache(&level, vertices.size());
+
+			// each level simplifies the previous one: its error is measured from the full resolution vertices
+			const float error = std::max(previous.error, deviation(vertices, &(*indices)[0], fullCount, level, collapsedOnto));
+			const LevelOfDetail lod = { ratios[l], error, static_cast<unsigned int>(indices->size()), static_cast<unsigned int>(level.size()) };
+			indices->insert(indices->end(), level.begin(), level.end());
+			lods->push_back(lod);
+		}
+	}
+}
+
+/*@}*/
+
+}
+
+#endif
@@ -0,0 +1,390 @@
+#ifndef OCCLUSIONCULLING_HPP
+#define OCCLUSIONCULLING_HPP
+
+
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "frustumCulling.hpp"
+#include "jobSystem.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file occlusionCulling.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SCENE */
+/*@{*/
+
+
+//! smallest clip space w rasterized or tested by an OcclusionBuffer (in front of the camera)
+const float OCCLUSION_NEAR_W = 1e-5f;
+
+
+/*!
+*  \brief Occlusion Buffer: \n
+*		Software occlusion culling, after "Masked Software Occlusion Culling" (Hasselgren, Andersson, Akenine-Moller): \n
+*		a few large occluders (at full resolution: a coarser level may cover more than the mesh) are rasterized on the CPU into a small depth buffer, \n
+*		then the screen space bounds of the other objects are tested against it. No OpenGL call: the buffer is filled \n
+*		and tested on the JobSystem, and can be benchmarked without a context. \n
+*
+*		- addOccluder transforms the triangles to the screen (view-projection * model), and bins them to the tiles of \n
+*		  TILE_WIDTH x TILE_HEIGHT pixels their bounding rectangle overlaps \n
+*		- rasterize fills every tile on its own (in parallel), 4 pixels at a time (SSE, scalar fallback): edge functions and \n
+*		  depth plane at the pixel centers, nearest depth kept. Each tile then records its farthest depth \n
+*		- isVisible projects a world space box: the object is hidden if, over its screen rectangle, every occluder pixel \n
+*		  is nearer than the nearest corner of the box. Tiles whose farthest depth is nearer are skipped pixel-free \n
+*
+*		The test is conservative: triangles crossing the near plane are not rasterized (they occlude nothing), \n
+*		and boxes crossing it are visible. Depth is the window depth in [0, 1] (1 = far plane, the cleared value).
+*
+*	\code{.cpp}
+*		OcclusionBuffer occlusion(256, 128);
+*		occlusion.clear(projection * view);
+*		occlusion.addOccluder(&floorVertices[0].Position, sizeof(Vertex), NULL, floorVertices.size(), floorModel);
+*		occlusion.rasterize();
+*		if (!occlusion.isVisible(boundsMin + position, boundsMax + position))
+*			... // hidden behind the floor
+*	\endcode
+*/
+class OcclusionBuffer
+{
+public:
+	//! tile size in pixels (width a multiple of 4, the SIMD width)
+	static const int TILE_WIDTH = 32;
+	static const int TILE_HEIGHT = 8;
+	//! tiles rasterized per job
+	static const size_t TILES_PER_JOB = 4;
+
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Constructor: \n
+	*		allocates a cleared depth buffer
+	* \param int width : width in pixels, rounded up to a multiple of TILE_WIDTH
+	* \param int height : height in pixels, rounded up to a multiple of TILE_HEIGHT
+	*/
+	OcclusionBuffer(int width = 256, int height = 128)
+	{
+		tilesX = std::max(1, (width + TILE_WIDTH - 1) / TILE_WIDTH);
+		tilesY = std::max(1, (height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+		this->width = tilesX * TILE_WIDTH;
+		this->height = tilesY * TILE_HEIGHT;
+		depth.assign(static_cast<size_t>(this->width) * this->height, 1.0f);
+		tileFarthest.assign(static_cast<size_t>(tilesX) * tilesY, 1.0f);
+		bins.resize(static_cast<size_t>(tilesX) * tilesY);
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	int getWidth() const
+	{
+		return width;
+	}
+	int getHeight() const
+	{
+		return height;
+	}
+	/*!
+	*  \brief Returns the number of occluder triangles binned since clear (degenerate, off screen and near clipped ones excluded)
+	*/
+	size_t getTriangleCount() const
+	{
+		return triangles.size();
+	}
+	/*!
+	*  \brief Returns the depth of a pixel, in [0, 1] (1 where no occluder was rasterized)
+	* \param int x : column, from the left
+	* \param int y : row, from the bottom
+	*/
+	float getDepth(int x, int y) const
+	{
+		return depth[static_cast<size_t>(y) * width + x];
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Starts a frame: clears the depth and drops the binned triangles
+	* \param const glm::mat4 & viewProjection : projection * view of the camera
+	*/
+	void clear(const glm::mat4 & viewProjection)
+	{
+		this->viewProjection = viewProjection;
+		triangles.clear();
+		for (size_t t = 0; t < bins.size(); ++t)
+			bins[t].clear();
+		std::fill(depth.begin(), depth.end(), 1.0f);
+		std::fill(tileFarthest.begin(), tileFarthest.end(), 1.0f);
+	}
+
+	/*!
+	*  \brief Transforms and bins the triangles of an occluder (drawn by the next rasterize)
+	*
+	* \param const glm::vec3 * positions : first vertex position
+	* \param size_t stride : bytes from one position to the next (e.g. sizeof(Vertex))
+	* \param const unsigned int * indices : three indices per triangle, NULL => consecutive positions
+	* \param size_t nbIndices : number of indices (or of positions if indices is NULL)
+	* \param const glm::mat4 & model : object to world space transform
+	* \note both windings are rasterized: the nearest surface is kept whatever the orientation of the mesh
+	*/
+	void addOccluder(const glm::vec3 * positions, size_t stride, const unsigned int * indices, size_t nbIndices, const glm::mat4 & model)
+	{
+		const glm::mat4 transform = viewProjection * model;
+		const unsigned char * base = reinterpret_cast<const unsigned char *>(positions);
+		for (size_t i = 0; i + 2 < nbIndices; i += 3)
+		{
+			glm::vec4 clip[3];
+			bool behind = false;
+			for (int k = 0; k < 3; ++k)
+			{
+				const size_t index = indices != NULL ? indices[i + k] : i + k;
+				const glm::vec3 & p = *reinterpret_cast<const glm::vec3 *>(base + index * stride);
+				clip[k] = transform * glm::vec4(p, 1.0f);
+				behind = behind || clip[k].w < OCCLUSION_NEAR_W;
+			}
+			if (!behind)
+				addTriangle(clip);
+		}
+	}
+
+	/*!
+	*  \brief Rasterizes the binned triangles, tiles in parallel on the JobSystem, then records the farthest depth of every tile
+	*/
+	void rasterize()
+	{
+		JobSystem::get().parallelFor(bins.size(), TILES_PER_JOB, [&](size_t first, size_t last, unsigned int) {
+			for (size_t tile = first; tile < last; ++tile)
+				rasterizeTile(tile);
+		});
+	}
+
+	/*!
+	*  \brief Tests a world space box against the occluders (thread safe once rasterized)
+	* \param const glm::vec3 & boundsMin : world space min corner
+	* \param const glm::vec3 & boundsMax : world space max corner
+	* \return false if the occluders hide the whole box, true otherwise (also if it crosses the near plane, or is off screen)
+	*/
+	bool isVisible(const glm::vec3 & boundsMin, const glm::vec3 & boundsMax) const
+	{
+		float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, nearest = 1e30f;
+		for (int c = 0; c < 8; ++c)
+		{
+			const glm::vec3 corner((c & 1) ? boundsMax.x : boundsMin.x, (c & 2) ? boundsMax.y : boundsMin.y, (c & 4) ? boundsMax.z : boundsMin.z);
+			const glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+			if (clip.w < OCCLUSION_NEAR_W)
+				return true;
+			const glm::vec3 window = toWindow(clip);
+			minX = std::min(minX, window.x);
+			maxX = std::max(maxX, window.x);
+			minY = std::min(minY, window.y);
+			maxY = std::max(maxY, window.y);
+			nearest = std::min(nearest, window.z);
+		}
+		if (nearest > 1.0f || maxX < 0.0f || maxY < 0.0f || minX >= static_cast<float>(width) || minY >= static_cast<float>(height))
+			return true;
+
+		// every on screen pixel the rectangle touches (the part off screen is left to frustum culling)
+		const int x0 = static_cast<int>(std::max(minX, 0.0f));
+		const int y0 = static_cast<int>(std::max(minY, 0.0f));
+		const int x1 = static_cast<int>(std::min(maxX, static_cast<float>(width - 1)));
+		const int y1 = static_cast<int>(std::min(maxY, static_cast<float>(height - 1)));
+
+		for (int ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ++ty)
+		{
+			for (int tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; ++tx)
+			{
+				if (tileFarthest[static_cast<size_t>(ty) * tilesX + tx] < nearest)
+					continue;
+				const int rowFirst = std::max(y0, ty * TILE_HEIGHT), rowLast = std::min(y1, ty * TILE_HEIGHT + TILE_HEIGHT - 1);
+				const int columnFirst = std::max(x0, tx * TILE_WIDTH), columnLast = std::min(x1, tx * TILE_WIDTH + TILE_WIDTH - 1);
+				for (int y = rowFirst; y <= rowLast; ++y)
+				{
+					const float * row = &depth[static_cast<size_t>(y) * width];
+					for (int x = columnFirst; x <= columnLast; ++x)
+						if (row[x] >= nearest)
+							return true;
+				}
+			}
+		}
+		return false;
+	}
+
+
+private:
+	/*!
+	*  \brief Screen space triangle: edge functions A * x + B * y + C >= 0 inside, depth plane, bounding rectangle
+	*/
+	struct Triangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];
+		float depthA, depthB, depthC;
+		int x0, y0, x1, y1;
+	};
+
+	int width, height;
+	int tilesX, tilesY;
+	glm::mat4 viewProjection;
+	std::vector<float> depth; /**< width * height, rows from the bottom */
+	std::vector<float> tileFarthest; /**< farthest depth of every tile */
+	std::vector<Triangle> triangles;
+	std::vector<std::vector<unsigned int> > bins; /**< triangles overlapping every tile */
+
+	glm::vec3 toWindow(const glm::vec4 & clip) const
+	{
+		const float invW = 1.0f / clip.w;
+		return glm::vec3((clip.x * invW * 0.5f + 0.5f) * width, (clip.y * invW * 0.5f + 0.5f) * height, clip.z * invW * 0.5f + 0.5f);
+	}
+
+	/*!
+	*  \brief Sets up a triangle in front of the near plane and bins it
+	*/
+	void addTriangle(const glm::vec4 clip[3])
+	{
+		glm::vec3 v[3];
+		for (int k = 0; k < 3; ++k)
+			v[k] = toWindow(clip[k]);
+
+		float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+		if (area == 0.0f)
+			return;
+		if (area < 0.0f)
+		{
+			std::swap(v[1], v[2]);
+			area = -area;
+		}
+
+		Triangle triangle;
+		triangle.x0 = std::max(0, static_cast<int>(std::floor(std::min(v[0].x, std::min(v[1].x, v[2].x)))));
+		triangle.y0 = std::max(0, static_cast<int>(std::floor(std::min(v[0].y, std::min(v[1].y, v[2].y)))));
+		triangle.x1 = std::min(width - 1, static_cast<int>(std::ceil(std::max(v[0].x, std::max(v[1].x, v[2].x)))));
+		triangle.y1 = std::min(height - 1, static_cast<int>(std::ceil(std::max(v[0].y, std::max(v[1].y, v[2].y)))));
+		if (triangle.x0 > triangle.x1 || triangle.y0 > triangle.y1)
+			return;
+
+		for (int e = 0; e < 3; ++e)
+		{
+			const glm::vec3 & a = v[e];
+			const glm::vec3 & b = v[(e + 1) % 3];
+			triangle.edgeA[e] = a.y - b.y;
+			triangle.edgeB[e] = b.x - a.x;
+			triangle.edgeC[e] = -(triangle.edgeA[e] * a.x + triangle.edgeB[e] * a.y);
+		}
+		const float dx1 = v[1].x - v[0].x, dy1 = v[1].y - v[0].y, dz1 = v[1].z - v[0].z;
+		const float dx2 = v[2].x - v[0].x, dy2 = v[2].y - v[0].y, dz2 = v[2].z - v[0].z;
+		triangle.depthA = (dz1 * dy2 - dz2 * dy1) / area;
+		triangle.depthB = (dx1 * dz2 - dx2 * dz1) / area;
+		triangle.depthC = v[0].z - triangle.depthA * v[0].x - triangle.depthB * v[0].y;
+
+		const unsigned int index = static_cast<unsigned int>(triangles.size());
+		triangles.push_back(triangle);
+		for (int ty = triangle.y0 / TILE_HEIGHT; ty <= triangle.y1 / TILE_HEIGHT; ++ty)
+			for (int tx = triangle.x0 / TILE_WIDTH; tx <= triangle.x1 / TILE_WIDTH; ++tx)
+				bins[static_cast<size_t>(ty) * tilesX + tx].push_back(index);
+	}
+
+	/*!
+	*  \brief Rasterizes the triangles binned to a tile, 4 pixels at a time, and records its farthest depth
+	*/
+	void rasterizeTile(size_t tile)
+	{
+		const std::vector<unsigned int> & bin = bins[tile];
+		const int tileX = static_cast<int>(tile % tilesX) * TILE_WIDTH;
+		const int tileY = static_cast<int>(tile / tilesX) * TILE_HEIGHT;
+
+		for (size_t b = 0; b < bin.size(); ++b)
+		{
+			const Triangle & triangle = triangles[bin[b]];
+			const int x0 = std::max(tileX, triangle.x0) & ~3;
+			const int x1 = std::min(tileX + TILE_WIDTH - 1, triangle.x1);
+			const int y0 = std::max(tileY, triangle.y0);
+			const int y1 = std::min(tileY + TILE_HEIGHT - 1, triangle.y1);
+
+#ifdef OPENGLENGINE_USE_SSE
+			__m128 a[3], b4[3], c[3];
+			for (int e = 0; e < 3; ++e)
+			{
+				a[e] = _mm_set1_ps(triangle.edgeA[e]);
+				b4[e] = _mm_set1_ps(triangle.edgeB[e]);
+				c[e] = _mm_set1_ps(triangle.edgeC[e]);
+			}
+			const __m128 depthA = _mm_set1_ps(triangle.depthA), depthB = _mm_set1_ps(triangle.depthB), depthC = _mm_set1_ps(triangle.depthC);
+			const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+			const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			for (int y = y0; y <= y1; ++y)
+			{
+				const __m128 py = _mm_set1_ps(static_cast<float>(y) + 0.5f);
+				float * row = &depth[static_cast<size_t>(y) * width];
+				for (int x = x0; x <= x1; x += 4)
+				{
+					const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+					__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], px), _mm_mul_ps(b4[0], py)), c[0]), zero);
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a[1], px), _mm_mul_ps(b4[1], py)), c[1]), zero));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a[2], px), _mm_mul_ps(b4[2], py)), c[2]), zero));
+					if (_mm_movemask_ps(inside) == 0)
+						continue;
+					const __m128 z = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(depthA, px), _mm_mul_ps(depthB, py)), depthC), zero), one);
+					const __m128 previous = _mm_loadu_ps(row + x);
+					const __m128 nearest = _mm_min_ps(previous, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+				}
+			}
+#else
+			for (int y = y0; y <= y1; ++y)
+			{
+				const float py = static_cast<float>(y) + 0.5f;
+				float * row = &depth[static_cast<size_t>(y) * width];
+				for (int x = x0; x <= x1; ++x)
+				{
+					const float px = static_cast<float>(x) + 0.5f;
+					bool inside = true;
+					for (int e = 0; e < 3 && inside; ++e)
+						inside = triangle.edgeA[e] * px + triangle.edgeB[e] * py + triangle.edgeC[e] >= 0.0f;
+					if (!inside)
+						continue;
+					const float z = std::min(std::max(triangle.depthA * px + triangle.depthB * py + triangle.depthC, 0.0f), 1.0f);
+					row[x] = std::min(row[x], z);
+				}
+			}
+#endif
+		}
+
+		float farthest = 0.0f;
+		for (int y = tileY; y < tileY + TILE_HEIGHT; ++y)
+		{
+			const float * row = &depth[static_cast<size_t>(y) * width];
+			for (int x = tileX; x < tileX + TILE_WIDTH; ++x)
+				farthest = std::max(farthest, row[x]);
+		}
+		tileFarthest[tile] = farthest;
+	}
+};
+
+/*@}*/
+
+}
+
+#endif
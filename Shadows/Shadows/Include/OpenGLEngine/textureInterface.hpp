@@ -21,6 +21,8 @@
 // CUSTOM
 ////////////////////////
 #include "shaderInterface.hpp"
+#include "programReflection.hpp"
+#include "glState.hpp"
 
 namespace OpenGLEngine
 {
@@ -46,7 +48,10 @@ namespace OpenGLEngine
 *			name, texture name: std::string \n
 *			type, texture type (2D or cube-map): std::string \n
 *			\n
-*			virtual binding function to input shader location
+*			virtual binding function to input shader location \n
+*			\n
+*			bindTexture is also compiled into the engine library: it binds directly (invalidate GLState's textures after it). \n
+*			bindCached binds through GLState, and sets the sampler through the ProgramReflection of the shader, only when it reads another unit
 */
 struct Texture {
 	unsigned int ID; /**< ID, OpenGL texture refence: unsigned int */
@@ -85,6 +90,29 @@ struct Texture {
 	virtual void bindTexture(GLuint locInShader, Shader * shader)
 	{
 	}
+
+	/*!
+	*  \brief Binds texture to input shader through the state cache (cf GLState::bindTexture, linkSampler): \n
+	*		same result as bindTexture, without the calls that would not change anything
+	*
+	* \param GLuint locInShader: texture unit
+	* \param Shader * shader: input shader (in use)
+	*/
+	void bindCached(GLuint locInShader, Shader * shader);
+
+	/*!
+	*  \brief Points the sampler of input shader to a texture unit (skipped if it already reads it)
+	*
+	* \param GLuint locInShader: texture unit
+	* \param Shader * shader: input shader (in use)
+	*/
+	void linkSampler(GLuint locInShader, Shader * shader)
+	{
+		const unsigned int slot = ProgramReflection::slotOf(name);
+		ProgramReflection & program = ProgramReflection::of(shader->Program);
+		if (program.samplerChanged(slot, static_cast<GLint>(locInShader)))
+			glUniform1i(program.location(slot), static_cast<GLint>(locInShader));
+	}
 };
 
 /*!
@@ -143,6 +171,13 @@ struct TextureCube : Texture
 
 
 
+inline void Texture::bindCached(GLuint locInShader, Shader * shader)
+{
+	GLState::get().bindTexture(locInShader, dynamic_cast<TextureCube *>(this) != NULL ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, ID);
+	linkSampler(locInShader, shader);
+}
+
+
 /*!
 *  \brief Texture Client Wrapper: \n
 *		Interface for a texture (both 2D and cubemap) handleing \n
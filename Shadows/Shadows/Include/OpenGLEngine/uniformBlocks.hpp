@@ -0,0 +1,383 @@
+#ifndef UNIFORMBLOCKS_HPP
+#define UNIFORMBLOCKS_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+#include <glm\gtc\type_ptr.hpp>
+
+////////////////////////
+// STL
+////////////////////////
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "shaderInterface.hpp"
+#include "programReflection.hpp"
+#include "glState.hpp"
+#include "sampleTables.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file uniformBlocks.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SCENE */
+/*@{*/
+
+
+/*!
+*  \brief Per frame uniform block (std140, 208 bytes, binding UniformBlocks::FRAME_BINDING): \n
+*		layout (std140) uniform FrameUniforms { mat4 viewMatrix; mat4 projectionMatrix; mat4 cameraMovment; vec4 cameraPosition; vec4 viewport; };
+*/
+struct FrameUniforms
+{
+	glm::mat4 viewMatrix;
+	glm::mat4 projectionMatrix;
+	glm::mat4 cameraMovment;
+	glm::vec4 cameraPosition; /**< world space camera position (w = 1) */
+	glm::vec4 viewport; /**< width, height, near plane, far plane */
+};
+
+/*!
+*  \brief Per object uniform block (std140, 128 bytes, binding UniformBlocks::OBJECT_BINDING): \n
+*		layout (std140) uniform ObjectUniforms { mat4 modelMatrix; mat4 normalMatrix; };
+*/
+struct ObjectUniforms
+{
+	glm::mat4 modelMatrix;
+	glm::mat4 normalMatrix;
+};
+
+
+/*!
+*  \brief Uniform Blocks: \n
+*		the default uniforms (cf Scene::linkDefaultUniforms) as two std140 uniform buffers, instead of glUniform* calls per program and mesh: \n
+*			- FrameUniforms: one record, sent once per frame (setFrame) \n
+*			- ObjectUniforms: one record per draw, all sent in one upload (uploadObjects), each bound by offset (bindObject). \n
+*			  Record 0 holds the frame's default model and normal matrices, for draws that are not per object \n
+*
+*		Programs are bound to the binding points once (bindProgram), along with the SampleTables blocks they declare. \n
+*		A shader that only declares FrameUniforms needs no setup: block bindings default to 0, FRAME_BINDING. \n
+*		It may keep plain modelMatrix / normalMatrix uniforms (set by Scene::linkDefaultUniforms)
+*
+*	\code{.cpp}
+*		std::pair<FrameUniforms, ObjectUniforms> defaults = blocks.captureDefaults([&](Shader * shader) { scene.linkDefaultUniforms(shader, &camera, &window); });
+*		blocks.setFrame(defaults.first, defaults.second); // cf SceneRenderer::updateFrameUniforms
+*		size_t object = blocks.pushObject(objectUniforms); // per draw
+*		blocks.uploadObjects();
+*		shader.Use();
+*		if (blocks.bindProgram(&shader))
+*			blocks.bindObject(object);
+*	\endcode
+*/
+class UniformBlocks
+{
+public:
+	//! binding point of FrameUniforms
+	static const GLuint FRAME_BINDING = 0;
+	//! binding point of ObjectUniforms
+	static const GLuint OBJECT_BINDING = 1;
+
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Constructor: \n
+	*		the buffers are allocated by the first setFrame
+	*/
+	UniformBlocks()
+	{}
+
+	/*!
+	*  \brief Destructor: \n
+	*		deletes the buffers and the capture program
+	*/
+	~UniformBlocks()
+	{
+		if (frameBuffer != 0)
+			glDeleteBuffers(1, &frameBuffer);
+		if (objectBuffer != 0)
+			glDeleteBuffers(1, &objectBuffer);
+		if (probe)
+		{
+			ProgramReflection::forget(probe->Program);
+			GLState::get().programDeleted(probe->Program);
+			glDeleteProgram(probe->Program);
+		}
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	const FrameUniforms & getFrame() const
+	{
+		return frame;
+	}
+	/*!
+	*  \brief Returns record 0: the frame's default model and normal matrices
+	*/
+	const ObjectUniforms & getDefaultObject() const
+	{
+		return defaultObject;
+	}
+	/*!
+	*  \brief Returns the number of object records of the frame (record 0 included)
+	*/
+	size_t getObjectCount() const
+	{
+		return nbObjects;
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Binds the blocks a program declares to FRAME_BINDING and OBJECT_BINDING, and its sample tables (looked up once per program)
+	* \param Shader * shader : linked program
+	* \return true if the program reads ObjectUniforms (its model matrix comes from bindObject), \n
+	*		false if it uses plain modelMatrix / normalMatrix uniforms
+	*/
+	bool bindProgram(Shader * shader)
+	{
+		std::unordered_map<GLuint, bool>::const_iterator known = programs.find(shader->Program);
+		if (known != programs.end())
+			return known->second;
+
+		const GLuint frameIndex = glGetUniformBlockIndex(shader->Program, "FrameUniforms");
+		if (frameIndex != GL_INVALID_INDEX)
+			glUniformBlockBinding(shader->Program, frameIndex, FRAME_BINDING);
+		const GLuint objectIndex = glGetUniformBlockIndex(shader->Program, "ObjectUniforms");
+		if (objectIndex != GL_INVALID_INDEX)
+			glUniformBlockBinding(shader->Program, objectIndex, OBJECT_BINDING);
+		SampleTables::get().bindProgram(shader);
+
+		return programs[shader->Program] = objectIndex != GL_INVALID_INDEX;
+	}
+
+	/*!
+	*  \brief Reads the default uniforms back from a capture program: \n
+	*		the callback links them exactly as it would for any program, then they are read with glGetUniformfv \n
+	*		(uniforms the callback leaves alone read as identity)
+	* \param std::function<void(Shader *)> linkDefaults : links the default uniforms of a program (cf Scene::linkDefaultUniforms)
+	* \return FrameUniforms (matrices only: cameraPosition and viewport are left to the caller) and ObjectUniforms (record 0) of the frame
+	* \note leaves the capture program in use
+	*/
+	std::pair<FrameUniforms, ObjectUniforms> captureDefaults(std::function<void(Shader *)> linkDefaults)
+	{
+		if (!probe)
+			buildProbe();
+
+		GLState::get().useProgram(probe->Program);
+		const glm::mat4 identity(1.0f);
+		for (int i = 0; i < NB_DEFAULT_UNIFORMS; ++i)
+			if (probeLocations[i] >= 0)
+				glUniformMatrix4fv(probeLocations[i], 1, GL_FALSE, glm::value_ptr(identity));
+		linkDefaults(probe.get());
+
+		std::pair<FrameUniforms, ObjectUniforms> defaults;
+		glm::mat4 * matrices[NB_DEFAULT_UNIFORMS] = { &defaults.second.modelMatrix, &defaults.first.cameraMovment, &defaults.second.normalMatrix,
+			&defaults.first.viewMatrix, &defaults.first.projectionMatrix };
+		for (int i = 0; i < NB_DEFAULT_UNIFORMS; ++i)
+		{
+			*matrices[i] = identity;
+			if (probeLocations[i] >= 0)
+				glGetUniformfv(probe->Program, probeLocations[i], glm::value_ptr(*matrices[i]));
+		}
+		return defaults;
+	}
+
+	/*!
+	*  \brief Starts a frame: sends FrameUniforms, resets the object records to record 0 and sends it
+	* \param const FrameUniforms & frame : per frame record (cf captureDefaults)
+	* \param const ObjectUniforms & defaults : record 0, the default model and normal matrices
+	* \return both buffers are bound (record 0 on OBJECT_BINDING)
+	*/
+	void setFrame(const FrameUniforms & frame, const ObjectUniforms & defaults)
+	{
+		this->frame = frame;
+		defaultObject = defaults;
+
+		if (frameBuffer == 0)
+		{
+			glGenBuffers(1, &frameBuffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+			glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &this->frame);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, frameBuffer);
+
+		nbObjects = 0;
+		pushObject(defaults);
+		uploadObjects();
+	}
+
+	/*!
+	*  \brief Appends an object record (sent by the next uploadObjects)
+	* \return index of the record, for bindObject
+	*/
+	size_t pushObject(const ObjectUniforms & object)
+	{
+		const size_t index = reserveObjects(1);
+		writeObject(index, object);
+		return index;
+	}
+
+	/*!
+	*  \brief Appends count object records, filled later with writeObject (e.g. by several threads, cf RenderQueue::submit)
+	* \return index of the first record
+	*/
+	size_t reserveObjects(size_t count)
+	{
+		if (objectStride == 0)
+		{
+			GLint alignment = 0;
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			const size_t align = alignment > 0 ? static_cast<size_t>(alignment) : 256;
+			objectStride = (sizeof(ObjectUniforms) + align - 1) / align * align;
+		}
+		if ((nbObjects + count) * objectStride > objects.size())
+			objects.resize(std::max((nbObjects + count) * objectStride, 2 * objects.size()));
+		const size_t first = nbObjects;
+		nbObjects += count;
+		return first;
+	}
+	/*!
+	*  \brief Fills a record returned by pushObject or reserveObjects (no OpenGL call: records apart may be written concurrently)
+	*/
+	void writeObject(size_t index, const ObjectUniforms & object)
+	{
+		std::memcpy(&objects[index * objectStride], &object, sizeof(ObjectUniforms));
+	}
+
+	/*!
+	*  \brief Sends every object record of the frame in one upload (the previous content is orphaned), binds record 0
+	*/
+	void uploadObjects()
+	{
+		if (objectBuffer == 0)
+			glGenBuffers(1, &objectBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(nbObjects * objectStride), &objects[0], GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		bindObject(0);
+	}
+
+	/*!
+	*  \brief Binds an object record to OBJECT_BINDING (glBindBufferRange)
+	* \param size_t index : record returned by pushObject, 0 for the default matrices
+	*/
+	void bindObject(size_t index)
+	{
+		glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BINDING, objectBuffer, static_cast<GLintptr>(index * objectStride), sizeof(ObjectUniforms));
+	}
+
+
+private:
+	FrameUniforms frame;
+	ObjectUniforms defaultObject;
+
+	GLuint frameBuffer = 0, objectBuffer = 0;
+	//! object records, objectStride bytes apart (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+	std::vector<unsigned char> objects;
+	size_t objectStride = 0;
+	size_t nbObjects = 0;
+
+	//! programs seen by bindProgram: whether they read ObjectUniforms
+	std::unordered_map<GLuint, bool> programs;
+
+	//! capture program, declaring every default uniform as a plain uniform (cf captureDefaults), and their locations
+	static const int NB_DEFAULT_UNIFORMS = 5;
+	std::unique_ptr<Shader> probe;
+	GLint probeLocations[NB_DEFAULT_UNIFORMS];
+
+	/*!
+	*  \brief Compiles the capture program: every default uniform is used, so that none is optimized out
+	*/
+	void buildProbe()
+	{
+		const GLchar * vShaderCode = "#version 330 core\n"
+			"uniform mat4 modelMatrix;\n"
+			"uniform mat4 cameraMovment;\n"
+			"uniform mat4 normalMatrix;\n"
+			"uniform mat4 viewMatrix;\n"
+			"uniform mat4 projectionMatrix;\n"
+			"void main()\n"
+			"{\n"
+			"	gl_Position = projectionMatrix * viewMatrix * cameraMovment * normalMatrix * modelMatrix * vec4(0.0, 0.0, 0.0, 1.0);\n"
+			"}\n";
+		const GLchar * fShaderCode = "#version 330 core\n"
+			"out vec4 color;\n"
+			"void main()\n"
+			"{\n"
+			"	color = vec4(1.0);\n"
+			"}\n";
+
+		GLuint shaders[2] = { glCreateShader(GL_VERTEX_SHADER), glCreateShader(GL_FRAGMENT_SHADER) };
+		glShaderSource(shaders[0], 1, &vShaderCode, NULL);
+		glShaderSource(shaders[1], 1, &fShaderCode, NULL);
+		const GLuint program = glCreateProgram();
+		ProgramReflection::forget(program); // the name of a deleted program may be reused
+		for (int i = 0; i < 2; ++i)
+		{
+			glCompileShader(shaders[i]);
+			glAttachShader(program, shaders[i]);
+		}
+		glLinkProgram(program);
+
+		GLint success;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			GLchar infoLog[512];
+			glGetProgramInfoLog(program, 512, NULL, infoLog);
+			std::cout << "ERROR::UNIFORMBLOCKS::PROBE::LINKING_FAILED\n" << infoLog << std::endl;
+		}
+		for (int i = 0; i < 2; ++i)
+			glDeleteShader(shaders[i]);
+
+		// a Shader only wraps a program ID: its default program is replaced by the capture one
+		probe.reset(new Shader());
+		ProgramReflection::forget(probe->Program);
+		GLState::get().programDeleted(probe->Program);
+		glDeleteProgram(probe->Program);
+		probe->Program = program;
+
+		const char * names[NB_DEFAULT_UNIFORMS] = { "modelMatrix", "cameraMovment", "normalMatrix", "viewMatrix", "projectionMatrix" };
+		for (int i = 0; i < NB_DEFAULT_UNIFORMS; ++i)
+			probeLocations[i] = glGetUniformLocation(program, names[i]);
+	}
+
+	UniformBlocks(const UniformBlocks &);
+	UniformBlocks & operator=(const UniformBlocks &);
+};
+
+/*@}*/
+
+}
+
+#endif
@@ -28,9 +28,10 @@
 #include <OpenGLEngine\textureInterface.hpp> // texture wrapper
 #include <OpenGLEngine\uniformInterface.hpp> // uniform wrapper
 #include <OpenGLEngine\mesh.hpp> // mesh wrapper
-#include <OpenGLEngine\scene.hpp> // scene manager
+#include <OpenGLEngine\sceneRenderer.hpp> // scene manager
 #include <OpenGLEngine\frameBuffer.hpp> // FBO wrapper
 #include <OpenGLEngine\renderBuffer.hpp> // RBO wrapper
+#include <OpenGLEngine\gpuProfiler.hpp> // GPU time per render pass (timer queries)
 
 
 ////////////////////////
@@ -176,12 +177,18 @@ int main(int argc, char ** argv)
 	/////////////////////////////
 	float y_translate = -2.0;
 	glm::vec3 meshPos = glm::vec3(0.0, -3.0 + y_translate, 0.0);
-	OpenGLEngine::Geometry mesh_geometry("Resources/Models/clumsy-dragon.obj", meshPos, 5.0);
-
-	OpenGLEngine::Geometry mesh2_geometry("Resources/Models/stanford-dragon.obj", meshPos, 1.0);
+	// the dragons get a LOD chain (50%, 25%, 10%, 3% of their triangles): Scene::drawMeshes picks a level from the projected error
+	OpenGLEngine::GeometryOptions meshOptions;
+	meshOptions.setLODChain();
+	OpenGLEngine::Geometry mesh_geometry;
+	mesh_geometry.loadOBJ("Resources/Models/clumsy-dragon.obj", meshPos, 5.0, meshOptions);
+
+	OpenGLEngine::Geometry mesh2_geometry;
+	mesh2_geometry.loadOBJ("Resources/Models/stanford-dragon.obj", meshPos, 1.0, meshOptions);
 	mesh2_geometry.setWorldSpacePosition(glm::vec3(-5.5, -2.0 + y_translate, 0.0));
 
-	OpenGLEngine::Geometry mesh3_geometry("Resources/Models/dragon-xyz-rgb-scan.obj", meshPos, 1.0);
+	OpenGLEngine::Geometry mesh3_geometry;
+	mesh3_geometry.loadOBJ("Resources/Models/dragon-xyz-rgb-scan.obj", meshPos, 1.0, meshOptions);
 	mesh3_geometry.setWorldSpacePosition(glm::vec3(0.5, -2.0 + y_translate, -8));
 
 	OpenGLEngine::Geometry plane_geometry("PlaneGeometry", 40, glm::vec3(0.0, -2.0 + y_translate, 0.0));
@@ -215,9 +222,9 @@ int main(int argc, char ** argv)
 	//
 	// Memory managment is left to the user. No copies are done
 	//
-	// => <OpenGLEngine\scene.hpp>
+	// => <OpenGLEngine\sceneRenderer.hpp>
 	////////////////////////
-	OpenGLEngine::Scene scene;
+	OpenGLEngine::SceneRenderer scene;
 	scene.addMesh(&clumbsy_dragon);
 	scene.addMesh(&standford_dragon_bunny);
 	scene.addMesh(&xyz_dragon);
@@ -296,6 +303,7 @@ int main(int argc, char ** argv)
 	// 1st pass: render depth map
 	////////////////////////
 	shadowMap_FBO.bindFBO();
+	OpenGLEngine::GLState::get().invalidate(); // framebuffer and viewport set by the engine library, behind the state cache
 
 	// render from light position
 	glm::vec3 cameraPos = camera.getCameraPosition();
@@ -315,28 +323,33 @@ int main(int argc, char ** argv)
 	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
 	uNearFarPlane.linkUniform(&shadowMapShader);
-	// draw scene (depth only)
-	scene.drawMeshes(&camera, &window, &shadowMapShader);
+	// draw scene (depth only), two levels coarser than what the camera would pick: the blurred variance shadow map hides the difference
+	// (drawMeshes updates the uniform blocks with the light's view and projection, for depthShader.vert)
+	scene.drawMeshes(&camera, &window, &shadowMapShader, 2);
 
 
 	shadowMap_FBO.unbindFBO();
+	OpenGLEngine::GLState::get().invalidate();
 	
 	////////////////////////
 	// 2nd pass: blur depth map
 	////////////////////////
 	biLateralBlur_FBO.bindFBO();
+	OpenGLEngine::GLState::get().invalidate();
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 	bilateralBlurShader.Use();
 
 	// Active proper texture unit before binding
 	shadowMap_FBO.bindTextureTargets();
+	OpenGLEngine::GLState::get().invalidateTextures(); // bound by the engine library, behind the state cache
 	shadowMap_FBO.linkTextureTargets(&std::vector<std::string>{ "frag_depth" }, &bilateralBlurShader);
 
 	// draw quad
-	screenQuadGeometry.draw();
+	screenQuadGeometry.drawGeometry();
 
 	biLateralBlur_FBO.unbindFBO();
+	OpenGLEngine::GLState::get().invalidate();
 	
 
 	// Syncronyse
@@ -348,6 +361,7 @@ int main(int argc, char ** argv)
 	////////////////////////
 
 	biLateralBlur_FBO.bindFBO();
+	OpenGLEngine::GLState::get().invalidate();
 
 	std::vector< float > shadowMap_rawData(3 * ShadowMap_width * ShadowMap_height);
 	glPixelStorei(GL_PACK_ALIGNMENT, 1);
@@ -372,6 +386,7 @@ int main(int argc, char ** argv)
 	glFinish();
 
 	biLateralBlur_FBO.unbindFBO();
+	OpenGLEngine::GLState::get().invalidate();
 
 	////////////////////////
 	// Declare Texture uniform
@@ -424,11 +439,13 @@ int main(int argc, char ** argv)
 	////////////////////////
 
 	stopWatch timer; // FPS counter
+	OpenGLEngine::GPUProfiler profiler; // GPU time per pass, read back a few frames later (no glFinish)
 
 	// Render loop
 	while (window.isOpen())
 	{
 		timer.start();
+		profiler.beginFrame();
 
 		////////////////////////
 		//	- Update Events
@@ -461,22 +478,31 @@ int main(int argc, char ** argv)
 
 
 
+		profiler.endFrame();
+
 		// Swap the screen buffers
 		window.draw();
 
-		// Syncronyse
-		glFinish();
-
 
 		timer.end();
 		double render_time = timer.time();
-		std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+		// every 120 frames: CPU frame time and GPU time of each pass
+		if (profiler.getFrameCount() % 120 == 0)
+		{
+			std::cout << "1F: " << 1000.0*render_time << "ms" << "," << "FPS: " << 1.0 / render_time << std::endl;
+			profiler.print(std::cout);
+		}
 	}
 
 	// Melete meshes
 	// Properly de-allocate all resources once they've outlived their purpose
 	// => done in mesh desctuctor
 
+	// GPU time statistics of the last frames
+	profiler.flush();
+	profiler.writeCSV("gpuProfile.csv");
+	profiler.writeJSON("gpuProfile.json");
+
 	window.isClosed();
 
 
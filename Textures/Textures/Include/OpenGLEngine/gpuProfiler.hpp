@@ -0,0 +1,466 @@
+#ifndef GPUPROFILER_HPP
+#define GPUPROFILER_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// STL
+////////////////////////
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+
+namespace OpenGLEngine
+{
+
+/**
+* \file gpuProfiler.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup UTILITIES */
+/*@{*/
+
+
+/*!
+*  \brief Statistics of a pass over the last frames (GPU time, in milliseconds)
+*/
+struct PassStats
+{
+	std::string name;
+	size_t frames = 0; /**< frames in the statistics (at most the profiler window) */
+	size_t total = 0; /**< frames measured since the start */
+	double last = 0.0; /**< most recent frame */
+	double min = 0.0;
+	double avg = 0.0;
+	double p99 = 0.0; /**< 99th percentile */
+};
+
+
+/*!
+*  \brief GPU Profiler: \n
+*		GPU time of render passes, from GL_TIMESTAMP queries (glQueryCounter) issued around each pass. \n
+*		Nothing waits for the GPU: the queries of a frame are read back latency frames later, when that frame's slot \n
+*		of the query ring comes around again. A frame whose results are still not available then is dropped (getDroppedFrames). \n
+*
+*		Every pass keeps a rolling window of per frame times (a pass measured several times in a frame adds up), \n
+*		summed up as min / avg / p99 (getStats), printed (print) or exported (writeCSV, writeJSON). \n
+*		The "frame" pass spans beginFrame to endFrame.
+*
+*	\code{.cpp}
+*		GPUProfiler profiler;
+*		while (window.isOpen())
+*		{
+*			profiler.beginFrame();
+*			{
+*				GPUProfiler::Scope pass(profiler, "SSAO");
+*				... // draw calls of the pass
+*			}
+*			profiler.endFrame();
+*			window.draw();
+*		}
+*		profiler.flush(); // waits for the frames in flight
+*		profiler.writeJSON("gpuProfile.json");
+*	\endcode
+*
+*	\note timestamps (unlike GL_TIME_ELAPSED queries) may nest and overlap: scopes can be nested freely. \n
+*		Requires OpenGL 3.3 or ARB_timer_query, cf isSupported (otherwise markers do nothing)
+*/
+class GPUProfiler
+{
+public:
+	//! frames between issuing the queries of a frame and reading them back
+	static const size_t DEFAULT_LATENCY = 4;
+	//! frames per pass in the rolling statistics
+	static const size_t DEFAULT_WINDOW = 240;
+
+	/*!
+	*  \brief Scoped marker: measures a pass from its construction to its destruction
+	*/
+	class Scope
+	{
+	public:
+		Scope(GPUProfiler & profiler, const std::string & name)
+			: profiler(profiler), marker(profiler.begin(name))
+		{}
+		~Scope()
+		{
+			profiler.end(marker);
+		}
+
+	private:
+		GPUProfiler & profiler;
+		size_t marker;
+
+		Scope(const Scope &);
+		Scope & operator=(const Scope &);
+	};
+
+	///////////////////////////////////////////
+	//	CONSTUCTOR & DESTRUCTOR
+	///////////////////////////////////////////
+	/*!
+	*  \brief Constructor (after glewInit): \n
+	*		query objects are created as passes are measured
+	*
+	* \param size_t latency : frames in flight before a frame is read back (at least 1)
+	* \param size_t window : frames per pass in the statistics
+	*/
+	GPUProfiler(size_t latency = DEFAULT_LATENCY, size_t window = DEFAULT_WINDOW)
+		: frames(std::max<size_t>(latency, 1)), window(std::max<size_t>(window, 1)), supported(isSupported())
+	{
+		passIndex("frame");
+	}
+	/*!
+	*  \brief Destructor: \n
+	*		deletes the query objects
+	*/
+	~GPUProfiler()
+	{
+		for (size_t f = 0; f < frames.size(); ++f)
+			if (!frames[f].queries.empty())
+				glDeleteQueries(static_cast<GLsizei>(frames[f].queries.size()), &frames[f].queries[0]);
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Returns true if the context has timestamp queries
+	*/
+	static bool isSupported()
+	{
+		return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	}
+	/*!
+	*  \brief Returns the number of frames begun
+	*/
+	size_t getFrameCount() const
+	{
+		return frameCount;
+	}
+	/*!
+	*  \brief Returns the number of frames whose queries were not available when read back (not in the statistics)
+	*/
+	size_t getDroppedFrames() const
+	{
+		return droppedFrames;
+	}
+	/*!
+	*  \brief Returns the statistics of every pass, in order of first use ("frame" first)
+	*/
+	std::vector<PassStats> getStats() const
+	{
+		std::vector<PassStats> stats;
+		for (size_t p = 0; p < passes.size(); ++p)
+			stats.push_back(getStats(p));
+		return stats;
+	}
+	/*!
+	*  \brief Returns the statistics of a pass (empty if it was never measured)
+	*/
+	PassStats getStats(const std::string & name) const
+	{
+		std::unordered_map<std::string, size_t>::const_iterator it = passNames.find(name);
+		if (it == passNames.end())
+		{
+			PassStats empty;
+			empty.name = name;
+			return empty;
+		}
+		return getStats(it->second);
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Starts a frame: reads back the frame issued latency frames ago (if its results are available) and \n
+	*		reuses its queries, then starts the "frame" pass
+	*/
+	void beginFrame()
+	{
+		current = frameCount % frames.size();
+		collect(frames[current], false);
+		++frameCount;
+		frameMarker = begin("frame");
+	}
+	/*!
+	*  \brief Ends the frame: ends the "frame" pass (call it before swapping the buffers)
+	*/
+	void endFrame()
+	{
+		end(frameMarker);
+		frames[current].pending = !frames[current].markers.empty();
+	}
+
+	/*!
+	*  \brief Starts measuring a pass (cf Scope)
+	* \param const std::string & name : pass name, the same every frame
+	* \return marker to give to end
+	*/
+	size_t begin(const std::string & name)
+	{
+		Frame & frame = frames[current];
+		Marker marker;
+		marker.pass = passIndex(name);
+		marker.begin = query(frame);
+		marker.end = 0;
+		if (supported)
+			glQueryCounter(marker.begin, GL_TIMESTAMP);
+		frame.markers.push_back(marker);
+		return frame.markers.size() - 1;
+	}
+	/*!
+	*  \brief Ends measuring a pass
+	* \param size_t marker : returned by begin, in the same frame
+	*/
+	void end(size_t marker)
+	{
+		Frame & frame = frames[current];
+		if (marker >= frame.markers.size())
+			return;
+		frame.markers[marker].end = query(frame);
+		if (supported)
+			glQueryCounter(frame.markers[marker].end, GL_TIMESTAMP);
+		frame.lastQuery = frame.markers[marker].end;
+	}
+
+	/*!
+	*  \brief Reads back every frame in flight, waiting for the GPU (e.g. before exporting the statistics at exit)
+	*/
+	void flush()
+	{
+		for (size_t f = 1; f <= frames.size(); ++f)
+			collect(frames[(current + f) % frames.size()], true);
+	}
+
+	/*!
+	*  \brief Prints one line per pass: avg, min and p99 over the window (ms)
+	*/
+	void print(std::ostream & os) const
+	{
+		const std::vector<PassStats> stats = getStats();
+		for (size_t p = 0; p < stats.size(); ++p)
+			os << std::left << std::setw(16) << stats[p].name << std::right << std::fixed << std::setprecision(3)
+				<< " avg " << stats[p].avg << "ms  min " << stats[p].min << "ms  p99 " << stats[p].p99 << "ms" << std::endl;
+		os.unsetf(std::ios::floatfield);
+	}
+
+	/*!
+	*  \brief Writes the statistics as CSV: a header line, then one line per pass (times in ms)
+	*/
+	void writeCSV(std::ostream & os) const
+	{
+		const std::vector<PassStats> stats = getStats();
+		os << "pass,frames,total,last_ms,min_ms,avg_ms,p99_ms" << std::endl;
+		for (size_t p = 0; p < stats.size(); ++p)
+			os << stats[p].name << "," << stats[p].frames << "," << stats[p].total << "," << stats[p].last << ","
+				<< stats[p].min << "," << stats[p].avg << "," << stats[p].p99 << std::endl;
+	}
+	/*!
+	*  \brief Writes the statistics as JSON: { "frames", "dropped_frames", "window", "passes": [ ... ] } (times in ms)
+	*/
+	void writeJSON(std::ostream & os) const
+	{
+		const std::vector<PassStats> stats = getStats();
+		os << "{" << std::endl;
+		os << "  \"frames\": " << frameCount << "," << std::endl;
+		os << "  \"dropped_frames\": " << droppedFrames << "," << std::endl;
+		os << "  \"window\": " << window << "," << std::endl;
+		os << "  \"passes\": [";
+		for (size_t p = 0; p < stats.size(); ++p)
+		{
+			os << (p == 0 ? "" : ",") << std::endl << "    { \"name\": \"" << escape(stats[p].name) << "\", \"frames\": " << stats[p].frames
+				<< ", \"total\": " << stats[p].total << ", \"last_ms\": " << stats[p].last << ", \"min_ms\": " << stats[p].min
+				<< ", \"avg_ms\": " << stats[p].avg << ", \"p99_ms\": " << stats[p].p99 << " }";
+		}
+		os << std::endl << "  ]" << std::endl << "}" << std::endl;
+	}
+	/*!
+	*  \brief Writes the statistics to a file, as CSV or JSON
+	* \return true if the file could be written
+	*/
+	bool writeCSV(const std::string path) const
+	{
+		std::ofstream file(path.c_str());
+		if (!file.good())
+			return false;
+		writeCSV(file);
+		return file.good();
+	}
+	bool writeJSON(const std::string path) const
+	{
+		std::ofstream file(path.c_str());
+		if (!file.good())
+			return false;
+		writeJSON(file);
+		return file.good();
+	}
+
+
+private:
+	//! a measured pass in a frame: its two timestamp queries
+	struct Marker
+	{
+		size_t pass;
+		GLuint begin, end;
+	};
+	//! a slot of the query ring: the queries issued during one frame
+	struct Frame
+	{
+		std::vector<GLuint> queries;
+		size_t used = 0;
+		std::vector<Marker> markers;
+		GLuint lastQuery = 0;
+		bool pending = false;
+	};
+	//! a pass: rolling window of per frame times (ms)
+	struct Pass
+	{
+		std::string name;
+		std::vector<double> times;
+		size_t next = 0;
+		size_t total = 0;
+		double last = 0.0;
+	};
+
+	std::vector<Frame> frames;
+	size_t current = 0;
+	size_t frameCount = 0, droppedFrames = 0;
+	size_t frameMarker = 0;
+
+	std::vector<Pass> passes;
+	std::unordered_map<std::string, size_t> passNames;
+	size_t window;
+	bool supported;
+
+	size_t passIndex(const std::string & name)
+	{
+		std::unordered_map<std::string, size_t>::const_iterator it = passNames.find(name);
+		if (it != passNames.end())
+			return it->second;
+		Pass pass;
+		pass.name = name;
+		passes.push_back(pass);
+		return passNames[name] = passes.size() - 1;
+	}
+
+	/*!
+	*  \brief Returns the next free query object of a frame (created the first time)
+	*/
+	GLuint query(Frame & frame)
+	{
+		if (frame.used == frame.queries.size())
+		{
+			GLuint id = 0;
+			if (supported)
+				glGenQueries(1, &id);
+			frame.queries.push_back(id);
+		}
+		return frame.queries[frame.used++];
+	}
+
+	/*!
+	*  \brief Adds the times of a frame to the pass windows and frees its queries for reuse
+	* \param bool wait : true => waits for the results, false => drops the frame if they are not available yet
+	*/
+	void collect(Frame & frame, bool wait)
+	{
+		if (frame.pending && supported)
+		{
+			GLint available = GL_FALSE;
+			if (!wait)
+				glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (wait || available)
+			{
+				std::vector<double> frameTimes(passes.size(), -1.0);
+				for (size_t m = 0; m < frame.markers.size(); ++m)
+				{
+					const Marker & marker = frame.markers[m];
+					if (marker.end == 0)
+						continue;
+					GLuint64 begin = 0, end = 0;
+					glGetQueryObjectui64v(marker.begin, GL_QUERY_RESULT, &begin);
+					glGetQueryObjectui64v(marker.end, GL_QUERY_RESULT, &end);
+					const double time = end > begin ? (end - begin) * 1e-6 : 0.0;
+					frameTimes[marker.pass] = frameTimes[marker.pass] < 0.0 ? time : frameTimes[marker.pass] + time;
+				}
+				for (size_t p = 0; p < frameTimes.size(); ++p)
+					if (frameTimes[p] >= 0.0)
+						record(passes[p], frameTimes[p]);
+			}
+			else
+				++droppedFrames;
+		}
+		frame.markers.clear();
+		frame.used = 0;
+		frame.pending = false;
+	}
+
+	void record(Pass & pass, double time)
+	{
+		if (pass.times.size() < window)
+			pass.times.push_back(time);
+		else
+			pass.times[pass.next] = time;
+		pass.next = (pass.next + 1) % window;
+		pass.last = time;
+		++pass.total;
+	}
+
+	PassStats getStats(size_t p) const
+	{
+		const Pass & pass = passes[p];
+		PassStats stats;
+		stats.name = pass.name;
+		stats.frames = pass.times.size();
+		stats.total = pass.total;
+		stats.last = pass.last;
+		if (pass.times.empty())
+			return stats;
+
+		std::vector<double> sorted = pass.times;
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0.0;
+		for (size_t i = 0; i < sorted.size(); ++i)
+			sum += sorted[i];
+		stats.min = sorted.front();
+		stats.avg = sum / sorted.size();
+		stats.p99 = sorted[std::min(sorted.size() - 1, (sorted.size() * 99 + 99) / 100 - 1)];
+		return stats;
+	}
+
+	static std::string escape(const std::string & s)
+	{
+		std::string escaped;
+		for (size_t i = 0; i < s.size(); ++i)
+		{
+			if (s[i] == '"' || s[i] == '\\')
+				escaped += '\\';
+			escaped += s[i];
+		}
+		return escaped;
+	}
+
+	GPUProfiler(const GPUProfiler &);
+	GPUProfiler & operator=(const GPUProfiler &);
+};
+
+/*@}*/
+
+}
+
+#endif
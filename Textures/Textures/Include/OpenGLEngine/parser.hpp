@@ -10,6 +10,32 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+
+////////////////////////
+// GLM
+////////////////////////
+#include <glm\glm.hpp>
+
+////////////////////////
+// OS (read-only file mapping)
+////////////////////////
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 namespace OpenGLEngine
 {
@@ -140,6 +166,729 @@ namespace parser
 	* \return size_t : index + 1 of last char.
 	*/
 	size_t skipComment(std::vector<char> * buffer, size_t startIndex, std::ifstream * readStream, char comment);
+
+
+
+	///////////////////////////////////////////
+	//	MEMORY-MAPPED PARSING
+	///////////////////////////////////////////
+	/*!
+	*  \brief Zero-allocation parsing path: \n
+	*		The functions above copy every token into a fresh std::string and refill a chunk buffer from a stream. \n
+	*		The path below maps the whole file read-only and tokenizes it in place: \n
+	*			- a Token is a [begin, end) span pointing inside the mapped file (no copy)
+	*			- numbers are scanned straight from the mapping by scanInt/scanFloat
+	*			- records are counted first, the output arrays are allocated once
+	*			- large files are cut at line boundaries and parsed by several threads (cf parseOBJParallel)
+	*
+	*	\code{.cpp}
+	*			parser::OBJData obj;
+	*			if (parser::loadOBJ("Resources/Models/clumsy-dragon.obj", &obj))
+	*				... // obj.positions, obj.normals, obj.uvs, obj.corners
+	*	\endcode
+	*/
+
+	/*!
+	*  \brief MappedFile: \n
+	*		Read-only memory mapping of a whole file (MapViewOfFile on Windows, mmap elsewhere) \n
+	*		The mapping is released when the object goes out of scope
+	*/
+	class MappedFile
+	{
+	public:
+		/*!
+		*  \brief Default Constructor: \n
+		*		nothing is mapped
+		*/
+		MappedFile() : fileData(NULL), fileSize(0)
+		{
+#ifdef _WIN32
+			fileHandle = INVALID_HANDLE_VALUE;
+			mappingHandle = NULL;
+#endif
+		}
+		/*!
+		*  \brief Constructor from file: \n
+		*		maps input file read-only
+		*
+		* \param const std::string filename : path to the file to map
+		*/
+		explicit MappedFile(const std::string filename) : fileData(NULL), fileSize(0)
+		{
+#ifdef _WIN32
+			fileHandle = INVALID_HANDLE_VALUE;
+			mappingHandle = NULL;
+#endif
+			open(filename);
+		}
+		/*!
+		*  \brief Destructor: \n
+		*		unmaps the file
+		*/
+		~MappedFile()
+		{
+			close();
+		}
+
+		/*!
+		*  \brief Maps input file read-only
+		* \param const std::string filename : path to the file to map
+		* \return true if the file could be mapped (an empty file is a valid, empty mapping)
+		*/
+		bool open(const std::string filename)
+		{
+			close();
+#ifdef _WIN32
+			fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (fileHandle == INVALID_HANDLE_VALUE)
+			{
+				std::cout << "ERROR::PARSER::FILE_NOT_SUCCESFULLY_MAPPED: " << filename << std::endl;
+				return false;
+			}
+			LARGE_INTEGER size;
+			GetFileSizeEx(fileHandle, &size);
+			fileSize = static_cast<size_t>(size.QuadPart);
+			if (fileSize == 0)
+				return true;
+			mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mappingHandle != NULL)
+				fileData = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+			int fd = ::open(filename.c_str(), O_RDONLY);
+			if (fd < 0)
+			{
+				std::cout << "ERROR::PARSER::FILE_NOT_SUCCESFULLY_MAPPED: " << filename << std::endl;
+				return false;
+			}
+			struct stat st;
+			fstat(fd, &st);
+			fileSize = static_cast<size_t>(st.st_size);
+			if (fileSize == 0)
+			{
+				::close(fd);
+				return true;
+			}
+			void * addr = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+			::close(fd);
+			if (addr != MAP_FAILED)
+			{
+				madvise(addr, fileSize, MADV_SEQUENTIAL);
+				fileData = static_cast<const char *>(addr);
+			}
+#endif
+			if (fileData == NULL)
+			{
+				std::cout << "ERROR::PARSER::FILE_NOT_SUCCESFULLY_MAPPED: " << filename << std::endl;
+				close();
+				return false;
+			}
+			return true;
+		}
+		/*!
+		*  \brief Unmaps the file (no-op if nothing is mapped)
+		*/
+		void close()
+		{
+#ifdef _WIN32
+			if (fileData != NULL)
+				UnmapViewOfFile(fileData);
+			if (mappingHandle != NULL)
+				CloseHandle(mappingHandle);
+			if (fileHandle != INVALID_HANDLE_VALUE)
+				CloseHandle(fileHandle);
+			fileHandle = INVALID_HANDLE_VALUE;
+			mappingHandle = NULL;
+#else
+			if (fileData != NULL)
+				munmap(const_cast<char *>(fileData), fileSize);
+#endif
+			fileData = NULL;
+			fileSize = 0;
+		}
+
+		/*!
+		*  \brief Returns the first byte of the mapping
+		*/
+		const char * begin() const { return fileData; }
+		/*!
+		*  \brief Returns one past the last byte of the mapping
+		*/
+		const char * end() const { return fileData + fileSize; }
+		/*!
+		*  \brief Returns the mapped size in bytes
+		*/
+		size_t size() const { return fileSize; }
+
+	private:
+		MappedFile(const MappedFile &);
+		MappedFile & operator=(const MappedFile &);
+
+		//! mapped bytes and their count
+		const char * fileData;
+		size_t fileSize;
+#ifdef _WIN32
+		//! OS handles kept alive for the lifetime of the mapping
+		HANDLE fileHandle, mappingHandle;
+#endif
+	};
+
+
+	/*!
+	*  \brief Token: \n
+	*		[begin, end) span inside a buffer: a word that is never copied
+	*/
+	struct Token
+	{
+		const char * begin; /**< first char of the word */
+		const char * end; /**< one past the last char of the word */
+
+		/*!
+		*  \brief Returns the word's length
+		*/
+		size_t size() const { return static_cast<size_t>(end - begin); }
+		/*!
+		*  \brief Compares the word with a null-terminated string
+		*/
+		bool equals(const char * word) const
+		{
+			const char * c = begin;
+			for (; c < end && *word != '\0'; ++c, ++word)
+				if (*c != *word)
+					return false;
+			return c == end && *word == '\0';
+		}
+	};
+
+	/*!
+	*  \brief Skips blanks (space, tab, '\r') but stops on end of line
+	* \return pointer to the first non-blank char (or end)
+	*/
+	inline const char * skipBlanks(const char * c, const char * end)
+	{
+		while (c < end && (*c == ' ' || *c == '\t' || *c == '\r'))
+			++c;
+		return c;
+	}
+	/*!
+	*  \brief Skips the rest of the current line
+	* \return pointer to the first char of the next line (or end)
+	*/
+	inline const char * skipLine(const char * c, const char * end)
+	{
+		while (c < end && *c != '\n')
+			++c;
+		return c < end ? c + 1 : end;
+	}
+	/*!
+	*  \brief Reads the next word of the current line, in place
+	* \param Token * token : span of the word (empty if the line is over)
+	* \return pointer to the char following the word
+	*/
+	inline const char * readToken(const char * c, const char * end, Token * token)
+	{
+		c = skipBlanks(c, end);
+		token->begin = c;
+		while (c < end && *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n')
+			++c;
+		token->end = c;
+		return c;
+	}
+
+	/*!
+	*  \brief Scans a signed decimal integer
+	* \param int * value : scanned value (untouched if no digit was found)
+	* \return pointer to the char following the integer (input pointer if no digit was found)
+	*/
+	inline const char * scanInt(const char * c, const char * end, int * value)
+	{
+		const char * start = c;
+		bool negative = false;
+		if (c < end && (*c == '-' || *c == '+'))
+		{
+			negative = (*c == '-');
+			++c;
+		}
+		if (c == end || *c < '0' || *c > '9')
+			return start;
+		int result = 0;
+		while (c < end && *c >= '0' && *c <= '9')
+		{
+			result = result * 10 + (*c - '0');
+			++c;
+		}
+		*value = negative ? -result : result;
+		return c;
+	}
+
+	/*!
+	*  \brief Scans a decimal floating point number ([+-]digits[.digits][(e|E)[+-]digits]) \n
+	*		Up to 19 significant digits are accumulated in a 64 bits integer, then scaled once by a power of ten. \n
+	*		This is exact enough for mesh data and does not go through the locale-aware strtod.
+	* \param float * value : scanned value (untouched if no digit was found)
+	* \return pointer to the char following the number (input pointer if no digit was found)
+	*/
+	inline const char * scanFloat(const char * c, const char * end, float * value)
+	{
+		static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		const char * start = c;
+		bool negative = false;
+		if (c < end && (*c == '-' || *c == '+'))
+		{
+			negative = (*c == '-');
+			++c;
+		}
+
+		unsigned long long mantissa = 0;
+		int exponent = 0, significant = 0;
+		bool anyDigit = false;
+		// integer part
+		for (; c < end && *c >= '0' && *c <= '9'; ++c)
+		{
+			anyDigit = true;
+			if (significant < 19)
+			{
+				mantissa = mantissa * 10 + static_cast<unsigned>(*c - '0');
+				if (mantissa != 0)
+					++significant;
+			}
+			else
+				++exponent;
+		}
+		// fractional part
+		if (c < end && *c == '.')
+		{
+			for (++c; c < end && *c >= '0' && *c <= '9'; ++c)
+			{
+				anyDigit = true;
+				if (significant < 19)
+				{
+					mantissa = mantissa * 10 + static_cast<unsigned>(*c - '0');
+					if (mantissa != 0)
+						++significant;
+					--exponent;
+				}
+			}
+		}
+		if (!anyDigit)
+			return start;
+		// exponent
+		if (c < end && (*c == 'e' || *c == 'E'))
+		{
+			int e = 0;
+			const char * next = scanInt(c + 1, end, &e);
+			if (next != c + 1)
+			{
+				exponent += e;
+				c = next;
+			}
+		}
+
+		double result = static_cast<double>(mantissa);
+		while (exponent > 22) { result *= 1e22; exponent -= 22; }
+		while (exponent < -22) { result /= 1e22; exponent += 22; }
+		result = exponent < 0 ? result / POW10[-exponent] : result * POW10[exponent];
+
+		*value = static_cast<float>(negative ? -result : result);
+		return c;
+	}
+
+
+	/*!
+	*  \brief OBJCorner: \n
+	*		One corner of a triangle, as indices into the OBJData arrays (0-based, already resolved) \n
+	*		-1 denotes a missing attribute (ex: "f 1//1 2//2 3//3" has no texture coordinates)
+	*/
+	struct OBJCorner
+	{
+		int position; /**< index into OBJData::positions */
+		int uv; /**< index into OBJData::uvs, -1 if absent */
+		int normal; /**< index into OBJData::normals, -1 if absent */
+	};
+
+	/*!
+	*  \brief OBJData: \n
+	*		Raw content of an .obj file \n
+	*		Polygons are fan-triangulated: three consecutive corners make up a face
+	*/
+	struct OBJData
+	{
+		std::vector<glm::vec3> positions; /**< "v" records */
+		std::vector<glm::vec3> normals; /**< "vn" records */
+		std::vector<glm::vec2> uvs; /**< "vt" records */
+		std::vector<OBJCorner> corners; /**< "f" records, triangulated */
+	};
+
+	/*!
+	*  \brief Resolves a 1-based (or negative, relative) .obj index into a 0-based one
+	* \param int index : index as written in the file
+	* \param size_t count : number of records of that kind read so far
+	* \return 0-based index, -1 if absent or invalid
+	*/
+	inline int resolveOBJIndex(int index, size_t count)
+	{
+		if (index > 0)
+			return index - 1;
+		if (index < 0)
+			return static_cast<int>(count) + index;
+		return -1;
+	}
+
+	/*!
+	*  \brief Scans one "v/vt/vn" face corner
+	* \return pointer to the char following the corner
+	*/
+	inline const char * scanOBJCorner(const char * c, const char * end, int * v, int * vt, int * vn)
+	{
+		*v = 0; *vt = 0; *vn = 0;
+		c = scanInt(c, end, v);
+		if (c < end && *c == '/')
+		{
+			c = scanInt(c + 1, end, vt);
+			if (c < end && *c == '/')
+				c = scanInt(c + 1, end, vn);
+		}
+		return c;
+	}
+
+	/*!
+	*  \brief OBJCounts: \n
+	*		Number of records of each kind in a range of an .obj file \n
+	*		Also used as a write cursor: index of the next record of each kind in OBJData
+	*/
+	struct OBJCounts
+	{
+		size_t positions; /**< "v" records */
+		size_t normals; /**< "vn" records */
+		size_t uvs; /**< "vt" records */
+		size_t corners; /**< triangle corners generated by "f" records */
+
+		OBJCounts() : positions(0), normals(0), uvs(0), corners(0) {}
+	};
+
+	/*!
+	*  \brief .obj record kinds handled by the parser
+	*/
+	enum OBJRecord { OBJ_OTHER, OBJ_POSITION, OBJ_NORMAL, OBJ_UV, OBJ_FACE };
+
+	/*!
+	*  \brief Identifies the record starting at c (c must point to the first non-blank char of a line)
+	* \param const char ** data : set to the first char following the record tag
+	* \return kind of record
+	*/
+	inline OBJRecord readOBJRecord(const char * c, const char * end, const char ** data)
+	{
+		*data = c;
+		if (c + 1 >= end)
+			return OBJ_OTHER;
+		if (c[0] == 'v')
+		{
+			if (c[1] == ' ' || c[1] == '\t')
+			{
+				*data = c + 1;
+				return OBJ_POSITION;
+			}
+			if (c + 2 < end && (c[2] == ' ' || c[2] == '\t'))
+			{
+				*data = c + 2;
+				if (c[1] == 'n')
+					return OBJ_NORMAL;
+				if (c[1] == 't')
+					return OBJ_UV;
+			}
+		}
+		else if (c[0] == 'f' && (c[1] == ' ' || c[1] == '\t'))
+		{
+			*data = c + 1;
+			return OBJ_FACE;
+		}
+		return OBJ_OTHER;
+	}
+
+	/*!
+	*  \brief Counts .obj records in a range, without storing them \n
+	*		Faces are scanned exactly as parseOBJRange does, so both always agree on the number of corners
+	*
+	* \param const char * begin : first char of the range (must start a line)
+	* \param const char * end : one past the last char of the range
+	* \return record counts of the range
+	*/
+	inline OBJCounts countOBJ(const char * begin, const char * end)
+	{
+		OBJCounts counts;
+		const char * c = begin;
+		while (c < end)
+		{
+			c = skipBlanks(c, end);
+			const char * data;
+			switch (readOBJRecord(c, end, &data))
+			{
+			case OBJ_POSITION: ++counts.positions; break;
+			case OBJ_NORMAL: ++counts.normals; break;
+			case OBJ_UV: ++counts.uvs; break;
+			case OBJ_FACE:
+			{
+				size_t corner = 0;
+				c = data;
+				while (true)
+				{
+					c = skipBlanks(c, end);
+					if (c == end || *c == '\n' || *c == '#')
+						break;
+					int v, vt, vn;
+					const char * next = scanOBJCorner(c, end, &v, &vt, &vn);
+					if (next == c)
+						break;
+					c = next;
+					++corner;
+				}
+				if (corner >= 3)
+					counts.corners += 3 * (corner - 2);
+				break;
+			}
+			default: break;
+			}
+			c = skipLine(c, end);
+		}
+		return counts;
+	}
+
+	/*!
+	*  \brief Parses .obj records (v, vn, vt, f) from a range into pre-sized OBJData arrays \n
+	*		Records are written starting at the input cursor, which also gives the number of records preceding the range \n
+	*		(needed to resolve negative, relative, face indices)
+	*
+	* \param const char * begin : first char of the range (must start a line)
+	* \param const char * end : one past the last char of the range
+	* \param OBJData * data : arrays already sized to hold the whole file (cf countOBJ)
+	* \param OBJCounts cursor : index of the first record of each kind of the range
+	* \return writes all records of the range in data
+	*/
+	inline void parseOBJRange(const char * begin, const char * end, OBJData * data, OBJCounts cursor)
+	{
+		const char * c = begin;
+		while (c < end)
+		{
+			c = skipBlanks(c, end);
+			const char * record;
+			switch (readOBJRecord(c, end, &record))
+			{
+			case OBJ_POSITION:
+			{
+				glm::vec3 & p = data->positions[cursor.positions++];
+				p = glm::vec3(0.0f);
+				c = skipBlanks(scanFloat(skipBlanks(record, end), end, &p.x), end);
+				c = skipBlanks(scanFloat(c, end, &p.y), end);
+				c = scanFloat(c, end, &p.z);
+				break;
+			}
+			case OBJ_NORMAL:
+			{
+				glm::vec3 & n = data->normals[cursor.normals++];
+				n = glm::vec3(0.0f);
+				c = skipBlanks(scanFloat(skipBlanks(record, end), end, &n.x), end);
+				c = skipBlanks(scanFloat(c, end, &n.y), end);
+				c = scanFloat(c, end, &n.z);
+				break;
+			}
+			case OBJ_UV:
+			{
+				glm::vec2 & t = data->uvs[cursor.uvs++];
+				t = glm::vec2(0.0f);
+				c = skipBlanks(scanFloat(skipBlanks(record, end), end, &t.x), end);
+				c = scanFloat(c, end, &t.y);
+				break;
+			}
+			case OBJ_FACE:
+			{
+				OBJCorner first, previous, current;
+				int corner = 0;
+				c = record;
+				while (true)
+				{
+					c = skipBlanks(c, end);
+					if (c == end || *c == '\n' || *c == '#')
+						break;
+
+					int v, vt, vn;
+					const char * next = scanOBJCorner(c, end, &v, &vt, &vn);
+					if (next == c)
+						break; // malformed corner, skip the rest of the line
+
+					c = next;
+					current.position = resolveOBJIndex(v, cursor.positions);
+					current.uv = resolveOBJIndex(vt, cursor.uvs);
+					current.normal = resolveOBJIndex(vn, cursor.normals);
+
+					if (corner == 0)
+						first = current;
+					else if (corner >= 2)
+					{
+						data->corners[cursor.corners++] = first;
+						data->corners[cursor.corners++] = previous;
+						data->corners[cursor.corners++] = current;
+					}
+					previous = current;
+					++corner;
+				}
+				break;
+			}
+			default: break;
+			}
+			c = skipLine(c, end);
+		}
+	}
+
+	/*!
+	*  \brief Parses .obj records (v, vn, vt, f) from an in-memory range \n
+	*		Every other record (comments, o, g, s, usemtl, mtllib...) is skipped \n
+	*		Faces with more than 3 corners are fan-triangulated \n
+	*		Records are counted first, so every output array is allocated exactly once
+	*
+	* \param const char * begin : first char of the .obj text
+	* \param const char * end : one past the last char of the .obj text
+	* \param OBJData * data : parsed records are appended to data
+	* \return appends all records to data
+	*/
+	inline void parseOBJ(const char * begin, const char * end, OBJData * data)
+	{
+		OBJCounts counts = countOBJ(begin, end);
+
+		OBJCounts cursor;
+		cursor.positions = data->positions.size();
+		cursor.normals = data->normals.size();
+		cursor.uvs = data->uvs.size();
+		cursor.corners = data->corners.size();
+
+		data->positions.resize(cursor.positions + counts.positions);
+		data->normals.resize(cursor.normals + counts.normals);
+		data->uvs.resize(cursor.uvs + counts.uvs);
+		data->corners.resize(cursor.corners + counts.corners);
+
+		parseOBJRange(begin, end, data, cursor);
+	}
+
+	/*!
+	*  \brief Runs f(i) for every i in [0, count) on nbThreads threads (the calling thread takes the first share)
+	* \param size_t count : number of iterations
+	* \param unsigned int nbThreads : number of threads (0 => std::thread::hardware_concurrency())
+	* \param F f : callable taking (size_t begin, size_t end), called once per thread on a contiguous sub-range
+	*/
+	template <typename F>
+	void parallelRanges(size_t count, unsigned int nbThreads, F f)
+	{
+		if (nbThreads == 0)
+			nbThreads = std::max(1u, std::thread::hardware_concurrency());
+		nbThreads = static_cast<unsigned int>(std::min<size_t>(nbThreads, std::max<size_t>(count, 1)));
+
+		std::vector<std::thread> workers;
+		const size_t share = (count + nbThreads - 1) / nbThreads;
+		for (unsigned int t = 1; t < nbThreads; ++t)
+		{
+			size_t first = std::min(count, t * share), last = std::min(count, (t + 1) * share);
+			workers.push_back(std::thread(f, first, last));
+		}
+		f(static_cast<size_t>(0), std::min(count, share));
+		for (size_t t = 0; t < workers.size(); ++t)
+			workers[t].join();
+	}
+
+	/*!
+	*  \brief Multithreaded parseOBJ: \n
+	*			-# the range is cut in nbThreads chunks, each chunk boundary is moved to the next line start
+	*			-# every worker counts the records of its chunk (countOBJ)
+	*			-# an exclusive prefix sum over the chunk counts gives every chunk its write cursor, the arrays are sized once
+	*			-# every worker parses its chunk straight into its slice of the arrays (parseOBJRange) \n
+	*		Since each chunk knows how many records precede it, relative face indices resolve exactly as in a sequential parse
+	*
+	* \param const char * begin : first char of the .obj text
+	* \param const char * end : one past the last char of the .obj text
+	* \param OBJData * data : parsed records are appended to data
+	* \param unsigned int nbThreads : number of threads (0 => std::thread::hardware_concurrency())
+	* \return appends all records to data, in file order
+	*/
+	inline void parseOBJParallel(const char * begin, const char * end, OBJData * data, unsigned int nbThreads = 0)
+	{
+		if (nbThreads == 0)
+			nbThreads = std::max(1u, std::thread::hardware_concurrency());
+
+		// 1. chunks, cut at line boundaries
+		const size_t size = static_cast<size_t>(end - begin);
+		std::vector<const char *> bounds(1, begin);
+		for (unsigned int t = 1; t < nbThreads; ++t)
+		{
+			const char * cut = begin + size * t / nbThreads;
+			if (cut < bounds.back())
+				cut = bounds.back();
+			while (cut > begin && cut < end && cut[-1] != '\n')
+				++cut;
+			bounds.push_back(cut);
+		}
+		bounds.push_back(end);
+		const size_t nbChunks = bounds.size() - 1;
+
+		// 2. count records per chunk
+		std::vector<OBJCounts> counts(nbChunks);
+		parallelRanges(nbChunks, nbThreads, [&](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; ++i)
+				counts[i] = countOBJ(bounds[i], bounds[i + 1]);
+		});
+
+		// 3. exclusive prefix sum => write cursor of every chunk
+		std::vector<OBJCounts> cursors(nbChunks);
+		OBJCounts total;
+		total.positions = data->positions.size();
+		total.normals = data->normals.size();
+		total.uvs = data->uvs.size();
+		total.corners = data->corners.size();
+		for (size_t i = 0; i < nbChunks; ++i)
+		{
+			cursors[i] = total;
+			total.positions += counts[i].positions;
+			total.normals += counts[i].normals;
+			total.uvs += counts[i].uvs;
+			total.corners += counts[i].corners;
+		}
+		data->positions.resize(total.positions);
+		data->normals.resize(total.normals);
+		data->uvs.resize(total.uvs);
+		data->corners.resize(total.corners);
+
+		// 4. parse every chunk in its own slice
+		parallelRanges(nbChunks, nbThreads, [&](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; ++i)
+				parseOBJRange(bounds[i], bounds[i + 1], data, cursors[i]);
+		});
+	}
+
+	/*!
+	*  \brief Files smaller than this are parsed on the calling thread: spawning workers would cost more than it saves
+	*/
+	const size_t PARALLEL_PARSE_MIN_SIZE = 1 << 20; // 1 MB
+
+	/*!
+	*  \brief Maps an .obj file and parses it in place (cf parseOBJ and parseOBJParallel)
+	*
+	* \param const std::string filename : .obj file see <https://en.wikipedia.org/wiki/Wavefront_.obj_file>
+	* \param OBJData * data : parsed records
+	* \param unsigned int nbThreads : number of parsing threads (0 => one per core, 1 => sequential). Small files are always parsed sequentially
+	* \return true if the file could be mapped
+	*/
+	inline bool loadOBJ(const std::string filename, OBJData * data, unsigned int nbThreads = 0)
+	{
+		MappedFile file;
+		if (!file.open(filename))
+			return false;
+
+		if (nbThreads == 1 || file.size() < PARALLEL_PARSE_MIN_SIZE)
+			parseOBJ(file.begin(), file.end(), data);
+		else
+			parseOBJParallel(file.begin(), file.end(), data, nbThreads);
+		return true;
+	}
 }
 
 /*@}*/
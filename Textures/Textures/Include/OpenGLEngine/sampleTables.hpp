@@ -0,0 +1,389 @@
+#ifndef SAMPLETABLES_HPP
+#define SAMPLETABLES_HPP
+
+
+
+////////////////////////
+// GLEW
+////////////////////////
+#include <GL/glew.h>
+
+////////////////////////
+// STL
+////////////////////////
+#include <cstddef>
+#include <cmath>
+#include <unordered_map>
+
+////////////////////////
+// CUSTOM
+////////////////////////
+#include "shaderInterface.hpp"
+
+namespace OpenGLEngine
+{
+
+/**
+* \file sampleTables.hpp
+* \author Alexandre Ribard
+* \date Feb 2016
+*/
+
+/** @addtogroup SHADER */
+/*@{*/
+
+
+/*!
+*  \brief Low-discrepancy point sets, generated once, on first use: \n
+*		- hammersley: (i/N, radical inverse of i), the IBL importance sampling set (pbr.frag, envMapConvol.frag, brdfLUT.frag) \n
+*		- sobol: first two Sobol dimensions, any prefix of the set is well distributed (unlike Hammersley, whose first \n
+*		  coordinate needs the whole set) \n
+*		- blueNoise: Mitchell's best candidate points, the first n of them evenly spread for every n \n
+*		- ssaoKernel: the SSAO hemisphere kernels of SSAO_MIN_KERNEL, 2 * SSAO_MIN_KERNEL, ... SSAO_MAX_KERNEL samples, one after the other \n
+*
+*		Point set records are (u, v, cos(2 pi u), sin(2 pi u)): the GGX importance sampling angle comes with the point, \n
+*		shaders do no bit reversal nor trigonometry per sample. Kernel records are (x, y, z, 0). \n
+*		The sets are constants: every run (and every frame) samples the same points, cf SampleTables for their upload. \n
+*
+*	\note the generators are plain functions (the v120 toolset has no constexpr, and C++14 loops in constexpr functions \n
+*		need VS2017): the static_asserts on the sequences are only compiled where relaxed constexpr is available
+*
+*	\code{.cpp}
+*		const lowDiscrepancy::Sample & Xi = lowDiscrepancy::hammersley()[i];
+*	\endcode
+*/
+#if (defined(_MSC_VER) && _MSC_VER >= 1910) || (!defined(_MSC_VER) && __cplusplus >= 201402L)
+#define LOW_DISCREPANCY_CONSTEXPR constexpr
+#define LOW_DISCREPANCY_STATIC_CHECKS
+#else
+#define LOW_DISCREPANCY_CONSTEXPR inline
+#endif
+
+namespace lowDiscrepancy
+{
+	const size_t HAMMERSLEY_SIZE = 1024; /**< samples per IBL integral */
+	const size_t SOBOL_SIZE = 1024;
+	const size_t BLUE_NOISE_SIZE = 64;
+	const size_t SSAO_MIN_KERNEL = 8; /**< smallest SSAO kernel (the kernel of n samples starts at record n - SSAO_MIN_KERNEL) */
+	const size_t SSAO_MAX_KERNEL = 32; /**< largest SSAO kernel */
+	const size_t SSAO_KERNEL_SIZE = 2 * SSAO_MAX_KERNEL - SSAO_MIN_KERNEL; /**< records of every kernel (8 + 16 + 32) */
+
+	/*!
+	*  \brief One record of a set: a vec4 of the std140 arrays the shaders read
+	*/
+	struct Sample
+	{
+		float x, y, z, w;
+	};
+
+	/*!
+	*  \brief A set of N records
+	*/
+	template <size_t N>
+	struct SampleSet
+	{
+		Sample samples[N];
+
+		const Sample & operator[](size_t i) const
+		{
+			return samples[i];
+		}
+		static size_t size()
+		{
+			return N;
+		}
+	};
+
+
+	///////////////////////////////////////////
+	//	SEQUENCES
+	///////////////////////////////////////////
+	const double PI = 3.14159265358979323846;
+
+	/*!
+	*  \brief Radical inverse of i in a base: its digits mirrored around the decimal point (0.5, 0.25, 0.75... in base 2)
+	*/
+	LOW_DISCREPANCY_CONSTEXPR double radicalInverse(unsigned int base, unsigned int i)
+	{
+		double inverse = 0.0, digit = 1.0 / base;
+		for (; i != 0; i /= base, digit /= base)
+			inverse += (i % base) * digit;
+		return inverse;
+	}
+	/*!
+	*  \brief Second Sobol dimension (direction numbers of x + 1: v_k = v_k-1 ^ (v_k-1 >> 1)), in [0, 1)
+	*/
+	LOW_DISCREPANCY_CONSTEXPR double sobolY(unsigned int i)
+	{
+		unsigned int direction = 1u << 31, y = 0;
+		for (; i != 0; i >>= 1, direction ^= direction >> 1)
+			if (i & 1u)
+				y ^= direction;
+		return y / 4294967296.0;
+	}
+
+	/*!
+	*  \brief Record of a 2D point: (u, v, cos(2 pi u), sin(2 pi u))
+	*/
+	inline Sample point(double u, double v)
+	{
+		const Sample sample = { static_cast<float>(u), static_cast<float>(v), static_cast<float>(std::cos(2.0 * PI * u)), static_cast<float>(std::sin(2.0 * PI * u)) };
+		return sample;
+	}
+
+
+	///////////////////////////////////////////
+	//	GENERATORS
+	///////////////////////////////////////////
+	inline SampleSet<HAMMERSLEY_SIZE> makeHammersley()
+	{
+		SampleSet<HAMMERSLEY_SIZE> set;
+		for (unsigned int i = 0; i < HAMMERSLEY_SIZE; ++i)
+			set.samples[i] = point(static_cast<double>(i) / HAMMERSLEY_SIZE, radicalInverse(2, i));
+		return set;
+	}
+
+	inline SampleSet<SOBOL_SIZE> makeSobol()
+	{
+		SampleSet<SOBOL_SIZE> set;
+		for (unsigned int i = 0; i < SOBOL_SIZE; ++i)
+			set.samples[i] = point(radicalInverse(2, i), sobolY(i));
+		return set;
+	}
+
+	/*!
+	*  \brief Best candidate points: each point is the candidate farthest from the previous ones (toroidal distance), \n
+	*		candidates drawn from a fixed seed (PCG multiplier), up to 16 per point
+	*/
+	inline SampleSet<BLUE_NOISE_SIZE> makeBlueNoise()
+	{
+		SampleSet<BLUE_NOISE_SIZE> set;
+		unsigned long long state = 0x853c49e6748fea9bull;
+		double xs[BLUE_NOISE_SIZE] = { 0.0 }, ys[BLUE_NOISE_SIZE] = { 0.0 };
+		for (size_t k = 0; k < BLUE_NOISE_SIZE; ++k)
+		{
+			const size_t nbCandidates = k < 15 ? k + 1 : 16;
+			double bestDistance = -1.0;
+			for (size_t c = 0; c < nbCandidates; ++c)
+			{
+				double candidate[2] = { 0.0, 0.0 };
+				for (int d = 0; d < 2; ++d)
+				{
+					state = state * 6364136223846793005ull + 1442695040888963407ull;
+					candidate[d] = static_cast<double>(state >> 40) / 16777216.0;
+				}
+
+				double distance = 2.0;
+				for (size_t p = 0; p < k; ++p)
+				{
+					double dx = candidate[0] > xs[p] ? candidate[0] - xs[p] : xs[p] - candidate[0];
+					double dy = candidate[1] > ys[p] ? candidate[1] - ys[p] : ys[p] - candidate[1];
+					dx = dx < 0.5 ? dx : 1.0 - dx;
+					dy = dy < 0.5 ? dy : 1.0 - dy;
+					distance = dx * dx + dy * dy < distance ? dx * dx + dy * dy : distance;
+				}
+				if (distance > bestDistance)
+				{
+					bestDistance = distance;
+					xs[k] = candidate[0];
+					ys[k] = candidate[1];
+				}
+			}
+			set.samples[k] = point(xs[k], ys[k]);
+		}
+		return set;
+	}
+
+	/*!
+	*  \brief SSAO hemisphere kernels (z up), one per size from SSAO_MIN_KERNEL to SSAO_MAX_KERNEL (doubling): \n
+	*		direction: cosine weighted, from the Sobol points; length: radical inverse in base 3, \n
+	*		scaled by lerp(0.1, 1.0, (i / n)^2) so that samples gather near the fragment (as the former random kernel)
+	*/
+	inline SampleSet<SSAO_KERNEL_SIZE> makeSSAOKernels()
+	{
+		SampleSet<SSAO_KERNEL_SIZE> set;
+		for (size_t n = SSAO_MIN_KERNEL; n <= SSAO_MAX_KERNEL; n *= 2)
+			for (unsigned int i = 0; i < n; ++i)
+			{
+				const double u = radicalInverse(2, i), v = sobolY(i);
+				const double r = std::sqrt(v);
+				const double t = static_cast<double>(i) / n;
+				const double length = radicalInverse(3, i + 1) * (0.1 + 0.9 * t * t);
+				const Sample sample = { static_cast<float>(length * r * std::cos(2.0 * PI * u)),
+					static_cast<float>(length * r * std::sin(2.0 * PI * u)), static_cast<float>(length * std::sqrt(1.0 - v)), 0.0f };
+				set.samples[n - SSAO_MIN_KERNEL + i] = sample;
+			}
+		return set;
+	}
+
+#ifdef LOW_DISCREPANCY_STATIC_CHECKS
+	static_assert(radicalInverse(2, 1) == 0.5 && radicalInverse(2, 6) == 0.375 && radicalInverse(3, 1) == 1.0 / 3.0, "radical inverse");
+	static_assert(sobolY(1) == 0.5 && sobolY(2) == 0.75 && sobolY(3) == 0.25 && sobolY(4) == 0.625, "Sobol direction numbers");
+#endif
+	static_assert(sizeof(SampleSet<HAMMERSLEY_SIZE>) == HAMMERSLEY_SIZE * 4 * sizeof(float), "records are std140 vec4");
+
+
+	///////////////////////////////////////////
+	//	SETS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Returns the sets (generated by the first call, from the GL thread: SampleTables upload)
+	*/
+	inline const SampleSet<HAMMERSLEY_SIZE> & hammersley()
+	{
+		static const SampleSet<HAMMERSLEY_SIZE> set = makeHammersley();
+		return set;
+	}
+	inline const SampleSet<SOBOL_SIZE> & sobol()
+	{
+		static const SampleSet<SOBOL_SIZE> set = makeSobol();
+		return set;
+	}
+	inline const SampleSet<BLUE_NOISE_SIZE> & blueNoise()
+	{
+		static const SampleSet<BLUE_NOISE_SIZE> set = makeBlueNoise();
+		return set;
+	}
+	inline const SampleSet<SSAO_KERNEL_SIZE> & ssaoKernel()
+	{
+		static const SampleSet<SSAO_KERNEL_SIZE> set = makeSSAOKernels();
+		return set;
+	}
+}
+
+
+/*!
+*  \brief Sample Tables: \n
+*		the lowDiscrepancy sets in one uniform buffer, uploaded once (GL_STATIC_DRAW) and shared by every program. \n
+*		Each set is a std140 block of its own, bound by range to a fixed binding point: \n
+*			- layout (std140) uniform HammersleyTable { vec4 hammersley[1024]; }; => HAMMERSLEY_BINDING \n
+*			- layout (std140) uniform SobolTable { vec4 sobol[1024]; }; => SOBOL_BINDING \n
+*			- layout (std140) uniform BlueNoiseTable { vec4 blueNoise[64]; }; => BLUE_NOISE_BINDING \n
+*			- layout (std140) uniform SSAOKernel { vec4 ssaoKernel[56]; }; => SSAO_KERNEL_BINDING \n
+*
+*		Programs are bound to the blocks they declare once (bindProgram). UniformBlocks::bindProgram does it for every \n
+*		program drawn by the SceneRenderer (or linked through SceneRenderer::linkUniformBlocks): other programs call it themselves.
+*
+*	\code{.cpp}
+*		// envMapConvol.frag: vec4 Xi = hammersley[i]; H.x = sinTheta * Xi.z; H.y = sinTheta * Xi.w; ...
+*		envMapConvolShader.Use();
+*		SampleTables::get().bindProgram(&envMapConvolShader);
+*	\endcode
+*
+*	\note the buffer lives as long as the context (the tables are the same for every program)
+*/
+class SampleTables
+{
+public:
+	//! binding points of the blocks (0 and 1 are the UniformBlocks, 2 the CompiledMaterial)
+	static const GLuint HAMMERSLEY_BINDING = 3;
+	static const GLuint SOBOL_BINDING = 4;
+	static const GLuint BLUE_NOISE_BINDING = 5;
+	static const GLuint SSAO_KERNEL_BINDING = 6;
+
+	/*!
+	*  \brief Returns the tables of the context
+	*/
+	static SampleTables & get()
+	{
+		static SampleTables tables;
+		return tables;
+	}
+
+
+	///////////////////////////////////////////
+	//	GETTERS
+	///////////////////////////////////////////
+	/*!
+	*  \brief Returns the uniform buffer (0 until the first program declaring a table is bound)
+	*/
+	GLuint getBuffer() const
+	{
+		return buffer;
+	}
+
+
+	///////////////////////////////////////////
+	//	UTILITY
+	///////////////////////////////////////////
+	/*!
+	*  \brief Binds the table blocks a program declares to their binding points (looked up once per program), \n
+	*		uploads the tables the first time
+	* \param Shader * shader : linked program
+	* \return true if the program reads a table
+	*/
+	bool bindProgram(Shader * shader)
+	{
+		std::unordered_map<GLuint, bool>::const_iterator known = programs.find(shader->Program);
+		if (known != programs.end())
+			return known->second;
+
+		const char * names[NB_TABLES] = { "HammersleyTable", "SobolTable", "BlueNoiseTable", "SSAOKernel" };
+		const GLuint bindings[NB_TABLES] = { HAMMERSLEY_BINDING, SOBOL_BINDING, BLUE_NOISE_BINDING, SSAO_KERNEL_BINDING };
+		bool readsTable = false;
+		for (int t = 0; t < NB_TABLES; ++t)
+		{
+			const GLuint blockIndex = glGetUniformBlockIndex(shader->Program, names[t]);
+			if (blockIndex == GL_INVALID_INDEX)
+				continue;
+			glUniformBlockBinding(shader->Program, blockIndex, bindings[t]);
+			readsTable = true;
+		}
+		if (readsTable)
+			upload();
+		return programs[shader->Program] = readsTable;
+	}
+
+	/*!
+	*  \brief Uploads the tables and binds each one to its binding point (once, then does nothing)
+	*/
+	void upload()
+	{
+		if (buffer != 0)
+			return;
+
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		const size_t align = alignment > 0 ? static_cast<size_t>(alignment) : 256;
+
+		const void * tables[NB_TABLES] = { &lowDiscrepancy::hammersley(), &lowDiscrepancy::sobol(), &lowDiscrepancy::blueNoise(), &lowDiscrepancy::ssaoKernel() };
+		const size_t sizes[NB_TABLES] = { sizeof(lowDiscrepancy::hammersley()), sizeof(lowDiscrepancy::sobol()),
+			sizeof(lowDiscrepancy::blueNoise()), sizeof(lowDiscrepancy::ssaoKernel()) };
+		const GLuint bindings[NB_TABLES] = { HAMMERSLEY_BINDING, SOBOL_BINDING, BLUE_NOISE_BINDING, SSAO_KERNEL_BINDING };
+		size_t offsets[NB_TABLES] = {};
+		size_t total = 0;
+		for (int t = 0; t < NB_TABLES; ++t)
+		{
+			offsets[t] = total;
+			total += (sizes[t] + align - 1) / align * align;
+		}
+
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(total), NULL, GL_STATIC_DRAW);
+		for (int t = 0; t < NB_TABLES; ++t)
+			glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(offsets[t]), static_cast<GLsizeiptr>(sizes[t]), tables[t]);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		for (int t = 0; t < NB_TABLES; ++t)
+			glBindBufferRange(GL_UNIFORM_BUFFER, bindings[t], buffer, static_cast<GLintptr>(offsets[t]), static_cast<GLsizeiptr>(sizes[t]));
+	}
+
+
+private:
+	static const int NB_TABLES = 4;
+
+	GLuint buffer = 0;
+	//! programs seen by bindProgram: whether they read a table
+	std::unordered_map<GLuint, bool> programs;
+
+	SampleTables()
+	{}
+	SampleTables(const SampleTables &);
+	SampleTables & operator=(const SampleTables &);
+};
+
+/*@}*/
+
+}
+
+#endif